@@ -0,0 +1,137 @@
+#include "Atom.h"
+#include "List.h"
+#include "Exception.h"
+#include <atomic>
+#include <mutex>
+
+namespace CoreLib
+{
+	namespace Basic
+	{
+		// The atoms are kept in blocks that are never moved or freed, so that they can be read without
+		// taking the lock that guards interning.
+		static const int AtomBlockBits = 12;
+		static const int AtomBlockSize = 1 << AtomBlockBits;
+		static const int MaxAtomBlocks = 1 << 14;
+
+		struct AtomEntry
+		{
+			String Text;
+			int HashCode;
+		};
+
+		class AtomTable
+		{
+		private:
+			std::mutex mutex;
+			std::atomic<AtomEntry*> blocks[MaxAtomBlocks];
+			int count = 0;
+			// open addressing over the hash of the text; a slot holds the id of an atom plus one, or 0 if empty
+			List<int> slots;
+
+			// the same hash as String::GetHashCode(), so that an atom can look up a String key
+			static int Hash(const char * buffer, int length)
+			{
+				int hash = 0;
+				for (int i = 0; i < length; i++)
+					hash = buffer[i] + (hash << 6) + (hash << 16) - hash;
+				return hash;
+			}
+			void Insert(int id)
+			{
+				int mask = slots.Count() - 1;
+				int i = Get(id).HashCode & mask;
+				while (slots[i])
+					i = (i + 1) & mask;
+				slots[i] = id + 1;
+			}
+		public:
+			AtomTable()
+			{
+				for (auto & block : blocks)
+					block.store(nullptr, std::memory_order_relaxed);
+				slots.SetSize(4096);
+				for (auto & slot : slots)
+					slot = 0;
+				Intern("", 0);
+			}
+			const AtomEntry & Get(int id)
+			{
+				return blocks[id >> AtomBlockBits].load(std::memory_order_acquire)[id & (AtomBlockSize - 1)];
+			}
+			int Intern(const char * buffer, int length)
+			{
+				int hash = Hash(buffer, length);
+				std::lock_guard<std::mutex> lock(mutex);
+				int mask = slots.Count() - 1;
+				for (int i = hash & mask; slots[i]; i = (i + 1) & mask)
+				{
+					int id = slots[i] - 1;
+					auto & entry = Get(id);
+					if (entry.HashCode == hash && entry.Text.Length() == length && memcmp(entry.Text.Buffer(), buffer, length) == 0)
+						return id;
+				}
+				int id = count;
+				int blockIndex = id >> AtomBlockBits;
+				if (blockIndex == MaxAtomBlocks)
+					throw InvalidOperationException("too many distinct atoms.");
+				AtomEntry * block = blocks[blockIndex].load(std::memory_order_relaxed);
+				if (!block)
+					block = new AtomEntry[AtomBlockSize];
+				RefPtr<char, RefPtrArrayDestructor> text = new char[length + 1];
+				memcpy(text.Ptr(), buffer, length);
+				text[length] = 0;
+				block[id & (AtomBlockSize - 1)].Text = String::FromBuffer(text, length);
+				block[id & (AtomBlockSize - 1)].HashCode = hash;
+				// publishes the text of the new atom to readers that got its id from another thread
+				blocks[blockIndex].store(block, std::memory_order_release);
+				count++;
+				if (count * 2 > slots.Count())
+				{
+					slots.SetSize(slots.Count() * 2);
+					for (auto & slot : slots)
+						slot = 0;
+					for (int i = 0; i < count; i++)
+						Insert(i);
+				}
+				else
+					Insert(id);
+				return id;
+			}
+		};
+
+		// never destroyed, as atoms may still be used by the destructors of other static objects
+		static AtomTable & GetAtomTable()
+		{
+			static AtomTable * table = new AtomTable();
+			return *table;
+		}
+
+		Atom::Atom(const String & str)
+		{
+			id = GetAtomTable().Intern(str.Buffer(), str.Length());
+		}
+
+		Atom::Atom(const char * str)
+		{
+			id = GetAtomTable().Intern(str, (int)strlen(str));
+		}
+
+		Atom Atom::FromBuffer(const char * buffer, int length)
+		{
+			Atom result;
+			result.id = GetAtomTable().Intern(buffer, length);
+			return result;
+		}
+
+		const String & Atom::ToString() const
+		{
+			return GetAtomTable().Get(id).Text;
+		}
+
+		int Atom::GetHashCode() const
+		{
+			return GetAtomTable().Get(id).HashCode;
+		}
+	}
+}
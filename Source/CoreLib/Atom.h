@@ -0,0 +1,72 @@
+#ifndef CORE_LIB_ATOM_H
+#define CORE_LIB_ATOM_H
+
+#include "LibString.h"
+
+namespace CoreLib
+{
+	namespace Basic
+	{
+		/*!
+		@brief An interned string. Every distinct text is stored once for the lifetime of the process and
+		is identified by a small integer, so atoms are copied and compared as integers. An atom hashes the
+		same as its text, so it can look up String keys. The table is shared by all threads.
+		*/
+		class Atom
+		{
+		private:
+			int id = 0; // 0 is the empty string
+		public:
+			Atom() = default;
+			Atom(const String & str);
+			Atom(const char * str);
+			// interns `length` characters at `buffer` without building a String first
+			static Atom FromBuffer(const char * buffer, int length);
+
+			const String & ToString() const;
+			operator const String & () const
+			{
+				return ToString();
+			}
+			const char * Buffer() const
+			{
+				return ToString().Buffer();
+			}
+			int Length() const
+			{
+				return ToString().Length();
+			}
+			int GetId() const
+			{
+				return id;
+			}
+			int GetHashCode() const;
+			bool operator == (const Atom & other) const
+			{
+				return id == other.id;
+			}
+			bool operator != (const Atom & other) const
+			{
+				return id != other.id;
+			}
+			bool operator == (const String & str) const
+			{
+				return ToString() == str;
+			}
+			bool operator != (const String & str) const
+			{
+				return ToString() != str;
+			}
+			bool operator == (const char * str) const
+			{
+				return ToString() == str;
+			}
+			bool operator != (const char * str) const
+			{
+				return ToString() != str;
+			}
+		};
+	}
+}
+
+#endif
@@ -4,6 +4,7 @@
 #include "Common.h"
 #include "LibMath.h"
 #include "LibString.h"
+#include "Atom.h"
 #include "Array.h"
 #include "List.h"
 #include "Link.h"
@@ -6,6 +6,14 @@
 #include <sys/stat.h>
 #ifdef _WIN32
 #include <direct.h>
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
 #endif
 namespace CoreLib
 {
@@ -31,6 +39,38 @@ namespace CoreLib
 #endif
 		}
 
+		bool File::Replace(const String & sourceFileName, const String & destFileName)
+		{
+#ifdef _WIN32
+			return MoveFileExW(sourceFileName.ToWString(), destFileName.ToWString(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+			return ::rename(sourceFileName.Buffer(), destFileName.Buffer()) == 0;
+#endif
+		}
+
+		bool File::GetStatus(const String & fileName, Int64 & lastWriteTime, Int64 & size)
+		{
+#ifdef _WIN32
+			WIN32_FILE_ATTRIBUTE_DATA data;
+			if (!GetFileAttributesExW(fileName.ToWString(), GetFileExInfoStandard, &data))
+				return false;
+			lastWriteTime = ((Int64)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+			size = ((Int64)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+#else
+			struct stat statVar;
+			if (::stat(fileName.Buffer(), &statVar) != 0)
+				return false;
+			// in nanoseconds, so that a file rewritten within the same second is still seen as modified
+#ifdef __APPLE__
+			lastWriteTime = (Int64)statVar.st_mtimespec.tv_sec * 1000000000 + statVar.st_mtimespec.tv_nsec;
+#else
+			lastWriteTime = (Int64)statVar.st_mtim.tv_sec * 1000000000 + statVar.st_mtim.tv_nsec;
+#endif
+			size = (Int64)statVar.st_size;
+#endif
+			return true;
+		}
+
 		String Path::TruncateExt(const String & path)
 		{
 			int dotPos = path.LastIndexOf('.');
@@ -105,6 +145,24 @@ namespace CoreLib
 			return sb.ProduceString();
 		}
 
+		String Path::GetCanonicalPath(const String & path)
+		{
+#ifdef _WIN32
+			wchar_t buffer[MAX_PATH];
+			DWORD length = GetFullPathNameW(path.ToWString(), MAX_PATH, buffer, nullptr);
+			if (length == 0 || length >= MAX_PATH)
+				return path;
+			return String::FromWString(buffer);
+#else
+			char * resolved = realpath(path.Buffer(), nullptr);
+			if (!resolved)
+				return path;
+			String rs(resolved);
+			free(resolved);
+			return rs;
+#endif
+		}
+
 		bool Path::CreateDir(const String & path)
 		{
 #if defined(_WIN32)
@@ -114,8 +172,161 @@ namespace CoreLib
 #endif
 		}
 
+		MemoryMappedFile::MemoryMappedFile(const CoreLib::Basic::String & fileName)
+		{
+#ifdef _WIN32
+			HANDLE file = CreateFileW(fileName.ToWString(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (file == INVALID_HANDLE_VALUE)
+				throw IOException("Cannot open file '" + fileName + "'");
+			LARGE_INTEGER fileSize;
+			if (!GetFileSizeEx(file, &fileSize))
+			{
+				CloseHandle(file);
+				throw IOException("Cannot read size of file '" + fileName + "'");
+			}
+			size = fileSize.QuadPart;
+			// an empty file cannot be mapped, and has no content to map either
+			if (size)
+			{
+				mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+				if (mapping)
+					buffer = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			}
+			CloseHandle(file);
+			if (size && !buffer)
+			{
+				if (mapping)
+					CloseHandle(mapping);
+				throw IOException("Cannot map file '" + fileName + "'");
+			}
+#else
+			int file = open(fileName.Buffer(), O_RDONLY);
+			if (file == -1)
+				throw IOException("Cannot open file '" + fileName + "'");
+			struct stat statVar;
+			if (fstat(file, &statVar) != 0)
+			{
+				close(file);
+				throw IOException("Cannot read size of file '" + fileName + "'");
+			}
+			size = statVar.st_size;
+			// an empty file cannot be mapped, and has no content to map either
+			if (size)
+			{
+				void * view = mmap(nullptr, (size_t)size, PROT_READ, MAP_PRIVATE, file, 0);
+				if (view != MAP_FAILED)
+					buffer = (const unsigned char*)view;
+			}
+			close(file);
+			if (size && !buffer)
+				throw IOException("Cannot map file '" + fileName + "'");
+#endif
+		}
+
+		MemoryMappedFile::~MemoryMappedFile()
+		{
+#ifdef _WIN32
+			if (buffer)
+				UnmapViewOfFile(buffer);
+			if (mapping)
+				CloseHandle(mapping);
+#else
+			if (buffer)
+				munmap((void*)buffer, (size_t)size);
+#endif
+		}
+
+		// Returns true if `text` is well-formed UTF-8 without zero bytes. StreamReader decodes such text into
+		// the same bytes, apart from line breaks; anything else may be in another encoding.
+		static bool IsPlainUTF8(const unsigned char * text, Int64 length)
+		{
+			Int64 i = 0;
+			while (i < length)
+			{
+				unsigned char ch = text[i];
+				if (ch < 0x80)
+				{
+					if (ch == 0)
+						return false;
+					i++;
+					continue;
+				}
+				int count;
+				unsigned char low = 0x80, high = 0xBF; // range of the second byte, which rules out overlong forms
+				if (ch >= 0xC2 && ch <= 0xDF)
+					count = 1;
+				else if (ch >= 0xE0 && ch <= 0xEF)
+				{
+					count = 2;
+					if (ch == 0xE0)
+						low = 0xA0;
+				}
+				else if (ch >= 0xF0 && ch <= 0xF4)
+				{
+					count = 3;
+					if (ch == 0xF0)
+						low = 0x90;
+					else if (ch == 0xF4)
+						high = 0x8F;
+				}
+				else
+					return false;
+				if (i + count >= length || text[i + 1] < low || text[i + 1] > high)
+					return false;
+				for (int j = 2; j <= count; j++)
+					if ((text[i + j] & 0xC0) != 0x80)
+						return false;
+				i += count + 1;
+			}
+			return true;
+		}
+
 		CoreLib::Basic::String File::ReadAllText(const CoreLib::Basic::String & fileName)
 		{
+			// UTF-8 text is copied straight out of a mapping of the file, turning "\r\n" and "\r" into "\n" on
+			// the way as StreamReader does; other encodings are decoded by StreamReader
+			try
+			{
+				MemoryMappedFile file(fileName);
+				auto text = file.GetBuffer();
+				Int64 length = file.GetSize();
+				if (length >= 3 && text[0] == 0xEF && text[1] == 0xBB && text[2] == 0xBF)
+				{
+					text += 3;
+					length -= 3;
+				}
+				if (length == 0)
+					return String();
+				if (length < (1 << 30) && IsPlainUTF8(text, length))
+				{
+					RefPtr<char, RefPtrArrayDestructor> buffer = new char[(int)length + 1];
+					int count = 0;
+					if (!memchr(text, '\r', (size_t)length))
+					{
+						memcpy(buffer.Ptr(), text, (size_t)length);
+						count = (int)length;
+					}
+					else
+					{
+						for (int i = 0; i < (int)length; i++)
+						{
+							if (text[i] == '\r')
+							{
+								buffer[count++] = '\n';
+								if (i + 1 < (int)length && text[i + 1] == '\n')
+									i++;
+							}
+							else
+								buffer[count++] = (char)text[i];
+						}
+					}
+					buffer[count] = 0;
+					return String::FromBuffer(buffer, count);
+				}
+			}
+			catch (IOException)
+			{
+			}
 			StreamReader reader(new FileStream(fileName, FileMode::Open, FileAccess::Read, FileShare::ReadWrite));
 			return reader.ReadToEnd();
 		}
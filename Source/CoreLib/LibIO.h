@@ -14,9 +14,39 @@ namespace CoreLib
 		{
 		public:
 			static bool Exists(const CoreLib::Basic::String & fileName);
+			// Retrieves the last modification time and the size in bytes of a file. Returns false if the file does not exist.
+			static bool GetStatus(const CoreLib::Basic::String & fileName, CoreLib::Int64 & lastWriteTime, CoreLib::Int64 & size);
 			static CoreLib::Basic::String ReadAllText(const CoreLib::Basic::String & fileName);
 			static CoreLib::Basic::List<unsigned char> ReadAllBytes(const CoreLib::Basic::String & fileName);
 			static void WriteAllText(const CoreLib::Basic::String & fileName, const CoreLib::Basic::String & text);
+			// Renames `sourceFileName` to `destFileName`, replacing the destination in one step if it exists, so that
+			// a reader finds either the old or the new file. Returns false if the file could not be renamed.
+			static bool Replace(const CoreLib::Basic::String & sourceFileName, const CoreLib::Basic::String & destFileName);
+		};
+
+		// A read-only view of the whole content of a file, mapped into memory instead of read into a buffer.
+		// The content stays valid until the object is destroyed.
+		class MemoryMappedFile
+		{
+		private:
+			const unsigned char * buffer = nullptr;
+			Int64 size = 0;
+#ifdef _WIN32
+			void * mapping = nullptr;
+#endif
+		public:
+			MemoryMappedFile(const CoreLib::Basic::String & fileName);
+			~MemoryMappedFile();
+			MemoryMappedFile(const MemoryMappedFile &) = delete;
+			MemoryMappedFile & operator = (const MemoryMappedFile &) = delete;
+			const unsigned char * GetBuffer() const
+			{
+				return buffer;
+			}
+			Int64 GetSize() const
+			{
+				return size;
+			}
 		};
 
 		class Path
@@ -35,6 +65,9 @@ namespace CoreLib
 			static String GetDirectoryName(const String & path);
 			static String Combine(const String & path1, const String & path2);
 			static String Combine(const String & path1, const String & path2, const String & path3);
+			// Returns the absolute path of an existing file with all relative components and links resolved,
+			// so that every path naming the file maps to the same string. Returns `path` unchanged if it cannot be resolved.
+			static String GetCanonicalPath(const String & path);
 			static bool CreateDir(const String & path);
 		};
 
@@ -38,7 +38,7 @@ inline int sprintf_s(char * buffer, size_t sizeOfBuffer, const char * format, ..
 {
 	va_list argptr;
 	va_start(argptr, format);
-	int rs = snprintf(buffer, sizeOfBuffer, format, argptr);
+	int rs = vsnprintf(buffer, sizeOfBuffer, format, argptr);
 	va_end(argptr);
 	return rs;
 }
@@ -47,7 +47,7 @@ inline int swprintf_s(wchar_t * buffer, size_t sizeOfBuffer, const wchar_t * for
 {
 	va_list argptr;
 	va_start(argptr, format);
-	int rs = swprintf(buffer, sizeOfBuffer, format, argptr);
+	int rs = vswprintf(buffer, sizeOfBuffer, format, argptr);
 	va_end(argptr);
 	return rs;
 }
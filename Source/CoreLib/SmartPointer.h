@@ -2,6 +2,7 @@
 #define FUNDAMENTAL_LIB_SMART_POINTER_H
 
 #include "TypeTraits.h"
+#include <atomic>
 
 namespace CoreLib
 {
@@ -27,17 +28,22 @@ namespace CoreLib
 			}
 		};
 
+		// Reference counts are atomic so that objects shared between compilation contexts (such as
+		// the standard library symbols) can be referenced from several threads at once.
 		class ReferenceCounted
 		{
 			template<typename T, bool b, typename Destructor>
 			friend class RefPtrImpl;
 		private:
-			int _refCount = 0;
+			std::atomic<int> _refCount{0};
 		public:
 			ReferenceCounted() {}
 			ReferenceCounted(const ReferenceCounted &)
 			{
-				_refCount = 0;
+			}
+			ReferenceCounted & operator = (const ReferenceCounted &)
+			{
+				return *this;
 			}
 		};
 
@@ -64,7 +70,7 @@ namespace CoreLib
 			friend class RefPtrImpl;
 		private:
 			T * pointer;
-			int * refCount;
+			std::atomic<int> * refCount;
 			
 		public:
 			RefPtrImpl()
@@ -143,8 +149,7 @@ namespace CoreLib
 					pointer = ptr;
 					if (ptr)
 					{
-						refCount = new int;
-						(*refCount) = 1;
+						refCount = new std::atomic<int>(1);
 					}
 					else
 						refCount = 0;
@@ -213,14 +218,8 @@ namespace CoreLib
 			{
 				if(pointer)
 				{
-					if((*refCount) > 1)
-					{
-						(*refCount)--;
-					}
-					else
-					{
+					if (refCount->fetch_sub(1) == 1)
 						delete refCount;
-					}
 				}
 				auto rs = pointer;
 				refCount = 0;
@@ -236,11 +235,7 @@ namespace CoreLib
 			{
 				if(pointer)
 				{
-					if((*refCount) > 1)
-					{
-						(*refCount)--;
-					}
-					else
+					if (refCount->fetch_sub(1) == 1)
 					{
 						Destructor destructor;
 						destructor(pointer);
@@ -422,11 +417,7 @@ namespace CoreLib
 			{
 				if (pointer)
 				{
-					if (pointer->_refCount > 1)
-					{
-						pointer->_refCount--;
-					}
-					else
+					if (pointer->_refCount.fetch_sub(1) == 1)
 					{
 						Destructor destructor;
 						destructor(pointer);
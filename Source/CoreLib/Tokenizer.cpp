@@ -1,5 +1,13 @@
 #include "Tokenizer.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CORELIB_TOKENIZER_SSE2
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
 using namespace CoreLib::Basic;
 
 namespace CoreLib
@@ -22,17 +30,94 @@ namespace CoreLib
 			None, Line, File
 		};
 
-		void ParseOperators(const String & str, List<Token> & tokens, TokenFlags& tokenFlags, int line, int col, int startPos, String fileName)
+		bool TokenizerFastScan = true;
+
+		// Scanning helpers used by TokenizeText to skip over runs of characters that do not change the state
+		// of the lexer. Each returns the index of the first character in [pos, end) that stops the run, or
+		// `end`. With SSE2 they look at 16 characters at a time; the scalar loops finish the tail of the text.
+#ifdef CORELIB_TOKENIZER_SSE2
+		static inline int FirstSetBit(unsigned int mask)
+		{
+#ifdef _MSC_VER
+			unsigned long index;
+			_BitScanForward(&index, mask);
+			return (int)index;
+#else
+			return __builtin_ctz(mask);
+#endif
+		}
+		// letters, digits and '_'; bytes >= 0x80 are negative and fail the signed range tests
+		static inline int IdentifierCharMask(__m128i block)
+		{
+			__m128i lower = _mm_or_si128(block, _mm_set1_epi8(0x20));
+			__m128i letter = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1)));
+			__m128i digit = _mm_and_si128(_mm_cmpgt_epi8(block, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(block, _mm_set1_epi8('9' + 1)));
+			__m128i underscore = _mm_cmpeq_epi8(block, _mm_set1_epi8('_'));
+			return _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(letter, digit), underscore));
+		}
+#endif
+
+		static int ScanIdentifier(const char * text, int pos, int end)
+		{
+#ifdef CORELIB_TOKENIZER_SSE2
+			for (; pos + 16 <= end; pos += 16)
+			{
+				int stop = ~IdentifierCharMask(_mm_loadu_si128((const __m128i*)(text + pos))) & 0xFFFF;
+				if (stop)
+					return pos + FirstSetBit(stop);
+			}
+#endif
+			while (pos < end && (IsLetter(text[pos]) || IsDigit(text[pos])))
+				pos++;
+			return pos;
+		}
+
+		// spaces and tabs; line breaks are left to the caller, which counts lines
+		static int ScanBlanks(const char * text, int pos, int end)
+		{
+#ifdef CORELIB_TOKENIZER_SSE2
+			for (; pos + 16 <= end; pos += 16)
+			{
+				__m128i block = _mm_loadu_si128((const __m128i*)(text + pos));
+				__m128i blank = _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(block, _mm_set1_epi8('\t')));
+				int stop = ~_mm_movemask_epi8(blank) & 0xFFFF;
+				if (stop)
+					return pos + FirstSetBit(stop);
+			}
+#endif
+			while (pos < end && (text[pos] == ' ' || text[pos] == '\t'))
+				pos++;
+			return pos;
+		}
+
+		// the first occurrence of `ch0` or `ch1`
+		static int ScanUntil(const char * text, int pos, int end, char ch0, char ch1)
+		{
+#ifdef CORELIB_TOKENIZER_SSE2
+			for (; pos + 16 <= end; pos += 16)
+			{
+				__m128i block = _mm_loadu_si128((const __m128i*)(text + pos));
+				int stop = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8(ch0)), _mm_cmpeq_epi8(block, _mm_set1_epi8(ch1))));
+				if (stop)
+					return pos + FirstSetBit(stop);
+			}
+#endif
+			while (pos < end && text[pos] != ch0 && text[pos] != ch1)
+				pos++;
+			return pos;
+		}
+
+		void ParseOperators(const char * str, int length, List<Token> & tokens, TokenFlags& tokenFlags, int line, int col, int startPos, Atom fileName)
 		{
 			int pos = 0;
-			while (pos < str.Length())
+			while (pos < length)
 			{
 				wchar_t curChar = str[pos];
-				wchar_t nextChar = (pos < str.Length() - 1) ? str[pos + 1] : '\0';
-				wchar_t nextNextChar = (pos < str.Length() - 2) ? str[pos + 2] : '\0';
-				auto InsertToken = [&](TokenType type, const String & ct)
+				wchar_t nextChar = (pos < length - 1) ? str[pos + 1] : '\0';
+				wchar_t nextNextChar = (pos < length - 2) ? str[pos + 2] : '\0';
+				auto InsertToken = [&](TokenType type, const char * ct)
 				{
-					tokens.Add(Token(type, ct, line, col + pos, pos + startPos, fileName, tokenFlags));
+					tokens.Add(Token(type, Atom::FromBuffer(ct, (int)strlen(ct)), line, col + pos, pos + startPos, fileName, tokenFlags));
                     tokenFlags = 0;
 				};
 				switch (curChar)
@@ -305,7 +390,7 @@ namespace CoreLib
 		{
 			int lastPos = 0, pos = 0;
 			int line = 1, col = 0;
-			String file = fileName;
+			Atom file = fileName;
 			State state = State::Start;
 			StringBuilder tokenBuilder;
 			int tokenLine, tokenCol;
@@ -315,10 +400,19 @@ namespace CoreLib
 			auto InsertToken = [&](TokenType type)
 			{
 				derivative = LexDerivative::None;
-				tokenList.Add(Token(type, tokenBuilder.ToString(), tokenLine, tokenCol, pos, file, tokenFlags));
+				tokenList.Add(Token(type, Atom::FromBuffer(tokenBuilder.Buffer(), tokenBuilder.Length()), tokenLine, tokenCol, pos, file, tokenFlags));
                 tokenFlags = 0;
 				tokenBuilder.Clear();
 			};
+			const char * textBuffer = text.Buffer();
+			int textLength = text.Length();
+			// moves to `newPos` as if the loop had stepped there one character at a time; the characters
+			// passed over must not contain line breaks
+			auto SkipTo = [&](int newPos)
+			{
+				col += newPos - pos;
+				pos = lastPos = newPos;
+			};
 			auto ProcessTransferChar = [&](char nextChar)
 			{
 				switch (nextChar)
@@ -364,7 +458,20 @@ namespace CoreLib
 				switch (state)
 				{
 				case State::Start:
-					if (IsLetter(curChar))
+					if (TokenizerFastScan && IsLetter(curChar))
+					{
+						// the whole identifier at once, ending where the Identifier state would have ended it
+						int start = pos;
+						int end = ScanIdentifier(textBuffer, pos + 1, textLength);
+						tokenLine = line;
+						tokenCol = col;
+						SkipTo(end - 1);
+						pos++;
+						derivative = LexDerivative::None;
+						tokenList.Add(Token(TokenType::Identifier, Atom::FromBuffer(textBuffer + start, end - start), tokenLine, tokenCol, pos, file, tokenFlags));
+						tokenFlags = 0;
+					}
+					else if (IsLetter(curChar))
 					{
 						state = State::Identifier;
 						tokenLine = line;
@@ -398,6 +505,8 @@ namespace CoreLib
 					else if (curChar == ' ' || curChar == '\t' || curChar == -62 || curChar== -96) // -62/-96:non-break space
                     {
                         tokenFlags |= TokenFlag::AfterWhitespace;
+						if (TokenizerFastScan && (curChar == ' ' || curChar == '\t'))
+							SkipTo(ScanBlanks(textBuffer, pos + 1, textLength) - 1);
 						pos++;
                     }
 					else if (curChar == '/' && nextChar == '/')
@@ -436,8 +545,8 @@ namespace CoreLib
 					}
 					else
 					{
-						auto tokenStr = tokenBuilder.ToString();
 #if 0
+						auto tokenStr = tokenBuilder.ToString();
 						if (tokenStr == "#line_reset#")
 						{
 							line = 0;
@@ -471,7 +580,7 @@ namespace CoreLib
 					else
 					{
 						//do token analyze
-						ParseOperators(tokenBuilder.ToString(), tokenList, tokenFlags, tokenLine, tokenCol, pos - tokenBuilder.Length(), file);
+						ParseOperators(tokenBuilder.Buffer(), tokenBuilder.Length(), tokenList, tokenFlags, tokenLine, tokenCol, pos - tokenBuilder.Length(), file);
 						tokenBuilder.Clear();
 						state = State::Start;
 					}
@@ -633,6 +742,8 @@ namespace CoreLib
 						state = State::Start;
 						tokenFlags |= TokenFlag::AtStartOfLine | TokenFlag::AfterWhitespace;
 					}
+					else if (TokenizerFastScan)
+						SkipTo(ScanUntil(textBuffer, pos + 1, textLength, '\n', '\n') - 1);
 					pos++;
 					break;
 				case State::MultiComment:
@@ -643,7 +754,11 @@ namespace CoreLib
 						pos += 2;
 					}
 					else
+					{
+						if (TokenizerFastScan)
+							SkipTo(ScanUntil(textBuffer, pos + 1, textLength, '*', '\n') - 1);
 						pos++;
+					}
 					break;
 				}
 			}
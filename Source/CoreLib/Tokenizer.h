@@ -44,7 +44,7 @@ namespace CoreLib
 		{
 		public:
 			int Line = -1, Col = -1, Pos = -1;
-			String FileName;
+			Atom FileName;
 			String ToString()
 			{
 				StringBuilder sb(100);
@@ -54,7 +54,7 @@ namespace CoreLib
 				return sb.ProduceString();
 			}
 			CodePosition() = default;
-			CodePosition(int line, int col, int pos, String fileName)
+			CodePosition(int line, int col, int pos, Atom fileName)
 			{
 				Line = line;
 				Col = col;
@@ -63,7 +63,7 @@ namespace CoreLib
 			}
 			bool operator < (const CodePosition & pos) const
 			{
-				return FileName < pos.FileName || (FileName == pos.FileName && Line < pos.Line) ||
+				return FileName.ToString() < pos.FileName.ToString() || (FileName == pos.FileName && Line < pos.Line) ||
 					(FileName == pos.FileName && Line == pos.Line && Col < pos.Col);
 			}
 			bool operator == (const CodePosition & pos) const
@@ -72,7 +72,7 @@ namespace CoreLib
 			}
 		};
 
-		enum class TokenType
+		enum class TokenType : short
 		{
             EndOfFile = -1,
 			// illegal
@@ -94,22 +94,24 @@ namespace CoreLib
 
 		String TokenTypeToString(TokenType type);
 
-        enum TokenFlag : unsigned int
+        enum TokenFlag : unsigned short
         {
             AtStartOfLine   = 1 << 0,
             AfterWhitespace = 1 << 1,
         };
-        typedef unsigned int TokenFlags;
+        typedef unsigned short TokenFlags;
 
+		// A token holds no memory of its own: its text and the name of its file are atoms, so tokens
+		// are copied as plain bytes and lexing allocates nothing per token.
 		class Token
 		{
 		public:
 			TokenType Type = TokenType::Unknown;
-			String Content;
-			CodePosition Position;
             TokenFlags flags = 0;
+			Atom Content;
+			CodePosition Position;
 			Token() = default;
-			Token(TokenType type, const String & content, int line, int col, int pos, String fileName, TokenFlags flags = 0)
+			Token(TokenType type, Atom content, int line, int col, int pos, Atom fileName, TokenFlags flags = 0)
                 : flags(flags)
 			{
 				Type = type;
@@ -126,6 +128,10 @@ namespace CoreLib
 		List<Token> TokenizeText(const String & fileName, const String & text, Procedure<TokenizeErrorType, CodePosition> errorHandler);
 		List<Token> TokenizeText(const String & fileName, const String & text);
 		List<Token> TokenizeText(const String & text);
+
+		// when set (the default), TokenizeText skips whitespace, comments and identifiers a block of characters
+		// at a time instead of one character at a time; the tokens are the same either way
+		extern bool TokenizerFastScan;
 		
 		String EscapeStringLiteral(String str);
 		String UnescapeStringLiteral(String str);
@@ -28,6 +28,7 @@ int wmain(int argc, wchar_t* argv[])
 		// We need to parse any command-line arguments.
 		String outputDir;
 		CompileOptions options;
+		bool binaryOutput = false;
 
 		// As we parse the command line, we will rewrite the
 		// entries in `argv` to collect any "ordinary" arguments.
@@ -69,7 +70,7 @@ int wmain(int argc, wchar_t* argv[])
 					{
 						options.Target = CodeGenTarget::HLSL;
 					}
-					else if (name == "spriv")
+					else if (name == "spirv" || name == "spriv")
 					{
 						options.Target = CodeGenTarget::SPIRV;
 					}
@@ -80,6 +81,13 @@ int wmain(int argc, wchar_t* argv[])
 				}
 				else if (argStr == "-genchoice")
 					options.Mode = CompilerMode::GenerateChoice;
+				else if (argStr == "-explore")
+				{
+					options.Mode = CompilerMode::GenerateChoice;
+					options.ExploreSchedules = true;
+				}
+				else if (argStr == "-binary")
+					binaryOutput = true;
 				else if (argStr == "--")
 				{
 					// The `--` option causes us to stop trying to parse options,
@@ -147,7 +155,10 @@ int wmain(int argc, wchar_t* argv[])
 				
 				try
 				{
-					f.SaveToFile(Path::Combine(outputDir, f.MetaData.ShaderName + ".cse"));
+					if (binaryOutput)
+						f.SaveToBinaryFile(Path::Combine(outputDir, f.MetaData.ShaderName + ".cse"));
+					else
+						f.SaveToFile(Path::Combine(outputDir, f.MetaData.ShaderName + ".cse"));
 				}
 				catch (Exception &)
 				{
@@ -155,6 +166,38 @@ int wmain(int argc, wchar_t* argv[])
 				}
 			}
 
+			// write the schedules of the Pareto front of each shader, and list their costs. The schedule with
+			// the lowest total cost is also written to <shader>.schedule, so that it can be picked without looking.
+			auto writeSchedule = [&](ExploredSchedule & schedule, String scheduleFileName)
+			{
+				try
+				{
+					File::WriteAllText(scheduleFileName, schedule.ToScheduleSource());
+				}
+				catch (Exception &)
+				{
+					result.GetErrorWriter()->diagnose(CodePosition(0, 0, 0, ""), Diagnostics::cannotWriteOutputFile, scheduleFileName);
+				}
+			};
+			for (auto & explored : result.ExploredSchedules)
+			{
+				auto & exploration = explored.Value;
+				printf("%S: %d of %d schedules lead to distinct variants%s\n", explored.Key.ToWString(), exploration.Schedules.Count(),
+					exploration.EvaluatedCount, exploration.IsExhaustive ? "" : " (sampled)");
+				for (int i = 0; i < exploration.ParetoFront.Count(); i++)
+				{
+					auto & schedule = exploration.Schedules[exploration.ParetoFront[i]];
+					auto scheduleFileName = Path::Combine(outputDir, explored.Key + "." + String(i) + ".schedule");
+					printf("  %S:", Path::GetFileName(scheduleFileName).ToWString());
+					for (int j = 0; j < schedule.Costs.Count(); j++)
+						printf(" %S=%g", exploration.CostNames[j].ToWString(), schedule.Costs[j]);
+					printf("%s\n", exploration.ParetoFront[i] == exploration.LowestCostSchedule ? " (lowest cost)" : "");
+					writeSchedule(schedule, scheduleFileName);
+				}
+				if (exploration.Schedules.Count())
+					writeSchedule(exploration.Schedules[exploration.LowestCostSchedule], Path::Combine(outputDir, explored.Key + ".schedule"));
+			}
+
 			if (options.Target == CodeGenTarget::HLSL)
 			{
 				// verify shader using D3DCompileShaderFromFile
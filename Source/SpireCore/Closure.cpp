@@ -51,7 +51,7 @@ namespace Spire
 		}
 		RefPtr<ShaderClosure> CreateShaderClosure(DiagnosticSink * err, SymbolTable * symTable, ShaderSymbol * shader, CodePosition usingPos, 
 			ShaderClosure * rootShader,
-			const EnumerableDictionary<String, RefPtr<ShaderComponentSymbol>>& pRefMap)
+			const EnumerableDictionary<Atom, RefPtr<ShaderComponentSymbol>>& pRefMap)
 		{
 			RefPtr<ShaderClosure> rs = new ShaderClosure();
 			if (rootShader == nullptr)
@@ -85,7 +85,7 @@ namespace Spire
 				if (auto import = dynamic_cast<ImportSyntaxNode*>(mbr.Ptr()))
 				{
 					// create component for each argument
-					EnumerableDictionary<String, RefPtr<ShaderComponentSymbol>> refMap;
+					EnumerableDictionary<Atom, RefPtr<ShaderComponentSymbol>> refMap;
 					for (auto & arg : import->Arguments)
 					{
 						RefPtr<ShaderComponentSymbol> ccomp = new ShaderComponentSymbol();
@@ -187,7 +187,7 @@ namespace Spire
 
 		RefPtr<ShaderClosure> CreateShaderClosure(DiagnosticSink * err, SymbolTable * symTable, ShaderSymbol * shader)
 		{
-			return CreateShaderClosure(err, symTable, shader, shader->SyntaxNode->Position, nullptr, EnumerableDictionary<String, RefPtr<ShaderComponentSymbol>>());
+			return CreateShaderClosure(err, symTable, shader, shader->SyntaxNode->Position, nullptr, EnumerableDictionary<Atom, RefPtr<ShaderComponentSymbol>>());
 		}
 
 		class ReplaceReferenceVisitor : public SyntaxVisitor
@@ -539,7 +539,8 @@ namespace Spire
 				GatherComponents(err, closure, sc.Value.Ptr());
 		}
 
-		bool IsWorldFeasible(SymbolTable * symTable, PipelineSymbol * pipeline, ShaderComponentImplSymbol * impl, String world, ShaderComponentSymbol*& unaccessibleComp)
+		bool IsWorldFeasible(SymbolTable * symTable, PipelineSymbol * pipeline, ShaderComponentImplSymbol * impl, String world, ShaderComponentSymbol*& unaccessibleComp,
+			EnumerableDictionary<ShaderComponentSymbol*, EnumerableHashSet<String>> * assignedWorlds)
 		{
 			// shader parameter (uniform values) are available to all worlds
 			if (impl->SyntaxNode->IsParam())
@@ -550,7 +551,13 @@ namespace Spire
 				if (dcomp.Value.Contains(nullptr))
 				{
 					bool reachable = false;
-					for (auto & dw : dcomp.Key->Type->FeasibleWorlds)
+					auto srcWorlds = &dcomp.Key->Type->FeasibleWorlds;
+					if (assignedWorlds)
+					{
+						if (auto worlds = assignedWorlds->TryGetValue(dcomp.Key))
+							srcWorlds = worlds;
+					}
+					for (auto & dw : *srcWorlds)
 					{
 						if (symTable->IsWorldImplicitlyReachable(pipeline, dw, world, dcomp.Key->Type->DataType))
 						{
@@ -9,6 +9,10 @@ namespace Spire
 		RefPtr<ShaderClosure> CreateShaderClosure(DiagnosticSink * sink, SymbolTable * symTable, ShaderSymbol * shader);
 		void FlattenShaderClosure(DiagnosticSink * sink, SymbolTable * symTable, ShaderClosure * shader);
 		void InsertImplicitImportOperators(DiagnosticSink * sink, ShaderIR * shader);
+		// whether `impl` can be computed at `world`, taking the worlds of the components it reads from `assignedWorlds`
+		// where they are assigned there, and from their feasible worlds otherwise
+		bool IsWorldFeasible(SymbolTable * symTable, PipelineSymbol * pipeline, ShaderComponentImplSymbol * impl, String world, ShaderComponentSymbol*& unaccessibleComp,
+			EnumerableDictionary<ShaderComponentSymbol*, EnumerableHashSet<String>> * assignedWorlds = nullptr);
 	}
 }
 
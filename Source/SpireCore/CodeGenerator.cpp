@@ -221,7 +221,8 @@ namespace Spire
 						{
 							param->BindingPoints.Clear();
 							param->BufferOffset = (int)RoundToAlignment(module->BufferSize, (int)GetTypeAlignment(param->Type.Ptr(), defaultLayoutRule));
-							module->BufferSize = param->BufferOffset + (int)GetTypeSize(param->Type.Ptr(), defaultLayoutRule);
+							param->Size = (int)GetTypeSize(param->Type.Ptr(), defaultLayoutRule);
+							module->BufferSize = param->BufferOffset + param->Size;
 						}
 						else
 						{
@@ -378,7 +379,7 @@ namespace Spire
 				// 2) For each abstract world, add its components to record type
 
 				Dictionary<String, List<ComponentDefinitionIR*>> worldComps;
-				auto worlds = From(pipeline->Worlds).Select([](KeyValuePair<String, WorldSyntaxNode*> kv) {return kv.Key; }).Concat(FromSingle(String("<uniform>")));
+				auto worlds = From(pipeline->Worlds).Select([](KeyValuePair<Atom, WorldSyntaxNode*> kv) {return kv.Key.ToString(); }).Concat(FromSingle(String("<uniform>")));
 				//worlds.Add("<uniform>");
 				for (auto world : worlds)
 				{
@@ -1174,7 +1175,7 @@ namespace Spire
 				{
 					if (basicType->Func)
 					{
-						funcName = basicType->Func->SyntaxNode->IsExtern() ? basicType->Func->SyntaxNode->Name.Content : basicType->Func->SyntaxNode->InternalName;
+						funcName = basicType->Func->SyntaxNode->IsExtern() ? basicType->Func->SyntaxNode->Name.Content.ToString() : basicType->Func->SyntaxNode->InternalName;
 						for (auto & param : basicType->Func->SyntaxNode->GetParameters())
 						{
 							if (param->HasModifier(ModifierFlag::Out))
@@ -1390,7 +1391,8 @@ namespace Spire
 			CodeGenerator(SymbolTable * symbols, DiagnosticSink * pErr, CompileResult & _result, LayoutRule defaultLayoutRule)
 				: ICodeGenerator(pErr), symTable(symbols), result(_result), defaultLayoutRule(defaultLayoutRule)
 			{
-				result.Program = new ILProgram();
+				if (!result.Program)
+					result.Program = new ILProgram();
 				codeWriter.SetConstantPool(result.Program->ConstantPool.Ptr());
 			}
 
@@ -0,0 +1,154 @@
+#include "CompileUnitCache.h"
+
+using namespace CoreLib::Basic;
+
+namespace Spire
+{
+	namespace Compiler
+	{
+		static bool IsSameList(const List<String> & a, const List<String> & b)
+		{
+			if (a.Count() != b.Count())
+				return false;
+			for (int i = 0; i < a.Count(); i++)
+				if (a[i] != b[i])
+					return false;
+			return true;
+		}
+
+		bool CompileUnitCache::IsValid(const Entry & entry, const Dictionary<String, String> & defines, IncludeHandler * includeHandler)
+		{
+			for (auto & macro : entry.Dependencies.Macros)
+			{
+				String value;
+				bool isDefined = defines.TryGetValue(macro.Name, value);
+				if (isDefined != macro.IsDefined || (isDefined && value != macro.Value))
+					return false;
+			}
+			for (auto & include : entry.Dependencies.Includes)
+			{
+				if (!includeHandler)
+					return false;
+				RefPtr<SourceFile> file = includeHandler->TryToFindIncludeFile(include.PathToInclude, include.PathIncludedFrom);
+				if (!file)
+					return false;
+				// a handler without a source file cache reads the same file into a new object each time
+				if (file != include.File && (file->FileName != include.File->FileName || file->Text != include.File->Text))
+					return false;
+			}
+			return true;
+		}
+
+		int CompileUnitCache::HashMacroValue(int hash, const String & name, bool isDefined, const String & value)
+		{
+			hash = hash * 16777619 ^ name.GetHashCode();
+			return hash * 16777619 ^ (isDefined ? value.GetHashCode() : -1);
+		}
+
+		RefPtr<ProgramSyntaxNode> CompileUnitCache::Find(const String & fileName, const String & text,
+			const Dictionary<String, String> & defines, IncludeHandler * includeHandler, int & tokenCount)
+		{
+			List<RefPtr<Entry>> candidates;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				auto file = files.TryGetValue(fileName);
+				if (!file || file->Text != text)
+					return nullptr;
+				for (auto & group : file->Groups)
+				{
+					int hash = 0;
+					for (auto & name : group.MacroNames)
+					{
+						String value;
+						bool isDefined = defines.TryGetValue(name, value);
+						hash = HashMacroValue(hash, name, isDefined, value);
+					}
+					if (auto entries = group.Entries.TryGetValue(hash))
+						candidates.AddRange(*entries);
+				}
+			}
+			// entries with the same hash can still differ in their macros, and an include may find another file now
+			for (auto & entry : candidates)
+			{
+				if (IsValid(*entry, defines, includeHandler))
+				{
+					tokenCount = entry->TokenCount;
+					CloneContext cloneCtx;
+					cloneCtx.CopyAll = true;
+					return entry->SyntaxNode->Clone(cloneCtx);
+				}
+			}
+			return nullptr;
+		}
+
+		void CompileUnitCache::Add(const String & fileName, const String & text, const PreprocessorDependencies & dependencies,
+			ProgramSyntaxNode * syntaxNode, int tokenCount)
+		{
+			RefPtr<Entry> entry = new Entry();
+			entry->Dependencies = dependencies;
+			entry->TokenCount = tokenCount;
+			{
+				CloneContext cloneCtx;
+				cloneCtx.CopyAll = true;
+				entry->SyntaxNode = syntaxNode->Clone(cloneCtx);
+			}
+			// the values are hashed in the order of the names, whatever order the macros were looked up in
+			List<String> macroNames;
+			for (auto & macro : dependencies.Macros)
+				macroNames.Add(macro.Name);
+			macroNames.Sort();
+			List<String> uniqueNames;
+			for (auto & name : macroNames)
+				if (!uniqueNames.Count() || uniqueNames.Last() != name)
+					uniqueNames.Add(name);
+			int hash = 0;
+			for (auto & name : uniqueNames)
+			{
+				for (auto & macro : dependencies.Macros)
+				{
+					if (macro.Name == name)
+					{
+						hash = HashMacroValue(hash, name, macro.IsDefined, macro.Value);
+						break;
+					}
+				}
+			}
+
+			std::lock_guard<std::mutex> lock(mutex);
+			auto file = files.TryGetValue(fileName);
+			if (!file)
+			{
+				files[fileName] = FileEntries();
+				file = files.TryGetValue(fileName);
+			}
+			// the trees of an older text of the file are not looked for again once it has changed, and a file that
+			// has been parsed under too many definitions starts over
+			if (file->Text != text || file->EntryCount == MaxEntriesPerFile)
+			{
+				file->Text = text;
+				file->Groups.Clear();
+				file->EntryCount = 0;
+			}
+			MacroGroup * group = nullptr;
+			for (auto & existingGroup : file->Groups)
+				if (IsSameList(existingGroup.MacroNames, uniqueNames))
+					group = &existingGroup;
+			if (!group)
+			{
+				MacroGroup newGroup;
+				newGroup.MacroNames = uniqueNames;
+				file->Groups.Add(newGroup);
+				group = &file->Groups.Last();
+			}
+			if (auto entries = group->Entries.TryGetValue(hash))
+				entries->Add(entry);
+			else
+			{
+				List<RefPtr<Entry>> newEntries;
+				newEntries.Add(entry);
+				group->Entries[hash] = newEntries;
+			}
+			file->EntryCount++;
+		}
+	}
+}
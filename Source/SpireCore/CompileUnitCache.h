@@ -0,0 +1,61 @@
+#ifndef SPIRE_COMPILE_UNIT_CACHE_H
+#define SPIRE_COMPILE_UNIT_CACHE_H
+
+#include "../CoreLib/Basic.h"
+#include "Preprocessor.h"
+#include "Syntax.h"
+
+#include <mutex>
+
+namespace Spire
+{
+	namespace Compiler
+	{
+		// Files parsed by a compilation context, kept under what their preprocessing depended on. A file is
+		// usually preprocessed with many sets of macro definitions, most of which define nothing it looks at,
+		// so its tree is kept under the definitions of just the macros it looked up, and the files it included.
+		// Parsing it again under definitions that agree on those macros gives a copy of the kept tree. Only
+		// the trees of the latest text of each file are kept, at most MaxEntriesPerFile of them. The kept trees
+		// are never checked; the cache may be used by several threads at once.
+		class CompileUnitCache : public RefObject
+		{
+		private:
+			struct Entry : public RefObject
+			{
+				PreprocessorDependencies Dependencies;
+				RefPtr<ProgramSyntaxNode> SyntaxNode;
+				int TokenCount = 0;
+			};
+			// the trees parsed while looking up the same macros, under the hash of the values the macros had
+			struct MacroGroup
+			{
+				// sorted, without duplicates
+				CoreLib::List<CoreLib::String> MacroNames;
+				CoreLib::Dictionary<int, CoreLib::List<RefPtr<Entry>>> Entries;
+			};
+			struct FileEntries
+			{
+				CoreLib::String Text;
+				CoreLib::List<MacroGroup> Groups;
+				int EntryCount = 0;
+			};
+			static const int MaxEntriesPerFile = 64;
+			std::mutex mutex;
+			CoreLib::Dictionary<CoreLib::String, FileEntries> files;
+			static int HashMacroValue(int hash, const CoreLib::String & name, bool isDefined, const CoreLib::String & value);
+			static bool IsValid(const Entry & entry, const CoreLib::Dictionary<CoreLib::String, CoreLib::String> & defines,
+				IncludeHandler * includeHandler);
+		public:
+			// Returns a copy of the tree kept for `text` as the content of `fileName` if its macros are defined the
+			// same way in `defines` and its includes still find the same files through `includeHandler`, or nullptr.
+			// `tokenCount` receives the number of tokens the kept tree was parsed from.
+			RefPtr<ProgramSyntaxNode> Find(const CoreLib::String & fileName, const CoreLib::String & text,
+				const CoreLib::Dictionary<CoreLib::String, CoreLib::String> & defines, IncludeHandler * includeHandler, int & tokenCount);
+			// Keeps a copy of `syntaxNode`, parsed without diagnostics from `text` as the content of `fileName`.
+			void Add(const CoreLib::String & fileName, const CoreLib::String & text, const PreprocessorDependencies & dependencies,
+				ProgramSyntaxNode * syntaxNode, int tokenCount);
+		};
+	}
+}
+
+#endif
@@ -48,6 +48,27 @@ namespace Spire
 		{
 			return ShaderChoiceValue(str);
 		}
+		String ExploredSchedule::ToScheduleSource()
+		{
+			StringBuilder sb;
+			for (auto & choice : Choices)
+				sb << choice.Key << " = \"" << choice.Value << "\";\n";
+			return sb.ProduceString();
+		}
+		double WorldCostEstimate::GetWeightedCost() const
+		{
+			// a texture fetch is assumed to cost as much as four ALU operations, an interpolated scalar as much as one
+			return Frequency * (AluOps + TextureFetches * 4.0 + Interpolants);
+		}
+		void CompileStats::Add(const CompileStats & other)
+		{
+			for (int i = 0; i < (int)CompilePhase::Count; i++)
+				PhaseTimes[i] += other.PhaseTimes[i];
+			TokenCount += other.TokenCount;
+			SyntaxNodeCount += other.SyntaxNodeCount;
+			ILInstructionCount += other.ILInstructionCount;
+			OutputBytes += other.OutputBytes;
+		}
 		
 }
 }
\ No newline at end of file
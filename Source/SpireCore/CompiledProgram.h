@@ -5,6 +5,7 @@
 #include "Diagnostics.h"
 #include "IL.h"
 #include "Syntax.h"
+#include <chrono>
 
 namespace Spire
 {
@@ -177,6 +178,50 @@ namespace Spire
 			List<ShaderChoiceValue> Options;
 		};
 
+		// one point of the choice space of a shader, with the costs its variant is estimated to have
+		class ExploredSchedule
+		{
+		public:
+			EnumerableDictionary<String, String> Choices; // choice name -> world
+			List<double> Costs;
+			String ToScheduleSource();
+		};
+
+		class ScheduleExplorationResult
+		{
+		public:
+			List<String> CostNames;
+			// schedules that lead to distinct variants, starting with the default one
+			List<ExploredSchedule> Schedules;
+			// indices into Schedules of the schedules no other schedule is at least as cheap as in every cost and cheaper in one
+			List<int> ParetoFront;
+			// index into Schedules of the schedule with the lowest sum of costs
+			int LowestCostSchedule = 0;
+			// false when the choice space was too large to enumerate and has been sampled
+			bool IsExhaustive = true;
+			int EvaluatedCount = 0;
+		};
+
+		// static estimate of the work of one world of a shader, per invocation of the world. Counts in loops are
+		// multiplied by an assumed trip count, and the count of a called function is added at every call.
+		class WorldCostEstimate
+		{
+		public:
+			double Frequency = 1.0; // invocations relative to the other worlds, from the Frequency attribute of the world
+			double AluOps = 0.0;
+			double TextureFetches = 0.0;
+			double Interpolants = 0.0; // scalars imported from other worlds
+			double Instructions = 0.0; // all IL instructions
+			double GetWeightedCost() const;
+		};
+
+		class ShaderCostEstimate
+		{
+		public:
+			EnumerableDictionary<String, WorldCostEstimate> Worlds;
+			double TotalCost = 0.0; // sum of the weighted costs of all worlds
+		};
+
 		class ShaderMetaData
 		{
 		public:
@@ -200,6 +245,49 @@ namespace Spire
 
 		void IndentString(StringBuilder & sb, String src);
 
+		enum class CompilePhase
+		{
+			Preprocess, Parse, SemanticCheck, ShaderClosure, VariantIR, ImplicitImports, ILCodeGen, TargetCodeGen,
+			Count
+		};
+
+		// Where the time of a compile went, and how much each phase allocated. Times are wall-clock seconds.
+		class CompileStats
+		{
+		public:
+			double PhaseTimes[(int)CompilePhase::Count] = {};
+			int TokenCount = 0;
+			int SyntaxNodeCount = 0;
+			int ILInstructionCount = 0;
+			int OutputBytes = 0;
+			void Add(const CompileStats & other);
+		};
+
+		// adds the wall time from its construction until Stop() or its destruction to one phase of `stats`
+		class PhaseTimer
+		{
+		private:
+			CompileStats & stats;
+			CompilePhase phase;
+			std::chrono::steady_clock::time_point start;
+			bool running = true;
+		public:
+			PhaseTimer(CompileStats & _stats, CompilePhase _phase)
+				: stats(_stats), phase(_phase), start(std::chrono::steady_clock::now())
+			{}
+			~PhaseTimer()
+			{
+				Stop();
+			}
+			void Stop()
+			{
+				if (!running)
+					return;
+				stats.PhaseTimes[(int)phase] += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+				running = false;
+			}
+		};
+
 		class CompileResult
 		{
 		public:
@@ -207,13 +295,16 @@ namespace Spire
 			String ScheduleFile;
 			RefPtr<ILProgram> Program;
 			List<ShaderChoice> Choices;
+			EnumerableDictionary<String, ScheduleExplorationResult> ExploredSchedules; // shader -> explored schedules
 			EnumerableDictionary<String, CompiledShaderSource> CompiledSource; // shader -> stage -> code
+			EnumerableDictionary<String, ShaderCostEstimate> CostEstimates; // shader -> estimated cost of its compiled code
+			CompileStats Stats;
 			void PrintDiagnostics()
 			{
 				for (int i = 0; i < sink.diagnostics.Count(); i++)
 				{
 					fprintf(stderr, "%S(%d): %s %d: %S\n",
-                        sink.diagnostics[i].Position.FileName.ToWString(),
+                        sink.diagnostics[i].Position.FileName.ToString().ToWString(),
                         sink.diagnostics[i].Position.Line,
                         getSeverityName(sink.diagnostics[i].severity),
 						sink.diagnostics[i].ErrorID,
@@ -0,0 +1,53 @@
+#include "ContentHash.h"
+#include <stdio.h>
+
+using namespace CoreLib::Basic;
+
+namespace Spire
+{
+	namespace Compiler
+	{
+		ContentHash::ContentHash()
+		{
+			lane0 = 0xcbf29ce484222325ull;
+			lane1 = 0x84222325cbf29ce4ull;
+		}
+
+		void ContentHash::Append(const void * data, int length)
+		{
+			auto bytes = (const unsigned char *)data;
+			for (int i = 0; i < length; i++)
+			{
+				// lane 0 is FNV-1a, lane 1 an add-multiply-xorshift mix of the same stream
+				lane0 = (lane0 ^ bytes[i]) * 0x100000001b3ull;
+				lane1 = (lane1 + bytes[i]) * 0x9e3779b97f4a7c15ull;
+				lane1 ^= lane1 >> 29;
+			}
+		}
+
+		void ContentHash::Append(const String & str)
+		{
+			Append(str.Length());
+			Append(str.Buffer(), str.Length());
+		}
+
+		void ContentHash::Append(int value)
+		{
+			Append(&value, sizeof(int));
+		}
+
+		String ContentHash::ProduceString() const
+		{
+			char buffer[33];
+			snprintf(buffer, sizeof(buffer), "%016llx%016llx", lane0, lane1);
+			return String(buffer);
+		}
+
+		String ContentHash::Compute(const String & str)
+		{
+			ContentHash hash;
+			hash.Append(str);
+			return hash.ProduceString();
+		}
+	}
+}
@@ -0,0 +1,27 @@
+#ifndef SPIRE_CONTENT_HASH_H
+#define SPIRE_CONTENT_HASH_H
+
+#include "../CoreLib/Basic.h"
+
+namespace Spire
+{
+	namespace Compiler
+	{
+		// 128-bit content hash (two independent 64-bit lanes) used to address cache entries.
+		// Strings are length-prefixed so that concatenated fields cannot alias each other.
+		class ContentHash
+		{
+		private:
+			unsigned long long lane0, lane1;
+		public:
+			ContentHash();
+			void Append(const void * data, int length);
+			void Append(const CoreLib::Basic::String & str);
+			void Append(int value);
+			CoreLib::Basic::String ProduceString() const;
+			static CoreLib::Basic::String Compute(const CoreLib::Basic::String & str);
+		};
+	}
+}
+
+#endif
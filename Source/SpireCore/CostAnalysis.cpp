@@ -0,0 +1,131 @@
+#include "CostAnalysis.h"
+
+namespace Spire
+{
+	namespace Compiler
+	{
+		using namespace CoreLib;
+
+		// number of iterations assumed for a loop whose trip count is unknown
+		const double LoopIterationEstimate = 8.0;
+
+		class CostEstimator
+		{
+		private:
+			ILProgram * program;
+			Dictionary<ILFunction*, WorldCostEstimate> functionCosts;
+			HashSet<ILFunction*> visitingFunctions;
+			int GetScalarCount(ILType * type)
+			{
+				if (auto arrType = dynamic_cast<ILArrayType*>(type))
+					return GetScalarCount(arrType->BaseType.Ptr()) * Math::Max(arrType->ArrayLength, 1);
+				if (auto structType = dynamic_cast<ILStructType*>(type))
+				{
+					int count = 0;
+					for (auto & member : structType->Members)
+						count += GetScalarCount(member.Type.Ptr());
+					return count;
+				}
+				return type->GetVectorSize();
+			}
+			WorldCostEstimate GetFunctionCost(ILFunction * func)
+			{
+				WorldCostEstimate cost;
+				if (functionCosts.TryGetValue(func, cost))
+					return cost;
+				// a recursive call adds nothing to the function it recurses into
+				if (!func->Code || !visitingFunctions.Add(func))
+					return cost;
+				AddCost(cost, func->Code.Ptr(), 1.0);
+				visitingFunctions.Remove(func);
+				functionCosts[func] = cost;
+				return cost;
+			}
+			void AddCost(WorldCostEstimate & cost, ILInstruction & instr, double weight)
+			{
+				cost.Instructions += weight;
+				if (auto import = dynamic_cast<ImportInstruction*>(&instr))
+				{
+					if (import->Type)
+						cost.Interpolants += GetScalarCount(import->Type.Ptr()) * weight;
+				}
+				else if (auto call = dynamic_cast<CallInstruction*>(&instr))
+				{
+					RefPtr<ILFunction> func;
+					if (program->Functions.TryGetValue(call->Function, func))
+					{
+						auto funcCost = GetFunctionCost(func.Ptr());
+						cost.AluOps += funcCost.AluOps * weight;
+						cost.TextureFetches += funcCost.TextureFetches * weight;
+						cost.Instructions += funcCost.Instructions * weight;
+					}
+					else if (call->Function.StartsWith("Sample"))
+						cost.TextureFetches += weight;
+					else
+						cost.AluOps += weight;
+				}
+				else if (dynamic_cast<IfInstruction*>(&instr))
+				{
+					// both branches are counted: divergent branches of a shader usually run both
+					cost.AluOps += weight;
+				}
+				else if (dynamic_cast<BinaryInstruction*>(&instr))
+				{
+					if (!dynamic_cast<MemberLoadInstruction*>(&instr))
+						cost.AluOps += weight;
+				}
+				else if (dynamic_cast<NotInstruction*>(&instr) || dynamic_cast<NegInstruction*>(&instr) ||
+					dynamic_cast<BitNotInstruction*>(&instr) || dynamic_cast<CastInstruction*>(&instr) ||
+					dynamic_cast<SelectInstruction*>(&instr))
+					cost.AluOps += weight;
+
+				auto forInstr = dynamic_cast<ForInstruction*>(&instr);
+				bool isLoop = forInstr || dynamic_cast<WhileInstruction*>(&instr) || dynamic_cast<DoInstruction*>(&instr);
+				for (int i = 0; i < instr.GetSubBlockCount(); i++)
+				{
+					auto block = instr.GetSubBlock(i);
+					if (!block)
+						continue;
+					if (isLoop && !(forInstr && block == forInstr->InitialCode.Ptr()))
+						AddCost(cost, block, weight * LoopIterationEstimate);
+					else
+						AddCost(cost, block, weight);
+				}
+			}
+			void AddCost(WorldCostEstimate & cost, CFGNode * code, double weight)
+			{
+				for (auto & instr : *code)
+					AddCost(cost, instr, weight);
+			}
+		public:
+			CostEstimator(ILProgram * _program)
+				: program(_program)
+			{}
+			WorldCostEstimate EstimateWorldCost(ILWorld * world)
+			{
+				WorldCostEstimate cost;
+				Token frequency;
+				if (world->Attributes.TryGetValue("Frequency", frequency))
+					cost.Frequency = StringToDouble(frequency.Content);
+				if (world->Code)
+					AddCost(cost, world->Code.Ptr(), 1.0);
+				return cost;
+			}
+		};
+
+		ShaderCostEstimate EstimateShaderCost(ILProgram * program, ILShader * shader)
+		{
+			ShaderCostEstimate rs;
+			CostEstimator estimator(program);
+			for (auto & world : shader->Worlds)
+			{
+				if (world.Value->IsAbstract)
+					continue;
+				auto cost = estimator.EstimateWorldCost(world.Value.Ptr());
+				rs.TotalCost += cost.GetWeightedCost();
+				rs.Worlds[world.Key] = cost;
+			}
+			return rs;
+		}
+	}
+}
@@ -0,0 +1,17 @@
+#ifndef SPIRE_COST_ANALYSIS_H
+#define SPIRE_COST_ANALYSIS_H
+
+#include "IL.h"
+#include "CompiledProgram.h"
+
+namespace Spire
+{
+	namespace Compiler
+	{
+		// estimates the cost of every non-abstract world of `shader` from its IL, weighted by the Frequency
+		// attribute of the world (e.g. `[Frequency: "16"] world Fragment;`), which defaults to 1.
+		ShaderCostEstimate EstimateShaderCost(ILProgram * program, ILShader * shader);
+	}
+}
+
+#endif
@@ -294,5 +294,6 @@ DIAGNOSTIC(51092, Error, stageDoesntHaveInputWorld, "'$0' doesn't appear to have
 
 DIAGNOSTIC(99999, Internal, internalCompilerError, "internal compiler error")
 DIAGNOSTIC(99999, Internal, unimplemented, "unimplemented feature: $0")
+DIAGNOSTIC(99999, Error, compilationAborted, "compilation aborted: $0")
 
 #undef DIAGNOSTIC
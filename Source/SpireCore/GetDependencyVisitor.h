@@ -9,25 +9,6 @@ namespace Spire
 {
 	namespace Compiler
 	{
-		class ComponentDependency
-		{
-		public:
-			String ReferencedComponent;
-			ImportOperatorDefSyntaxNode * ImportOperator = nullptr;
-			ComponentDependency() = default;
-			ComponentDependency(String compName, ImportOperatorDefSyntaxNode * impOp)
-				: ReferencedComponent(compName), ImportOperator(impOp)
-			{}
-			int GetHashCode()
-			{
-				return ReferencedComponent.GetHashCode() ^ (int)(CoreLib::PtrInt)(void*)(ImportOperator);
-			}
-			bool operator == (const ComponentDependency & other)
-			{
-				return ReferencedComponent == other.ReferencedComponent && ImportOperator == other.ImportOperator;
-			}
-		};
-
 		class GetDependencyVisitor : public SyntaxVisitor
 		{
 		public:
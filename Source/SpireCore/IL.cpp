@@ -56,6 +56,18 @@ namespace Spire
 				return new ILBasicType(ILBaseType::Texture3D);
 			if (parser.LookAhead("bool"))
 				return new ILBasicType(ILBaseType::Bool);
+			if (parser.LookAhead("bvec2"))
+				return new ILBasicType(ILBaseType::Bool2);
+			if (parser.LookAhead("bvec3"))
+				return new ILBasicType(ILBaseType::Bool3);
+			if (parser.LookAhead("bvec4"))
+				return new ILBasicType(ILBaseType::Bool4);
+			if (parser.LookAhead("SamplerState"))
+				return new ILBasicType(ILBaseType::SamplerState);
+			if (parser.LookAhead("SamplerComparisonState"))
+				return new ILBasicType(ILBaseType::SamplerComparisonState);
+			if (parser.LookAhead("void"))
+				return new ILBasicType(ILBaseType::Void);
 			return nullptr;
 		}
 
@@ -306,13 +318,14 @@ namespace Spire
 			RefPtr<ILStructType> rs = new ILStructType();
 			rs->TypeName = reader.ReadToken().Content;
 			reader.Read("(");
-			while (reader.LookAhead(")"))
+			while (!reader.LookAhead(")"))
 			{
 				ILStructType::ILStructField field;
 				field.FieldName = reader.ReadToken().Content;
 				reader.Read(":");
 				field.Type = ILType::Deserialize(reader);
 				reader.Read(";");
+				rs->Members.Add(field);
 			}
 			reader.Read(")");
 			return rs;
@@ -375,7 +388,8 @@ namespace Spire
 			return tailInstr;
 		}
 
-		int NamingCounter = 0;
+		thread_local int NamingCounter = 0;
+		thread_local int ILInstructionAllocationCount = 0;
 
 		void CFGNode::NameAllInstructions()
 		{
@@ -30,7 +30,9 @@ namespace Spire
 		};
 		int SizeofBaseType(ILBaseType type);
 		int RoundToAlignment(int offset, int alignment);
-		extern int NamingCounter;
+		extern thread_local int NamingCounter;
+		// number of IL instructions created on this thread, for compile statistics
+		extern thread_local int ILInstructionAllocationCount;
 
 		enum class BindableResourceType
 		{
@@ -700,6 +702,7 @@ namespace Spire
 				next = 0;
 				prev = 0;
 				Parent = 0;
+				ILInstructionAllocationCount++;
 			}
 			ILInstruction(const ILInstruction & instr)
 				: ILOperand(instr)
@@ -707,6 +710,7 @@ namespace Spire
 				next = 0;
 				prev = 0;
 				Parent = 0;
+				ILInstructionAllocationCount++;
 			}
 			~ILInstruction()
 			{
@@ -82,6 +82,7 @@ namespace Spire
 						thruDef->UniqueKey = referencedDef->UniqueKey + "@" + node.TargetWorld;
 						thruDef->IsEntryPoint = false;
 						thruDef->SyntaxNode = new ComponentSyntaxNode();
+						thruDef->OwnsSyntaxNode = true;
 						thruDef->SyntaxNode->Type = thruDef->Type = srcDef->SyntaxNode->Type;
 						thruDef->SyntaxNode->Rate = new RateSyntaxNode();
 						thruDef->SyntaxNode->Rate->Worlds.Add(RateWorld(node.TargetWorld));
@@ -174,7 +175,10 @@ namespace Spire
 			for (auto & comp : shader->Definitions)
 			{
 				visitor.currentCompDef = comp.Ptr();
-				comp->SyntaxNode->Accept(&visitor);
+				// references are rewritten for the world of the definition, so a definition that refers to
+				// other components gets a copy of the syntax it shares with its implementation
+				if (comp->GetSyntaxDependencies().Count())
+					comp->GetMutableSyntaxNode()->Accept(&visitor);
 			}
 			for (auto & comp : visitor.passThroughComponents)
 			{
@@ -183,6 +187,8 @@ namespace Spire
 				defs[comp.Value->World] = comp.Value.Ptr();
 				shader->DefinitionsByComponent[comp.Key] = defs;
 			}
+			shader->DependencyGraph.Clear();
+			shader->UserGraph.Clear();
 		}
 	}
 }
\ No newline at end of file
@@ -0,0 +1,334 @@
+#ifndef RASTER_RENDERER_LAYERED_DICTIONARY_H
+#define RASTER_RENDERER_LAYERED_DICTIONARY_H
+
+#include "../CoreLib/Basic.h"
+
+using namespace CoreLib::Basic;
+
+namespace Spire
+{
+	namespace Compiler
+	{
+		// links a layer of a LayeredDictionary to the layers below it; this is not part of the layer class
+		// because a RefPtr member cannot name the class template being defined
+		class DictionaryLayerBase : public RefObject
+		{
+		public:
+			RefPtr<DictionaryLayerBase> Below;
+			int Count = 0; // number of visible entries in this layer and the layers below
+		};
+
+		// A dictionary made of a stack of layers. Only the top layer is written to; the layers below it are
+		// immutable and may be shared with other dictionaries, and lookups fall through them from top to bottom.
+		// Forking a dictionary therefore costs O(1): the fork starts with an empty top layer over the layers of
+		// its parent. Values found in a shared layer must not be modified in place (see TryGetMutableValue).
+		template <typename TKey, typename TValue>
+		class LayeredDictionary
+		{
+		private:
+			class Layer : public DictionaryLayerBase
+			{
+			public:
+				EnumerableDictionary<TKey, TValue> Entries;
+				HashSet<TKey> Removed; // keys of the layers below that are hidden by this layer
+				Layer * GetBelow() const
+				{
+					return static_cast<Layer*>(Below.Ptr());
+				}
+				bool IsEmpty() const
+				{
+					return Entries.Count() == 0 && Removed.Count() == 0;
+				}
+			};
+			// frozen layers above `base` are owned by this dictionary, and are merged into one when there
+			// are more than this many of them, so that lookups do not slow down as a dictionary is forked
+			static const int MaxOwnLayers = 8;
+			RefPtr<Layer> top = new Layer();
+			// the top layer of the parent at the time this dictionary was forked from it
+			RefPtr<DictionaryLayerBase> base;
+			int ownLayerCount = 0;
+
+			template<typename T>
+			static TValue * Find(Layer * layer, const T & key)
+			{
+				for (; layer; layer = layer->GetBelow())
+				{
+					if (auto value = layer->Entries.TryGetValue(key))
+						return value;
+					if (layer->Removed.Contains(key))
+						return nullptr;
+				}
+				return nullptr;
+			}
+			// combines the layers from `layer` down to (not including) `stop` into a single layer
+			static RefPtr<Layer> MergeLayers(Layer * layer, Layer * stop)
+			{
+				List<Layer*> layers;
+				for (; layer != stop; layer = layer->GetBelow())
+					layers.Add(layer);
+				RefPtr<Layer> merged = new Layer();
+				for (int i = layers.Count() - 1; i >= 0; i--)
+				{
+					for (auto & key : layers[i]->Removed)
+					{
+						merged->Entries.Remove(key);
+						merged->Removed.Add(key);
+					}
+					for (auto & entry : layers[i]->Entries)
+						merged->Entries[entry.Key] = entry.Value;
+				}
+				return merged;
+			}
+		public:
+			class Iterator
+			{
+			private:
+				List<Layer*> layers; // from top to bottom
+				int layerIndex = -1; // entries are visited from the bottom layer up, -1 once done
+				typename EnumerableDictionary<TKey, TValue>::Iterator iter;
+				bool IsVisible() const
+				{
+					for (int i = layerIndex - 1; i >= 0; i--)
+						if (layers[i]->Entries.ContainsKey((*iter).Key) || layers[i]->Removed.Contains((*iter).Key))
+							return false;
+					return true;
+				}
+				void SkipHidden()
+				{
+					while (layerIndex >= 0)
+					{
+						if (!(iter != layers[layerIndex]->Entries.end()))
+						{
+							layerIndex--;
+							if (layerIndex >= 0)
+								iter = layers[layerIndex]->Entries.begin();
+						}
+						else if (IsVisible())
+							return;
+						else
+							++iter;
+					}
+				}
+			public:
+				Iterator() = default;
+				Iterator(Layer * top)
+				{
+					for (auto layer = top; layer; layer = layer->GetBelow())
+						layers.Add(layer);
+					layerIndex = layers.Count() - 1;
+					iter = layers[layerIndex]->Entries.begin();
+					SkipHidden();
+				}
+				KeyValuePair<TKey, TValue> & operator *() const
+				{
+					return *iter;
+				}
+				KeyValuePair<TKey, TValue> * operator ->() const
+				{
+					return &(*iter);
+				}
+				Iterator & operator ++()
+				{
+					++iter;
+					SkipHidden();
+					return *this;
+				}
+				bool operator != (const Iterator & other) const
+				{
+					return layerIndex != other.layerIndex || (layerIndex >= 0 && iter != other.iter);
+				}
+				bool operator == (const Iterator & other) const
+				{
+					return !(*this != other);
+				}
+			};
+			class ItemProxy
+			{
+			private:
+				LayeredDictionary<TKey, TValue> * dict;
+				TKey key;
+			public:
+				ItemProxy(const TKey & _key, LayeredDictionary<TKey, TValue> * _dict)
+				{
+					this->dict = _dict;
+					this->key = _key;
+				}
+				const TValue & GetValue() const
+				{
+					if (auto value = dict->TryGetValue(key))
+						return *value;
+					throw KeyNotFoundException("The key does not exists in dictionary.");
+				}
+				inline const TValue & operator()() const
+				{
+					return GetValue();
+				}
+				operator const TValue&() const
+				{
+					return GetValue();
+				}
+				TValue & operator = (const TValue & val)
+				{
+					return dict->Set(key, val);
+				}
+				TValue & operator = (TValue && val)
+				{
+					return dict->Set(key, _Move(val));
+				}
+			};
+			LayeredDictionary() = default;
+			// copies share every frozen layer and duplicate only the top one
+			LayeredDictionary(const LayeredDictionary<TKey, TValue> & other)
+			{
+				operator=(other);
+			}
+			LayeredDictionary<TKey, TValue> & operator = (const LayeredDictionary<TKey, TValue> & other)
+			{
+				if (this == &other)
+					return *this;
+				RefPtr<Layer> newTop = new Layer();
+				newTop->Entries = other.top->Entries;
+				newTop->Removed = other.top->Removed;
+				newTop->Below = other.top->Below;
+				newTop->Count = other.top->Count;
+				top = newTop;
+				base = other.base;
+				ownLayerCount = other.ownLayerCount;
+				return *this;
+			}
+
+			// Turns the entries written since the last call into a frozen layer. Does not modify anything
+			// if nothing was written, so a frozen dictionary may be forked from several threads at once.
+			void Freeze()
+			{
+				if (top->IsEmpty())
+					return;
+				RefPtr<DictionaryLayerBase> frozen = top;
+				if (++ownLayerCount > MaxOwnLayers)
+				{
+					frozen = MergeLayers(top.Ptr(), static_cast<Layer*>(base.Ptr()));
+					frozen->Below = base;
+					frozen->Count = top->Count;
+					ownLayerCount = 1;
+				}
+				top = new Layer();
+				top->Below = frozen;
+				top->Count = frozen->Count;
+			}
+			// Makes this dictionary a copy of `parent` that shares all of its layers.
+			void Fork(LayeredDictionary<TKey, TValue> & parent)
+			{
+				parent.Freeze();
+				base = parent.top->Below;
+				top = new Layer();
+				top->Below = base;
+				top->Count = parent.top->Count;
+				ownLayerCount = 0;
+			}
+			// Re-applies everything written to this dictionary since it was forked on top of the current
+			// content of `parent`. Entries of this dictionary take precedence over those of the parent.
+			void MergeWith(LayeredDictionary<TKey, TValue> & parent)
+			{
+				auto merged = MergeLayers(top.Ptr(), static_cast<Layer*>(base.Ptr()));
+				parent.Freeze();
+				base = parent.top->Below;
+				merged->Below = base;
+				merged->Count = parent.top->Count;
+				for (auto & key : merged->Removed)
+					if (!merged->Entries.ContainsKey(key) && Find(static_cast<Layer*>(base.Ptr()), key))
+						merged->Count--;
+				for (auto & entry : merged->Entries)
+					if (!Find(static_cast<Layer*>(base.Ptr()), entry.Key))
+						merged->Count++;
+				top = merged;
+				ownLayerCount = 0;
+			}
+
+			// like Dictionary, lookups accept any type that hashes and compares like TKey, so that a key does
+			// not have to be converted first
+			template<typename T>
+			const TValue * TryGetValue(const T & key) const
+			{
+				return Find(top.Ptr(), key);
+			}
+			template<typename T>
+			bool TryGetValue(const T & key, TValue & value) const
+			{
+				if (auto rs = Find(top.Ptr(), key))
+				{
+					value = *rs;
+					return true;
+				}
+				return false;
+			}
+			// Returns the value of `key` for modification; a value found in a shared layer is copied to the
+			// top layer first. Returns nullptr if there is no such key.
+			TValue * TryGetMutableValue(const TKey & key)
+			{
+				if (auto value = top->Entries.TryGetValue(key))
+					return value;
+				auto value = Find(top.Ptr(), key);
+				if (!value)
+					return nullptr;
+				return &(top->Entries[key] = *value);
+			}
+			template<typename T>
+			bool ContainsKey(const T & key) const
+			{
+				return Find(top.Ptr(), key) != nullptr;
+			}
+			TValue & Set(const TKey & key, const TValue & value)
+			{
+				if (!Find(top.Ptr(), key))
+					top->Count++;
+				return top->Entries[key] = value;
+			}
+			TValue & Set(const TKey & key, TValue && value)
+			{
+				if (!Find(top.Ptr(), key))
+					top->Count++;
+				return top->Entries[key] = _Move(value);
+			}
+			void Add(const TKey & key, const TValue & value)
+			{
+				if (!AddIfNotExists(key, value))
+					throw KeyExistsException("The key already exists in Dictionary.");
+			}
+			bool AddIfNotExists(const TKey & key, const TValue & value)
+			{
+				if (Find(top.Ptr(), key))
+					return false;
+				top->Count++;
+				top->Entries[key] = value;
+				return true;
+			}
+			void Remove(const TKey & key)
+			{
+				if (!Find(top.Ptr(), key))
+					return;
+				top->Count--;
+				top->Entries.Remove(key);
+				if (Find(top->GetBelow(), key))
+					top->Removed.Add(key);
+			}
+			int Count() const
+			{
+				return top->Count;
+			}
+			ItemProxy operator [](const TKey & key)
+			{
+				return ItemProxy(key, this);
+			}
+			Iterator begin() const
+			{
+				return Iterator(top.Ptr());
+			}
+			Iterator end() const
+			{
+				return Iterator();
+			}
+		};
+	}
+}
+
+#endif
@@ -1,11 +1,8 @@
 #include "CodeGenBackend.h"
-#include "../CoreLib/Tokenizer.h"
-#include "IL.h"
-#include "Syntax.h"
-#include <vector>
-#include <fstream>
-#include "../CoreLib/TextIO.h"
-#include "../CoreLib/LibIO.h"
+#include "CLikeCodeGen.h"
+#include "Naming.h"
+#include "TypeLayout.h"
+#include <initializer_list>
 
 using namespace CoreLib::Basic;
 
@@ -13,68 +10,2758 @@ namespace Spire
 {
 	namespace Compiler
 	{
-		void PrintILShader(ILShader * shader)
+		namespace SpirV
 		{
-			printf("%S\n", shader->Name.ToWString());
-			printf("%S\n", shader->Position.ToString().ToWString());
-			printf("\n---\n\n");
+			const unsigned int MagicNumber = 0x07230203;
+			const unsigned int Version = 0x00010000;
 
-			for (auto& stage : shader->Stages)
+			enum Op
 			{
-				printf("Stage: %S\n", stage.Key.ToWString());
-				auto& stageIL = stage.Value;
+				OpUndef = 1, OpName = 5, OpMemberName = 6, OpExtInstImport = 11, OpExtInst = 12,
+				OpMemoryModel = 14, OpEntryPoint = 15, OpExecutionMode = 16, OpCapability = 17,
+				OpTypeVoid = 19, OpTypeBool = 20, OpTypeInt = 21, OpTypeFloat = 22, OpTypeVector = 23, OpTypeMatrix = 24,
+				OpTypeImage = 25, OpTypeSampler = 26, OpTypeSampledImage = 27, OpTypeArray = 28, OpTypeRuntimeArray = 29,
+				OpTypeStruct = 30, OpTypePointer = 32, OpTypeFunction = 33,
+				OpConstantTrue = 41, OpConstantFalse = 42, OpConstant = 43, OpConstantComposite = 44,
+				OpFunction = 54, OpFunctionParameter = 55, OpFunctionEnd = 56, OpFunctionCall = 57,
+				OpVariable = 59, OpLoad = 61, OpStore = 62, OpAccessChain = 65,
+				OpDecorate = 71, OpMemberDecorate = 72,
+				OpVectorExtractDynamic = 77, OpVectorShuffle = 79, OpCompositeConstruct = 80, OpCompositeExtract = 81,
+				OpTranspose = 84,
+				OpSampledImage = 86, OpImageSampleImplicitLod = 87, OpImageSampleExplicitLod = 88,
+				OpImageSampleDrefImplicitLod = 89, OpImageSampleDrefExplicitLod = 90, OpImageFetch = 95,
+				OpConvertFToU = 109, OpConvertFToS = 110, OpConvertSToF = 111, OpConvertUToF = 112, OpBitcast = 124,
+				OpSNegate = 126, OpFNegate = 127, OpIAdd = 128, OpFAdd = 129, OpISub = 130, OpFSub = 131,
+				OpIMul = 132, OpFMul = 133, OpUDiv = 134, OpSDiv = 135, OpFDiv = 136, OpUMod = 137, OpSRem = 138,
+				OpSMod = 139, OpFRem = 140, OpFMod = 141,
+				OpVectorTimesScalar = 142, OpMatrixTimesScalar = 143, OpVectorTimesMatrix = 144,
+				OpMatrixTimesVector = 145, OpMatrixTimesMatrix = 146, OpDot = 148,
+				OpAny = 154, OpAll = 155,
+				OpLogicalEqual = 164, OpLogicalNotEqual = 165, OpLogicalOr = 166, OpLogicalAnd = 167, OpLogicalNot = 168,
+				OpSelect = 169, OpIEqual = 170, OpINotEqual = 171,
+				OpUGreaterThan = 172, OpSGreaterThan = 173, OpUGreaterThanEqual = 174, OpSGreaterThanEqual = 175,
+				OpULessThan = 176, OpSLessThan = 177, OpULessThanEqual = 178, OpSLessThanEqual = 179,
+				OpFOrdEqual = 180, OpFUnordNotEqual = 183, OpFOrdLessThan = 184, OpFOrdGreaterThan = 186,
+				OpFOrdLessThanEqual = 188, OpFOrdGreaterThanEqual = 190,
+				OpShiftRightLogical = 194, OpShiftRightArithmetic = 195, OpShiftLeftLogical = 196,
+				OpBitwiseOr = 197, OpBitwiseXor = 198, OpBitwiseAnd = 199, OpNot = 200,
+				OpDPdx = 207, OpDPdy = 208, OpFwidth = 209,
+				OpLoopMerge = 246, OpSelectionMerge = 247, OpLabel = 248, OpBranch = 249, OpBranchConditional = 250,
+				OpKill = 252, OpReturn = 253, OpReturnValue = 254,
+			};
 
-				int maxAttrNameLength = 0;
-				int maxAttrValueLength = 0;
-				for (auto& attr : stageIL->Attributes)
+			enum GLSLstd450
+			{
+				GLSLstd450FAbs = 4, GLSLstd450SAbs = 5, GLSLstd450FSign = 6, GLSLstd450SSign = 7,
+				GLSLstd450Floor = 8, GLSLstd450Ceil = 9, GLSLstd450Fract = 10,
+				GLSLstd450Sin = 13, GLSLstd450Cos = 14, GLSLstd450Tan = 15, GLSLstd450Asin = 16, GLSLstd450Acos = 17,
+				GLSLstd450Atan = 18, GLSLstd450Atan2 = 25, GLSLstd450Pow = 26, GLSLstd450Exp = 27, GLSLstd450Log = 28,
+				GLSLstd450Exp2 = 29, GLSLstd450Log2 = 30, GLSLstd450Sqrt = 31,
+				GLSLstd450FMin = 37, GLSLstd450UMin = 38, GLSLstd450SMin = 39,
+				GLSLstd450FMax = 40, GLSLstd450UMax = 41, GLSLstd450SMax = 42,
+				GLSLstd450FClamp = 43, GLSLstd450UClamp = 44, GLSLstd450SClamp = 45,
+				GLSLstd450FMix = 46, GLSLstd450Step = 48, GLSLstd450SmoothStep = 49,
+				GLSLstd450Length = 66, GLSLstd450Cross = 68, GLSLstd450Normalize = 69,
+				GLSLstd450Reflect = 71, GLSLstd450Refract = 72,
+			};
+
+			enum StorageClass
+			{
+				StorageClassUniformConstant = 0, StorageClassInput = 1, StorageClassUniform = 2,
+				StorageClassOutput = 3, StorageClassFunction = 7,
+			};
+
+			enum Decoration
+			{
+				DecorationBlock = 2, DecorationBufferBlock = 3, DecorationColMajor = 5, DecorationArrayStride = 6,
+				DecorationMatrixStride = 7, DecorationBuiltIn = 11, DecorationFlat = 14, DecorationPatch = 15,
+				DecorationLocation = 30, DecorationBinding = 33, DecorationDescriptorSet = 34, DecorationOffset = 35,
+			};
+
+			enum BuiltIn
+			{
+				BuiltInPosition = 0, BuiltInPrimitiveId = 7, BuiltInInvocationId = 8, BuiltInTessCoord = 13,
+				BuiltInPatchVertices = 14, BuiltInFragCoord = 15, BuiltInFragDepth = 22, BuiltInInstanceIndex = 43,
+			};
+
+			enum ExecutionModel
+			{
+				ExecutionModelVertex = 0, ExecutionModelTessellationEvaluation = 2, ExecutionModelFragment = 4,
+			};
+
+			enum ExecutionMode
+			{
+				ExecutionModeSpacingEqual = 1, ExecutionModeVertexOrderCw = 4, ExecutionModeVertexOrderCcw = 5,
+				ExecutionModeOriginUpperLeft = 7, ExecutionModeDepthReplacing = 12,
+				ExecutionModeTriangles = 22, ExecutionModeQuads = 24,
+			};
+
+			enum Capability
+			{
+				CapabilityMatrix = 0, CapabilityShader = 1, CapabilityGeometry = 2, CapabilityTessellation = 3,
+				CapabilityImageGatherExtended = 25,
+			};
+
+			enum Dim
+			{
+				Dim2D = 1, Dim3D = 2, DimCube = 3,
+			};
+
+			enum ImageOperands
+			{
+				ImageOperandsBias = 0x1, ImageOperandsLod = 0x2, ImageOperandsGrad = 0x4,
+				ImageOperandsConstOffset = 0x8, ImageOperandsOffset = 0x10,
+			};
+
+			const int AddressingModelLogical = 0;
+			const int MemoryModelGLSL450 = 1;
+
+			// A sequence of SPIR-V words. Fixed-length instructions are written with Emit(),
+			// variable-length ones (strings, id lists) between Begin() and End().
+			class InstructionStream
+			{
+			private:
+				int instrStart = -1;
+			public:
+				List<unsigned int> Words;
+				void Emit(Op op, std::initializer_list<int> operands)
+				{
+					Words.Add(((unsigned int)(operands.size() + 1) << 16) | (unsigned int)op);
+					for (auto operand : operands)
+						Words.Add((unsigned int)operand);
+				}
+				void Begin(Op op)
+				{
+					instrStart = Words.Count();
+					Words.Add((unsigned int)op);
+				}
+				void Add(int operand)
+				{
+					Words.Add((unsigned int)operand);
+				}
+				void Add(const List<int> & operands)
+				{
+					for (auto operand : operands)
+						Words.Add((unsigned int)operand);
+				}
+				void AddString(const String & str)
+				{
+					auto buffer = str.Buffer();
+					int length = str.Length();
+					for (int i = 0; i <= length; i += 4)
+					{
+						unsigned int word = 0;
+						for (int j = 0; j < 4 && i + j < length; j++)
+							word |= ((unsigned int)(unsigned char)buffer[i + j]) << (j * 8);
+						Words.Add(word);
+					}
+				}
+				void End()
+				{
+					Words[instrStart] |= (unsigned int)(Words.Count() - instrStart) << 16;
+					instrStart = -1;
+				}
+				void Append(const InstructionStream & stream)
 				{
-					if (attr.Value.Name.Length() > maxAttrNameLength)
-						maxAttrNameLength = attr.Value.Name.Length();
+					Words.AddRange(stream.Words);
+				}
+			};
 
-					if (attr.Value.Value.Length() > maxAttrValueLength)
-						maxAttrValueLength = attr.Value.Value.Length();
+			// Owns the id space and the module-level sections of a SPIR-V module. Types and
+			// constants are deduplicated, as SPIR-V requires for non-aggregate types.
+			class ModuleBuilder
+			{
+			private:
+				int idBound = 1;
+				HashSet<int> capabilities;
+				Dictionary<String, int> types, constants;
+				Dictionary<int, int> undefs;
+				template<typename EmitFunc>
+				int GetOrCreate(Dictionary<String, int> & cache, const String & key, const EmitFunc & emit)
+				{
+					int id;
+					if (cache.TryGetValue(key, id))
+						return id;
+					id = AllocId();
+					emit(id);
+					cache[key] = id;
+					return id;
 				}
+			public:
+				InstructionStream Capabilities, ExtInstImports, MemoryModel, EntryPoints, ExecutionModes;
+				InstructionStream DebugNames, Annotations, Globals, Functions;
 
-				for (auto& attr : stageIL->Attributes)
+				int AllocId()
+				{
+					return idBound++;
+				}
+				void RequireCapability(Capability cap)
+				{
+					if (capabilities.Add(cap))
+						Capabilities.Emit(OpCapability, { cap });
+				}
+				int TypeVoid()
+				{
+					return GetOrCreate(types, "void", [&](int id) { Globals.Emit(OpTypeVoid, { id }); });
+				}
+				int TypeBool()
+				{
+					return GetOrCreate(types, "bool", [&](int id) { Globals.Emit(OpTypeBool, { id }); });
+				}
+				int TypeInt(bool isSigned)
+				{
+					return GetOrCreate(types, isSigned ? "int" : "uint", [&](int id) { Globals.Emit(OpTypeInt, { id, 32, isSigned ? 1 : 0 }); });
+				}
+				int TypeFloat()
+				{
+					return GetOrCreate(types, "float", [&](int id) { Globals.Emit(OpTypeFloat, { id, 32 }); });
+				}
+				int TypeVector(int componentType, int count)
+				{
+					return GetOrCreate(types, "vec" + String(componentType) + "x" + String(count), [&](int id)
+					{
+						Globals.Emit(OpTypeVector, { id, componentType, count });
+					});
+				}
+				int TypeMatrix(int columnType, int count)
+				{
+					return GetOrCreate(types, "mat" + String(columnType) + "x" + String(count), [&](int id)
+					{
+						Globals.Emit(OpTypeMatrix, { id, columnType, count });
+					});
+				}
+				int TypeImage(Dim dim, bool depth, bool arrayed)
+				{
+					int sampledType = TypeFloat();
+					return GetOrCreate(types, "image" + String((int)dim) + (depth ? "d" : "") + (arrayed ? "a" : ""), [&](int id)
+					{
+						Globals.Emit(OpTypeImage, { id, sampledType, dim, depth ? 1 : 0, arrayed ? 1 : 0, 0, 1, 0 });
+					});
+				}
+				int TypeSampler()
+				{
+					return GetOrCreate(types, "sampler", [&](int id) { Globals.Emit(OpTypeSampler, { id }); });
+				}
+				int TypeSampledImage(int imageType)
+				{
+					return GetOrCreate(types, "sampledImage" + String(imageType), [&](int id) { Globals.Emit(OpTypeSampledImage, { id, imageType }); });
+				}
+				int TypeArray(int elementType, int length, int stride)
+				{
+					int lengthId = ConstantUInt((unsigned int)length);
+					return GetOrCreate(types, "array" + String(elementType) + "x" + String(length) + "s" + String(stride), [&](int id)
+					{
+						Globals.Emit(OpTypeArray, { id, elementType, lengthId });
+						if (stride)
+							Decorate(id, DecorationArrayStride, { stride });
+					});
+				}
+				int TypeRuntimeArray(int elementType, int stride)
+				{
+					return GetOrCreate(types, "runtimeArray" + String(elementType) + "s" + String(stride), [&](int id)
+					{
+						Globals.Emit(OpTypeRuntimeArray, { id, elementType });
+						Decorate(id, DecorationArrayStride, { stride });
+					});
+				}
+				int TypePointer(StorageClass storage, int type)
+				{
+					return GetOrCreate(types, "ptr" + String((int)storage) + "x" + String(type), [&](int id)
+					{
+						Globals.Emit(OpTypePointer, { id, storage, type });
+					});
+				}
+				int TypeFunction(int returnType, const List<int> & paramTypes)
+				{
+					StringBuilder key;
+					key << "func" << returnType;
+					for (auto paramType : paramTypes)
+						key << "," << paramType;
+					return GetOrCreate(types, key.ProduceString(), [&](int id)
+					{
+						Globals.Begin(OpTypeFunction);
+						Globals.Add(id);
+						Globals.Add(returnType);
+						Globals.Add(paramTypes);
+						Globals.End();
+					});
+				}
+				int ConstantInt(int value)
+				{
+					int type = TypeInt(true);
+					return GetOrCreate(constants, "i" + String(value), [&](int id) { Globals.Emit(OpConstant, { type, id, value }); });
+				}
+				int ConstantUInt(unsigned int value)
+				{
+					int type = TypeInt(false);
+					return GetOrCreate(constants, "u" + String(value), [&](int id) { Globals.Emit(OpConstant, { type, id, (int)value }); });
+				}
+				int ConstantFloat(float value)
+				{
+					union
+					{
+						float f;
+						int i;
+					} bits;
+					bits.f = value;
+					int type = TypeFloat();
+					return GetOrCreate(constants, "f" + String(bits.i), [&](int id) { Globals.Emit(OpConstant, { type, id, bits.i }); });
+				}
+				int ConstantBool(bool value)
+				{
+					int type = TypeBool();
+					return GetOrCreate(constants, value ? "true" : "false", [&](int id)
+					{
+						Globals.Emit(value ? OpConstantTrue : OpConstantFalse, { type, id });
+					});
+				}
+				int ConstantComposite(int type, const List<int> & parts)
+				{
+					StringBuilder key;
+					key << "c" << type;
+					for (auto part : parts)
+						key << "," << part;
+					return GetOrCreate(constants, key.ProduceString(), [&](int id)
+					{
+						Globals.Begin(OpConstantComposite);
+						Globals.Add(type);
+						Globals.Add(id);
+						Globals.Add(parts);
+						Globals.End();
+					});
+				}
+				int Undef(int type)
+				{
+					int id;
+					if (undefs.TryGetValue(type, id))
+						return id;
+					id = AllocId();
+					Globals.Emit(OpUndef, { type, id });
+					undefs[type] = id;
+					return id;
+				}
+				int Variable(StorageClass storage, int pointerType)
+				{
+					int id = AllocId();
+					Globals.Emit(OpVariable, { pointerType, id, storage });
+					return id;
+				}
+				void Decorate(int id, Decoration decoration, std::initializer_list<int> args = {})
+				{
+					Annotations.Begin(OpDecorate);
+					Annotations.Add(id);
+					Annotations.Add(decoration);
+					for (auto arg : args)
+						Annotations.Add(arg);
+					Annotations.End();
+				}
+				void MemberDecorate(int id, int member, Decoration decoration, std::initializer_list<int> args = {})
+				{
+					Annotations.Begin(OpMemberDecorate);
+					Annotations.Add(id);
+					Annotations.Add(member);
+					Annotations.Add(decoration);
+					for (auto arg : args)
+						Annotations.Add(arg);
+					Annotations.End();
+				}
+				void Name(int id, const String & name)
+				{
+					DebugNames.Begin(OpName);
+					DebugNames.Add(id);
+					DebugNames.AddString(name);
+					DebugNames.End();
+				}
+				void MemberName(int id, int member, const String & name)
+				{
+					DebugNames.Begin(OpMemberName);
+					DebugNames.Add(id);
+					DebugNames.Add(member);
+					DebugNames.AddString(name);
+					DebugNames.End();
+				}
+				void Assemble(List<unsigned char> & output)
 				{
-					printf("\t%-*S = %-*S (%S)\n",
-						maxAttrNameLength, attr.Value.Name.ToWString(),
-						maxAttrValueLength, attr.Value.Value.ToWString(),
-						attr.Value.Position.ToString().ToWString());
+					List<unsigned int> words;
+					words.Add(MagicNumber);
+					words.Add(Version);
+					words.Add(0); // generator
+					words.Add((unsigned int)idBound);
+					words.Add(0); // schema
+					for (auto section : { &Capabilities, &ExtInstImports, &MemoryModel, &EntryPoints, &ExecutionModes,
+						&DebugNames, &Annotations, &Globals, &Functions })
+						words.AddRange(section->Words);
+					output.SetSize(words.Count() * 4);
+					for (int i = 0; i < words.Count(); i++)
+					{
+						output[i * 4] = (unsigned char)(words[i] & 0xFF);
+						output[i * 4 + 1] = (unsigned char)((words[i] >> 8) & 0xFF);
+						output[i * 4 + 2] = (unsigned char)((words[i] >> 16) & 0xFF);
+						output[i * 4 + 3] = (unsigned char)((words[i] >> 24) & 0xFF);
+					}
 				}
+			};
+		}
+
+		using namespace SpirV;
+
+		enum class ScalarKind
+		{
+			None, Bool, Int, UInt, Float
+		};
+
+		enum class MemoryLayout
+		{
+			Plain, Std140, Std430
+		};
+
+		static ILBaseType GetBaseType(ILType * type)
+		{
+			if (auto basicType = dynamic_cast<ILBasicType*>(type))
+				return basicType->Type;
+			return ILBaseType::Void;
+		}
 
-				printf("\n");
+		static bool IsMatrixType(ILBaseType type)
+		{
+			return type == ILBaseType::Float3x3 || type == ILBaseType::Float4x4;
+		}
+
+		static ScalarKind GetScalarKind(ILBaseType type)
+		{
+			if (type >= ILBaseType::Int && type <= ILBaseType::Int4)
+				return ScalarKind::Int;
+			if (type >= ILBaseType::UInt && type <= ILBaseType::UInt4)
+				return ScalarKind::UInt;
+			if (type >= ILBaseType::Bool && type <= ILBaseType::Bool4)
+				return ScalarKind::Bool;
+			if ((type >= ILBaseType::Float && type <= ILBaseType::Float4) || IsMatrixType(type))
+				return ScalarKind::Float;
+			return ScalarKind::None;
+		}
+
+		// number of components of a scalar or vector, number of columns of a matrix
+		static int GetComponentCount(ILBaseType type)
+		{
+			switch (GetScalarKind(type))
+			{
+			case ScalarKind::Int:
+				return (int)type - (int)ILBaseType::Int + 1;
+			case ScalarKind::UInt:
+				return (int)type - (int)ILBaseType::UInt + 1;
+			case ScalarKind::Bool:
+				return (int)type - (int)ILBaseType::Bool + 1;
+			case ScalarKind::Float:
+				if (type == ILBaseType::Float3x3)
+					return 3;
+				if (type == ILBaseType::Float4x4)
+					return 4;
+				return (int)type - (int)ILBaseType::Float + 1;
+			default:
+				return 0;
 			}
+		}
+
+		static ILBaseType MakeBaseType(ScalarKind kind, int count)
+		{
+			switch (kind)
+			{
+			case ScalarKind::Int:
+				return (ILBaseType)((int)ILBaseType::Int + count - 1);
+			case ScalarKind::UInt:
+				return (ILBaseType)((int)ILBaseType::UInt + count - 1);
+			case ScalarKind::Bool:
+				return (ILBaseType)((int)ILBaseType::Bool + count - 1);
+			case ScalarKind::Float:
+				return (ILBaseType)((int)ILBaseType::Float + count - 1);
+			default:
+				return ILBaseType::Void;
+			}
+		}
+
+		static bool IsOpaqueType(ILType * type)
+		{
+			return type->IsTexture() || type->IsSamplerState();
+		}
+
+		static bool IsLazyInstruction(ILInstruction * instr)
+		{
+			return instr->Is<LoadInputInstruction>() || instr->Is<ProjectInstruction>() || instr->Is<MemberLoadInstruction>();
+		}
+
+		// imports of these types are references to a resource of another world rather than values,
+		// the same set CLikeCodeGen prints as expressions
+		static bool IsAliasImport(ILInstruction * instr)
+		{
+			if (auto import = dynamic_cast<ImportInstruction*>(instr))
+				return import->Type->IsTexture() || import->Type.As<ILArrayType>() || import->Type->IsSamplerState()
+					|| import->Type.As<ILGenericType>();
+			return false;
+		}
+
+		static ILOperand * GetImportOperand(ImportInstruction * import)
+		{
+			auto node = import->ImportOperator.Ptr();
+			if (node->begin() == node->end())
+				return nullptr;
+			if (auto ret = node->GetLastInstruction()->As<ReturnInstruction>())
+				return ret->Operand.Ptr();
+			return nullptr;
+		}
 
-			printf("\n---\n\n");
+		static String GetOriginalFunctionName(const String & name)
+		{
+			int splitPos = name.IndexOf('@');
+			if (splitPos > 0)
+				return name.SubString(0, splitPos);
+			return name;
+		}
 
-			for (auto& world : shader->Worlds)
+		static int GetLocationCount(ILType * type)
+		{
+			if (auto arrayType = dynamic_cast<ILArrayType*>(type))
+				return arrayType->ArrayLength * GetLocationCount(arrayType->BaseType.Ptr());
+			if (auto structType = dynamic_cast<ILStructType*>(type))
 			{
-				printf("World: %S\n", world.Key.ToWString());
-				//auto& worldIL = world.Value;
+				int count = 0;
+				for (auto & member : structType->Members)
+					count += GetLocationCount(member.Type.Ptr());
+				return count;
 			}
+			auto baseType = GetBaseType(type);
+			if (IsMatrixType(baseType))
+				return GetComponentCount(baseType);
+			return 1;
 		}
 
-		class SpirVCodeGen : public CodeGenBackend
+		struct SpvValue
+		{
+			int Id = 0;
+			ILType * Type = nullptr;
+			SpvValue() = default;
+			SpvValue(int id, ILType * type)
+				: Id(id), Type(type)
+			{}
+		};
+
+		struct SpvPointer
+		{
+			int Id = 0;
+			ILType * Type = nullptr;
+			StorageClass Storage = StorageClassFunction;
+			MemoryLayout Layout = MemoryLayout::Plain;
+			SpvPointer() = default;
+			SpvPointer(int id, ILType * type, StorageClass storage, MemoryLayout layout = MemoryLayout::Plain)
+				: Id(id), Type(type), Storage(storage), Layout(layout)
+			{}
+		};
+
+		struct LoopTargets
+		{
+			int ContinueLabel, MergeLabel;
+		};
+
+		// An operand that is used outside of the structured construct that defines it cannot be
+		// referenced as an SSA value (its definition may not dominate the use), so such operands
+		// get a Function-storage "home" variable, much like CLikeCodeGen declares a local for them.
+		class SpirVFunctionState
 		{
 		public:
-			virtual CompiledShaderSource GenerateShader(CompileResult & /*result*/, SymbolTable * /*symbols*/, ILShader * shader, DiagnosticSink * /*err*/) override
+			ILFunction * Function = nullptr; // null for the stage entry point
+			CFGNode * RootNode = nullptr;
+			InstructionStream Variables, Body;
+			List<SpvPointer> Parameters;
+			// keyed by ILInstruction* rather than ILOperand*: pointer keys hash by pointee size,
+			// so lookups must use exactly the key type
+			Dictionary<ILInstruction*, SpvPointer> Homes;
+			Dictionary<ILInstruction*, SpvValue> Values;
+			HashSet<ILInstruction*> Materialized;
+			Dictionary<CFGNode*, ILInstruction*> NodeOwners;
+			List<LoopTargets> Loops;
+			List<ImportInstruction*> Imports;
+		};
+
+		class SpirVStageCodeGen
+		{
+		private:
+			struct ParameterVariable
+			{
+				int Variable = 0;
+				int Member = -1;
+				StorageClass Storage = StorageClassUniformConstant;
+				MemoryLayout Layout = MemoryLayout::Plain;
+			};
+
+			ILProgram * program;
+			ILShader * shader;
+			ILStage * stage;
+			ILWorld * world = nullptr;
+			DiagnosticSink * sink;
+			ModuleBuilder module;
+			ExecutionModel executionModel = ExecutionModelVertex;
+			int glslStd450 = 0, mainFunction = 0;
+			List<int> interfaceVariables;
+			SpirVFunctionState * fn = nullptr;
+			ILOperand * positionOperand = nullptr;
+			Dictionary<int, RefPtr<ILType>> basicTypes;
+			List<RefPtr<ILType>> ownedTypes;
+			Dictionary<String, int> structTypes;
+			Dictionary<ILModuleParameterInstance*, ParameterVariable> parameterVariables;
+			Dictionary<String, SpvPointer> inputVariables, outputVariables;
+			Dictionary<int, SpvPointer> builtinVariables;
+			Dictionary<String, int> functionIds;
+			List<ILFunction*> pendingFunctions;
+
+			bool IsFragmentStage()
+			{
+				return executionModel == ExecutionModelFragment;
+			}
+
+			// types
+
+			ILType * BasicType(ILBaseType type)
+			{
+				RefPtr<ILType> rs;
+				if (basicTypes.TryGetValue((int)type, rs))
+					return rs.Ptr();
+				rs = new ILBasicType(type);
+				basicTypes[(int)type] = rs;
+				return rs.Ptr();
+			}
+			ILType * ArrayType(ILType * baseType, int length)
+			{
+				auto arrayType = new ILArrayType();
+				arrayType->BaseType = baseType;
+				arrayType->ArrayLength = length;
+				ownedTypes.Add(arrayType);
+				return arrayType;
+			}
+			LayoutRulesImpl * GetRules(MemoryLayout layout)
+			{
+				return GetLayoutRulesImpl(layout == MemoryLayout::Std430 ? LayoutRule::Std430 : LayoutRule::Std140);
+			}
+			int GetArrayStride(ILType * elementType, MemoryLayout layout)
+			{
+				auto rules = GetRules(layout);
+				auto elementLayout = GetLayout(elementType, rules);
+				return RoundToAlignment((int)rules->GetArrayLayout(elementLayout, 1).size, (int)elementLayout.alignment);
+			}
+			void DecorateMatrixMember(int structType, int member, ILType * type)
+			{
+				while (auto arrayType = dynamic_cast<ILArrayType*>(type))
+					type = arrayType->BaseType.Ptr();
+				if (type->IsFloatMatrix())
+				{
+					module.MemberDecorate(structType, member, DecorationColMajor);
+					module.MemberDecorate(structType, member, DecorationMatrixStride, { 16 });
+				}
+			}
+			int GetBasicTypeId(ILBaseType type, MemoryLayout layout)
+			{
+				switch (type)
+				{
+				case ILBaseType::Void:
+					return module.TypeVoid();
+				case ILBaseType::Texture2D:
+					return module.TypeImage(Dim2D, false, false);
+				case ILBaseType::TextureCube:
+					return module.TypeImage(DimCube, false, false);
+				case ILBaseType::Texture2DArray:
+					return module.TypeImage(Dim2D, false, true);
+				case ILBaseType::Texture2DShadow:
+					return module.TypeImage(Dim2D, true, false);
+				case ILBaseType::TextureCubeShadow:
+					return module.TypeImage(DimCube, true, false);
+				case ILBaseType::Texture2DArrayShadow:
+					return module.TypeImage(Dim2D, true, true);
+				case ILBaseType::Texture3D:
+					return module.TypeImage(Dim3D, false, false);
+				case ILBaseType::SamplerState:
+				case ILBaseType::SamplerComparisonState:
+					return module.TypeSampler();
+				default:
+					break;
+				}
+				auto kind = GetScalarKind(type);
+				int count = GetComponentCount(type);
+				int scalarType = 0;
+				switch (kind)
+				{
+				case ScalarKind::Bool:
+					// bool has no defined size, so it is stored as uint in buffers
+					scalarType = layout == MemoryLayout::Plain ? module.TypeBool() : module.TypeInt(false);
+					break;
+				case ScalarKind::Int:
+					scalarType = module.TypeInt(true);
+					break;
+				case ScalarKind::UInt:
+					scalarType = module.TypeInt(false);
+					break;
+				case ScalarKind::Float:
+					scalarType = module.TypeFloat();
+					break;
+				default:
+					SPIRE_UNIMPLEMENTED(sink, stage->Position, "SPIR-V type for '" + ILBasicType(type).ToString() + "'");
+					return module.TypeVoid();
+				}
+				if (IsMatrixType(type))
+					return module.TypeMatrix(module.TypeVector(scalarType, count), count);
+				if (count > 1)
+					return module.TypeVector(scalarType, count);
+				return scalarType;
+			}
+			int GetStructTypeId(ILStructType * structType, MemoryLayout layout)
+			{
+				String key = structType->TypeName + "#" + String((int)layout);
+				int id;
+				if (structTypes.TryGetValue(key, id))
+					return id;
+				List<int> memberTypes;
+				for (auto & member : structType->Members)
+					memberTypes.Add(GetTypeId(member.Type.Ptr(), layout));
+				id = module.AllocId();
+				module.Globals.Begin(OpTypeStruct);
+				module.Globals.Add(id);
+				module.Globals.Add(memberTypes);
+				module.Globals.End();
+				module.Name(id, structType->TypeName);
+				LayoutRulesImpl * rules = layout == MemoryLayout::Plain ? nullptr : GetRules(layout);
+				LayoutInfo structLayout;
+				if (rules)
+					structLayout = rules->BeginStructLayout();
+				for (int i = 0; i < structType->Members.Count(); i++)
+				{
+					auto & member = structType->Members[i];
+					module.MemberName(id, i, member.FieldName);
+					if (rules)
+					{
+						int offset = (int)rules->AddStructField(&structLayout, GetLayout(member.Type.Ptr(), rules));
+						module.MemberDecorate(id, i, DecorationOffset, { offset });
+						DecorateMatrixMember(id, i, member.Type.Ptr());
+					}
+				}
+				structTypes[key] = id;
+				return id;
+			}
+			int GetTypeId(ILType * type, MemoryLayout layout = MemoryLayout::Plain)
+			{
+				if (!type)
+					return module.TypeVoid();
+				if (auto basicType = dynamic_cast<ILBasicType*>(type))
+					return GetBasicTypeId(basicType->Type, layout);
+				if (auto arrayType = dynamic_cast<ILArrayType*>(type))
+				{
+					int elementType = GetTypeId(arrayType->BaseType.Ptr(), layout);
+					int stride = layout == MemoryLayout::Plain ? 0 : GetArrayStride(arrayType->BaseType.Ptr(), layout);
+					if (arrayType->ArrayLength == 0)
+						return module.TypeRuntimeArray(elementType, stride);
+					return module.TypeArray(elementType, arrayType->ArrayLength, stride);
+				}
+				if (auto structType = dynamic_cast<ILStructType*>(type))
+					return GetStructTypeId(structType, layout);
+				SPIRE_UNIMPLEMENTED(sink, stage->Position, "SPIR-V type for '" + type->ToString() + "'");
+				return module.TypeVoid();
+			}
+			int GetPointerTypeId(StorageClass storage, ILType * type, MemoryLayout layout = MemoryLayout::Plain)
+			{
+				return module.TypePointer(storage, GetTypeId(type, layout));
+			}
+
+			// instruction emission into the current function
+
+			int Emit(Op op, int resultType, std::initializer_list<int> operands)
+			{
+				int id = module.AllocId();
+				fn->Body.Begin(op);
+				fn->Body.Add(resultType);
+				fn->Body.Add(id);
+				for (auto operand : operands)
+					fn->Body.Add(operand);
+				fn->Body.End();
+				return id;
+			}
+			int Emit(Op op, int resultType, const List<int> & operands)
+			{
+				int id = module.AllocId();
+				fn->Body.Begin(op);
+				fn->Body.Add(resultType);
+				fn->Body.Add(id);
+				fn->Body.Add(operands);
+				fn->Body.End();
+				return id;
+			}
+			int EmitExtInst(GLSLstd450 inst, int resultType, const List<int> & operands)
+			{
+				int id = module.AllocId();
+				fn->Body.Begin(OpExtInst);
+				fn->Body.Add(resultType);
+				fn->Body.Add(id);
+				fn->Body.Add(glslStd450);
+				fn->Body.Add(inst);
+				fn->Body.Add(operands);
+				fn->Body.End();
+				return id;
+			}
+			int EmitLabel()
+			{
+				int label = module.AllocId();
+				fn->Body.Emit(OpLabel, { label });
+				return label;
+			}
+			void EmitLabel(int label)
+			{
+				fn->Body.Emit(OpLabel, { label });
+			}
+			// code following a branch, return or kill is unreachable but must still be in a block
+			void EmitTerminator(Op op, std::initializer_list<int> operands)
+			{
+				fn->Body.Emit(op, operands);
+				EmitLabel();
+			}
+			SpvPointer AllocLocal(ILType * type, const String & name)
+			{
+				int id = module.AllocId();
+				fn->Variables.Emit(OpVariable, { GetPointerTypeId(StorageClassFunction, type), id, StorageClassFunction });
+				if (name.Length())
+					module.Name(id, name);
+				return SpvPointer(id, type, StorageClassFunction);
+			}
+
+			// constants
+
+			int ConstantScalar(ScalarKind kind, double value)
+			{
+				switch (kind)
+				{
+				case ScalarKind::Float:
+					return module.ConstantFloat((float)value);
+				case ScalarKind::Int:
+					return module.ConstantInt((int)value);
+				case ScalarKind::UInt:
+					return module.ConstantUInt((unsigned int)value);
+				default:
+					return module.ConstantBool(value != 0.0);
+				}
+			}
+			SpvValue Constant(ILBaseType type, double value)
+			{
+				auto kind = GetScalarKind(type);
+				int count = GetComponentCount(type);
+				int scalar = ConstantScalar(kind, value);
+				if (count == 1)
+					return SpvValue(scalar, BasicType(type));
+				List<int> parts;
+				for (int i = 0; i < count; i++)
+					parts.Add(scalar);
+				return SpvValue(module.ConstantComposite(GetTypeId(BasicType(type)), parts), BasicType(type));
+			}
+			double GetConstComponent(ILConstOperand * c, ScalarKind kind, int index)
+			{
+				switch (kind)
+				{
+				case ScalarKind::Float:
+					return c->FloatValues[index];
+				case ScalarKind::UInt:
+					return (unsigned int)c->IntValues[index];
+				default:
+					return c->IntValues[index];
+				}
+			}
+			// builds the constant `c` directly as `targetType`, folding conversions on the host
+			bool TryFoldConstant(ILConstOperand * c, ILBaseType targetType, SpvValue & result)
+			{
+				auto srcType = GetBaseType(c->Type.Ptr());
+				auto srcKind = GetScalarKind(srcType), dstKind = GetScalarKind(targetType);
+				if (srcKind == ScalarKind::None || dstKind == ScalarKind::None)
+					return false;
+				int srcCount = GetComponentCount(srcType), dstCount = GetComponentCount(targetType);
+				if (IsMatrixType(srcType) || IsMatrixType(targetType))
+				{
+					if (srcType != targetType)
+						return false;
+					List<int> columns;
+					int columnType = GetTypeId(BasicType(MakeBaseType(ScalarKind::Float, dstCount)));
+					for (int col = 0; col < dstCount; col++)
+					{
+						List<int> parts;
+						for (int row = 0; row < dstCount; row++)
+							parts.Add(module.ConstantFloat(c->FloatValues[col * dstCount + row]));
+						columns.Add(module.ConstantComposite(columnType, parts));
+					}
+					result = SpvValue(module.ConstantComposite(GetTypeId(BasicType(targetType)), columns), BasicType(targetType));
+					return true;
+				}
+				if (srcCount != 1 && srcCount < dstCount)
+					return false;
+				List<int> parts;
+				for (int i = 0; i < dstCount; i++)
+					parts.Add(ConstantScalar(dstKind, GetConstComponent(c, srcKind, srcCount == 1 ? 0 : i)));
+				if (dstCount == 1)
+					result = SpvValue(parts[0], BasicType(targetType));
+				else
+					result = SpvValue(module.ConstantComposite(GetTypeId(BasicType(targetType)), parts), BasicType(targetType));
+				return true;
+			}
+
+			// conversions
+
+			SpvValue Extract(SpvValue value, int index, ILType * resultType)
+			{
+				return SpvValue(Emit(OpCompositeExtract, GetTypeId(resultType), { value.Id, index }), resultType);
+			}
+			SpvValue Splat(SpvValue scalar, int count)
+			{
+				if (count == 1)
+					return scalar;
+				auto type = BasicType(MakeBaseType(GetScalarKind(GetBaseType(scalar.Type)), count));
+				List<int> parts;
+				for (int i = 0; i < count; i++)
+					parts.Add(scalar.Id);
+				return SpvValue(Emit(OpCompositeConstruct, GetTypeId(type), parts), type);
+			}
+			SpvValue Shrink(SpvValue value, int count)
+			{
+				auto baseType = GetBaseType(value.Type);
+				auto kind = GetScalarKind(baseType);
+				if (GetComponentCount(baseType) <= count)
+					return value;
+				auto type = BasicType(MakeBaseType(kind, count));
+				if (count == 1)
+					return Extract(value, 0, type);
+				List<int> operands;
+				operands.Add(value.Id);
+				operands.Add(value.Id);
+				for (int i = 0; i < count; i++)
+					operands.Add(i);
+				return SpvValue(Emit(OpVectorShuffle, GetTypeId(type), operands), type);
+			}
+			SpvValue ConvertKind(SpvValue value, ScalarKind kind)
+			{
+				auto baseType = GetBaseType(value.Type);
+				auto srcKind = GetScalarKind(baseType);
+				if (srcKind == kind || srcKind == ScalarKind::None || kind == ScalarKind::None)
+					return value;
+				int count = GetComponentCount(baseType);
+				auto type = BasicType(MakeBaseType(kind, count));
+				int typeId = GetTypeId(type);
+				if (kind == ScalarKind::Bool)
+				{
+					auto zero = Constant(baseType, 0.0);
+					return SpvValue(Emit(srcKind == ScalarKind::Float ? OpFUnordNotEqual : OpINotEqual, typeId, { value.Id, zero.Id }), type);
+				}
+				if (srcKind == ScalarKind::Bool)
+				{
+					auto dstType = MakeBaseType(kind, count);
+					auto one = Constant(dstType, 1.0), zero = Constant(dstType, 0.0);
+					return SpvValue(Emit(OpSelect, typeId, { value.Id, one.Id, zero.Id }), type);
+				}
+				Op op = OpBitcast;
+				if (srcKind == ScalarKind::Float)
+					op = kind == ScalarKind::Int ? OpConvertFToS : OpConvertFToU;
+				else if (kind == ScalarKind::Float)
+					op = srcKind == ScalarKind::Int ? OpConvertSToF : OpConvertUToF;
+				return SpvValue(Emit(op, typeId, { value.Id }), type);
+			}
+			// implicit conversions between basic types: truncation, splatting and component type changes
+			SpvValue Convert(SpvValue value, ILType * targetType)
+			{
+				if (!targetType || !value.Type || value.Type == targetType)
+					return value;
+				auto srcType = GetBaseType(value.Type), dstType = GetBaseType(targetType);
+				if (srcType == dstType || GetScalarKind(srcType) == ScalarKind::None || GetScalarKind(dstType) == ScalarKind::None)
+					return SpvValue(value.Id, srcType == dstType ? targetType : value.Type);
+				if (IsMatrixType(srcType) || IsMatrixType(dstType))
+				{
+					if (srcType == ILBaseType::Float4x4 && dstType == ILBaseType::Float3x3)
+					{
+						List<int> columns;
+						auto columnType = BasicType(ILBaseType::Float4);
+						for (int i = 0; i < 3; i++)
+							columns.Add(Shrink(Extract(value, i, columnType), 3).Id);
+						return SpvValue(Emit(OpCompositeConstruct, GetTypeId(targetType), columns), targetType);
+					}
+					SPIRE_UNIMPLEMENTED(sink, stage->Position, "conversion from '" + value.Type->ToString() + "' to '" + targetType->ToString() + "'");
+					return value;
+				}
+				int dstCount = GetComponentCount(dstType);
+				auto rs = Shrink(value, dstCount);
+				rs = ConvertKind(rs, GetScalarKind(dstType));
+				int srcCount = GetComponentCount(GetBaseType(rs.Type));
+				if (srcCount == 1)
+					rs = Splat(rs, dstCount);
+				else if (srcCount < dstCount)
+				{
+					List<int> parts;
+					parts.Add(rs.Id);
+					auto zero = Constant(MakeBaseType(GetScalarKind(dstType), 1), 0.0);
+					for (int i = srcCount; i < dstCount; i++)
+						parts.Add(zero.Id);
+					rs = SpvValue(Emit(OpCompositeConstruct, GetTypeId(targetType), parts), targetType);
+				}
+				rs.Type = targetType;
+				return rs;
+			}
+			int ToBool(ILOperand * op)
+			{
+				auto value = Eval(op);
+				value = Shrink(value, 1);
+				return ConvertKind(value, ScalarKind::Bool).Id;
+			}
+
+			// layout conversion for values that live in explicitly laid out buffer memory
+
+			int ChangeLayout(int id, ILType * type, MemoryLayout srcLayout, MemoryLayout dstLayout)
+			{
+				if (srcLayout == dstLayout)
+					return id;
+				if (auto basicType = dynamic_cast<ILBasicType*>(type))
+				{
+					if (GetScalarKind(basicType->Type) != ScalarKind::Bool)
+						return id;
+					int count = GetComponentCount(basicType->Type);
+					auto uintType = MakeBaseType(ScalarKind::UInt, count);
+					if (srcLayout == MemoryLayout::Plain)
+						return Emit(OpSelect, GetTypeId(BasicType(uintType)), { id, Constant(uintType, 1.0).Id, Constant(uintType, 0.0).Id });
+					if (dstLayout == MemoryLayout::Plain)
+						return Emit(OpINotEqual, GetTypeId(type), { id, Constant(uintType, 0.0).Id });
+					return id;
+				}
+				List<int> parts;
+				if (auto arrayType = dynamic_cast<ILArrayType*>(type))
+				{
+					auto elementType = arrayType->BaseType.Ptr();
+					for (int i = 0; i < arrayType->ArrayLength; i++)
+					{
+						int element = Emit(OpCompositeExtract, GetTypeId(elementType, srcLayout), { id, i });
+						parts.Add(ChangeLayout(element, elementType, srcLayout, dstLayout));
+					}
+				}
+				else if (auto structType = dynamic_cast<ILStructType*>(type))
+				{
+					for (int i = 0; i < structType->Members.Count(); i++)
+					{
+						auto memberType = structType->Members[i].Type.Ptr();
+						int member = Emit(OpCompositeExtract, GetTypeId(memberType, srcLayout), { id, i });
+						parts.Add(ChangeLayout(member, memberType, srcLayout, dstLayout));
+					}
+				}
+				else
+					return id;
+				return Emit(OpCompositeConstruct, GetTypeId(type, dstLayout), parts);
+			}
+			SpvValue Load(const SpvPointer & ptr)
+			{
+				int id = Emit(OpLoad, GetTypeId(ptr.Type, ptr.Layout), { ptr.Id });
+				return SpvValue(ChangeLayout(id, ptr.Type, ptr.Layout, MemoryLayout::Plain), ptr.Type);
+			}
+			void Store(const SpvPointer & ptr, SpvValue value)
 			{
-				PrintILShader(shader);
-				system("pause");
-				return CompiledShaderSource();
+				value = Convert(value, ptr.Type);
+				fn->Body.Emit(OpStore, { ptr.Id, ChangeLayout(value.Id, ptr.Type, MemoryLayout::Plain, ptr.Layout) });
 			}
 
-            LayoutRule GetDefaultLayoutRule() override
-            {
-                return LayoutRule::Std140;
-            }
+			// interface variables
 
-    };
+			void DeclareParameters()
+			{
+				for (auto & paramSet : shader->ModuleParamSets)
+				{
+					auto set = paramSet.Value.Ptr();
+					auto bufferName = EscapeCodeName(set->BindingName);
+					auto setBindings = [&](int variable, int binding)
+					{
+						if (set->DescriptorSetId >= 0)
+							module.Decorate(variable, DecorationDescriptorSet, { set->DescriptorSetId });
+						module.Decorate(variable, DecorationBinding, { binding });
+					};
+					List<ILModuleParameterInstance*> ordinaryParams;
+					for (auto & param : set->Parameters)
+						if (param.Value->BufferOffset != -1)
+							ordinaryParams.Add(param.Value.Ptr());
+					if (ordinaryParams.Count())
+					{
+						List<int> memberTypes;
+						for (auto param : ordinaryParams)
+							memberTypes.Add(GetTypeId(param->Type.Ptr(), MemoryLayout::Std140));
+						int blockType = module.AllocId();
+						module.Globals.Begin(OpTypeStruct);
+						module.Globals.Add(blockType);
+						module.Globals.Add(memberTypes);
+						module.Globals.End();
+						module.Name(blockType, "buf" + bufferName);
+						module.Decorate(blockType, DecorationBlock);
+						for (int i = 0; i < ordinaryParams.Count(); i++)
+						{
+							module.MemberName(blockType, i, ordinaryParams[i]->Name);
+							module.MemberDecorate(blockType, i, DecorationOffset, { ordinaryParams[i]->BufferOffset });
+							DecorateMatrixMember(blockType, i, ordinaryParams[i]->Type.Ptr());
+						}
+						int variable = module.Variable(StorageClassUniform, module.TypePointer(StorageClassUniform, blockType));
+						module.Name(variable, bufferName);
+						setBindings(variable, 0);
+						for (int i = 0; i < ordinaryParams.Count(); i++)
+						{
+							ParameterVariable paramVar;
+							paramVar.Variable = variable;
+							paramVar.Member = i;
+							paramVar.Storage = StorageClassUniform;
+							paramVar.Layout = MemoryLayout::Std140;
+							parameterVariables[ordinaryParams[i]] = paramVar;
+						}
+					}
+					int slotId = ordinaryParams.Count() ? 1 : 0;
+					for (auto & param : set->Parameters)
+					{
+						ParameterVariable paramVar;
+						auto resourceName = EscapeCodeName(set->BindingName + "_" + param.Value->Name);
+						switch (param.Value->Type->GetBindableResourceType())
+						{
+						case BindableResourceType::StorageBuffer:
+						{
+							auto genType = param.Value->Type.As<ILGenericType>();
+							if (!genType)
+								continue;
+							auto elementType = genType->BaseType.Ptr();
+							int arrayType = module.TypeRuntimeArray(GetTypeId(elementType, MemoryLayout::Std430),
+								GetArrayStride(elementType, MemoryLayout::Std430));
+							int blockType = module.AllocId();
+							module.Globals.Emit(OpTypeStruct, { blockType, arrayType });
+							module.Name(blockType, "buf" + resourceName);
+							module.MemberName(blockType, 0, resourceName);
+							module.Decorate(blockType, DecorationBufferBlock);
+							module.MemberDecorate(blockType, 0, DecorationOffset, { 0 });
+							DecorateMatrixMember(blockType, 0, elementType);
+							paramVar.Variable = module.Variable(StorageClassUniform, module.TypePointer(StorageClassUniform, blockType));
+							paramVar.Storage = StorageClassUniform;
+							paramVar.Layout = MemoryLayout::Std430;
+							break;
+						}
+						case BindableResourceType::Texture:
+						case BindableResourceType::Sampler:
+							paramVar.Variable = module.Variable(StorageClassUniformConstant,
+								GetPointerTypeId(StorageClassUniformConstant, param.Value->Type.Ptr()));
+							paramVar.Storage = StorageClassUniformConstant;
+							break;
+						default:
+							continue;
+						}
+						module.Name(paramVar.Variable, resourceName);
+						setBindings(paramVar.Variable, slotId);
+						parameterVariables[param.Value.Ptr()] = paramVar;
+						slotId++;
+					}
+				}
+			}
+			bool GetParameterPointer(ILModuleParameterInstance * param, SpvPointer & ptr)
+			{
+				ParameterVariable paramVar;
+				if (!parameterVariables.TryGetValue(param, paramVar))
+				{
+					SPIRE_UNIMPLEMENTED(sink, param->Position, "SPIR-V code generation for parameter '" + param->Name + "'");
+					return false;
+				}
+				ptr = SpvPointer(paramVar.Variable, param->Type.Ptr(), paramVar.Storage, paramVar.Layout);
+				if (paramVar.Member != -1)
+				{
+					ptr.Id = Emit(OpAccessChain, GetPointerTypeId(paramVar.Storage, ptr.Type, paramVar.Layout),
+						{ paramVar.Variable, module.ConstantInt(paramVar.Member) });
+				}
+				return true;
+			}
+			SpvPointer GetBuiltinVariable(BuiltIn builtIn, StorageClass storage, ILType * type, const String & name)
+			{
+				int key = (int)builtIn * 8 + (int)storage;
+				SpvPointer ptr;
+				if (builtinVariables.TryGetValue(key, ptr))
+					return ptr;
+				ptr = SpvPointer(module.Variable(storage, GetPointerTypeId(storage, type)), type, storage);
+				module.Decorate(ptr.Id, DecorationBuiltIn, { builtIn });
+				if (IsFragmentStage() && storage == StorageClassInput && type->IsIntegral())
+					module.Decorate(ptr.Id, DecorationFlat);
+				module.Name(ptr.Id, name);
+				interfaceVariables.Add(ptr.Id);
+				builtinVariables[key] = ptr;
+				return ptr;
+			}
+			ILObjectDefinition * FindInput(const String & name)
+			{
+				for (auto & input : world->Inputs)
+					if (input.Name == name)
+						return &input;
+				return nullptr;
+			}
+			ExternComponentCodeGenInfo ExtractExternComponentInfo(const ILObjectDefinition & input)
+			{
+				ExternComponentCodeGenInfo info;
+				auto type = input.Type.Ptr();
+				info.Type = type;
+				if (ExtractRecordType(type))
+				{
+					if (auto genType = dynamic_cast<ILGenericType*>(type))
+					{
+						if (genType->GenericTypeName == "Patch")
+						{
+							type = genType->BaseType.Ptr();
+							info.DataStructure = ExternComponentCodeGenInfo::DataStructureType::Patch;
+						}
+					}
+					if (auto arrType = dynamic_cast<ILArrayType*>(type))
+					{
+						info.IsArray = true;
+						info.ArrayLength = arrType->ArrayLength;
+					}
+				}
+				else if (input.Attributes.ContainsKey("TessCoord"))
+					info.SystemVar = ExternComponentCodeGenInfo::SystemVarType::TessCoord;
+				else if (input.Attributes.ContainsKey("FragCoord"))
+					info.SystemVar = ExternComponentCodeGenInfo::SystemVarType::FragCoord;
+				else if (input.Attributes.ContainsKey("InvocationId"))
+					info.SystemVar = ExternComponentCodeGenInfo::SystemVarType::InvocationId;
+				else if (input.Attributes.ContainsKey("ThreadId"))
+					info.SystemVar = ExternComponentCodeGenInfo::SystemVarType::ThreadId;
+				else if (input.Attributes.ContainsKey("PrimitiveId"))
+					info.SystemVar = ExternComponentCodeGenInfo::SystemVarType::PrimitiveId;
+				else if (input.Attributes.ContainsKey("PatchVertexCount"))
+					info.SystemVar = ExternComponentCodeGenInfo::SystemVarType::PatchVertexCount;
+				else if (input.Attributes.ContainsKey("InstanceId"))
+					info.SystemVar = ExternComponentCodeGenInfo::SystemVarType::InstanceId;
+				return info;
+			}
+			bool GetSystemVarPointer(LoadInputInstruction * load, SpvPointer & ptr)
+			{
+				auto input = FindInput(load->InputName);
+				if (!input)
+					return false;
+				auto info = ExtractExternComponentInfo(*input);
+				switch (info.SystemVar)
+				{
+				case ExternComponentCodeGenInfo::SystemVarType::TessCoord:
+					ptr = GetBuiltinVariable(BuiltInTessCoord, StorageClassInput, BasicType(ILBaseType::Float3), "gl_TessCoord");
+					return true;
+				case ExternComponentCodeGenInfo::SystemVarType::FragCoord:
+					ptr = GetBuiltinVariable(BuiltInFragCoord, StorageClassInput, BasicType(ILBaseType::Float4), "gl_FragCoord");
+					return true;
+				case ExternComponentCodeGenInfo::SystemVarType::InvocationId:
+					ptr = GetBuiltinVariable(BuiltInInvocationId, StorageClassInput, BasicType(ILBaseType::Int), "gl_InvocationID");
+					return true;
+				case ExternComponentCodeGenInfo::SystemVarType::PrimitiveId:
+					if (IsFragmentStage())
+						module.RequireCapability(CapabilityGeometry);
+					ptr = GetBuiltinVariable(BuiltInPrimitiveId, StorageClassInput, BasicType(ILBaseType::Int), "gl_PrimitiveID");
+					return true;
+				case ExternComponentCodeGenInfo::SystemVarType::PatchVertexCount:
+					ptr = GetBuiltinVariable(BuiltInPatchVertices, StorageClassInput, BasicType(ILBaseType::Int), "gl_PatchVerticesIn");
+					return true;
+				case ExternComponentCodeGenInfo::SystemVarType::InstanceId:
+					ptr = GetBuiltinVariable(BuiltInInstanceIndex, StorageClassInput, BasicType(ILBaseType::Int), "gl_InstanceIndex");
+					return true;
+				case ExternComponentCodeGenInfo::SystemVarType::ThreadId:
+					// only compute stages have a thread id, and SPIR-V is not generated for them
+					SPIRE_UNIMPLEMENTED(sink, input->Position, "SPIR-V code generation for 'ThreadId' (use the GLSL_Vulkan target instead)");
+					return false;
+				default:
+					return false;
+				}
+			}
+			// locations follow declaration order of the record members, matching how outputs of
+			// the previous stage are numbered in DeclareOutputs()
+			int GetMemberLocation(ILRecordType * recType, const String & memberName, bool vertexInput)
+			{
+				int location = 0;
+				for (auto & member : recType->Members)
+				{
+					if (member.Key == memberName)
+						return location;
+					if (vertexInput)
+						location++;
+					else if (!member.Value.Attributes.ContainsKey("FragDepth"))
+						location += GetLocationCount(member.Value.Type.Ptr());
+				}
+				return location;
+			}
+			bool GetInputPointer(const String & inputName, const String & componentName, SpvPointer & ptr)
+			{
+				String key = inputName + "." + componentName;
+				if (inputVariables.TryGetValue(key, ptr))
+					return true;
+				auto input = FindInput(inputName);
+				if (!input)
+					return false;
+				auto recType = ExtractRecordType(input->Type.Ptr());
+				if (!recType)
+					return false;
+				ILObjectDefinition member;
+				if (!recType->Members.TryGetValue(componentName, member))
+					return false;
+				auto info = ExtractExternComponentInfo(*input);
+				ILType * type = member.Type.Ptr();
+				if (info.IsArray)
+					type = ArrayType(type, info.ArrayLength ? info.ArrayLength : 32);
+				bool vertexInput = input->Attributes.ContainsKey("VertexInput");
+				ptr = SpvPointer(module.Variable(StorageClassInput, GetPointerTypeId(StorageClassInput, type)), type, StorageClassInput);
+				module.Decorate(ptr.Id, DecorationLocation, { GetMemberLocation(recType, componentName, vertexInput) });
+				if (info.DataStructure == ExternComponentCodeGenInfo::DataStructureType::Patch)
+					module.Decorate(ptr.Id, DecorationPatch);
+				if (IsFragmentStage() && (input->Attributes.ContainsKey("Flat") || member.Type->IsIntegral()))
+					module.Decorate(ptr.Id, DecorationFlat);
+				module.Name(ptr.Id, AddWorldNameSuffix(componentName, recType->ToString()));
+				interfaceVariables.Add(ptr.Id);
+				inputVariables[key] = ptr;
+				return true;
+			}
+			void DeclareOutputs()
+			{
+				auto outputType = world->OutputType.Ptr();
+				if (!outputType)
+					return;
+				int location = 0;
+				for (auto & field : outputType->Members)
+				{
+					SpvPointer ptr;
+					if (field.Value.Attributes.ContainsKey("FragDepth"))
+					{
+						ptr = GetBuiltinVariable(BuiltInFragDepth, StorageClassOutput, BasicType(ILBaseType::Float), "gl_FragDepth");
+						module.ExecutionModes.Emit(OpExecutionMode, { mainFunction, ExecutionModeDepthReplacing });
+					}
+					else
+					{
+						auto type = field.Value.Type.Ptr();
+						ptr = SpvPointer(module.Variable(StorageClassOutput, GetPointerTypeId(StorageClassOutput, type)), type, StorageClassOutput);
+						module.Decorate(ptr.Id, DecorationLocation, { location });
+						location += GetLocationCount(type);
+						if (!IsFragmentStage() && type->IsIntegral())
+							module.Decorate(ptr.Id, DecorationFlat);
+						module.Name(ptr.Id, AddWorldNameSuffix(field.Key, outputType->TypeName));
+						interfaceVariables.Add(ptr.Id);
+					}
+					outputVariables[field.Key] = ptr;
+				}
+			}
+
+			// pointers
+
+			int EvalIndex(ILOperand * index)
+			{
+				if (auto c = dynamic_cast<ILConstOperand*>(index))
+					return module.ConstantInt(c->IntValues[0]);
+				return Convert(Eval(index), BasicType(ILBaseType::Int)).Id;
+			}
+			bool GetElementPointer(const SpvPointer & base, ILOperand * index, SpvPointer & result)
+			{
+				List<int> operands;
+				operands.Add(base.Id);
+				ILType * elementType = nullptr;
+				auto layout = base.Layout;
+				if (auto genType = dynamic_cast<ILGenericType*>(base.Type))
+				{
+					operands.Add(module.ConstantInt(0));
+					operands.Add(EvalIndex(index));
+					elementType = genType->BaseType.Ptr();
+				}
+				else if (auto arrayType = dynamic_cast<ILArrayType*>(base.Type))
+				{
+					operands.Add(EvalIndex(index));
+					elementType = arrayType->BaseType.Ptr();
+				}
+				else if (auto structType = dynamic_cast<ILStructType*>(base.Type))
+				{
+					auto c = dynamic_cast<ILConstOperand*>(index);
+					if (!c)
+						return false;
+					operands.Add(module.ConstantInt(c->IntValues[0]));
+					elementType = structType->Members[c->IntValues[0]].Type.Ptr();
+				}
+				else
+				{
+					auto baseType = GetBaseType(base.Type);
+					auto kind = GetScalarKind(baseType);
+					if (kind == ScalarKind::None || GetComponentCount(baseType) == 1)
+						return false;
+					operands.Add(EvalIndex(index));
+					elementType = BasicType(IsMatrixType(baseType) ? MakeBaseType(kind, GetComponentCount(baseType)) : MakeBaseType(kind, 1));
+				}
+				result = SpvPointer(Emit(OpAccessChain, GetPointerTypeId(base.Storage, elementType, layout), operands),
+					elementType, base.Storage, layout);
+				return true;
+			}
+			bool TryGetPointer(ILOperand * op, SpvPointer & ptr)
+			{
+				if (auto param = dynamic_cast<ILModuleParameterInstance*>(op))
+					return GetParameterPointer(param, ptr);
+				auto instr = dynamic_cast<ILInstruction*>(op);
+				if (!instr)
+					return false;
+				if (fn->Homes.TryGetValue(instr, ptr))
+					return true;
+				if (auto update = instr->As<MemberUpdateInstruction>())
+					return TryGetPointer(update->Operands[0].Ptr(), ptr);
+				if (IsAliasImport(instr))
+				{
+					auto importOperand = GetImportOperand(instr->As<ImportInstruction>());
+					return importOperand && TryGetPointer(importOperand, ptr);
+				}
+				if (auto memberLoad = instr->As<MemberLoadInstruction>())
+				{
+					SpvPointer base;
+					return TryGetPointer(memberLoad->Operands[0].Ptr(), base) && GetElementPointer(base, memberLoad->Operands[1].Ptr(), ptr);
+				}
+				if (auto project = instr->As<ProjectInstruction>())
+				{
+					List<ILOperand*> indices;
+					auto source = project->Operand.Ptr();
+					while (auto memberLoad = dynamic_cast<MemberLoadInstruction*>(source))
+					{
+						indices.Insert(0, memberLoad->Operands[1].Ptr());
+						source = memberLoad->Operands[0].Ptr();
+					}
+					auto load = dynamic_cast<LoadInputInstruction*>(source);
+					if (!load || !GetInputPointer(load->InputName, project->ComponentName, ptr))
+						return false;
+					for (auto index : indices)
+						if (!GetElementPointer(ptr, index, ptr))
+							return false;
+					return true;
+				}
+				if (auto load = instr->As<LoadInputInstruction>())
+					return GetSystemVarPointer(load, ptr);
+				return false;
+			}
+			ILOperand * GetLValueRoot(ILOperand * op)
+			{
+				while (auto instr = dynamic_cast<ILInstruction*>(op))
+				{
+					if (auto memberLoad = instr->As<MemberLoadInstruction>())
+						op = memberLoad->Operands[0].Ptr();
+					else if (auto update = instr->As<MemberUpdateInstruction>())
+						op = update->Operands[0].Ptr();
+					else if (IsAliasImport(instr))
+						op = GetImportOperand(instr->As<ImportInstruction>());
+					else
+						break;
+				}
+				return op;
+			}
+
+			// materialization analysis
+
+			bool CanHaveHome(ILInstruction * instr)
+			{
+				if (IsLazyInstruction(instr) || instr->Is<AllocVarInstruction>() || instr->Is<FetchArgInstruction>()
+					|| instr->Is<MemberUpdateInstruction>() || instr->Is<ImportInstruction>() || instr->Is<StoreInstruction>()
+					|| instr->Is<ExportInstruction>() || instr->Is<IfInstruction>() || instr->Is<WhileInstruction>()
+					|| instr->Is<DoInstruction>() || instr->Is<ForInstruction>() || instr->Is<ReturnInstruction>()
+					|| instr->Is<BreakInstruction>() || instr->Is<ContinueInstruction>() || instr->Is<DiscardInstruction>())
+					return false;
+				return instr->Type && !instr->Type->IsVoid() && !IsOpaqueType(instr->Type.Ptr());
+			}
+			bool IsWithin(CFGNode * node, CFGNode * ancestor)
+			{
+				while (node)
+				{
+					if (node == ancestor)
+						return true;
+					ILInstruction * owner = nullptr;
+					if (!fn->NodeOwners.TryGetValue(node, owner))
+						return false;
+					node = owner->Parent;
+				}
+				return false;
+			}
+			// the nodes in which the value of `instr` is actually read; uses through operands that are
+			// evaluated at their own use site (lazy loads, alias imports) are followed transitively
+			void CollectUseSites(ILInstruction * instr, List<CFGNode*> & sites, HashSet<ILInstruction*> & visited)
+			{
+				if (!visited.Add(instr))
+					return;
+				for (auto user : instr->Users)
+				{
+					auto userInstr = dynamic_cast<ILInstruction*>(user);
+					if (!userInstr)
+						continue;
+					if (IsLazyInstruction(userInstr) || IsAliasImport(userInstr))
+						CollectUseSites(userInstr, sites, visited);
+					else if (userInstr->Is<ReturnInstruction>())
+					{
+						ILInstruction * owner = nullptr;
+						if (fn->NodeOwners.TryGetValue(userInstr->Parent, owner) && IsAliasImport(owner))
+							CollectUseSites(owner, sites, visited);
+						else
+							sites.Add(userInstr->Parent);
+					}
+					else
+						sites.Add(userInstr->Parent);
+				}
+			}
+			void CollectInstructions(CFGNode * node, List<ILInstruction*> & instrs)
+			{
+				for (auto & instr : *node)
+				{
+					instrs.Add(&instr);
+					for (int i = 0; i < instr.GetSubBlockCount(); i++)
+					{
+						if (auto subBlock = instr.GetSubBlock(i))
+						{
+							fn->NodeOwners[subBlock] = &instr;
+							CollectInstructions(subBlock, instrs);
+						}
+					}
+				}
+			}
+			void RequireHome(ILOperand * op)
+			{
+				if (auto instr = dynamic_cast<ILInstruction*>(op))
+					if (CanHaveHome(instr))
+						fn->Materialized.Add(instr);
+			}
+			void AnalyzeCode(CFGNode * root)
+			{
+				fn->RootNode = root;
+				List<ILInstruction*> instrs;
+				CollectInstructions(root, instrs);
+				for (auto instr : instrs)
+				{
+					if (auto fetchArg = instr->As<FetchArgInstruction>())
+					{
+						if (fetchArg->ArgId > 0 && fetchArg->ArgId <= fn->Parameters.Count())
+							fn->Homes[instr] = fn->Parameters[fetchArg->ArgId - 1];
+						continue;
+					}
+					if (CanHaveHome(instr))
+					{
+						List<CFGNode*> sites;
+						HashSet<ILInstruction*> visited;
+						CollectUseSites(instr, sites, visited);
+						for (auto site : sites)
+						{
+							if (!IsWithin(site, instr->Parent))
+							{
+								fn->Materialized.Add(instr);
+								break;
+							}
+						}
+					}
+					// operands that are written through need a variable to write to
+					if (auto store = instr->As<StoreInstruction>())
+						RequireHome(GetLValueRoot(store->Operands[0].Ptr()));
+					else if (auto update = instr->As<MemberUpdateInstruction>())
+						RequireHome(GetLValueRoot(update->Operands[0].Ptr()));
+					else if (auto memberLoad = instr->As<MemberLoadInstruction>())
+					{
+						auto baseType = GetBaseType(memberLoad->Operands[0]->Type.Ptr());
+						bool isVector = GetScalarKind(baseType) != ScalarKind::None && !IsMatrixType(baseType);
+						if (!dynamic_cast<ILConstOperand*>(memberLoad->Operands[1].Ptr()) && !isVector)
+							RequireHome(GetLValueRoot(memberLoad->Operands[0].Ptr()));
+					}
+					else if (auto call = instr->As<CallInstruction>())
+					{
+						RefPtr<ILFunction> func;
+						if (program->Functions.TryGetValue(call->Function, func))
+						{
+							int i = 0;
+							for (auto & param : func->Parameters)
+							{
+								if (i < call->Arguments.Count() && (param.Value.Qualifier == ParameterQualifier::Out || param.Value.Qualifier == ParameterQualifier::InOut))
+									RequireHome(GetLValueRoot(call->Arguments[i].Ptr()));
+								i++;
+							}
+						}
+					}
+				}
+				if (!fn->Function && positionOperand)
+				{
+					auto positionInstr = dynamic_cast<ILInstruction*>(positionOperand);
+					if (positionInstr && positionInstr->Parent != root)
+						RequireHome(positionInstr);
+				}
+			}
+
+			// operand evaluation
+
+			SpvValue EvalConstant(ILConstOperand * c)
+			{
+				SpvValue rs;
+				if (TryFoldConstant(c, GetBaseType(c->Type.Ptr()), rs))
+					return rs;
+				SPIRE_UNIMPLEMENTED(sink, c->Position, "SPIR-V constant of type '" + c->Type->ToString() + "'");
+				return SpvValue(module.Undef(GetTypeId(c->Type.Ptr())), c->Type.Ptr());
+			}
+			SpvValue Undef(ILType * type)
+			{
+				return SpvValue(module.Undef(GetTypeId(type)), type);
+			}
+			SpvValue Eval(ILOperand * op)
+			{
+				if (auto c = dynamic_cast<ILConstOperand*>(op))
+					return EvalConstant(c);
+				if (op->IsUndefined())
+					return Undef(op->Type.Ptr());
+				SpvPointer ptr;
+				if (auto param = dynamic_cast<ILModuleParameterInstance*>(op))
+				{
+					if (GetParameterPointer(param, ptr))
+						return Load(ptr);
+					return Undef(param->Type.Ptr());
+				}
+				auto instr = dynamic_cast<ILInstruction*>(op);
+				if (!instr)
+				{
+					SPIRE_INTERNAL_ERROR(sink, op->Position);
+					return Undef(op->Type.Ptr());
+				}
+				if (auto update = instr->As<MemberUpdateInstruction>())
+					return Eval(update->Operands[0].Ptr());
+				if (IsAliasImport(instr))
+				{
+					auto importOperand = GetImportOperand(instr->As<ImportInstruction>());
+					if (importOperand)
+						return Eval(importOperand);
+					return Undef(instr->Type.Ptr());
+				}
+				if (fn->Homes.TryGetValue(instr, ptr))
+					return Convert(Load(ptr), instr->Type.Ptr());
+				SpvValue value;
+				if (fn->Values.TryGetValue(instr, value))
+					return value;
+				if (IsLazyInstruction(instr))
+				{
+					if (TryGetPointer(instr, ptr))
+						return Convert(Load(ptr), instr->Type.Ptr());
+					if (auto memberLoad = instr->As<MemberLoadInstruction>())
+						return EvalMemberLoad(memberLoad);
+					SPIRE_INTERNAL_ERROR(sink, instr->Position);
+					return Undef(instr->Type.Ptr());
+				}
+				// pure instructions that have not been generated yet (e.g. inside the operator of an alias import)
+				GenerateValueInstruction(instr);
+				return Eval(instr);
+			}
+			SpvValue EvalAs(ILOperand * op, ILType * type)
+			{
+				if (auto c = dynamic_cast<ILConstOperand*>(op))
+				{
+					SpvValue rs;
+					if (TryFoldConstant(c, GetBaseType(type), rs))
+						return rs;
+				}
+				return Convert(Eval(op), type);
+			}
+			SpvValue EvalMemberLoad(MemberLoadInstruction * memberLoad)
+			{
+				auto base = Eval(memberLoad->Operands[0].Ptr());
+				auto index = memberLoad->Operands[1].Ptr();
+				auto baseType = GetBaseType(base.Type);
+				if (auto c = dynamic_cast<ILConstOperand*>(index))
+				{
+					ILType * elementType = memberLoad->Type.Ptr();
+					if (auto arrayType = dynamic_cast<ILArrayType*>(base.Type))
+						elementType = arrayType->BaseType.Ptr();
+					else if (auto structType = dynamic_cast<ILStructType*>(base.Type))
+						elementType = structType->Members[c->IntValues[0]].Type.Ptr();
+					else if (IsMatrixType(baseType))
+						elementType = BasicType(MakeBaseType(ScalarKind::Float, GetComponentCount(baseType)));
+					else if (GetScalarKind(baseType) != ScalarKind::None)
+						elementType = BasicType(MakeBaseType(GetScalarKind(baseType), 1));
+					return Convert(Extract(base, c->IntValues[0], elementType), memberLoad->Type.Ptr());
+				}
+				if (GetScalarKind(baseType) != ScalarKind::None && !IsMatrixType(baseType))
+				{
+					auto elementType = BasicType(MakeBaseType(GetScalarKind(baseType), 1));
+					return Convert(SpvValue(Emit(OpVectorExtractDynamic, GetTypeId(elementType), { base.Id, EvalIndex(index) }), elementType),
+						memberLoad->Type.Ptr());
+				}
+				// dynamic indexing into a value: spill it to a temporary
+				auto temp = AllocLocal(base.Type, "");
+				Store(temp, base);
+				SpvPointer element;
+				if (GetElementPointer(temp, index, element))
+					return Convert(Load(element), memberLoad->Type.Ptr());
+				SPIRE_INTERNAL_ERROR(sink, memberLoad->Position);
+				return Undef(memberLoad->Type.Ptr());
+			}
+
+			// control flow
+
+			int GenerateConditionCode(CFGNode * node)
+			{
+				ILInstruction * last = nullptr;
+				for (auto & instr : *node)
+				{
+					if (auto ret = instr.As<ReturnInstruction>())
+						return ToBool(ret->Operand.Ptr());
+					GenerateInstruction(&instr);
+					last = &instr;
+				}
+				if (!last)
+					return module.ConstantBool(true);
+				return ToBool(last);
+			}
+			void GenerateIf(IfInstruction * instr)
+			{
+				int cond = ToBool(instr->Operand.Ptr());
+				int trueLabel = module.AllocId(), mergeLabel = module.AllocId();
+				int falseLabel = instr->FalseCode ? module.AllocId() : mergeLabel;
+				fn->Body.Emit(OpSelectionMerge, { mergeLabel, 0 });
+				fn->Body.Emit(OpBranchConditional, { cond, trueLabel, falseLabel });
+				EmitLabel(trueLabel);
+				GenerateCode(instr->TrueCode.Ptr());
+				fn->Body.Emit(OpBranch, { mergeLabel });
+				if (instr->FalseCode)
+				{
+					EmitLabel(falseLabel);
+					GenerateCode(instr->FalseCode.Ptr());
+					fn->Body.Emit(OpBranch, { mergeLabel });
+				}
+				EmitLabel(mergeLabel);
+			}
+			void GenerateLoop(CFGNode * conditionCode, CFGNode * bodyCode, CFGNode * sideEffectCode, bool testAtEnd)
+			{
+				int headerLabel = module.AllocId(), bodyLabel = module.AllocId();
+				int continueLabel = module.AllocId(), mergeLabel = module.AllocId();
+				fn->Body.Emit(OpBranch, { headerLabel });
+				EmitLabel(headerLabel);
+				fn->Body.Emit(OpLoopMerge, { mergeLabel, continueLabel, 0 });
+				if (testAtEnd || !conditionCode)
+					fn->Body.Emit(OpBranch, { bodyLabel });
+				else
+				{
+					int conditionLabel = module.AllocId();
+					fn->Body.Emit(OpBranch, { conditionLabel });
+					EmitLabel(conditionLabel);
+					int cond = GenerateConditionCode(conditionCode);
+					fn->Body.Emit(OpBranchConditional, { cond, bodyLabel, mergeLabel });
+				}
+				EmitLabel(bodyLabel);
+				LoopTargets targets;
+				targets.ContinueLabel = continueLabel;
+				targets.MergeLabel = mergeLabel;
+				fn->Loops.Add(targets);
+				if (bodyCode)
+					GenerateCode(bodyCode);
+				fn->Loops.RemoveAt(fn->Loops.Count() - 1);
+				fn->Body.Emit(OpBranch, { continueLabel });
+				EmitLabel(continueLabel);
+				if (sideEffectCode)
+					GenerateCode(sideEffectCode);
+				if (testAtEnd)
+				{
+					int cond = GenerateConditionCode(conditionCode);
+					fn->Body.Emit(OpBranchConditional, { cond, headerLabel, mergeLabel });
+				}
+				else
+					fn->Body.Emit(OpBranch, { headerLabel });
+				EmitLabel(mergeLabel);
+			}
+			void GenerateReturn(ReturnInstruction * instr)
+			{
+				auto operand = instr->Operand.Ptr();
+				if (fn->Imports.Count())
+				{
+					// return from an import operator assigns the imported value
+					auto import = fn->Imports.Last();
+					if (operand)
+						Store(fn->Homes[import](), EvalAs(operand, import->Type.Ptr()));
+					return;
+				}
+				auto returnType = fn->Function ? fn->Function->ReturnType.Ptr() : nullptr;
+				if (operand && returnType && !returnType->IsVoid())
+					EmitTerminator(OpReturnValue, { EvalAs(operand, returnType).Id });
+				else
+					EmitTerminator(OpReturn, {});
+			}
+			void GenerateCode(CFGNode * node)
+			{
+				for (auto & instr : *node)
+					GenerateInstruction(&instr);
+			}
+			void GenerateInstruction(ILInstruction * instr)
+			{
+				if (auto ifInstr = instr->As<IfInstruction>())
+					GenerateIf(ifInstr);
+				else if (auto whileInstr = instr->As<WhileInstruction>())
+					GenerateLoop(whileInstr->ConditionCode.Ptr(), whileInstr->BodyCode.Ptr(), nullptr, false);
+				else if (auto doInstr = instr->As<DoInstruction>())
+					GenerateLoop(doInstr->ConditionCode.Ptr(), doInstr->BodyCode.Ptr(), nullptr, true);
+				else if (auto forInstr = instr->As<ForInstruction>())
+				{
+					if (forInstr->InitialCode)
+						GenerateCode(forInstr->InitialCode.Ptr());
+					auto conditionCode = forInstr->ConditionCode.Ptr();
+					if (conditionCode && conditionCode->begin() == conditionCode->end())
+						conditionCode = nullptr;
+					GenerateLoop(conditionCode, forInstr->BodyCode.Ptr(), forInstr->SideEffectCode.Ptr(), false);
+				}
+				else if (instr->Is<BreakInstruction>())
+					EmitTerminator(OpBranch, { fn->Loops.Last().MergeLabel });
+				else if (instr->Is<ContinueInstruction>())
+					EmitTerminator(OpBranch, { fn->Loops.Last().ContinueLabel });
+				else if (instr->Is<DiscardInstruction>())
+					EmitTerminator(OpKill, {});
+				else if (auto ret = instr->As<ReturnInstruction>())
+					GenerateReturn(ret);
+				else if (auto allocVar = instr->As<AllocVarInstruction>())
+				{
+					ILType * type = allocVar->Type.Ptr();
+					if (auto size = dynamic_cast<ILConstOperand*>(allocVar->Size.Ptr()))
+						if (size->IntValues[0] > 0)
+							type = ArrayType(type, size->IntValues[0]);
+					fn->Homes[instr] = AllocLocal(type, instr->Name);
+				}
+				else if (auto fetchArg = instr->As<FetchArgInstruction>())
+				{
+					if (fetchArg->ArgId == 0)
+						fn->Homes[instr] = AllocLocal(instr->Type.Ptr(), instr->Name);
+				}
+				else if (auto import = instr->As<ImportInstruction>())
+				{
+					if (!IsAliasImport(import))
+					{
+						fn->Homes[instr] = AllocLocal(import->Type.Ptr(), import->Name);
+						fn->Imports.Add(import);
+						GenerateCode(import->ImportOperator.Ptr());
+						fn->Imports.RemoveAt(fn->Imports.Count() - 1);
+					}
+				}
+				else if (auto exportInstr = instr->As<ExportInstruction>())
+				{
+					SpvPointer ptr;
+					if (outputVariables.TryGetValue(exportInstr->ComponentName, ptr))
+						Store(ptr, Eval(exportInstr->Operand.Ptr()));
+					else
+						SPIRE_INTERNAL_ERROR(sink, instr->Position);
+				}
+				else if (auto store = instr->As<StoreInstruction>())
+				{
+					auto value = Eval(store->Operands[1].Ptr());
+					SpvPointer ptr;
+					if (TryGetPointer(store->Operands[0].Ptr(), ptr))
+						Store(ptr, value);
+					else
+						SPIRE_INTERNAL_ERROR(sink, instr->Position);
+				}
+				else if (auto update = instr->As<MemberUpdateInstruction>())
+				{
+					auto value = Eval(update->Operands[2].Ptr());
+					SpvPointer base, element;
+					if (TryGetPointer(update->Operands[0].Ptr(), base) && GetElementPointer(base, update->Operands[1].Ptr(), element))
+						Store(element, value);
+					else
+						SPIRE_INTERNAL_ERROR(sink, instr->Position);
+				}
+				else if (!IsLazyInstruction(instr))
+					GenerateValueInstruction(instr);
+			}
+			void GenerateValueInstruction(ILInstruction * instr)
+			{
+				auto value = ComputeValue(instr);
+				if (!value.Id)
+					return;
+				if (fn->Materialized.Contains(instr))
+				{
+					SpvPointer home;
+					if (!fn->Homes.TryGetValue(instr, home))
+					{
+						home = AllocLocal(instr->Type.Ptr(), instr->Name);
+						fn->Homes[instr] = home;
+					}
+					Store(home, value);
+				}
+				else
+					fn->Values[instr] = value;
+			}
+
+			// values
+
+			SpvValue GetMatrixColumn(SpvValue value, int column, int size)
+			{
+				auto columnType = BasicType(MakeBaseType(ScalarKind::Float, size));
+				if (IsMatrixType(GetBaseType(value.Type)))
+					return Extract(value, column, columnType);
+				return Convert(value, columnType);
+			}
+			SpvValue GenerateComponentWiseMatrixOp(Op op, ILType * resultType, SpvValue a, SpvValue b)
+			{
+				int size = GetComponentCount(GetBaseType(resultType));
+				auto columnType = BasicType(MakeBaseType(ScalarKind::Float, size));
+				List<int> columns;
+				for (int i = 0; i < size; i++)
+				{
+					auto columnA = GetMatrixColumn(a, i, size);
+					if (op == OpFNegate)
+						columns.Add(Emit(op, GetTypeId(columnType), { columnA.Id }));
+					else
+						columns.Add(Emit(op, GetTypeId(columnType), { columnA.Id, GetMatrixColumn(b, i, size).Id }));
+				}
+				return SpvValue(Emit(OpCompositeConstruct, GetTypeId(resultType), columns), resultType);
+			}
+			SpvValue GenerateMatrixMul(BinaryInstruction * instr)
+			{
+				auto op0 = instr->Operands[0].Ptr(), op1 = instr->Operands[1].Ptr();
+				auto type0 = GetBaseType(op0->Type.Ptr()), type1 = GetBaseType(op1->Type.Ptr());
+				auto floatType = BasicType(ILBaseType::Float);
+				if (IsMatrixType(type0) && IsMatrixType(type1))
+					return SpvValue(Emit(OpMatrixTimesMatrix, GetTypeId(op0->Type.Ptr()), { Eval(op0).Id, Eval(op1).Id }), op0->Type.Ptr());
+				if (IsMatrixType(type0))
+				{
+					auto matrix = Eval(op0);
+					if (GetComponentCount(type1) == 1)
+						return SpvValue(Emit(OpMatrixTimesScalar, GetTypeId(matrix.Type), { matrix.Id, EvalAs(op1, floatType).Id }), matrix.Type);
+					auto vectorType = BasicType(MakeBaseType(ScalarKind::Float, GetComponentCount(type0)));
+					return SpvValue(Emit(OpMatrixTimesVector, GetTypeId(vectorType), { matrix.Id, EvalAs(op1, vectorType).Id }), vectorType);
+				}
+				auto matrix = Eval(op1);
+				if (GetComponentCount(type0) == 1)
+					return SpvValue(Emit(OpMatrixTimesScalar, GetTypeId(matrix.Type), { matrix.Id, EvalAs(op0, floatType).Id }), matrix.Type);
+				auto vectorType = BasicType(MakeBaseType(ScalarKind::Float, GetComponentCount(type1)));
+				return SpvValue(Emit(OpVectorTimesMatrix, GetTypeId(vectorType), { EvalAs(op0, vectorType).Id, matrix.Id }), vectorType);
+			}
+			SpvValue GenerateCompare(CompareInstruction * instr)
+			{
+				auto type0 = GetBaseType(instr->Operands[0]->Type.Ptr()), type1 = GetBaseType(instr->Operands[1]->Type.Ptr());
+				auto kind0 = GetScalarKind(type0), kind1 = GetScalarKind(type1);
+				auto kind = ScalarKind::Bool;
+				if (kind0 == ScalarKind::Float || kind1 == ScalarKind::Float)
+					kind = ScalarKind::Float;
+				else if (kind0 == ScalarKind::Int || kind1 == ScalarKind::Int)
+					kind = ScalarKind::Int;
+				else if (kind0 == ScalarKind::UInt || kind1 == ScalarKind::UInt)
+					kind = ScalarKind::UInt;
+				int count = Math::Max(GetComponentCount(type0), GetComponentCount(type1));
+				auto operandType = BasicType(MakeBaseType(kind, count));
+				auto a = EvalAs(instr->Operands[0].Ptr(), operandType), b = EvalAs(instr->Operands[1].Ptr(), operandType);
+				Op op;
+				bool isFloat = kind == ScalarKind::Float, isSigned = kind == ScalarKind::Int;
+				bool isNotEqual = false;
+				if (instr->Is<CmpeqlInstruction>())
+					op = isFloat ? OpFOrdEqual : kind == ScalarKind::Bool ? OpLogicalEqual : OpIEqual;
+				else if (instr->Is<CmpneqInstruction>())
+				{
+					op = isFloat ? OpFUnordNotEqual : kind == ScalarKind::Bool ? OpLogicalNotEqual : OpINotEqual;
+					isNotEqual = true;
+				}
+				else
+				{
+					if (kind == ScalarKind::Bool)
+					{
+						operandType = BasicType(MakeBaseType(ScalarKind::UInt, count));
+						a = Convert(a, operandType);
+						b = Convert(b, operandType);
+					}
+					if (instr->Is<CmpltInstruction>())
+						op = isFloat ? OpFOrdLessThan : isSigned ? OpSLessThan : OpULessThan;
+					else if (instr->Is<CmpleInstruction>())
+						op = isFloat ? OpFOrdLessThanEqual : isSigned ? OpSLessThanEqual : OpULessThanEqual;
+					else if (instr->Is<CmpgtInstruction>())
+						op = isFloat ? OpFOrdGreaterThan : isSigned ? OpSGreaterThan : OpUGreaterThan;
+					else
+						op = isFloat ? OpFOrdGreaterThanEqual : isSigned ? OpSGreaterThanEqual : OpUGreaterThanEqual;
+				}
+				auto boolType = BasicType(MakeBaseType(ScalarKind::Bool, count));
+				SpvValue rs(Emit(op, GetTypeId(boolType), { a.Id, b.Id }), boolType);
+				if (count > 1)
+				{
+					auto scalarBool = BasicType(ILBaseType::Bool);
+					rs = SpvValue(Emit(isNotEqual ? OpAny : OpAll, GetTypeId(scalarBool), { rs.Id }), scalarBool);
+				}
+				return Convert(rs, instr->Type.Ptr());
+			}
+			SpvValue GenerateBinary(BinaryInstruction * instr)
+			{
+				auto resultType = instr->Type.Ptr();
+				auto baseType = GetBaseType(resultType);
+				if (instr->Is<MulInstruction>() && (instr->Operands[0]->Type->IsFloatMatrix() || instr->Operands[1]->Type->IsFloatMatrix()))
+					return Convert(GenerateMatrixMul(instr), resultType);
+				if (IsMatrixType(baseType))
+				{
+					Op op = OpFAdd;
+					if (instr->Is<SubInstruction>())
+						op = OpFSub;
+					else if (instr->Is<DivInstruction>())
+						op = OpFDiv;
+					else if (!instr->Is<AddInstruction>())
+					{
+						SPIRE_UNIMPLEMENTED(sink, instr->Position, "matrix operator '" + instr->GetOperatorString() + "'");
+						return Undef(resultType);
+					}
+					return GenerateComponentWiseMatrixOp(op, resultType, Eval(instr->Operands[0].Ptr()), Eval(instr->Operands[1].Ptr()));
+				}
+				auto kind = GetScalarKind(baseType);
+				if (instr->Is<AndInstruction>() || instr->Is<OrInstruction>()
+					|| (kind == ScalarKind::Bool && (instr->Is<BitAndInstruction>() || instr->Is<BitOrInstruction>() || instr->Is<BitXorInstruction>())))
+				{
+					auto boolType = BasicType(MakeBaseType(ScalarKind::Bool, GetComponentCount(baseType)));
+					auto a = EvalAs(instr->Operands[0].Ptr(), boolType), b = EvalAs(instr->Operands[1].Ptr(), boolType);
+					Op op = OpLogicalNotEqual;
+					if (instr->Is<AndInstruction>() || instr->Is<BitAndInstruction>())
+						op = OpLogicalAnd;
+					else if (instr->Is<OrInstruction>() || instr->Is<BitOrInstruction>())
+						op = OpLogicalOr;
+					return Convert(SpvValue(Emit(op, GetTypeId(boolType), { a.Id, b.Id }), boolType), resultType);
+				}
+				auto computeType = resultType;
+				if (kind == ScalarKind::Bool)
+				{
+					kind = ScalarKind::Int;
+					computeType = BasicType(MakeBaseType(kind, GetComponentCount(baseType)));
+				}
+				bool isFloat = kind == ScalarKind::Float, isSigned = kind == ScalarKind::Int;
+				Op op;
+				if (instr->Is<AddInstruction>())
+					op = isFloat ? OpFAdd : OpIAdd;
+				else if (instr->Is<SubInstruction>())
+					op = isFloat ? OpFSub : OpISub;
+				else if (instr->Is<MulInstruction>())
+					op = isFloat ? OpFMul : OpIMul;
+				else if (instr->Is<DivInstruction>())
+					op = isFloat ? OpFDiv : isSigned ? OpSDiv : OpUDiv;
+				else if (instr->Is<ModInstruction>())
+					op = isFloat ? OpFRem : isSigned ? OpSRem : OpUMod;
+				else if (instr->Is<ShlInstruction>())
+					op = OpShiftLeftLogical;
+				else if (instr->Is<ShrInstruction>())
+					op = isSigned ? OpShiftRightArithmetic : OpShiftRightLogical;
+				else if (instr->Is<BitAndInstruction>())
+					op = OpBitwiseAnd;
+				else if (instr->Is<BitOrInstruction>())
+					op = OpBitwiseOr;
+				else if (instr->Is<BitXorInstruction>())
+					op = OpBitwiseXor;
+				else
+				{
+					SPIRE_UNIMPLEMENTED(sink, instr->Position, "operator '" + instr->GetOperatorString() + "'");
+					return Undef(resultType);
+				}
+				auto a = EvalAs(instr->Operands[0].Ptr(), computeType), b = EvalAs(instr->Operands[1].Ptr(), computeType);
+				return Convert(SpvValue(Emit(op, GetTypeId(computeType), { a.Id, b.Id }), computeType), resultType);
+			}
+			SpvValue GenerateSwizzle(SwizzleInstruction * instr)
+			{
+				auto base = Eval(instr->Operand.Ptr());
+				auto baseType = GetBaseType(base.Type);
+				auto kind = GetScalarKind(baseType);
+				List<int> indices;
+				for (int i = 0; i < instr->SwizzleString.Length(); i++)
+				{
+					switch (instr->SwizzleString[i])
+					{
+					case 'x': case 'r': case 's':
+						indices.Add(0);
+						break;
+					case 'y': case 'g': case 't':
+						indices.Add(1);
+						break;
+					case 'z': case 'b': case 'p':
+						indices.Add(2);
+						break;
+					default:
+						indices.Add(3);
+						break;
+					}
+				}
+				auto resultType = BasicType(MakeBaseType(kind, indices.Count()));
+				SpvValue rs;
+				if (GetComponentCount(baseType) == 1)
+					rs = Splat(base, indices.Count());
+				else if (indices.Count() == 1)
+					rs = Extract(base, indices[0], resultType);
+				else
+				{
+					List<int> operands;
+					operands.Add(base.Id);
+					operands.Add(base.Id);
+					operands.AddRange(indices);
+					rs = SpvValue(Emit(OpVectorShuffle, GetTypeId(resultType), operands), resultType);
+				}
+				return Convert(rs, instr->Type.Ptr());
+			}
+			SpvValue GenerateSelect(SelectInstruction * instr)
+			{
+				auto resultType = instr->Type.Ptr();
+				auto baseType = GetBaseType(resultType);
+				if (GetScalarKind(baseType) != ScalarKind::None && !IsMatrixType(baseType))
+				{
+					auto cond = SpvValue(ToBool(instr->Operands[0].Ptr()), BasicType(ILBaseType::Bool));
+					cond = Splat(cond, GetComponentCount(baseType));
+					auto a = EvalAs(instr->Operands[1].Ptr(), resultType), b = EvalAs(instr->Operands[2].Ptr(), resultType);
+					return SpvValue(Emit(OpSelect, GetTypeId(resultType), { cond.Id, a.Id, b.Id }), resultType);
+				}
+				// OpSelect on composites requires SPIR-V 1.4, branch instead
+				int cond = ToBool(instr->Operands[0].Ptr());
+				auto temp = AllocLocal(resultType, "");
+				int trueLabel = module.AllocId(), falseLabel = module.AllocId(), mergeLabel = module.AllocId();
+				fn->Body.Emit(OpSelectionMerge, { mergeLabel, 0 });
+				fn->Body.Emit(OpBranchConditional, { cond, trueLabel, falseLabel });
+				EmitLabel(trueLabel);
+				Store(temp, Eval(instr->Operands[1].Ptr()));
+				fn->Body.Emit(OpBranch, { mergeLabel });
+				EmitLabel(falseLabel);
+				Store(temp, Eval(instr->Operands[2].Ptr()));
+				fn->Body.Emit(OpBranch, { mergeLabel });
+				EmitLabel(mergeLabel);
+				return Load(temp);
+			}
+			SpvValue ComputeValue(ILInstruction * instr)
+			{
+				if (auto compare = instr->As<CompareInstruction>())
+					return GenerateCompare(compare);
+				if (auto binary = instr->As<BinaryInstruction>())
+					return GenerateBinary(binary);
+				if (auto swizzle = instr->As<SwizzleInstruction>())
+					return GenerateSwizzle(swizzle);
+				if (auto select = instr->As<SelectInstruction>())
+					return GenerateSelect(select);
+				if (auto call = instr->As<CallInstruction>())
+					return GenerateCall(call);
+				auto resultType = instr->Type.Ptr();
+				if (auto notInstr = instr->As<NotInstruction>())
+				{
+					auto boolType = BasicType(MakeBaseType(ScalarKind::Bool, Math::Max(1, GetComponentCount(GetBaseType(resultType)))));
+					auto operand = EvalAs(notInstr->Operand.Ptr(), boolType);
+					return Convert(SpvValue(Emit(OpLogicalNot, GetTypeId(boolType), { operand.Id }), boolType), resultType);
+				}
+				if (auto neg = instr->As<NegInstruction>())
+				{
+					auto baseType = GetBaseType(resultType);
+					auto operand = EvalAs(neg->Operand.Ptr(), resultType);
+					if (IsMatrixType(baseType))
+						return GenerateComponentWiseMatrixOp(OpFNegate, resultType, operand, operand);
+					Op op = GetScalarKind(baseType) == ScalarKind::Float ? OpFNegate : OpSNegate;
+					return SpvValue(Emit(op, GetTypeId(resultType), { operand.Id }), resultType);
+				}
+				if (auto bitNot = instr->As<BitNotInstruction>())
+				{
+					if (GetScalarKind(GetBaseType(resultType)) == ScalarKind::Bool)
+						return SpvValue(Emit(OpLogicalNot, GetTypeId(resultType), { EvalAs(bitNot->Operand.Ptr(), resultType).Id }), resultType);
+					return SpvValue(Emit(OpNot, GetTypeId(resultType), { EvalAs(bitNot->Operand.Ptr(), resultType).Id }), resultType);
+				}
+				if (auto unary = instr->As<UnaryInstruction>())
+				{
+					// Float2Int, Int2Float, Copy and Load are all conversions to the result type
+					return EvalAs(unary->Operand.Ptr(), resultType);
+				}
+				SPIRE_UNIMPLEMENTED(sink, instr->Position, "SPIR-V code generation for '" + instr->GetOperatorString() + "'");
+				if (resultType && !resultType->IsVoid())
+					return Undef(resultType);
+				return SpvValue();
+			}
+
+			// calls
+
+			int GetFunctionId(ILFunction * func)
+			{
+				int id;
+				if (functionIds.TryGetValue(func->Name, id))
+					return id;
+				id = module.AllocId();
+				functionIds[func->Name] = id;
+				pendingFunctions.Add(func);
+				return id;
+			}
+			SpvValue GenerateUserCall(CallInstruction * call, ILFunction * func)
+			{
+				int funcId = GetFunctionId(func);
+				List<int> operands;
+				operands.Add(funcId);
+				List<SpvPointer> temps;
+				List<ILOperand*> copyBackArgs;
+				int i = 0;
+				for (auto & param : func->Parameters)
+				{
+					if (i >= call->Arguments.Count())
+						break;
+					auto arg = call->Arguments[i].Ptr();
+					auto paramType = param.Value.Type.Ptr();
+					i++;
+					if (IsOpaqueType(paramType))
+					{
+						SpvPointer ptr;
+						if (TryGetPointer(arg, ptr))
+							operands.Add(ptr.Id);
+						else
+						{
+							SPIRE_UNIMPLEMENTED(sink, call->Position, "passing '" + paramType->ToString() + "' that is not a shader parameter");
+							operands.Add(module.Undef(GetPointerTypeId(StorageClassUniformConstant, paramType)));
+						}
+						continue;
+					}
+					auto temp = AllocLocal(paramType, "");
+					if (param.Value.Qualifier != ParameterQualifier::Out)
+						Store(temp, EvalAs(arg, paramType));
+					if (param.Value.Qualifier == ParameterQualifier::Out || param.Value.Qualifier == ParameterQualifier::InOut)
+					{
+						temps.Add(temp);
+						copyBackArgs.Add(arg);
+					}
+					operands.Add(temp.Id);
+				}
+				auto returnType = func->ReturnType.Ptr();
+				SpvValue rs(Emit(OpFunctionCall, GetTypeId(returnType), operands), returnType);
+				for (int j = 0; j < temps.Count(); j++)
+				{
+					SpvPointer dest;
+					if (TryGetPointer(copyBackArgs[j], dest))
+						Store(dest, Load(temps[j]));
+					else
+						SPIRE_INTERNAL_ERROR(sink, call->Position);
+				}
+				if (!returnType || returnType->IsVoid())
+					return SpvValue();
+				return rs;
+			}
+			SpvValue GenerateConstructor(CallInstruction * call, ILType * resultType)
+			{
+				auto baseType = GetBaseType(resultType);
+				auto kind = GetScalarKind(baseType);
+				int count = GetComponentCount(baseType);
+				auto & args = call->Arguments;
+				if (args.Count() == 1)
+				{
+					auto argType = GetBaseType(args[0]->Type.Ptr());
+					if (IsMatrixType(baseType) == IsMatrixType(argType) && (GetComponentCount(argType) == 1 || GetComponentCount(argType) >= count))
+						return EvalAs(args[0].Ptr(), resultType);
+				}
+				List<int> parts;
+				if (IsMatrixType(baseType))
+				{
+					auto columnType = BasicType(MakeBaseType(ScalarKind::Float, count));
+					bool allColumns = args.Count() == count;
+					for (auto & arg : args)
+						if (GetComponentCount(GetBaseType(arg->Type.Ptr())) != count)
+							allColumns = false;
+					if (allColumns)
+					{
+						for (auto & arg : args)
+							parts.Add(EvalAs(arg.Ptr(), columnType).Id);
+					}
+					else
+					{
+						List<int> scalars;
+						auto floatType = BasicType(ILBaseType::Float);
+						for (auto & arg : args)
+						{
+							auto value = ConvertKind(Eval(arg.Ptr()), ScalarKind::Float);
+							int argCount = GetComponentCount(GetBaseType(value.Type));
+							if (argCount == 1)
+								scalars.Add(value.Id);
+							else
+								for (int j = 0; j < argCount; j++)
+									scalars.Add(Extract(value, j, floatType).Id);
+						}
+						for (int col = 0; col < count; col++)
+						{
+							List<int> column;
+							for (int row = 0; row < count; row++)
+							{
+								int index = col * count + row;
+								column.Add(index < scalars.Count() ? scalars[index] : module.ConstantFloat(0.0f));
+							}
+							parts.Add(Emit(OpCompositeConstruct, GetTypeId(columnType), column));
+						}
+					}
+				}
+				else
+				{
+					for (auto & arg : args)
+						parts.Add(ConvertKind(Eval(arg.Ptr()), kind).Id);
+				}
+				return SpvValue(Emit(OpCompositeConstruct, GetTypeId(resultType), parts), resultType);
+			}
+			SpvValue GenerateAlphaTest(CallInstruction * call)
+			{
+				auto floatType = BasicType(ILBaseType::Float);
+				auto alpha = EvalAs(call->Arguments[0].Ptr(), floatType), threshold = EvalAs(call->Arguments[1].Ptr(), floatType);
+				int cond = Emit(OpFOrdLessThan, module.TypeBool(), { alpha.Id, threshold.Id });
+				int killLabel = module.AllocId(), mergeLabel = module.AllocId();
+				fn->Body.Emit(OpSelectionMerge, { mergeLabel, 0 });
+				fn->Body.Emit(OpBranchConditional, { cond, killLabel, mergeLabel });
+				EmitLabel(killLabel);
+				fn->Body.Emit(OpKill, {});
+				EmitLabel(mergeLabel);
+				return SpvValue();
+			}
+			SpvValue GenerateTextureCall(CallInstruction * call)
+			{
+				auto & args = call->Arguments;
+				auto textureType = GetBaseType(args[0]->Type.Ptr());
+				int coordSize = 2, offsetSize = 2, gradSize = 2;
+				switch (textureType)
+				{
+				case ILBaseType::Texture2DShadow:
+					break;
+				case ILBaseType::Texture2DArrayShadow:
+					coordSize = 3;
+					break;
+				case ILBaseType::Texture2DArray:
+					coordSize = 3;
+					break;
+				case ILBaseType::TextureCubeShadow:
+					coordSize = 3;
+					offsetSize = 0;
+					gradSize = 3;
+					break;
+				case ILBaseType::TextureCube:
+					coordSize = 3;
+					offsetSize = 0;
+					gradSize = 3;
+					break;
+				case ILBaseType::Texture3D:
+					coordSize = offsetSize = gradSize = 3;
+					break;
+				default:
+					break;
+				}
+				int mask = 0;
+				List<int> imageOperands;
+				auto addOffset = [&](ILOperand * offset)
+				{
+					if (!offsetSize)
+						return;
+					auto offsetType = BasicType(MakeBaseType(ScalarKind::Int, offsetSize));
+					if (dynamic_cast<ILConstOperand*>(offset))
+						mask |= ImageOperandsConstOffset;
+					else
+					{
+						mask |= ImageOperandsOffset;
+						module.RequireCapability(CapabilityImageGatherExtended);
+					}
+					imageOperands.Add(EvalAs(offset, offsetType).Id);
+				};
+				auto vec4Type = BasicType(ILBaseType::Float4), floatType = BasicType(ILBaseType::Float);
+				auto image = Eval(args[0].Ptr());
+				if (call->Function == "Load")
+				{
+					// the last component of the location is the mip level
+					auto location = EvalAs(args[1].Ptr(), BasicType(MakeBaseType(ScalarKind::Int, coordSize + 1)));
+					auto coord = Shrink(location, coordSize);
+					auto lod = Extract(location, coordSize, BasicType(ILBaseType::Int));
+					mask |= ImageOperandsLod;
+					imageOperands.Add(lod.Id);
+					if (args.Count() > 2)
+						addOffset(args[2].Ptr());
+					List<int> operands;
+					operands.Add(image.Id);
+					operands.Add(coord.Id);
+					operands.Add(mask);
+					operands.AddRange(imageOperands);
+					return Convert(SpvValue(Emit(OpImageFetch, GetTypeId(vec4Type), operands), vec4Type), call->Type.Ptr());
+				}
+				auto sampler = Eval(args[1].Ptr());
+				int sampledImage = Emit(OpSampledImage, module.TypeSampledImage(GetTypeId(args[0]->Type.Ptr())), { image.Id, sampler.Id });
+				auto coord = EvalAs(args[2].Ptr(), BasicType(MakeBaseType(ScalarKind::Float, coordSize)));
+				// implicit LOD is only available in fragment shaders, other stages sample the base level
+				bool implicitLod = IsFragmentStage();
+				Op op = implicitLod ? OpImageSampleImplicitLod : OpImageSampleExplicitLod;
+				int dref = 0;
+				ILOperand * offset = nullptr;
+				if (call->Function == "Sample")
+				{
+					if (!implicitLod)
+					{
+						mask |= ImageOperandsLod;
+						imageOperands.Add(module.ConstantFloat(0.0f));
+					}
+					if (args.Count() > 3)
+						offset = args[3].Ptr();
+				}
+				else if (call->Function == "SampleBias")
+				{
+					if (implicitLod)
+						mask |= ImageOperandsBias;
+					else
+						mask |= ImageOperandsLod;
+					imageOperands.Add(implicitLod ? EvalAs(args[3].Ptr(), floatType).Id : module.ConstantFloat(0.0f));
+					if (args.Count() > 4)
+						offset = args[4].Ptr();
+				}
+				else if (call->Function == "SampleLevel")
+				{
+					op = OpImageSampleExplicitLod;
+					mask |= ImageOperandsLod;
+					imageOperands.Add(EvalAs(args[3].Ptr(), floatType).Id);
+					if (args.Count() > 4)
+						offset = args[4].Ptr();
+				}
+				else if (call->Function == "SampleGrad")
+				{
+					op = OpImageSampleExplicitLod;
+					mask |= ImageOperandsGrad;
+					auto gradType = BasicType(MakeBaseType(ScalarKind::Float, gradSize));
+					imageOperands.Add(EvalAs(args[3].Ptr(), gradType).Id);
+					imageOperands.Add(EvalAs(args[4].Ptr(), gradType).Id);
+					if (args.Count() > 5)
+						offset = args[5].Ptr();
+				}
+				else if (call->Function == "SampleCmp")
+				{
+					op = implicitLod ? OpImageSampleDrefImplicitLod : OpImageSampleDrefExplicitLod;
+					dref = EvalAs(args[3].Ptr(), floatType).Id;
+					if (!implicitLod)
+					{
+						mask |= ImageOperandsLod;
+						imageOperands.Add(module.ConstantFloat(0.0f));
+					}
+					if (args.Count() > 4)
+						offset = args[4].Ptr();
+				}
+				if (offset)
+					addOffset(offset);
+				auto resultType = dref ? floatType : vec4Type;
+				List<int> operands;
+				operands.Add(sampledImage);
+				operands.Add(coord.Id);
+				if (dref)
+					operands.Add(dref);
+				if (mask)
+				{
+					operands.Add(mask);
+					operands.AddRange(imageOperands);
+				}
+				return Convert(SpvValue(Emit(op, GetTypeId(resultType), operands), resultType), call->Type.Ptr());
+			}
+			SpvValue GenerateIntrinsicCall(CallInstruction * call)
+			{
+				auto name = GetOriginalFunctionName(call->Function);
+				auto resultType = call->Type.Ptr();
+				auto baseType = GetBaseType(resultType);
+				auto kind = GetScalarKind(baseType);
+				auto & args = call->Arguments;
+				int resultTypeId = GetTypeId(resultType);
+				if (baseType != ILBaseType::Void && name == resultType->ToString())
+					return GenerateConstructor(call, resultType);
+				auto argsAs = [&](ILType * type)
+				{
+					List<int> ids;
+					for (auto & arg : args)
+						ids.Add(EvalAs(arg.Ptr(), type).Id);
+					return ids;
+				};
+				auto extInst = [&](GLSLstd450 inst)
+				{
+					return SpvValue(EmitExtInst(inst, resultTypeId, argsAs(resultType)), resultType);
+				};
+				struct ExtInstEntry
+				{
+					const char * Name;
+					int FloatInst, IntInst, UIntInst;
+				};
+				static const ExtInstEntry componentWiseFunctions[] =
+				{
+					{ "abs", GLSLstd450FAbs, GLSLstd450SAbs, -1 },
+					{ "sign", GLSLstd450FSign, GLSLstd450SSign, -1 },
+					{ "floor", GLSLstd450Floor, -1, -1 },
+					{ "ceil", GLSLstd450Ceil, -1, -1 },
+					{ "fract", GLSLstd450Fract, -1, -1 },
+					{ "sin", GLSLstd450Sin, -1, -1 },
+					{ "cos", GLSLstd450Cos, -1, -1 },
+					{ "tan", GLSLstd450Tan, -1, -1 },
+					{ "asin", GLSLstd450Asin, -1, -1 },
+					{ "acos", GLSLstd450Acos, -1, -1 },
+					{ "atan", GLSLstd450Atan, -1, -1 },
+					{ "atan2", GLSLstd450Atan2, -1, -1 },
+					{ "pow", GLSLstd450Pow, -1, -1 },
+					{ "exp", GLSLstd450Exp, -1, -1 },
+					{ "log", GLSLstd450Log, -1, -1 },
+					{ "exp2", GLSLstd450Exp2, -1, -1 },
+					{ "log2", GLSLstd450Log2, -1, -1 },
+					{ "sqrt", GLSLstd450Sqrt, -1, -1 },
+					{ "min", GLSLstd450FMin, GLSLstd450SMin, GLSLstd450UMin },
+					{ "max", GLSLstd450FMax, GLSLstd450SMax, GLSLstd450UMax },
+					{ "clamp", GLSLstd450FClamp, GLSLstd450SClamp, GLSLstd450UClamp },
+					{ "mix", GLSLstd450FMix, -1, -1 },
+					{ "lerp", GLSLstd450FMix, -1, -1 },
+					{ "step", GLSLstd450Step, -1, -1 },
+					{ "smoothstep", GLSLstd450SmoothStep, -1, -1 },
+					{ "normalize", GLSLstd450Normalize, -1, -1 },
+					{ "cross", GLSLstd450Cross, -1, -1 },
+					{ "reflect", GLSLstd450Reflect, -1, -1 },
+				};
+				for (auto & entry : componentWiseFunctions)
+				{
+					if (name != entry.Name)
+						continue;
+					if (args.Count() == 1 && (name == "min" || name == "max"))
+						return EvalAs(args[0].Ptr(), resultType);
+					int inst = entry.FloatInst;
+					if (kind == ScalarKind::Int && entry.IntInst != -1)
+						inst = entry.IntInst;
+					else if (kind == ScalarKind::UInt)
+					{
+						if (entry.UIntInst != -1)
+							inst = entry.UIntInst;
+						else if (name == "abs")
+							return EvalAs(args[0].Ptr(), resultType);
+					}
+					if (kind != ScalarKind::Float && inst == entry.FloatInst)
+					{
+						// float-only functions on integers: compute in float and convert back
+						auto floatResult = BasicType(MakeBaseType(ScalarKind::Float, GetComponentCount(baseType)));
+						auto rs = SpvValue(EmitExtInst((GLSLstd450)inst, GetTypeId(floatResult), argsAs(floatResult)), floatResult);
+						return Convert(rs, resultType);
+					}
+					return extInst((GLSLstd450)inst);
+				}
+				if (name == "saturate")
+				{
+					List<int> operands;
+					operands.Add(EvalAs(args[0].Ptr(), resultType).Id);
+					operands.Add(Constant(baseType, 0.0).Id);
+					operands.Add(Constant(baseType, 1.0).Id);
+					return SpvValue(EmitExtInst(GLSLstd450FClamp, resultTypeId, operands), resultType);
+				}
+				if (name == "length")
+				{
+					auto argType = BasicType(MakeBaseType(ScalarKind::Float, Math::Max(1, GetComponentCount(GetBaseType(args[0]->Type.Ptr())))));
+					return Convert(SpvValue(EmitExtInst(GLSLstd450Length, module.TypeFloat(), argsAs(argType)), BasicType(ILBaseType::Float)), resultType);
+				}
+				if (name == "refract")
+				{
+					List<int> operands;
+					operands.Add(EvalAs(args[0].Ptr(), resultType).Id);
+					operands.Add(EvalAs(args[1].Ptr(), resultType).Id);
+					operands.Add(EvalAs(args[2].Ptr(), BasicType(ILBaseType::Float)).Id);
+					return SpvValue(EmitExtInst(GLSLstd450Refract, resultTypeId, operands), resultType);
+				}
+				if (name == "dot")
+				{
+					int count = Math::Max(GetComponentCount(GetBaseType(args[0]->Type.Ptr())), GetComponentCount(GetBaseType(args[1]->Type.Ptr())));
+					auto argType = BasicType(MakeBaseType(ScalarKind::Float, count));
+					auto operands = argsAs(argType);
+					SpvValue rs(Emit(count == 1 ? OpFMul : OpDot, module.TypeFloat(), operands), BasicType(ILBaseType::Float));
+					return Convert(rs, resultType);
+				}
+				if (name == "mod")
+				{
+					Op op = kind == ScalarKind::Float ? OpFMod : kind == ScalarKind::Int ? OpSMod : OpUMod;
+					return SpvValue(Emit(op, resultTypeId, argsAs(resultType)), resultType);
+				}
+				if (name == "transpose")
+					return SpvValue(Emit(OpTranspose, resultTypeId, argsAs(resultType)), resultType);
+				if (name == "dFdx" || name == "ddx")
+					return SpvValue(Emit(OpDPdx, resultTypeId, argsAs(resultType)), resultType);
+				if (name == "dFdy" || name == "ddy")
+					return SpvValue(Emit(OpDPdy, resultTypeId, argsAs(resultType)), resultType);
+				if (name == "fwidth")
+					return SpvValue(Emit(OpFwidth, resultTypeId, argsAs(resultType)), resultType);
+				if (name == "intBitsToFloat" || name == "floatBitsToInt")
+				{
+					auto value = Eval(args[0].Ptr());
+					return SpvValue(Emit(OpBitcast, resultTypeId, { value.Id }), resultType);
+				}
+				if (name == "alphaTest")
+					return GenerateAlphaTest(call);
+				SPIRE_UNIMPLEMENTED(sink, call->Position, "SPIR-V code generation for intrinsic '" + name + "'");
+				if (resultType && !resultType->IsVoid())
+					return Undef(resultType);
+				return SpvValue();
+			}
+			SpvValue GenerateCall(CallInstruction * call)
+			{
+				RefPtr<ILFunction> func;
+				if (program->Functions.TryGetValue(call->Function, func))
+					return GenerateUserCall(call, func.Ptr());
+				if (call->Arguments.Count() && call->Arguments[0]->Type->IsTexture())
+				{
+					auto & name = call->Function;
+					if (name == "Sample" || name == "SampleBias" || name == "SampleGrad" || name == "SampleLevel"
+						|| name == "SampleCmp" || name == "Load")
+						return GenerateTextureCall(call);
+				}
+				return GenerateIntrinsicCall(call);
+			}
+
+			// functions
+
+			void EmitFunction(int funcId, int returnType, int funcType, SpirVFunctionState & state, int entryLabel)
+			{
+				auto & out = module.Functions;
+				out.Emit(OpFunction, { returnType, funcId, 0, funcType });
+				for (auto & param : state.Parameters)
+					out.Emit(OpFunctionParameter, { GetPointerTypeId(param.Storage, param.Type), param.Id });
+				out.Emit(OpLabel, { entryLabel });
+				out.Append(state.Variables);
+				out.Append(state.Body);
+				out.Emit(OpFunctionEnd, {});
+			}
+			void GenerateFunction(ILFunction * func)
+			{
+				SpirVFunctionState state;
+				state.Function = func;
+				fn = &state;
+				func->Code->NameAllInstructions();
+				auto returnType = func->ReturnType.Ptr();
+				List<int> paramTypes;
+				for (auto & param : func->Parameters)
+				{
+					auto paramType = param.Value.Type.Ptr();
+					auto storage = IsOpaqueType(paramType) ? StorageClassUniformConstant : StorageClassFunction;
+					SpvPointer ptr(module.AllocId(), paramType, storage);
+					module.Name(ptr.Id, param.Key);
+					paramTypes.Add(GetPointerTypeId(storage, paramType));
+					state.Parameters.Add(ptr);
+				}
+				int funcType = module.TypeFunction(GetTypeId(returnType), paramTypes);
+				AnalyzeCode(func->Code.Ptr());
+				int entryLabel = module.AllocId();
+				GenerateCode(func->Code.Ptr());
+				if (returnType && !returnType->IsVoid())
+					state.Body.Emit(OpReturnValue, { module.Undef(GetTypeId(returnType)) });
+				else
+					state.Body.Emit(OpReturn, {});
+				int funcId = GetFunctionId(func);
+				module.Name(funcId, GetOriginalFunctionName(func->Name));
+				EmitFunction(funcId, GetTypeId(returnType), funcType, state, entryLabel);
+				fn = nullptr;
+			}
+			void GeneratePositionEpilog()
+			{
+				StageAttribute positionVar;
+				if (!stage->Attributes.TryGetValue("Position", positionVar))
+					return;
+				if (!positionOperand)
+				{
+					sink->diagnose(positionVar.Position, Diagnostics::componentNotDefined, positionVar.Value);
+					return;
+				}
+				if (!(positionOperand->Type->IsFloatVector() && positionOperand->Type->GetVectorSize() == 4))
+				{
+					sink->diagnose(positionVar.Position, Diagnostics::componentHasInvalidTypeForPositionOutput, positionVar.Value);
+					return;
+				}
+				auto ptr = GetBuiltinVariable(BuiltInPosition, StorageClassOutput, BasicType(ILBaseType::Float4), "gl_Position");
+				Store(ptr, Eval(positionOperand));
+			}
+			void GenerateMain()
+			{
+				SpirVFunctionState state;
+				fn = &state;
+				world->Code->NameAllInstructions();
+				AnalyzeCode(world->Code.Ptr());
+				int entryLabel = module.AllocId();
+				GenerateCode(world->Code.Ptr());
+				if (executionModel != ExecutionModelFragment)
+					GeneratePositionEpilog();
+				state.Body.Emit(OpReturn, {});
+				int voidType = module.TypeVoid();
+				EmitFunction(mainFunction, voidType, module.TypeFunction(voidType, List<int>()), state, entryLabel);
+				fn = nullptr;
+			}
+			void GenerateExecutionModes()
+			{
+				if (executionModel == ExecutionModelFragment)
+					module.ExecutionModes.Emit(OpExecutionMode, { mainFunction, ExecutionModeOriginUpperLeft });
+				else if (executionModel == ExecutionModelTessellationEvaluation)
+				{
+					module.RequireCapability(CapabilityTessellation);
+					StageAttribute val;
+					int domain = ExecutionModeTriangles;
+					if (stage->Attributes.TryGetValue("Domain", val))
+					{
+						if (val.Value == "quads")
+							domain = ExecutionModeQuads;
+						else if (val.Value != "triangles")
+							sink->diagnose(val.Position, Diagnostics::invalidTessellationDomain);
+					}
+					module.ExecutionModes.Emit(OpExecutionMode, { mainFunction, domain });
+					module.ExecutionModes.Emit(OpExecutionMode, { mainFunction, ExecutionModeSpacingEqual });
+					bool clockwise = stage->Attributes.TryGetValue("Winding", val) && val.Value == "cw";
+					module.ExecutionModes.Emit(OpExecutionMode, { mainFunction, clockwise ? ExecutionModeVertexOrderCw : ExecutionModeVertexOrderCcw });
+				}
+			}
+		public:
+			SpirVStageCodeGen(ILProgram * pProgram, ILShader * pShader, ILStage * pStage, DiagnosticSink * pSink)
+				: program(pProgram), shader(pShader), stage(pStage), sink(pSink)
+			{
+			}
+			void Generate(StageSource & src)
+			{
+				if (stage->StageType == "FragmentShader")
+					executionModel = ExecutionModelFragment;
+				else if (stage->StageType == "DomainShader")
+					executionModel = ExecutionModelTessellationEvaluation;
+				else
+					executionModel = ExecutionModelVertex;
+
+				StageAttribute worldName;
+				RefPtr<ILWorld> stageWorld;
+				if (stage->Attributes.TryGetValue("World", worldName))
+				{
+					if (!shader->Worlds.TryGetValue(worldName.Value, stageWorld))
+						sink->diagnose(worldName.Position, Diagnostics::worldIsNotDefined, worldName.Value);
+				}
+				else
+					sink->diagnose(stage->Position, Diagnostics::stageShouldProvideWorldAttribute, stage->StageType);
+				if (!stageWorld || !stageWorld->Code)
+					return;
+				world = stageWorld.Ptr();
+
+				module.RequireCapability(CapabilityShader);
+				glslStd450 = module.AllocId();
+				module.ExtInstImports.Begin(OpExtInstImport);
+				module.ExtInstImports.Add(glslStd450);
+				module.ExtInstImports.AddString("GLSL.std.450");
+				module.ExtInstImports.End();
+				module.MemoryModel.Emit(OpMemoryModel, { AddressingModelLogical, MemoryModelGLSL450 });
+				mainFunction = module.AllocId();
+				module.Name(mainFunction, "main");
+				GenerateExecutionModes();
+
+				StageAttribute positionVar;
+				if (stage->Attributes.TryGetValue("Position", positionVar))
+					world->Components.TryGetValue(positionVar.Value, positionOperand);
+
+				DeclareParameters();
+				DeclareOutputs();
+				GenerateMain();
+				while (pendingFunctions.Count())
+				{
+					auto func = pendingFunctions.Last();
+					pendingFunctions.RemoveAt(pendingFunctions.Count() - 1);
+					GenerateFunction(func);
+				}
+
+				module.EntryPoints.Begin(OpEntryPoint);
+				module.EntryPoints.Add(executionModel);
+				module.EntryPoints.Add(mainFunction);
+				module.EntryPoints.AddString("main");
+				module.EntryPoints.Add(interfaceVariables);
+				module.EntryPoints.End();
+				module.Assemble(src.BinaryCode);
+			}
+		};
+
+		class SpirVCodeGen : public CodeGenBackend
+		{
+		public:
+			virtual CompiledShaderSource GenerateShader(CompileResult & result, SymbolTable *, ILShader * shader, DiagnosticSink * err) override
+			{
+				CompiledShaderSource rs;
+				for (auto & stage : shader->Stages)
+				{
+					StageSource src;
+					auto & stageType = stage.Value->StageType;
+					if (stageType == "VertexShader" || stageType == "FragmentShader" || stageType == "DomainShader")
+					{
+						SpirVStageCodeGen codeGen(result.Program.Ptr(), shader, stage.Value.Ptr(), err);
+						codeGen.Generate(src);
+					}
+					else if (stageType == "ComputeShader" || stageType == "HullShader")
+						SPIRE_UNIMPLEMENTED(err, stage.Value->Position, "SPIR-V code generation for '" + stageType + "' (use the GLSL_Vulkan target instead)");
+					else
+						err->diagnose(stage.Value->Position, Diagnostics::unknownStageType, stageType);
+					rs.Stages[stage.Key] = src;
+				}
+				rs.MetaData.ShaderName = shader->Name;
+				rs.MetaData.ParameterSets = shader->ModuleParamSets;
+				return rs;
+			}
+			LayoutRule GetDefaultLayoutRule() override
+			{
+				return LayoutRule::Std140;
+			}
+		};
 
 		CodeGenBackend * CreateSpirVCodeGen()
 		{
 			return new SpirVCodeGen();
 		}
 	}
-}
\ No newline at end of file
+}
@@ -1852,7 +1852,7 @@ namespace Spire
 				FillPosition(constExpr.Ptr());
 				if (token.Type == TokenType::IntLiterial)
 				{
-					if (token.Content.EndsWith("u") || token.Content.EndsWith("U"))
+					if (token.Content.ToString().EndsWith("u") || token.Content.ToString().EndsWith("U"))
 					{
 						constExpr->ConstType = ConstantExpressionSyntaxNode::ConstantType::UInt;
 						constExpr->IntValue = StringToUInt(token.Content);
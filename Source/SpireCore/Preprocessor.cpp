@@ -3,6 +3,7 @@
 
 #include "Diagnostics.h"
 #include "Lexer.h"
+#include "../CoreLib/LibIO.h"
 
 #include <assert.h>
 
@@ -46,17 +47,141 @@ struct PreprocessorConditional
 
 struct PreprocessorMacro;
 
+// The macros of one environment, in a hash table with open addressing
+// that is keyed by the id of the interned macro name. A lookup hashes
+// an integer and compares integers, and removing every macro keeps the
+// slots around for the next use of the table.
+struct PreprocessorMacroTable
+{
+    struct Slot
+    {
+        // id of the macro name, or 0 if the slot was never used
+        int                 nameId;
+
+        // NULL if the macro was removed
+        PreprocessorMacro*  macro;
+    };
+
+    // The slots, a power of two of them (or none)
+    List<Slot>  slots;
+
+    // The number of slots that were ever used, removed macros included
+    int         usedSlotCount = 0;
+
+    static int GetSlotIndex(int nameId, int mask)
+    {
+        return (int)(((unsigned int)nameId * 2654435761u) >> 8) & mask;
+    }
+
+    Slot* FindSlot(Atom name)
+    {
+        int mask = slots.Count() - 1;
+        if (mask < 0)
+            return NULL;
+        for (int i = GetSlotIndex(name.GetId(), mask);; i = (i + 1) & mask)
+        {
+            if (slots[i].nameId == name.GetId())
+                return &slots[i];
+            if (slots[i].nameId == 0)
+                return NULL;
+        }
+    }
+
+    PreprocessorMacro* Find(Atom name)
+    {
+        Slot* slot = FindSlot(name);
+        return slot ? slot->macro : NULL;
+    }
+
+    // Sets the macro for `name`, which must not have one yet
+    void Add(Atom name, PreprocessorMacro* macro)
+    {
+        if (Slot* slot = FindSlot(name))
+        {
+            slot->macro = macro;
+            return;
+        }
+        if ((usedSlotCount + 1) * 4 > slots.Count() * 3)
+            Rehash(slots.Count() ? slots.Count() * 2 : 8);
+        int mask = slots.Count() - 1;
+        int i = GetSlotIndex(name.GetId(), mask);
+        while (slots[i].nameId)
+            i = (i + 1) & mask;
+        slots[i].nameId = name.GetId();
+        slots[i].macro = macro;
+        usedSlotCount++;
+    }
+
+    // Removes the macro for `name`, and returns it (or NULL if there was none)
+    PreprocessorMacro* Remove(Atom name)
+    {
+        Slot* slot = FindSlot(name);
+        if (!slot)
+            return NULL;
+        PreprocessorMacro* macro = slot->macro;
+        slot->macro = NULL;
+        return macro;
+    }
+
+    void Rehash(int slotCount)
+    {
+        List<Slot> oldSlots = _Move(slots);
+        slots.SetSize(slotCount);
+        for (auto & slot : slots)
+        {
+            slot.nameId = 0;
+            slot.macro = NULL;
+        }
+        usedSlotCount = 0;
+        for (auto & slot : oldSlots)
+        {
+            if (slot.macro)
+            {
+                int i = GetSlotIndex(slot.nameId, slotCount - 1);
+                while (slots[i].nameId)
+                    i = (i + 1) & (slotCount - 1);
+                slots[i] = slot;
+                usedSlotCount++;
+            }
+        }
+    }
+
+    // Empties the table, and calls `f` on each macro that was in it
+    template<typename F>
+    void Clear(F const& f)
+    {
+        if (!usedSlotCount)
+            return;
+        for (auto & slot : slots)
+        {
+            if (slot.macro)
+                f(slot.macro);
+            slot.nameId = 0;
+            slot.macro = NULL;
+        }
+        usedSlotCount = 0;
+    }
+};
+
 struct PreprocessorEnvironment
 {
     // The "outer" environment, to be used if lookup in this env fails
     PreprocessorEnvironment*                parent = NULL;
 
     // Macros defined in this environment
-    Dictionary<String, PreprocessorMacro*>  macros;
+    PreprocessorMacroTable                  macros;
 
     ~PreprocessorEnvironment();
 };
 
+// The kinds of input stream, each with a concrete type of its own
+enum class PreprocessorInputStreamFlavor
+{
+    SourceText,
+    ObjectLikeMacroExpansion,
+    FunctionLikeMacroExpansion,
+};
+
 // Input tokens can either come from source text, or from macro expansion.
 // In general, input streams can be nested, so we have to keep a conceptual
 // stack of input.
@@ -76,6 +201,9 @@ struct PreprocessorInputStream
     // Reader for pre-tokenized input
     TokenReader                     tokenReader;
 
+    // The concrete type of this stream
+    PreprocessorInputStreamFlavor   flavor;
+
     // Destructor is virtual so that we can clean up
     // after concrete subtypes.
     virtual ~PreprocessorInputStream() = default;
@@ -83,8 +211,8 @@ struct PreprocessorInputStream
 
 struct SourceTextInputStream : PreprocessorInputStream
 {
-    // The pre-tokenized input
-    TokenList           lexedTokens;
+    // The file being read, which holds the pre-tokenized input
+    RefPtr<SourceFile>  sourceFile;
 };
 
 struct MacroExpansion : PreprocessorInputStream
@@ -152,6 +280,27 @@ struct Preprocessor
     // Currently-defined macros
     PreprocessorEnvironment                 globalEnv;
 
+    // Canonical paths of the files that contained `#pragma once`,
+    // which are skipped when they are included again
+    HashSet<String>                         pragmaOnceFiles;
+
+    // If not NULL, receives the macros and files the output depends on
+    PreprocessorDependencies*               dependencies;
+
+    // The definitions the preprocessor was started with
+    Dictionary<String, String> const*       initialDefines;
+
+    // Names whose lookups no longer depend on `initialDefines`, either
+    // because they are recorded already or because the source itself
+    // defined or undefined them
+    HashSet<Atom>                           settledMacros;
+
+    // Macros and macro expansions that are no longer in use, kept to be
+    // used again so that expanding a macro does not allocate each time
+    List<PreprocessorMacro*>                freeMacros;
+    List<ObjectLikeMacroExpansion*>         freeObjectLikeExpansions;
+    List<FunctionLikeMacroExpansion*>       freeFunctionLikeExpansions;
+
     // A pre-allocated token that can be returned to
     // represent end-of-input situations.
     Token                                   endOfFileToken;
@@ -175,34 +324,71 @@ static void DestroyMacro(Preprocessor* preprocessor, PreprocessorMacro* macro);
 //
 
 // Create a fresh input stream
-static void  InitializeInputStream(Preprocessor* preprocessor, PreprocessorInputStream* inputStream)
+static void  InitializeInputStream(Preprocessor* preprocessor, PreprocessorInputStream* inputStream, PreprocessorInputStreamFlavor flavor)
 {
     inputStream->parent = NULL;
     inputStream->conditional = NULL;
     inputStream->environment = &preprocessor->globalEnv;
+    inputStream->flavor = flavor;
 }
 
-// Destroy an input stream
-static void DestroyInputStream(Preprocessor* /*preprocessor*/, PreprocessorInputStream* inputStream)
+// Destroy an input stream. Macro expansions go back to the pools of
+// the preprocessor, together with the arguments of a function-like one.
+static void DestroyInputStream(Preprocessor* preprocessor, PreprocessorInputStream* inputStream)
 {
-    delete inputStream;
+    switch (inputStream->flavor)
+    {
+    case PreprocessorInputStreamFlavor::ObjectLikeMacroExpansion:
+        preprocessor->freeObjectLikeExpansions.Add(static_cast<ObjectLikeMacroExpansion*>(inputStream));
+        break;
+
+    case PreprocessorInputStreamFlavor::FunctionLikeMacroExpansion:
+        {
+            FunctionLikeMacroExpansion* expansion = static_cast<FunctionLikeMacroExpansion*>(inputStream);
+            expansion->argumentEnvironment.macros.Clear([&](PreprocessorMacro* arg) { DestroyMacro(preprocessor, arg); });
+            preprocessor->freeFunctionLikeExpansions.Add(expansion);
+        }
+        break;
+
+    default:
+        delete inputStream;
+        break;
+    }
 }
 
 // Create an input stream to represent a pre-tokenized input file.
 // TODO(tfoley): pre-tokenizing files isn't going to work in the long run.
-static PreprocessorInputStream* CreateInputStreamForSource(Preprocessor* preprocessor, CoreLib::String const& source, CoreLib::String const& fileName)
+static PreprocessorInputStream* CreateInputStreamForSourceFile(Preprocessor* preprocessor, RefPtr<SourceFile> sourceFile)
 {
     SourceTextInputStream* inputStream = new SourceTextInputStream();
-    InitializeInputStream(preprocessor, inputStream);
+    InitializeInputStream(preprocessor, inputStream, PreprocessorInputStreamFlavor::SourceText);
 
-    // Use existing `Lexer` to generate a token stream.
-    Lexer lexer;
-    inputStream->lexedTokens = lexer.Parse(fileName, source, GetSink(preprocessor));
-    inputStream->tokenReader = TokenReader(inputStream->lexedTokens);
+    // Files from a `SourceFileCache` are shared, so one that still
+    // needs lexing is lexed into a copy of its own.
+    if (!sourceFile->IsLexed())
+    {
+        sourceFile = new SourceFile(*sourceFile);
+        sourceFile->Lex(GetSink(preprocessor));
+    }
+    inputStream->sourceFile = sourceFile;
+    inputStream->tokenReader = TokenReader(sourceFile->Tokens);
 
     return inputStream;
 }
 
+static PreprocessorInputStream* CreateInputStreamForSource(Preprocessor* preprocessor, CoreLib::String const& source, CoreLib::String const& fileName)
+{
+    SourceFileCache* sourceFileCache = preprocessor->includeHandler ? preprocessor->includeHandler->GetSourceFileCache() : NULL;
+    if (sourceFileCache)
+        return CreateInputStreamForSourceFile(preprocessor, sourceFileCache->Lex(fileName, source));
+
+    RefPtr<SourceFile> sourceFile = new SourceFile();
+    sourceFile->FileName = fileName;
+    sourceFile->CanonicalPath = CoreLib::IO::Path::GetCanonicalPath(fileName);
+    sourceFile->Text = source;
+    return CreateInputStreamForSourceFile(preprocessor, sourceFile);
+}
+
 
 
 static void PushInputStream(Preprocessor* preprocessor, PreprocessorInputStream* inputStream)
@@ -377,32 +563,58 @@ static CoreLib::Text::TokenType PeekRawTokenType(Preprocessor* preprocessor)
 // Macros
 //
 
-// Create a macro
+// Create a macro, reusing one from the pool of the preprocessor if possible
 static PreprocessorMacro* CreateMacro(Preprocessor* preprocessor)
 {
-    // TODO(tfoley): Allocate these more intelligently.
-    // For example, consider pooling them on the preprocessor.
-
-    PreprocessorMacro* macro = new PreprocessorMacro();
+    PreprocessorMacro* macro;
+    if (preprocessor->freeMacros.Count())
+    {
+        macro = preprocessor->freeMacros.Last();
+        preprocessor->freeMacros.RemoveAt(preprocessor->freeMacros.Count() - 1);
+    }
+    else
+        macro = new PreprocessorMacro();
     macro->flavor = PreprocessorMacroFlavor::ObjectLike;
     macro->environment = &preprocessor->globalEnv;
     return macro;
 }
 
-// Destroy a macro
-static void DestroyMacro(Preprocessor* /*preprocessor*/, PreprocessorMacro* macro)
+// Destroy a macro, or return it to the pool of `preprocessor` if
+// there is one. Pooled macros keep the space of their token lists.
+static void DestroyMacro(Preprocessor* preprocessor, PreprocessorMacro* macro)
 {
-    delete macro;
+    if (!preprocessor)
+    {
+        delete macro;
+        return;
+    }
+    macro->params.Clear();
+    macro->tokens.mTokens.Clear();
+    preprocessor->freeMacros.Add(macro);
 }
 
 
+// Record that the output depends on how `name` was defined when
+// preprocessing started.
+static void NoteMacroQuery(Preprocessor* preprocessor, Atom name)
+{
+    if (!preprocessor->dependencies || !preprocessor->settledMacros.Add(name))
+        return;
+    PreprocessorMacroQuery query;
+    query.Name = name.ToString();
+    if (preprocessor->initialDefines)
+        query.IsDefined = preprocessor->initialDefines->TryGetValue(query.Name, query.Value);
+    preprocessor->dependencies->Macros.Add(query);
+}
+
 // Find the currently-defined macro of the given name, or return NULL
-static PreprocessorMacro* LookupMacro(PreprocessorEnvironment* environment, String const& name)
+static PreprocessorMacro* LookupMacro(Preprocessor* preprocessor, PreprocessorEnvironment* environment, Atom name)
 {
     for(PreprocessorEnvironment* e = environment; e; e = e->parent)
     {
-        PreprocessorMacro* macro = NULL;
-        if (e->macros.TryGetValue(name, macro))
+        if (e == &preprocessor->globalEnv)
+            NoteMacroQuery(preprocessor, name);
+        if (PreprocessorMacro* macro = e->macros.Find(name))
             return macro;
     }
 
@@ -415,9 +627,9 @@ static PreprocessorEnvironment* GetCurrentEnvironment(Preprocessor* preprocessor
     return inputStream ? inputStream->environment : &preprocessor->globalEnv;
 }
 
-static PreprocessorMacro* LookupMacro(Preprocessor* preprocessor, String const& name)
+static PreprocessorMacro* LookupMacro(Preprocessor* preprocessor, Atom name)
 {
-    return LookupMacro(GetCurrentEnvironment(preprocessor), name);
+    return LookupMacro(preprocessor, GetCurrentEnvironment(preprocessor), name);
 }
 
 // A macro is "busy" if it is currently being used for expansion.
@@ -456,11 +668,12 @@ static bool IsMacroBusy(PreprocessorMacro* /*macro*/)
 //
 
 static void InitializeMacroExpansion(
-    Preprocessor*       preprocessor,
-    MacroExpansion*     expansion,
-    PreprocessorMacro*  macro)
+    Preprocessor*                   preprocessor,
+    MacroExpansion*                 expansion,
+    PreprocessorMacro*              macro,
+    PreprocessorInputStreamFlavor   flavor)
 {
-    InitializeInputStream(preprocessor, expansion);
+    InitializeInputStream(preprocessor, expansion, flavor);
     expansion->environment = macro->environment;
     expansion->macro = macro;
     expansion->tokenReader = TokenReader(macro->tokens);
@@ -500,8 +713,7 @@ static void MaybeBeginMacroExpansion(
             return;
 
         // Look for a macro with the given name.
-        String name = token.Content;
-        PreprocessorMacro* macro = LookupMacro(preprocessor, name);
+        PreprocessorMacro* macro = LookupMacro(preprocessor, token.Content);
 
         // Not a macro? Can't be an invocation.
         if (!macro)
@@ -526,8 +738,15 @@ static void MaybeBeginMacroExpansion(
             // Consume the opening `(`
             Token leftParen = AdvanceRawToken(preprocessor);
 
-            FunctionLikeMacroExpansion* expansion = new FunctionLikeMacroExpansion();
-            InitializeMacroExpansion(preprocessor, expansion, macro);
+            FunctionLikeMacroExpansion* expansion;
+            if (preprocessor->freeFunctionLikeExpansions.Count())
+            {
+                expansion = preprocessor->freeFunctionLikeExpansions.Last();
+                preprocessor->freeFunctionLikeExpansions.RemoveAt(preprocessor->freeFunctionLikeExpansions.Count() - 1);
+            }
+            else
+                expansion = new FunctionLikeMacroExpansion();
+            InitializeMacroExpansion(preprocessor, expansion, macro, PreprocessorInputStreamFlavor::FunctionLikeMacroExpansion);
             expansion->argumentEnvironment.parent = &preprocessor->globalEnv;
             expansion->environment = &expansion->argumentEnvironment;
 
@@ -554,10 +773,9 @@ static void MaybeBeginMacroExpansion(
                     arg->environment = GetCurrentEnvironment(preprocessor);
 
                     // Associate the new macro with its parameter name
-                    Token paramToken = macro->params[argIndex];
-                    String const& paramName = paramToken.Content;
+                    Token const& paramToken = macro->params[argIndex];
                     arg->nameToken = paramToken;
-                    expansion->argumentEnvironment.macros[paramName] = arg;
+                    expansion->argumentEnvironment.macros.Add(paramToken.Content, arg);
                     argIndex++;
 
                     // Read tokens for the argument
@@ -650,8 +868,15 @@ static void MaybeBeginMacroExpansion(
             AdvanceRawToken(preprocessor);
 
             // Object-like macros are the easy case.
-            ObjectLikeMacroExpansion* expansion = new ObjectLikeMacroExpansion();
-            InitializeMacroExpansion(preprocessor, expansion, macro);
+            ObjectLikeMacroExpansion* expansion;
+            if (preprocessor->freeObjectLikeExpansions.Count())
+            {
+                expansion = preprocessor->freeObjectLikeExpansions.Last();
+                preprocessor->freeObjectLikeExpansions.RemoveAt(preprocessor->freeObjectLikeExpansions.Count() - 1);
+            }
+            else
+                expansion = new ObjectLikeMacroExpansion();
+            InitializeMacroExpansion(preprocessor, expansion, macro, PreprocessorInputStreamFlavor::ObjectLikeMacroExpansion);
             PushMacroExpansion(preprocessor, expansion);
         }
     }
@@ -786,7 +1011,7 @@ static CodePosition PeekLoc(PreprocessorDirectiveContext* context)
 }
 
 // Wrapper to look up a macro in the context of a directive.
-static PreprocessorMacro* LookupMacro(PreprocessorDirectiveContext* context, String const& name)
+static PreprocessorMacro* LookupMacro(PreprocessorDirectiveContext* context, Atom name)
 {
     return LookupMacro(context->preprocessor, name);
 }
@@ -1030,7 +1255,7 @@ static PreprocessorExpressionValue ParseAndEvaluateUnaryExpression(PreprocessorD
                 {
                     return 0;
                 }
-                String name = nameToken.Content;
+                Atom name = nameToken.Content;
 
                 // If we saw an opening `(`, then expect one to close
                 if (leftParen.Type != TokenType::Unknown)
@@ -1242,7 +1467,7 @@ static void HandleIfDefDirective(PreprocessorDirectiveContext* context)
     Token nameToken;
     if(!ExpectRaw(context, TokenType::Identifier, Diagnostics::expectedTokenInPreprocessorDirective, &nameToken))
         return;
-    String name = nameToken.Content;
+    Atom name = nameToken.Content;
 
     // Check if the name is defined.
     BeginConditional(context, LookupMacro(context, name) != NULL);
@@ -1255,7 +1480,7 @@ static void HandleIfNDefDirective(PreprocessorDirectiveContext* context)
     Token nameToken;
     if(!ExpectRaw(context, TokenType::Identifier, Diagnostics::expectedTokenInPreprocessorDirective, &nameToken))
         return;
-    String name = nameToken.Content;
+    Atom name = nameToken.Content;
 
     // Check if the name is defined.
     BeginConditional(context, LookupMacro(context, name) == NULL);
@@ -1367,9 +1592,6 @@ static void HandleIncludeDirective(PreprocessorDirectiveContext* context)
 
     // TODO(tfoley): make this robust in presence of `#line`
     String pathIncludedFrom = GetDirectiveLoc(context).FileName;
-    String foundPath;
-    String foundSource;
-
 
     IncludeHandler* includeHandler = context->preprocessor->includeHandler;
     if (!includeHandler)
@@ -1378,15 +1600,32 @@ static void HandleIncludeDirective(PreprocessorDirectiveContext* context)
         GetSink(context)->diagnose(pathToken.Position, Diagnostics::noIncludeHandlerSpecified);
         return;
     }
-    if (!includeHandler->TryToFindIncludeFile(path, pathIncludedFrom, &foundPath, &foundSource))
+    RefPtr<SourceFile> sourceFile = includeHandler->TryToFindIncludeFile(path, pathIncludedFrom);
+    if (!sourceFile)
     {
         GetSink(context)->diagnose(pathToken.Position, Diagnostics::includeFailed, path);
         return;
     }
+    if (context->preprocessor->dependencies)
+    {
+        PreprocessorIncludeQuery query;
+        query.PathToInclude = path;
+        query.PathIncludedFrom = pathIncludedFrom;
+        query.File = sourceFile;
+        context->preprocessor->dependencies->Includes.Add(query);
+    }
+
+    // A file marked with `#pragma once` that was already included, or
+    // a file whose include guard is already defined, would not produce
+    // any tokens, so it is skipped without being read again.
+    if (context->preprocessor->pragmaOnceFiles.Contains(sourceFile->CanonicalPath))
+        return;
+    if (sourceFile->IncludeGuard.Length() && LookupMacro(context->preprocessor, &context->preprocessor->globalEnv, sourceFile->IncludeGuard))
+        return;
 
     // Push the new file onto our stack of input streams
     // TODO(tfoley): check if we have made our include stack too deep
-    PreprocessorInputStream* inputStream = CreateInputStreamForSource(context->preprocessor, foundSource, foundPath);
+    PreprocessorInputStream* inputStream = CreateInputStreamForSourceFile(context->preprocessor, sourceFile);
     inputStream->parent = context->preprocessor->inputStream;
     context->preprocessor->inputStream = inputStream;
 }
@@ -1395,14 +1634,15 @@ static void HandleIncludeDirective(PreprocessorDirectiveContext* context)
 static void HandleDefineDirective(PreprocessorDirectiveContext* context)
 {
     Token nameToken;
-    if (!Expect(context, TokenType::Identifier, Diagnostics::expectedTokenInPreprocessorDirective, &nameToken))
+    if (!ExpectRaw(context, TokenType::Identifier, Diagnostics::expectedTokenInPreprocessorDirective, &nameToken))
         return;
-    String name = nameToken.Content;
+    Atom name = nameToken.Content;
 
     PreprocessorMacro* macro = CreateMacro(context->preprocessor);
     macro->nameToken = nameToken;
 
-    PreprocessorMacro* oldMacro = LookupMacro(&context->preprocessor->globalEnv, name);
+    PreprocessorMacro* oldMacro = LookupMacro(context->preprocessor, &context->preprocessor->globalEnv, name);
+    context->preprocessor->settledMacros.Add(name);
     if (oldMacro)
     {
         GetSink(context)->diagnose(nameToken.Position, Diagnostics::macroRedefinition, name);
@@ -1410,7 +1650,7 @@ static void HandleDefineDirective(PreprocessorDirectiveContext* context)
 
         DestroyMacro(context->preprocessor, oldMacro);
     }
-    context->preprocessor->globalEnv.macros[name] = macro;
+    context->preprocessor->globalEnv.macros.Add(name, macro);
 
     // If macro name is immediately followed (with no space) by `(`,
     // then we have a function-like macro
@@ -1469,12 +1709,13 @@ static void HandleDefineDirective(PreprocessorDirectiveContext* context)
 static void HandleUndefDirective(PreprocessorDirectiveContext* context)
 {
     Token nameToken;
-    if (!Expect(context, TokenType::Identifier, Diagnostics::expectedTokenInPreprocessorDirective, &nameToken))
+    if (!ExpectRaw(context, TokenType::Identifier, Diagnostics::expectedTokenInPreprocessorDirective, &nameToken))
         return;
-    String name = nameToken.Content;
+    Atom name = nameToken.Content;
 
     PreprocessorEnvironment* env = &context->preprocessor->globalEnv;
-    PreprocessorMacro* macro = LookupMacro(env, name);
+    PreprocessorMacro* macro = LookupMacro(context->preprocessor, env, name);
+    context->preprocessor->settledMacros.Add(name);
     if (macro != NULL)
     {
         // name was defined, so remove it
@@ -1560,7 +1801,17 @@ static void HandleLineDirective(PreprocessorDirectiveContext* context)
 // Handle a `#pragma` directive
 static void HandlePragmaDirective(PreprocessorDirectiveContext* context)
 {
-    // TODO(tfoley): figure out which pragmas to parse,
+    // `#pragma once` marks the current file, so that later
+    // `#include`s of it are skipped
+    if (PeekRawTokenType(context) == TokenType::Identifier && PeekRawToken(context).Content == "once")
+    {
+        AdvanceRawToken(context);
+        if (auto sourceStream = dynamic_cast<SourceTextInputStream*>(context->preprocessor->inputStream))
+            context->preprocessor->pragmaOnceFiles.Add(sourceStream->sourceFile->CanonicalPath);
+        return;
+    }
+
+    // TODO(tfoley): figure out which other pragmas to parse,
     // and which to pass along
     SkipToEndOfLine(context);
 }
@@ -1741,6 +1992,8 @@ static void InitializePreprocessor(
 {
     preprocessor->sink = sink;
     preprocessor->includeHandler = NULL;
+    preprocessor->dependencies = NULL;
+    preprocessor->initialDefines = NULL;
     preprocessor->endOfFileToken.Type = TokenType::EndOfFile;
     preprocessor->endOfFileToken.flags = TokenFlag::AtStartOfLine;
 }
@@ -1748,10 +2001,7 @@ static void InitializePreprocessor(
 // clean up after an environment
 PreprocessorEnvironment::~PreprocessorEnvironment()
 {
-    for (auto pair : this->macros)
-    {
-        DestroyMacro(NULL, pair.Value);
-    }
+    this->macros.Clear([](PreprocessorMacro* macro) { DestroyMacro(NULL, macro); });
 }
 
 // finalize a preprocessor and free any memory still in use
@@ -1767,12 +2017,17 @@ static void FinalizePreprocessor(
         input = parent;
     }
 
+    // Free the pooled macros and expansions
+    for (auto macro : preprocessor->freeMacros)
+        delete macro;
+    for (auto expansion : preprocessor->freeObjectLikeExpansions)
+        delete expansion;
+    for (auto expansion : preprocessor->freeFunctionLikeExpansions)
+        delete expansion;
+
 #if 0
     // clean up any macros that were allocated
-    for (auto pair : preprocessor->globalEnv.macros)
-    {
-        DestroyMacro(preprocessor, pair.Value);
-    }
+    preprocessor->globalEnv.macros.Clear([&](PreprocessorMacro* macro) { DestroyMacro(preprocessor, macro); });
 #endif
 }
 
@@ -1791,13 +2046,13 @@ static void DefineMacro(
     macro->tokens = lexer.Parse(fileName, value, GetSink(preprocessor));
     macro->nameToken = Token(TokenType::Identifier, key, 0, 0, 0, fileName);
 
-    PreprocessorMacro* oldMacro = NULL;
-    if (preprocessor->globalEnv.macros.TryGetValue(key, oldMacro))
+    Atom name = key;
+    if (PreprocessorMacro* oldMacro = preprocessor->globalEnv.macros.Find(name))
     {
         DestroyMacro(preprocessor, oldMacro);
     }
 
-    preprocessor->globalEnv.macros[key] = macro;
+    preprocessor->globalEnv.macros.Add(name, macro);
 }
 
 // read the entire input into tokens
@@ -1848,11 +2103,24 @@ TokenList PreprocessSource(
     DiagnosticSink* sink,
     IncludeHandler* includeHandler,
     CoreLib::Dictionary<CoreLib::String, CoreLib::String>  defines)
+{
+    return PreprocessSource(source, fileName, sink, includeHandler, defines, NULL);
+}
+
+TokenList PreprocessSource(
+    CoreLib::String const& source,
+    CoreLib::String const& fileName,
+    DiagnosticSink* sink,
+    IncludeHandler* includeHandler,
+    CoreLib::Dictionary<CoreLib::String, CoreLib::String> const& defines,
+    PreprocessorDependencies* dependencies)
 {
     Preprocessor preprocessor;
     InitializePreprocessor(&preprocessor, sink);
 
     preprocessor.includeHandler = includeHandler;
+    preprocessor.dependencies = dependencies;
+    preprocessor.initialDefines = &defines;
     for (auto p : defines)
     {
         DefineMacro(&preprocessor, p.Key, p.Value);
@@ -5,20 +5,59 @@
 #include "../CoreLib/Basic.h"
 #include "../CoreLib/Tokenizer.h"
 #include "../SpireCore/Lexer.h"
+#include "../SpireCore/SourceFileCache.h"
 
 namespace Spire{ namespace Compiler {
 
 class DiagnosticSink;
+class CompileUnitCache;
 
 // Callback interface for the preprocessor to use when looking
 // for files in `#include` directives.
 struct IncludeHandler
 {
-    virtual bool TryToFindIncludeFile(
+    // Returns the file to include, or nullptr if it cannot be found.
+    // The file may come from a `SourceFileCache`, in which case it is
+    // already lexed and the preprocessor reuses its tokens.
+    virtual RefPtr<SourceFile> TryToFindIncludeFile(
         CoreLib::String const& pathToInclude,
-        CoreLib::String const& pathIncludedFrom,
-        CoreLib::String* outFoundPath,
-        CoreLib::String* outFoundSource) = 0;
+        CoreLib::String const& pathIncludedFrom) = 0;
+
+    // The cache the preprocessor uses for the tokens of the source
+    // text it is given, if any. Preprocessing text that is in the
+    // cache already does not lex it again.
+    virtual SourceFileCache* GetSourceFileCache() { return NULL; }
+
+    // The cache of parsed files the compiler uses with this handler, if any.
+    virtual CompileUnitCache* GetCompileUnitCache() { return NULL; }
+};
+
+// A macro the preprocessor looked up before the source itself defined
+// or undefined it, so its meaning came from the definitions passed in.
+struct PreprocessorMacroQuery
+{
+    CoreLib::String Name;
+    bool IsDefined = false;
+    // the definition the macro had, if it was defined
+    CoreLib::String Value;
+};
+
+// A file the preprocessor found for an `#include` directive.
+struct PreprocessorIncludeQuery
+{
+    CoreLib::String PathToInclude;
+    CoreLib::String PathIncludedFrom;
+    RefPtr<SourceFile> File;
+};
+
+// Everything the output of preprocessing a source depended on besides
+// its text. Preprocessing the same text again gives the same tokens if
+// every macro is defined the same way and every include finds the same
+// file.
+struct PreprocessorDependencies
+{
+    CoreLib::List<PreprocessorMacroQuery> Macros;
+    CoreLib::List<PreprocessorIncludeQuery> Includes;
 };
 
 // Take a string of source code and preprocess it into a list of tokens.
@@ -35,6 +74,15 @@ TokenList PreprocessSource(
     IncludeHandler* includeHandler,
     CoreLib::Dictionary<CoreLib::String, CoreLib::String>  defines);
 
+// Same as above, and records in `dependencies` what the tokens depended on.
+TokenList PreprocessSource(
+    CoreLib::String const& source,
+    CoreLib::String const& fileName,
+    DiagnosticSink* sink,
+    IncludeHandler* includeHandler,
+    CoreLib::Dictionary<CoreLib::String, CoreLib::String> const& defines,
+    PreprocessorDependencies* dependencies);
+
 }}
 
 #endif
@@ -70,6 +70,7 @@ namespace Spire
 				Schedule schedule;
 				Lexer lex;
 				tokens = lex.Parse(fileName, source, sink);
+				reader = TokenReader(tokens);
 				try
 				{
 					while (reader.PeekTokenType() != TokenType::EndOfFile)
@@ -0,0 +1,505 @@
+#include "ScheduleExplorer.h"
+#include "Closure.h"
+#include "Schedule.h"
+#include "SyntaxVisitors.h"
+#include "CostAnalysis.h"
+#include "../CoreLib/LibMath.h"
+#include <atomic>
+#include <limits>
+#include <thread>
+
+namespace Spire
+{
+	namespace Compiler
+	{
+		List<ShaderChoice> GetShaderChoices(ShaderClosure * shader)
+		{
+			List<ShaderChoice> choices;
+			auto & worldOrder = shader->Pipeline->GetWorldTopologyOrder();
+			for (auto & comp : shader->AllComponents)
+			{
+				ShaderChoice choice;
+				if (comp.Value.Symbol->ChoiceNames.Count() == 0)
+					continue;
+				if (comp.Value.Symbol->IsRequire())
+					continue;
+				choice.ChoiceName = comp.Value.Symbol->ChoiceNames.First();
+				for (auto & impl : comp.Value.Symbol->Implementations)
+				{
+					for (auto w : impl->Worlds)
+						if (comp.Value.Symbol->Type->ConstrainedWorlds.Contains(w))
+							choice.Options.Add(ShaderChoiceValue(w));
+				}
+				if (auto defs = shader->IR->DefinitionsByComponent.TryGetValue(comp.Key))
+				{
+					int latestWorldOrder = -1;
+					for (auto & def : *defs)
+					{
+						int order = worldOrder.IndexOf(def.Key);
+						if (latestWorldOrder < order)
+						{
+							choice.DefaultValue = def.Key;
+							latestWorldOrder = order;
+						}
+					}
+				}
+				choices.Add(choice);
+			}
+			return choices;
+		}
+
+		// counts the operations of a component definition, without changing the syntax, which other variants share
+		class OperationCountVisitor : public SyntaxVisitor
+		{
+		public:
+			int Count = 0;
+			OperationCountVisitor()
+				: SyntaxVisitor(nullptr)
+			{}
+			RefPtr<ExpressionSyntaxNode> VisitBinaryExpression(BinaryExpressionSyntaxNode * expr) override
+			{
+				Count++;
+				return SyntaxVisitor::VisitBinaryExpression(expr);
+			}
+			RefPtr<ExpressionSyntaxNode> VisitUnaryExpression(UnaryExpressionSyntaxNode * expr) override
+			{
+				Count++;
+				return SyntaxVisitor::VisitUnaryExpression(expr);
+			}
+			RefPtr<ExpressionSyntaxNode> VisitIndexExpression(IndexExpressionSyntaxNode * expr) override
+			{
+				Count++;
+				return SyntaxVisitor::VisitIndexExpression(expr);
+			}
+			RefPtr<ExpressionSyntaxNode> VisitSelectExpression(SelectExpressionSyntaxNode * expr) override
+			{
+				Count++;
+				return SyntaxVisitor::VisitSelectExpression(expr);
+			}
+			RefPtr<ExpressionSyntaxNode> VisitInvokeExpression(InvokeExpressionSyntaxNode * expr) override
+			{
+				Count++;
+				return SyntaxVisitor::VisitInvokeExpression(expr);
+			}
+			RefPtr<ExpressionSyntaxNode> VisitTypeCastExpression(TypeCastExpressionSyntaxNode * expr) override
+			{
+				// the default visitor replaces the cast by its operand
+				Count++;
+				if (expr->Expression)
+					expr->Expression->Accept(this);
+				return expr;
+			}
+			RefPtr<ExpressionSyntaxNode> VisitImportExpression(ImportExpressionSyntaxNode * expr) override
+			{
+				// an import is one operation, whatever the body of its operator does
+				Count++;
+				for (auto & arg : expr->Arguments)
+					arg->Accept(this);
+				return expr;
+			}
+		};
+
+		class SyntaxCostModel : public ScheduleCostModel
+		{
+		public:
+			virtual List<String> GetCostNames(ShaderClosure * shader) override
+			{
+				List<String> names;
+				for (auto & world : shader->Pipeline->Worlds)
+					if (!shader->Pipeline->IsAbstractWorld(world.Key))
+						names.Add(world.Key);
+				return names;
+			}
+			virtual List<double> Evaluate(ShaderIR * variant) override
+			{
+				auto worlds = GetCostNames(variant->Shader);
+				List<double> costs;
+				for (int i = 0; i < worlds.Count(); i++)
+					costs.Add(0.0);
+				for (auto & def : variant->Definitions)
+				{
+					int world = worlds.IndexOf(def->World);
+					if (world == -1)
+						continue;
+					OperationCountVisitor visitor;
+					def->SyntaxNode->Accept(&visitor);
+					costs[world] += visitor.Count;
+				}
+				return costs;
+			}
+		};
+
+		RefPtr<ScheduleCostModel> CreateSyntaxCostModel()
+		{
+			return new SyntaxCostModel();
+		}
+
+		class ILCostModel : public ScheduleCostModel
+		{
+		private:
+			// the symbols of the context, frozen so that each variant can fork them; the code generator adds the
+			// component functions of a variant to the fork it is given, so variants do not see each other's
+			SymbolTable symTable;
+			CodeGenBackend * backend;
+			CompileResult functionResult; // the IL of the functions and structs every variant calls
+		public:
+			ILCostModel(SymbolTable * symbols, CodeGenBackend * _backend, ProgramSyntaxNode * program, ILProgram * contextProgram)
+				: backend(_backend)
+			{
+				symTable.Fork(*symbols);
+				functionResult.Program = new ILProgram();
+				if (contextProgram)
+				{
+					functionResult.Program->Functions = contextProgram->Functions;
+					functionResult.Program->Structs = contextProgram->Structs;
+				}
+				RefPtr<ICodeGenerator> codeGen = CreateCodeGenerator(&symTable, functionResult, backend);
+				for (auto & s : program->GetStructs())
+					codeGen->ProcessStruct(s.Ptr());
+				for (auto & func : program->GetFunctions())
+					codeGen->ProcessFunction(func.Ptr());
+				symTable.Freeze();
+			}
+			virtual List<String> GetCostNames(ShaderClosure * shader) override
+			{
+				List<String> names;
+				for (auto & world : shader->Pipeline->Worlds)
+					if (!shader->Pipeline->IsAbstractWorld(world.Key))
+						names.Add(world.Key);
+				return names;
+			}
+			virtual List<double> Evaluate(ShaderIR * variant) override
+			{
+				auto worlds = GetCostNames(variant->Shader);
+				List<double> costs;
+				// each variant is generated into a program and a symbol table of its own, so variants are evaluated
+				// concurrently; the constants of its code are kept apart from the shared ones of the functions, whose
+				// uses other threads update as their variants are generated and released
+				CompileResult variantResult;
+				variantResult.Program = new ILProgram();
+				variantResult.Program->Functions = functionResult.Program->Functions;
+				variantResult.Program->Structs = functionResult.Program->Structs;
+				InsertImplicitImportOperators(variantResult.GetErrorWriter(), variant);
+				if (variantResult.GetErrorCount() == 0)
+				{
+					SymbolTable variantSymbols;
+					variantSymbols.Fork(symTable);
+					RefPtr<ICodeGenerator> codeGen = CreateCodeGenerator(&variantSymbols, variantResult, backend);
+					codeGen->ProcessShader(variant);
+				}
+				// a variant that cannot be compiled is never cheaper than one that can
+				if (variantResult.GetErrorCount() != 0 || variantResult.Program->Shaders.Count() == 0)
+				{
+					for (int i = 0; i < worlds.Count(); i++)
+						costs.Add(std::numeric_limits<double>::infinity());
+					return costs;
+				}
+				auto estimate = EstimateShaderCost(variantResult.Program.Ptr(), variantResult.Program->Shaders.Last().Ptr());
+				for (auto & world : worlds)
+				{
+					WorldCostEstimate cost;
+					estimate.Worlds.TryGetValue(world, cost);
+					costs.Add(cost.GetWeightedCost());
+				}
+				return costs;
+			}
+		};
+
+		RefPtr<ScheduleCostModel> CreateILCostModel(SymbolTable * symbols, CodeGenBackend * backend, ProgramSyntaxNode * program,
+			ILProgram * contextProgram)
+		{
+			return new ILCostModel(symbols, backend, program, contextProgram);
+		}
+
+		// the choices of a shader in dependency order, with the option of each choice given by its index
+		class ScheduleSpace
+		{
+		private:
+			SymbolTable * symTable;
+			ShaderClosure * shader;
+			EnumerableDictionary<ShaderComponentSymbol*, EnumerableHashSet<String>> assignedWorlds;
+			void Assign(int choice, int option)
+			{
+				EnumerableHashSet<String> worlds;
+				worlds.Add(Choices[choice].Options[option].WorldName);
+				assignedWorlds[Components[choice]] = _Move(worlds);
+			}
+			// whether the component of `choice` can be computed at its `option`th world, given the worlds of the choices before it
+			bool IsFeasible(int choice, int option)
+			{
+				auto & world = Choices[choice].Options[option].WorldName;
+				for (auto & impl : Components[choice]->Implementations)
+				{
+					ShaderComponentSymbol * unaccessibleComp = nullptr;
+					if (impl->Worlds.Contains(world) &&
+						IsWorldFeasible(symTable, shader->Pipeline, impl.Ptr(), world, unaccessibleComp, &assignedWorlds))
+						return true;
+				}
+				return false;
+			}
+		public:
+			List<ShaderComponentSymbol*> Components;
+			List<ShaderChoice> Choices;
+			ScheduleSpace(SymbolTable * _symTable, ShaderClosure * _shader)
+				: symTable(_symTable), shader(_shader)
+			{
+				Dictionary<String, int> choiceIds;
+				auto choices = GetShaderChoices(shader);
+				for (int i = 0; i < choices.Count(); i++)
+					choiceIds[choices[i].ChoiceName] = i;
+				// components are assigned after the components they depend on, so that each assignment can be checked
+				// against the worlds of its dependencies. Component functions are inlined at every world they are
+				// used at, and are left out.
+				for (auto & comp : shader->GetDependencyOrder())
+				{
+					int choiceId;
+					if (comp->ChoiceNames.Count() && !comp->Implementations.First()->SyntaxNode->IsComponentFunction() &&
+						choiceIds.TryGetValue(comp->ChoiceNames.First(), choiceId) &&
+						choices[choiceId].Options.Count())
+					{
+						Components.Add(comp);
+						Choices.Add(choices[choiceId]);
+					}
+				}
+			}
+			// adds the feasible assignments that start with `current` to `result`; returns false if it stopped at `maxCount`
+			bool Enumerate(List<int> & current, List<List<int>> & result, int maxCount)
+			{
+				if (current.Count() == Choices.Count())
+				{
+					if (result.Count() == maxCount)
+						return false;
+					result.Add(current);
+					return true;
+				}
+				int choice = current.Count();
+				bool hasFeasibleOption = false;
+				for (int i = 0; i < Choices[choice].Options.Count(); i++)
+				{
+					if (!IsFeasible(choice, i))
+						continue;
+					hasFeasibleOption = true;
+					Assign(choice, i);
+					current.Add(i);
+					bool isComplete = Enumerate(current, result, maxCount);
+					current.RemoveAt(current.Count() - 1);
+					assignedWorlds.Remove(Components[choice]);
+					if (!isComplete)
+						return false;
+				}
+				if (hasFeasibleOption)
+					return true;
+				// a choice left without an option is left to the compiler
+				current.Add(-1);
+				bool isComplete = Enumerate(current, result, maxCount);
+				current.RemoveAt(current.Count() - 1);
+				return isComplete;
+			}
+			// picks a random feasible option for each choice, leaving the choices without one to the compiler
+			void Sample(Random & random, List<int> & result)
+			{
+				result.Clear();
+				List<int> options;
+				for (int choice = 0; choice < Choices.Count(); choice++)
+				{
+					options.Clear();
+					for (int i = 0; i < Choices[choice].Options.Count(); i++)
+						if (IsFeasible(choice, i))
+							options.Add(i);
+					if (options.Count() == 0)
+						result.Add(-1);
+					else
+					{
+						result.Add(options[random.Next(0, options.Count())]);
+						Assign(choice, result.Last());
+					}
+				}
+				assignedWorlds.Clear();
+			}
+			// option -1 leaves a choice to the compiler
+			Schedule GetSchedule(const List<int> & assignment)
+			{
+				Schedule schedule;
+				for (int i = 0; i < assignment.Count(); i++)
+				{
+					if (assignment[i] == -1)
+						continue;
+					RefPtr<ChoiceValueSyntaxNode> value = new ChoiceValueSyntaxNode();
+					value->WorldName = Choices[i].Options[assignment[i]].WorldName;
+					List<RefPtr<ChoiceValueSyntaxNode>> values;
+					values.Add(value);
+					schedule.Choices[Choices[i].ChoiceName] = values;
+				}
+				return schedule;
+			}
+			ExploredSchedule GetExploredSchedule(const List<int> & assignment)
+			{
+				ExploredSchedule schedule;
+				for (int i = 0; i < assignment.Count(); i++)
+					if (assignment[i] != -1)
+						schedule.Choices[Choices[i].ChoiceName] = Choices[i].Options[assignment[i]].WorldName;
+				return schedule;
+			}
+		};
+
+		// variants are the same if they keep the same definitions, and each of them uses the same definitions
+		String GetVariantSignature(ShaderIR * variant)
+		{
+			List<String> defs;
+			for (auto & def : variant->Definitions)
+			{
+				List<String> deps;
+				for (auto & dep : def->Dependency)
+					deps.Add(dep->UniqueName + "@" + dep->World);
+				deps.Sort();
+				StringBuilder sb;
+				sb << def->UniqueName << "@" << def->World << ":";
+				for (auto & dep : deps)
+					sb << " " << dep;
+				defs.Add(sb.ProduceString());
+			}
+			defs.Sort();
+			StringBuilder sb;
+			for (auto & def : defs)
+				sb << def << "\n";
+			return sb.ProduceString();
+		}
+
+		bool IsDominatedBy(const List<double> & costs, const List<double> & otherCosts)
+		{
+			bool isCheaper = false;
+			for (int i = 0; i < costs.Count(); i++)
+			{
+				if (otherCosts[i] > costs[i])
+					return false;
+				if (otherCosts[i] < costs[i])
+					isCheaper = true;
+			}
+			return isCheaper;
+		}
+
+		ScheduleExplorationResult ExploreSchedules(ShaderCompiler * compiler, CompilationContext & context, String shaderName,
+			const CompileOptions & options)
+		{
+			ScheduleExplorationResult result;
+			RefPtr<ShaderClosure> shader;
+			if (!context.ShaderClosures.TryGetValue(shaderName, shader) || !shader->IR)
+				return result;
+			auto costModel = options.CostModel ? options.CostModel : CreateSyntaxCostModel();
+			result.CostNames = costModel->GetCostNames(shader.Ptr());
+			ScheduleSpace space(&context.Symbols, shader.Ptr());
+
+			// the schedule of the default values comes first, so that the variant compiled without a schedule is always scored
+			List<List<int>> assignments;
+			HashSet<String> assignmentKeys;
+			auto addAssignment = [&](const List<int> & assignment)
+			{
+				StringBuilder key;
+				for (auto option : assignment)
+					key << option << ",";
+				if (assignmentKeys.Add(key.ProduceString()))
+					assignments.Add(assignment);
+			};
+			List<int> defaultAssignment;
+			for (auto & choice : space.Choices)
+			{
+				int option = -1;
+				for (int i = 0; i < choice.Options.Count(); i++)
+					if (choice.Options[i].WorldName == choice.DefaultValue)
+						option = i;
+				defaultAssignment.Add(option);
+			}
+			addAssignment(defaultAssignment);
+			int maxCount = Math::Max(1, options.MaxExploredSchedules);
+			List<List<int>> enumerated;
+			List<int> current;
+			result.IsExhaustive = space.Enumerate(current, enumerated, maxCount);
+			if (result.IsExhaustive)
+			{
+				for (auto & assignment : enumerated)
+					addAssignment(assignment);
+			}
+			else
+			{
+				// a fixed seed keeps the result of exploring the same shader the same
+				Random random(0x5151);
+				List<int> assignment;
+				for (int attempt = 0; attempt < maxCount * 8 && assignments.Count() <= maxCount; attempt++)
+				{
+					space.Sample(random, assignment);
+					addAssignment(assignment);
+				}
+			}
+
+			int threadCount = options.ExplorationThreadCount;
+			if (threadCount <= 0)
+				threadCount = Math::Max(1, (int)std::thread::hardware_concurrency());
+			HashSet<String> signatures;
+			// variants are generated a batch at a time, so that only the variants of one batch are kept in memory
+			const int batchSize = 64;
+			for (int batchStart = 0; batchStart < assignments.Count(); batchStart += batchSize)
+			{
+				int count = Math::Min(batchSize, assignments.Count() - batchStart);
+				List<Schedule> schedules;
+				for (int i = 0; i < count; i++)
+					schedules.Add(space.GetSchedule(assignments[batchStart + i]));
+				CompileResult variantResult;
+				auto variants = compiler->GenerateShaderVariants(variantResult, context, shaderName, schedules.GetArrayView(), threadCount);
+				List<String> variantSignatures;
+				List<List<double>> variantCosts;
+				variantSignatures.SetSize(count);
+				variantCosts.SetSize(count);
+				std::atomic<int> nextVariant(0);
+				auto worker = [&]()
+				{
+					for (int i = nextVariant++; i < count; i = nextVariant++)
+					{
+						if (!variants[i])
+							continue;
+						variantSignatures[i] = GetVariantSignature(variants[i].Ptr());
+						variantCosts[i] = costModel->Evaluate(variants[i].Ptr());
+					}
+				};
+				List<std::thread> threads;
+				for (int i = 1; i < Math::Min(threadCount, count); i++)
+					threads.Add(std::thread(worker));
+				worker();
+				for (auto & thread : threads)
+					thread.join();
+				for (int i = 0; i < count; i++)
+				{
+					if (!variants[i])
+						continue;
+					result.EvaluatedCount++;
+					if (!signatures.Add(variantSignatures[i]))
+						continue;
+					auto schedule = space.GetExploredSchedule(assignments[batchStart + i]);
+					schedule.Costs = _Move(variantCosts[i]);
+					result.Schedules.Add(_Move(schedule));
+				}
+			}
+
+			for (int i = 0; i < result.Schedules.Count(); i++)
+			{
+				bool isDominated = false;
+				for (int j = 0; j < result.Schedules.Count() && !isDominated; j++)
+					isDominated = IsDominatedBy(result.Schedules[i].Costs, result.Schedules[j].Costs);
+				if (!isDominated)
+					result.ParetoFront.Add(i);
+			}
+			double lowestCost = 0.0;
+			for (int i = 0; i < result.Schedules.Count(); i++)
+			{
+				double cost = 0.0;
+				for (auto c : result.Schedules[i].Costs)
+					cost += c;
+				if (i == 0 || cost < lowestCost)
+				{
+					lowestCost = cost;
+					result.LowestCostSchedule = i;
+				}
+			}
+			return result;
+		}
+	}
+}
@@ -0,0 +1,30 @@
+#ifndef SPIRE_SCHEDULE_EXPLORER_H
+#define SPIRE_SCHEDULE_EXPLORER_H
+
+#include "ShaderCompiler.h"
+#include "VariantIR.h"
+
+namespace Spire
+{
+	namespace Compiler
+	{
+		// the choices of a closure, with the world the variant generated without a schedule uses as default value
+		List<ShaderChoice> GetShaderChoices(ShaderClosure * shader);
+
+		// scores a variant with one cost per non-abstract world of the pipeline: the number of operations in the definitions computed at it
+		RefPtr<ScheduleCostModel> CreateSyntaxCostModel();
+
+		// scores a variant with the weighted cost per non-abstract world of the IL generated for it (see EstimateShaderCost).
+		// The IL of the functions of `program` is generated once; the IL of the variants one at a time.
+		RefPtr<ScheduleCostModel> CreateILCostModel(SymbolTable * symbols, CodeGenBackend * backend, ProgramSyntaxNode * program,
+			ILProgram * contextProgram);
+
+		// enumerates the schedules of shader `shaderName`, checked by an earlier compile in `context`, skipping the ones
+		// that place a component at a world it cannot read its dependencies at, or samples them if there are more than
+		// options.MaxExploredSchedules. The variants are generated and scored on options.ExplorationThreadCount threads.
+		ScheduleExplorationResult ExploreSchedules(ShaderCompiler * compiler, CompilationContext & context, String shaderName,
+			const CompileOptions & options);
+	}
+}
+
+#endif
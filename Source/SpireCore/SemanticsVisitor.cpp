@@ -11,6 +11,9 @@ namespace Spire
 
 		String GetFullComponentName(ComponentSyntaxNode * comp)
 		{
+			// a component function that was checked before (and then cloned) already carries its full name
+			if (comp->IsComponentFunction() && comp->Name.Content.ToString().IndexOf('@') != -1)
+				return comp->Name.Content;
 			StringBuilder sb;
 			sb << comp->Name.Content;
 			for (auto & param : comp->GetParameters())
@@ -332,6 +335,7 @@ namespace Spire
 						}
 					}
 				}
+				psymbol->EvalWorldReachability();
 
 				for (auto & op : pipeline->GetImportOperators())
 				{
@@ -828,11 +832,14 @@ namespace Spire
 				}
 				if (compImpl->SyntaxNode->IsComponentFunction())
 				{
-					auto list = funcComponents.TryGetValue(comp->Name.Content);
+					String funcName = comp->Name.Content;
+					if (funcName.IndexOf('@') != -1)
+						funcName = funcName.SubString(0, funcName.IndexOf('@'));
+					auto list = funcComponents.TryGetValue(funcName);
 					if (!list)
 					{
-						funcComponents[comp->Name.Content] = List<RefPtr<ShaderComponentSymbol>>();
-						list = funcComponents.TryGetValue(comp->Name.Content);
+						funcComponents[funcName] = List<RefPtr<ShaderComponentSymbol>>();
+						list = funcComponents.TryGetValue(funcName);
 					}
 					comp->Name.Content = compName;
 					list->Add(compSym);
@@ -1002,11 +1009,11 @@ namespace Spire
 				RefPtr<FunctionSymbol> symbol = new FunctionSymbol();
 				symbol->SyntaxNode = functionNode;
 				symbolTable->Functions[functionNode->InternalName] = symbol;
-				auto overloadList = symbolTable->FunctionOverloads.TryGetValue(functionNode->Name.Content);
+				auto overloadList = symbolTable->FunctionOverloads.TryGetMutableValue(functionNode->Name.Content);
 				if (!overloadList)
 				{
 					symbolTable->FunctionOverloads[functionNode->Name.Content] = List<RefPtr<FunctionSymbol>>();
-					overloadList = symbolTable->FunctionOverloads.TryGetValue(functionNode->Name.Content);
+					overloadList = symbolTable->FunctionOverloads.TryGetMutableValue(functionNode->Name.Content);
 				}
 				overloadList->Add(symbol);
 				this->function = NULL;
@@ -1207,7 +1214,7 @@ namespace Spire
 					List<RefPtr<ExpressionType>> argTypes;
 					argTypes.Add(leftType);
 					argTypes.Add(rightType);
-					List<RefPtr<FunctionSymbol>> * operatorOverloads = symbolTable->FunctionOverloads.TryGetValue(GetOperatorFunctionName(expr->Operator));
+					const List<RefPtr<FunctionSymbol>> * operatorOverloads = symbolTable->FunctionOverloads.TryGetValue(GetOperatorFunctionName(expr->Operator));
 					auto overload = FindFunctionOverload(*operatorOverloads, [](RefPtr<FunctionSymbol> f)
 					{
 						return f->SyntaxNode->GetParameters();
@@ -1541,7 +1548,7 @@ namespace Spire
 				{
 					// find function overload with implicit argument type conversions
 					auto namePrefix = varExpr->Variable + "@";
-					List<RefPtr<FunctionSymbol>> * functionOverloads = symbolTable->FunctionOverloads.TryGetValue(varExpr->Variable);
+					const List<RefPtr<FunctionSymbol>> * functionOverloads = symbolTable->FunctionOverloads.TryGetValue(varExpr->Variable);
 					if (functionOverloads)
 					{
 						func = FindFunctionOverload(*functionOverloads, [](RefPtr<FunctionSymbol> f)
@@ -1735,7 +1742,7 @@ namespace Spire
 				expr->Expression = expr->Expression->Accept(this).As<ExpressionSyntaxNode>();
 				List<RefPtr<ExpressionType>> argTypes;
 				argTypes.Add(expr->Expression->Type);
-				List<RefPtr<FunctionSymbol>> * operatorOverloads = symbolTable->FunctionOverloads.TryGetValue(GetOperatorFunctionName(expr->Operator));
+				const List<RefPtr<FunctionSymbol>> * operatorOverloads = symbolTable->FunctionOverloads.TryGetValue(GetOperatorFunctionName(expr->Operator));
 				auto overload = FindFunctionOverload(*operatorOverloads, [](RefPtr<FunctionSymbol> f)
 				{
 					return f->SyntaxNode->GetParameters();
@@ -1761,8 +1768,13 @@ namespace Spire
 				if (varDecl)
 				{
 					expr->Type = varDecl->Type;
-					if (auto basicType = expr->Type->AsBasicType())
-						basicType->IsLeftValue = !(dynamic_cast<ComponentSyntaxNode*>(varDecl));
+					// the type of the declaration is shared by every expression that refers to it (and by the copies
+					// of the syntax other threads check), so it is cloned before being marked
+					if (expr->Type->AsBasicType())
+					{
+						expr->Type = expr->Type->Clone();
+						expr->Type->AsBasicType()->IsLeftValue = !(dynamic_cast<ComponentSyntaxNode*>(varDecl));
+					}
 				}
 				else if (currentShader && currentShader->ShaderObjects.TryGetValue(expr->Variable, shaderObj))
 				{
@@ -1924,7 +1936,8 @@ namespace Spire
 							}
 							expr->Type->AsBasicType()->IsMaskedVector = true;
 						}
-						if (auto bt = expr->Type->AsBasicType())
+						// ExpressionType::Error is shared, so only the type of a valid swizzle is marked
+						if (auto bt = error ? nullptr : expr->Type->AsBasicType())
 						{
 							bt->IsLeftValue = !baseType->AsBasicType()->IsMaskedVector;
 							if (children.Count() > vecLen || children.Count() == 0)
@@ -1968,10 +1981,10 @@ namespace Spire
 						getSink()->diagnose(expr, Diagnostics::noMemberOfNameInType, expr->MemberName, baseType->AsBasicType()->structDecl);
 					}
 					else
-						expr->Type = field->Type;
-					if (auto bt = expr->Type->AsBasicType())
 					{
-						bt->IsLeftValue = baseType->AsBasicType()->IsLeftValue;
+						expr->Type = field->Type->Clone();
+						if (auto bt = expr->Type->AsBasicType())
+							bt->IsLeftValue = baseType->AsBasicType()->IsLeftValue;
 					}
 				}
 				else
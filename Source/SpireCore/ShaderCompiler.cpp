@@ -6,6 +6,7 @@
 #include "Lexer.h"
 #include "Parser.h"
 #include "Preprocessor.h"
+#include "CompileUnitCache.h"
 #include "SyntaxVisitors.h"
 #include "StdInclude.h"
 #include "Schedule.h"
@@ -14,6 +15,11 @@
 #include "Closure.h"
 #include "VariantIR.h"
 #include "Naming.h"
+#include "ScheduleExplorer.h"
+#include "CostAnalysis.h"
+#include <atomic>
+#include <mutex>
+#include <thread>
 
 #ifdef CreateDirectory
 #undef CreateDirectory
@@ -27,7 +33,10 @@ namespace Spire
 {
 	namespace Compiler
 	{
+		// the basic expression types and the standard library source are process-wide and live as long
+		// as at least one compiler does; compilers may be created and destroyed on any thread
 		int compilerInstances = 0;
+		std::mutex compilerInstancesMutex;
 
 		class ShaderCompilerImpl : public ShaderCompiler
 		{
@@ -73,17 +82,24 @@ namespace Spire
 			}
 
 			/* Generate a shader variant by applying mechanic choice rules and the choice file.
-			   The choice file provides "preferred" definitions, as represented in ShaderComponentSymbol::Type::PinnedWorlds
+			   The choice file provides "preferred" definitions, as represented in ShaderIR::PinnedWorlds
 		       The process resolves the component references by picking a pinned definition if one is available, or a definition
 			   with the preferred import path as defined by import operator ordering.
 			   After all references are resolved, all unreferenced definitions (dead code) are eliminated, 
 			   resulting a shader variant ready for code generation.
+			   The shader closure is only read, so variants of the same closure may be generated concurrently.
 			*/
-			RefPtr<ShaderIR> GenerateShaderVariantIR(CompileResult & cresult, ShaderClosure * shader, Schedule & schedule, SymbolTable * symbolTable)
+			RefPtr<ShaderIR> GenerateShaderVariantIR(DiagnosticSink * sink, ShaderClosure * shader, Schedule & schedule, SymbolTable * symbolTable)
 			{
 				RefPtr<ShaderIR> result = new ShaderIR();
 				result->Shader = shader;
 				result->SymbolTable = symbolTable;
+				auto getPinnedWorlds = [&](const String & compName) -> EnumerableHashSet<String>&
+				{
+					if (auto worlds = result->PinnedWorlds.TryGetValue(compName))
+						return *worlds;
+					return result->PinnedWorlds[compName] = EnumerableHashSet<String>();
+				};
 				// mark pinned worlds
 				for (auto & comp : shader->Components)
 				{
@@ -93,7 +109,7 @@ namespace Spire
 						{
 							if (impl->SrcPinnedWorlds.Contains(w) || impl->SyntaxNode->IsInline() || impl->ExportWorlds.Contains(w) || impl->SyntaxNode->IsInput())
 							{
-								comp.Value->Type->PinnedWorlds.Add(w);
+								getPinnedWorlds(comp.Value->UniqueName).Add(w);
 							}
 						}
 					}
@@ -111,12 +127,13 @@ namespace Spire
 					ShaderComponentSymbol * comp = nullptr;
 					if (choiceComps.TryGetValue(choice.Key, comp))
 					{
-						comp->Type->PinnedWorlds.Clear();
+						auto & pinnedWorlds = getPinnedWorlds(comp->UniqueName);
+						pinnedWorlds.Clear();
 						for (auto & selectedDef : choice.Value)
 						{
 							if (comp->Type->ConstrainedWorlds.Contains(selectedDef->WorldName))
 							{
-								comp->Type->PinnedWorlds.Add(selectedDef->WorldName);
+								pinnedWorlds.Add(selectedDef->WorldName);
 								// find specified impl
 								for (auto & impl : comp->Implementations)
 								{
@@ -126,11 +143,13 @@ namespace Spire
 							}
 							else
 							{
-                                cresult.GetErrorWriter()->diagnose(selectedDef.Ptr()->Position, Diagnostics::worldIsNotAValidChoiceForKey, selectedDef->WorldName, choice.Key);
+                                sink->diagnose(selectedDef.Ptr()->Position, Diagnostics::worldIsNotAValidChoiceForKey, selectedDef->WorldName, choice.Key);
 							}
 						}
 					}
 				}
+				// attributes from the schedule go on a copy of the implementation syntax that the definitions of this variant use
+				Dictionary<ShaderComponentImplSymbol*, RefPtr<ComponentSyntaxNode>> attributedSyntax;
 				for (auto & attribs : schedule.AddtionalAttributes)
 				{
 					ShaderComponentSymbol * comp = nullptr;
@@ -139,14 +158,21 @@ namespace Spire
 						// apply attributes
 						for (auto & impl : comp->Implementations)
 						{
+							RefPtr<ComponentSyntaxNode> syntax;
+							if (!attributedSyntax.TryGetValue(impl.Ptr(), syntax))
+							{
+								CloneContext cloneCtx;
+								syntax = impl->SyntaxNode->Clone(cloneCtx);
+								attributedSyntax[impl.Ptr()] = syntax;
+							}
                             for (auto & attrib : attribs.Value)
                             {
                                 auto modifier = new SimpleAttribute();
                                 modifier->Key = attrib.Key;
                                 modifier->Value.Content = attrib.Value;
 
-                                modifier->next = impl->SyntaxNode->modifiers.first;
-                                impl->SyntaxNode->modifiers.first = modifier;
+                                modifier->next = syntax->modifiers.first;
+                                syntax->modifiers.first = modifier;
                             }
 						}
 					}
@@ -195,6 +221,8 @@ namespace Spire
 					Dictionary<String, ShaderComponentImplSymbol*> impls;
 					for (auto & impl : comp.Value.Symbol->Implementations)
 					{
+						RefPtr<ComponentSyntaxNode> syntax = impl->SyntaxNode;
+						attributedSyntax.TryGetValue(impl.Ptr(), syntax);
 						auto createComponentDef = [&](const String & w)
 						{
 							RefPtr<ComponentDefinitionIR> def = new ComponentDefinitionIR();
@@ -202,11 +230,10 @@ namespace Spire
 							def->UniqueKey = comp.Value.Symbol->UniqueKey;
 							def->UniqueName = comp.Value.Symbol->UniqueName;
 							def->Type = comp.Value.Symbol->Type->DataType;
-							def->IsEntryPoint = (impl->ExportWorlds.Contains(w) || impl->SyntaxNode->IsParam() ||
+							def->IsEntryPoint = (impl->ExportWorlds.Contains(w) || syntax->IsParam() ||
 								(shader->Pipeline->IsAbstractWorld(w) &&
-								(impl->SyntaxNode->HasSimpleAttribute("Pinned") || shader->Pipeline->Worlds[w]()->HasSimpleAttribute("Pinned"))));
-							CloneContext cloneCtx;
-							def->SyntaxNode = impl->SyntaxNode->Clone(cloneCtx);
+								(syntax->HasSimpleAttribute("Pinned") || shader->Pipeline->Worlds[w]()->HasSimpleAttribute("Pinned"))));
+							def->SyntaxNode = syntax;
 							def->World = w;
 							def->ModuleInstance = createModuleInstance(comp.Value.Closure);
 							return def;
@@ -264,7 +291,7 @@ namespace Spire
 					{
 						if (def->Dependency.Contains(def.Ptr()))
 						{
-                            cresult.GetErrorWriter()->diagnose(def->SyntaxNode->Position, Diagnostics::componentDefinitionCircularity, def->OriginalName);
+                            sink->diagnose(def->SyntaxNode->Position, Diagnostics::componentDefinitionCircularity, def->OriginalName);
 							return nullptr;
 						}
 					}
@@ -276,8 +303,9 @@ namespace Spire
 						auto comp = comps[i];
 						auto & defs = result->DefinitionsByComponent[comp->UniqueName]();
 						EnumerableHashSet<ComponentDefinitionIR*> removedDefs;
+						auto pinnedWorlds = result->PinnedWorlds.TryGetValue(comp->UniqueName);
 						for (auto & def : defs)
-							if (!def.Value->IsEntryPoint && !comp->Type->PinnedWorlds.Contains(def.Value->World))
+							if (!def.Value->IsEntryPoint && !(pinnedWorlds && pinnedWorlds->Contains(def.Value->World)))
 							{
 								for (auto & otherDef : defs)
 								{
@@ -377,13 +405,58 @@ namespace Spire
 		public:
 			virtual CompileUnit Parse(CompileResult & result, String source, String fileName, IncludeHandler* includeHandler, Dictionary<String,String> const& preprocesorDefinitions) override
 			{
-                auto tokens = PreprocessSource(source, fileName, result.GetErrorWriter(), includeHandler, preprocesorDefinitions);
 				CompileUnit rs;
-                rs.SyntaxNode = ParseProgram(tokens, result.GetErrorWriter(), fileName);
+				// a file parsed before under the same definitions of the macros it looks at is copied instead
+				CompileUnitCache * unitCache = includeHandler ? includeHandler->GetCompileUnitCache() : nullptr;
+				if (unitCache)
+				{
+					PhaseTimer timer(result.Stats, CompilePhase::Parse);
+					int tokenCount = 0;
+					rs.SyntaxNode = unitCache->Find(fileName, source, preprocesorDefinitions, includeHandler, tokenCount);
+					if (rs.SyntaxNode)
+					{
+						result.Stats.TokenCount += tokenCount;
+						return rs;
+					}
+				}
+				int diagnosticCount = result.sink.diagnostics.Count();
+				PreprocessorDependencies dependencies;
+				TokenList tokens;
+				{
+					PhaseTimer timer(result.Stats, CompilePhase::Preprocess);
+					tokens = PreprocessSource(source, fileName, result.GetErrorWriter(), includeHandler, preprocesorDefinitions,
+						unitCache ? &dependencies : nullptr);
+				}
+				result.Stats.TokenCount += tokens.mTokens.Count();
+				int syntaxNodeCount = SyntaxNodeAllocationCount;
+				{
+					PhaseTimer timer(result.Stats, CompilePhase::Parse);
+					rs.SyntaxNode = ParseProgram(tokens, result.GetErrorWriter(), fileName);
+				}
+				result.Stats.SyntaxNodeCount += SyntaxNodeAllocationCount - syntaxNodeCount;
+				// files with diagnostics are parsed again so that every compile reports them
+				if (unitCache && rs.SyntaxNode && result.sink.diagnostics.Count() == diagnosticCount)
+					unitCache->Add(fileName, source, dependencies, rs.SyntaxNode.Ptr(), tokens.mTokens.Count());
 				return rs;
 			}
 			virtual void Compile(CompileResult & result, CompilationContext & context, List<CompileUnit> & units, const CompileOptions & options) override
 			{
+				// syntax nodes cloned and IL instructions created by this compile are counted on return
+				int syntaxNodeCount = SyntaxNodeAllocationCount;
+				int instructionCount = ILInstructionAllocationCount;
+				CompileInternal(result, context, units, options);
+				result.Stats.SyntaxNodeCount += SyntaxNodeAllocationCount - syntaxNodeCount;
+				result.Stats.ILInstructionCount += ILInstructionAllocationCount - instructionCount;
+				for (auto & shader : result.CompiledSource)
+					for (auto & stage : shader.Value.Stages)
+						result.Stats.OutputBytes += stage.Value.MainCode.Length() + stage.Value.BinaryCode.Count();
+			}
+			void CompileInternal(CompileResult & result, CompilationContext & context, List<CompileUnit> & units, const CompileOptions & options)
+			{
+				// generated names only depend on this compile, so that the same input produces
+				// the same output regardless of what was compiled before on this thread
+				NamingCounter = 0;
+				UniqueIdGenerator::Clear();
 				RefPtr<ProgramSyntaxNode> programSyntaxNode = new ProgramSyntaxNode();
 				for (auto & unit : units)
 				{
@@ -393,6 +466,7 @@ namespace Spire
 				SymbolTable & symTable = context.Symbols;
 				auto & shaderClosures = context.ShaderClosures;
 				
+				PhaseTimer semanticTimer(result.Stats, CompilePhase::SemanticCheck);
 				RefPtr<SyntaxVisitor> visitor = CreateSemanticsVisitor(&symTable, result.GetErrorWriter());
 				try
 				{
@@ -419,9 +493,11 @@ namespace Spire
 					}
 					visitor = nullptr;
 					symTable.EvalFunctionReferenceClosure();
+					semanticTimer.Stop();
 					if (result.GetErrorCount() > 0)
 						return;
 
+					PhaseTimer closureTimer(result.Stats, CompilePhase::ShaderClosure);
 					for (auto & shader : symTable.ShaderDependenceOrder)
 					{
 						if (shader->IsAbstract)
@@ -435,6 +511,7 @@ namespace Spire
 					}
 					
 					ResolveAttributes(&symTable);
+					closureTimer.Stop();
 
 					if (result.GetErrorCount() > 0)
 						return;
@@ -466,44 +543,58 @@ namespace Spire
 					{
 						schedule = Schedule::Parse(options.ScheduleSource, options.ScheduleFileName, result.GetErrorWriter());
 					}
+					PhaseTimer variantTimer(result.Stats, CompilePhase::VariantIR);
 					for (auto shader : shaderClosures)
 					{
 						// generate shader variant from schedule file, and also apply mechanic deduction rules
 						if (!shader.Value->IR)
-							shader.Value->IR = GenerateShaderVariantIR(result, shader.Value.Ptr(), schedule, &symTable);
+							shader.Value->IR = GenerateShaderVariantIR(result.GetErrorWriter(), shader.Value.Ptr(), schedule, &symTable);
 					}
+					variantTimer.Stop();
 					if (options.Mode == CompilerMode::ProduceShader)
 					{
 						if (result.GetErrorWriter()->GetErrorCount() > 0)
 							return;
 						// generate IL code
 						
-						RefPtr<ICodeGenerator> codeGen = CreateCodeGenerator(&symTable, result, backend);
+						// continue the context's program, so the code generator allocates constants from its pool
+						result.Program = new ILProgram();
 						if (context.Program)
 						{
 							result.Program->Functions = context.Program->Functions;
 							result.Program->Shaders = context.Program->Shaders;
 							result.Program->Structs = context.Program->Structs;
-							result.Program->ConstantPool = context.Program->ConstantPool;
+							// a shared program may be in use on other threads, so constants go to a pool of this context
+							result.Program->ConstantPool = context.IsProgramShared ? new ConstantPool() : context.Program->ConstantPool;
 						}
+						PhaseTimer codeGenTimer(result.Stats, CompilePhase::ILCodeGen);
+						RefPtr<ICodeGenerator> codeGen = CreateCodeGenerator(&symTable, result, backend);
 						for (auto & s : programSyntaxNode->GetStructs())
 							codeGen->ProcessStruct(s.Ptr());
 
 						for (auto & func : programSyntaxNode->GetFunctions())
 							codeGen->ProcessFunction(func.Ptr());
-						for (auto & shader : shaderClosures)
+						codeGenTimer.Stop();
 						{
-							InsertImplicitImportOperators(result.GetErrorWriter(), shader.Value->IR.Ptr());
+							PhaseTimer importTimer(result.Stats, CompilePhase::ImplicitImports);
+							for (auto & shader : shaderClosures)
+							{
+								InsertImplicitImportOperators(result.GetErrorWriter(), shader.Value->IR.Ptr());
+							}
 						}
 						if (result.GetErrorCount() > 0)
 							return;
-						for (auto & shader : shaderClosures)
 						{
-							codeGen->ProcessShader(shader.Value->IR.Ptr());
+							PhaseTimer shaderCodeGenTimer(result.Stats, CompilePhase::ILCodeGen);
+							for (auto & shader : shaderClosures)
+							{
+								codeGen->ProcessShader(shader.Value->IR.Ptr());
+							}
 						}
 						if (result.GetErrorCount() > 0)
 							return;
 						// emit target code
+						PhaseTimer targetTimer(result.Stats, CompilePhase::TargetCodeGen);
 						EnumerableHashSet<String> symbolsToGen;
 						for (auto & unit : units)
 						{
@@ -530,45 +621,22 @@ namespace Spire
 								StringBuilder glslBuilder;
 								Dictionary<String, String> targetCode;
 								result.CompiledSource[shader->Name] = backend->GenerateShader(result, &symTable, shader.Ptr(), result.GetErrorWriter());
+								result.CostEstimates[shader->Name] = EstimateShaderCost(result.Program.Ptr(), shader.Ptr());
 							}
 						}
 					}
 					else if (options.Mode == CompilerMode::GenerateChoice)
 					{
+						CompileOptions exploreOptions = options;
+						if (options.ExploreSchedules && !options.CostModel && result.GetErrorCount() == 0)
+							exploreOptions.CostModel = CreateILCostModel(&symTable, backend, programSyntaxNode.Ptr(), context.Program.Ptr());
 						for (auto shader : shaderClosures)
 						{
 							if (options.SymbolToCompile.Length() == 0 || shader.Value->Name == options.SymbolToCompile)
 							{
-								auto &worldOrder = shader.Value->Pipeline->GetWorldTopologyOrder();
-								for (auto & comp : shader.Value->AllComponents)
-								{
-									ShaderChoice choice;
-									if (comp.Value.Symbol->ChoiceNames.Count() == 0)
-										continue;
-									if (comp.Value.Symbol->IsRequire())
-										continue;
-									choice.ChoiceName = comp.Value.Symbol->ChoiceNames.First();
-									for (auto & impl : comp.Value.Symbol->Implementations)
-									{
-										for (auto w : impl->Worlds)
-											if (comp.Value.Symbol->Type->ConstrainedWorlds.Contains(w))
-												choice.Options.Add(ShaderChoiceValue(w));
-									}
-									if (auto defs = shader.Value->IR->DefinitionsByComponent.TryGetValue(comp.Key))
-									{
-										int latestWorldOrder = -1;
-										for (auto & def : *defs)
-										{
-											int order = worldOrder.IndexOf(def.Key);
-											if (latestWorldOrder < order)
-											{
-												choice.DefaultValue = def.Key;
-												latestWorldOrder = order;
-											}
-										}
-									}
-									result.Choices.Add(choice);
-								}
+								result.Choices.AddRange(GetShaderChoices(shader.Value.Ptr()));
+								if (options.ExploreSchedules && result.GetErrorCount() == 0)
+									result.ExploredSchedules[shader.Key] = ExploreSchedules(this, context, shader.Key, exploreOptions);
 							}
 						}
 					}
@@ -578,6 +646,7 @@ namespace Spire
 						return;
 					}
 					context.Program = result.Program;
+					context.IsProgramShared = false;
 				}
 				catch (int)
 				{
@@ -589,13 +658,57 @@ namespace Spire
 				return;
 			}
 
+			virtual List<RefPtr<ShaderIR>> GenerateShaderVariants(CompileResult & result, CompilationContext & context, String shaderName,
+				ArrayView<Schedule> schedules, int threadCount) override
+			{
+				List<RefPtr<ShaderIR>> variants;
+				variants.SetSize(schedules.Count());
+				RefPtr<ShaderClosure> shader;
+				if (!context.ShaderClosures.TryGetValue(shaderName, shader))
+				{
+					result.GetErrorWriter()->diagnose(CodePosition(), Diagnostics::undefinedIdentifier2, shaderName);
+					return variants;
+				}
+				PhaseTimer variantTimer(result.Stats, CompilePhase::VariantIR);
+				List<DiagnosticSink> sinks;
+				sinks.SetSize(schedules.Count());
+				std::atomic<int> nextSchedule(0);
+				auto worker = [&]()
+				{
+					for (int i = nextSchedule++; i < schedules.Count(); i = nextSchedule++)
+					{
+						auto variant = GenerateShaderVariantIR(&sinks[i], shader.Ptr(), schedules[i], &context.Symbols);
+						if (sinks[i].GetErrorCount() == 0)
+							variants[i] = variant;
+					}
+				};
+				if (threadCount <= 0)
+					threadCount = Math::Max(1, (int)std::thread::hardware_concurrency());
+				threadCount = Math::Min(threadCount, schedules.Count());
+				List<std::thread> threads;
+				for (int i = 1; i < threadCount; i++)
+					threads.Add(std::thread(worker));
+				worker();
+				for (auto & thread : threads)
+					thread.join();
+				for (auto & sink : sinks)
+				{
+					result.sink.diagnostics.AddRange(sink.diagnostics);
+					result.sink.errorCount += sink.errorCount;
+				}
+				return variants;
+			}
+
 			ShaderCompilerImpl()
 			{
-				if (compilerInstances == 0)
 				{
-					BasicExpressionType::Init();
+					std::lock_guard<std::mutex> lock(compilerInstancesMutex);
+					if (compilerInstances == 0)
+					{
+						BasicExpressionType::Init();
+					}
+					compilerInstances++;
 				}
-				compilerInstances++;
 				backends.Add("glsl", CreateGLSLCodeGen());
 				backends.Add("hlsl", CreateHLSLCodeGen());
 				backends.Add("spirv", CreateSpirVCodeGen());
@@ -605,6 +718,7 @@ namespace Spire
 
 			~ShaderCompilerImpl()
 			{
+				std::lock_guard<std::mutex> lock(compilerInstancesMutex);
 				compilerInstances--;
 				if (compilerInstances == 0)
 				{
@@ -619,10 +733,32 @@ namespace Spire
 			return new ShaderCompilerImpl();
 		}
 
+		const char * GetCompilerBuildId()
+		{
+			return __DATE__ " " __TIME__;
+		}
+
+		void CompilationContext::Fork(CompilationContext * parent)
+		{
+			Symbols.Fork(parent->Symbols);
+			ShaderClosures.Fork(parent->ShaderClosures);
+			Program = parent->Program;
+			IsProgramShared = true;
+		}
+
+		void CompilationContext::Freeze()
+		{
+			Symbols.Freeze();
+			ShaderClosures.Freeze();
+		}
+
 		void CompilationContext::MergeWith(CompilationContext * ctx)
 		{
 			Symbols.MergeWith(ctx->Symbols);
-			if (ctx->Program != Program)
+			ShaderClosures.MergeWith(ctx->ShaderClosures);
+			if (IsProgramShared)
+				Program = ctx->Program;
+			else if (ctx->Program != Program)
 			{
 				for (auto & f : ctx->Program->Functions)
 					Program->Functions[f.Key] = f.Value;
@@ -639,8 +775,36 @@ namespace Spire
 					if (existingShaders.Add(s.Ptr()))
 						Program->Shaders.Add(s);
 			}
-			for (auto & s : ctx->ShaderClosures)
-				ShaderClosures[s.Key] = s.Value;
+		}
+
+		void CompilationContext::RemoveShaders(const EnumerableHashSet<String> & shaderNames)
+		{
+			HashSet<String> codeNames;
+			for (auto & name : shaderNames)
+			{
+				RefPtr<ShaderSymbol> shader;
+				if (Symbols.Shaders.TryGetValue(name, shader))
+				{
+					Decl * decl = nullptr;
+					if (Symbols.globalDecls.TryGetValue(name, decl) && decl == shader->SyntaxNode.Ptr())
+						Symbols.globalDecls.Remove(name);
+					Symbols.Shaders.Remove(name);
+				}
+				ShaderClosures.Remove(name);
+				codeNames.Add(EscapeCodeName(name));
+			}
+			// the dependence order refers to the removed symbols
+			Symbols.SortShaders();
+			if (Program)
+			{
+				// earlier compile results may still refer to the current program, so it is not modified in place
+				RefPtr<ILProgram> program = new ILProgram(*Program);
+				program->Shaders.Clear();
+				for (auto & shader : Program->Shaders)
+					if (!codeNames.Contains(shader->Name))
+						program->Shaders.Add(shader);
+				Program = program;
+			}
 		}
 
 }
@@ -13,6 +13,8 @@ namespace Spire
 	{
 		class ILConstOperand;
         struct IncludeHandler;
+		class Schedule;
+		class ShaderIR;
 
 		enum class CompilerMode
 		{
@@ -26,6 +28,15 @@ namespace Spire
 			GLSL, GLSL_Vulkan, GLSL_Vulkan_OneDesc, HLSL, SPIRV
 		};
 
+		// scores shader variants for schedule exploration, lower costs being better. Evaluate is called
+		// for several variants of the same shader at once.
+		class ScheduleCostModel : public CoreLib::Basic::RefObject
+		{
+		public:
+			virtual List<String> GetCostNames(ShaderClosure * shader) = 0;
+			virtual List<double> Evaluate(ShaderIR * variant) = 0;
+		};
+
 		class CompileOptions
 		{
 		public:
@@ -37,6 +48,11 @@ namespace Spire
 			List<String> TemplateShaderArguments;
 			List<String> SearchDirectories;
             Dictionary<String, String> PreprocessorDefinitions;
+			// in GenerateChoice mode, also compile and score variants across the choice space of each shader
+			bool ExploreSchedules = false;
+			int MaxExploredSchedules = 256;
+			int ExplorationThreadCount = 0;
+			RefPtr<ScheduleCostModel> CostModel; // the estimated cost of the IL of each world if not set
 		};
 
 		class CompileUnit
@@ -49,9 +65,17 @@ namespace Spire
 		{
 		public:
 			SymbolTable Symbols;
-			EnumerableDictionary<String, RefPtr<ShaderClosure>> ShaderClosures;
+			LayeredDictionary<String, RefPtr<ShaderClosure>> ShaderClosures;
 			RefPtr<ILProgram> Program;
+			// Program (and the constant pool it allocates from) belongs to the context this one was forked from
+			bool IsProgramShared = false;
+			// starts out with the symbols, closures and program of `parent` in O(1), sharing instead of copying them
+			void Fork(CompilationContext * parent);
+			// makes everything added so far shareable, so that forking this context no longer modifies it
+			void Freeze();
 			void MergeWith(CompilationContext * ctx);
+			// removes the symbols, closures and generated code of `shaderNames` so that they can be checked again
+			void RemoveShaders(const EnumerableHashSet<String> & shaderNames);
 		};
 
 		class ShaderCompiler : public CoreLib::Basic::Object
@@ -59,6 +83,11 @@ namespace Spire
 		public:
 			virtual CompileUnit Parse(CompileResult & result, String source, String fileName, IncludeHandler* includeHandler, Dictionary<String,String> const& preprocessorDefinitions) = 0;
 			virtual void Compile(CompileResult & result, CompilationContext & context, List<CompileUnit> & units, const CompileOptions & options) = 0;
+			// generates the variant IR of shader `shaderName`, checked by an earlier compile in `context`, for each of `schedules`
+			// on up to `threadCount` threads (0 for one per hardware thread). The variant of a schedule that produces errors is null;
+			// diagnostics are added to `result` in schedule order.
+			virtual List<RefPtr<ShaderIR>> GenerateShaderVariants(CompileResult & result, CompilationContext & context, String shaderName,
+				ArrayView<Schedule> schedules, int threadCount) = 0;
 			void Compile(CompileResult & result, List<CompileUnit> & units, const CompileOptions & options)
 			{
 				CompilationContext context;
@@ -67,6 +96,9 @@ namespace Spire
 		};
 
 		ShaderCompiler * CreateShaderCompiler();
+		// identifies the build of the compiler by the time ShaderCompiler.cpp was compiled, so that code
+		// cached by one build of the compiler is not served by another
+		const char * GetCompilerBuildId();
 	}
 }
 
@@ -0,0 +1,122 @@
+#include "SourceFileCache.h"
+#include "../CoreLib/LibIO.h"
+
+using namespace CoreLib::Basic;
+using namespace CoreLib::IO;
+using namespace CoreLib::Text;
+
+namespace Spire
+{
+	namespace Compiler
+	{
+		// returns true if the tokens at `index` start a `#<name>` directive
+		static bool IsDirective(const List<Token> & tokens, int index, const char * name)
+		{
+			return index + 1 < tokens.Count() && tokens[index].Type == TokenType::Pound && (tokens[index].flags & TokenFlag::AtStartOfLine)
+				&& tokens[index + 1].Type == TokenType::Identifier && tokens[index + 1].Content == name;
+		}
+
+		// returns the index of the first token of the line after the one containing `index`
+		static int SkipLine(const List<Token> & tokens, int index)
+		{
+			index++;
+			while (tokens[index].Type != TokenType::EndOfFile && !(tokens[index].flags & TokenFlag::AtStartOfLine))
+				index++;
+			return index;
+		}
+
+		// A file is guarded by `X` if it starts with `#ifndef X` followed by `#define X`, and the `#endif`
+		// that matches the `#ifndef` is the last line of the file. Once `X` is defined, including such
+		// a file again produces no tokens.
+		static Atom FindIncludeGuard(const List<Token> & tokens)
+		{
+			if (!IsDirective(tokens, 0, "ifndef") || tokens[2].Type != TokenType::Identifier || (tokens[2].flags & TokenFlag::AtStartOfLine))
+				return Atom();
+			Atom guard = tokens[2].Content;
+			int index = SkipLine(tokens, 2);
+			if (!IsDirective(tokens, index, "define") || tokens[index + 2].Content != guard || (tokens[index + 2].flags & TokenFlag::AtStartOfLine))
+				return Atom();
+			int depth = 0;
+			for (index = SkipLine(tokens, index + 2); tokens[index].Type != TokenType::EndOfFile; index = SkipLine(tokens, index))
+			{
+				if (IsDirective(tokens, index, "if") || IsDirective(tokens, index, "ifdef") || IsDirective(tokens, index, "ifndef"))
+					depth++;
+				else if (IsDirective(tokens, index, "endif"))
+				{
+					if (depth == 0)
+						return tokens[SkipLine(tokens, index + 1)].Type == TokenType::EndOfFile ? guard : Atom();
+					depth--;
+				}
+				else if (depth == 0 && (IsDirective(tokens, index, "else") || IsDirective(tokens, index, "elif")))
+					return Atom();
+			}
+			return Atom();
+		}
+
+		void SourceFile::Lex(DiagnosticSink * sink)
+		{
+			Lexer lexer;
+			Tokens = lexer.Parse(FileName, Text, sink);
+			IncludeGuard = FindIncludeGuard(Tokens.mTokens);
+		}
+
+		RefPtr<SourceFile> SourceFileCache::Load(const String & fileName)
+		{
+			DiskFile diskFile;
+			if (!File::GetStatus(fileName, diskFile.LastWriteTime, diskFile.Size))
+				return nullptr;
+			String canonicalPath = Path::GetCanonicalPath(fileName);
+			DiskFile cachedFile;
+			bool found;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				found = diskFiles.TryGetValue(canonicalPath, cachedFile);
+			}
+			if (found && cachedFile.LastWriteTime == diskFile.LastWriteTime && cachedFile.Size == diskFile.Size)
+			{
+				if (cachedFile.File->FileName == fileName)
+					return cachedFile.File;
+				// the positions of the tokens have to name the file the way it was reached this time
+				return Lex(fileName, cachedFile.File->Text);
+			}
+			diskFile.File = Lex(fileName, File::ReadAllText(fileName));
+			std::lock_guard<std::mutex> lock(mutex);
+			diskFiles[canonicalPath] = diskFile;
+			return diskFile.File;
+		}
+
+		RefPtr<SourceFile> SourceFileCache::Lex(const String & fileName, const String & text)
+		{
+			String textHash = ContentHash::Compute(text);
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				auto lexedFile = lexedFiles.TryGetValue(fileName);
+				if (lexedFile && lexedFile->TextHash == textHash)
+					return lexedFile->File;
+			}
+			RefPtr<SourceFile> file = new SourceFile();
+			file->FileName = fileName;
+			file->CanonicalPath = Path::GetCanonicalPath(fileName);
+			file->Text = text;
+			DiagnosticSink sink;
+			try
+			{
+				file->Lex(&sink);
+			}
+			catch (InvalidOperationException)
+			{
+			}
+			if (sink.diagnostics.Count())
+				file->Tokens = TokenList();
+			LexedFile lexedFile;
+			lexedFile.TextHash = textHash;
+			lexedFile.File = file;
+			std::lock_guard<std::mutex> lock(mutex);
+			// the tokens of an older text of the file are dropped, and a cache of too many files starts over
+			if (lexedFiles.Count() == MaxLexedFiles && !lexedFiles.ContainsKey(fileName))
+				lexedFiles.Clear();
+			lexedFiles[fileName] = lexedFile;
+			return file;
+		}
+	}
+}
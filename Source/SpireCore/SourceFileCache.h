@@ -0,0 +1,74 @@
+#ifndef SPIRE_SOURCE_FILE_CACHE_H
+#define SPIRE_SOURCE_FILE_CACHE_H
+
+#include "../CoreLib/Basic.h"
+#include "ContentHash.h"
+#include "Lexer.h"
+
+#include <mutex>
+
+namespace Spire
+{
+	namespace Compiler
+	{
+		// A source file as read from disk, together with its tokens so that every `#include` or `using`
+		// of the file can reuse them instead of lexing the text again.
+		class SourceFile : public RefObject
+		{
+		public:
+			// the path the file was found under, which the positions of its tokens refer to
+			CoreLib::String FileName;
+			// identifies the file regardless of the path used to reach it (see Path::GetCanonicalPath)
+			CoreLib::String CanonicalPath;
+			CoreLib::String Text;
+			// empty until the file is lexed
+			TokenList Tokens;
+			// the macro of an include guard around the whole file (`#ifndef X`, `#define X`, ..., `#endif`),
+			// or an empty atom if the file has no such guard
+			CoreLib::Atom IncludeGuard;
+
+			bool IsLexed() const
+			{
+				return Tokens.mTokens.Count() != 0;
+			}
+			// lexes `Text` into `Tokens`, and looks for an include guard in them
+			void Lex(DiagnosticSink * sink);
+		};
+
+		// Source files read by a compilation context. Files on disk are found by canonical path, and an entry
+		// is used for as long as the modification time and size of its file stay the same. The tokens of the
+		// latest text of each file name are kept under the hash of that text, so the same text is lexed only
+		// once, however many times it is preprocessed and under whatever macro definitions. At most
+		// MaxLexedFiles file names are kept. The cache may be used by several threads at once; the files it
+		// returns are never modified.
+		class SourceFileCache : public RefObject
+		{
+		private:
+			struct DiskFile
+			{
+				RefPtr<SourceFile> File;
+				CoreLib::Int64 LastWriteTime = 0;
+				CoreLib::Int64 Size = 0;
+			};
+			struct LexedFile
+			{
+				// see ContentHash
+				CoreLib::String TextHash;
+				RefPtr<SourceFile> File;
+			};
+			static const int MaxLexedFiles = 1024;
+			std::mutex mutex;
+			CoreLib::Dictionary<CoreLib::String, DiskFile> diskFiles;
+			CoreLib::Dictionary<CoreLib::String, LexedFile> lexedFiles;
+		public:
+			// Returns the file at `fileName`, or nullptr if there is no such file. Throws IOException if the
+			// file exists but cannot be read.
+			RefPtr<SourceFile> Load(const CoreLib::String & fileName);
+			// Returns `text` lexed as the content of `fileName`. A file whose lexing produces diagnostics is
+			// returned unlexed, here as from Load, so that whoever lexes it reports them.
+			RefPtr<SourceFile> Lex(const CoreLib::String & fileName, const CoreLib::String & text);
+		};
+	}
+}
+
+#endif
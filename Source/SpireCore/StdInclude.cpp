@@ -1,5 +1,6 @@
 #include "StdInclude.h"
 #include "Syntax.h"
+#include <mutex>
 
 const char * LibIncludeString = R"(
 __intrinsic float dFdx(float v);
@@ -287,9 +288,11 @@ namespace Spire
 	namespace Compiler
 	{
 		String SpireStdLib::code;
+		static std::mutex codeMutex;
 
 		String SpireStdLib::GetCode()
 		{
+			std::lock_guard<std::mutex> lock(codeMutex);
 			if (code.Length() > 0)
 				return code;
 			StringBuilder sb;
@@ -413,6 +416,7 @@ namespace Spire
 
 		void SpireStdLib::Finalize()
 		{
+			std::lock_guard<std::mutex> lock(codeMutex);
 			code = nullptr;
 		}
 
@@ -46,6 +46,29 @@ namespace Spire
 			}
 			return (ShaderDependenceOrder.Count() == Shaders.Count());
 		}
+		void SymbolTable::AddShaderUsers(EnumerableHashSet<String> & shaderNames)
+		{
+			// DependentShaders lists the shaders a shader uses, so users are found by scanning until nothing is added
+			bool changed = true;
+			while (changed)
+			{
+				changed = false;
+				for (auto & shader : Shaders)
+				{
+					if (shaderNames.Contains(shader.Key))
+						continue;
+					for (auto & dshader : shader.Value->DependentShaders)
+					{
+						if (shaderNames.Contains(dshader->SyntaxNode->Name.Content))
+						{
+							shaderNames.Add(shader.Key);
+							changed = true;
+							break;
+						}
+					}
+				}
+			}
+		}
 		void SymbolTable::EvalFunctionReferenceClosure()
 		{
 			for (auto & func : Functions)
@@ -87,55 +110,98 @@ namespace Spire
 
 		List<ImportPath>& PipelineSymbol::GetPaths(String srcWorld, String destWorld)
 		{
-			if (auto first = pathCache.TryGetValue(srcWorld))
-			{
-				if (auto second = first->TryGetValue(destWorld))
-					return *second;
-			}
-			else
-			{
-				pathCache[srcWorld] = EnumerableDictionary<String, List<ImportPath>>();
+			int src = GetWorldId(srcWorld);
+			int dest = GetWorldId(destWorld);
+			if (src == -1 || dest == -1)
+				return emptyPaths;
+			return GetPaths(src, dest);
+		}
+
+		int PipelineSymbol::GetWorldId(const String & world)
+		{
+			int id;
+			if (worldIds.TryGetValue(world, id))
+				return id;
+			return -1;
+		}
+
+		void PipelineSymbol::EvalWorldReachability()
+		{
+			worldIds.Clear();
+			worldNames.Clear();
+			for (auto & world : Worlds)
+			{
+				worldIds[world.Key] = worldNames.Count();
+				worldNames.Add(world.Key);
+			}
+			worldCount = worldNames.Count();
+			paths.Clear();
+			for (int i = 0; i < worldCount * worldCount; i++)
+				paths.Add(List<ImportPath>());
+			reachableWorlds.SetMax(worldCount * worldCount);
+			implicitlyReachableWorlds.SetMax(worldCount * worldCount);
+			unconditionallyReachableWorlds.SetMax(worldCount * worldCount);
+			unconditionallyImplicitlyReachableWorlds.SetMax(worldCount * worldCount);
+			for (int i = 0; i < worldCount; i++)
+				FindPaths(i);
+			for (int i = 0; i < paths.Count(); i++)
+			{
+				for (auto & p : paths[i])
+				{
+					bool isUnconditional = p.TypeRequirements.Count() == 0;
+					reachableWorlds.Add(i);
+					if (isUnconditional)
+						unconditionallyReachableWorlds.Add(i);
+					if (p.IsImplicitPath)
+					{
+						implicitlyReachableWorlds.Add(i);
+						if (isUnconditional)
+							unconditionallyImplicitlyReachableWorlds.Add(i);
+					}
+				}
 			}
-			auto path = FindPaths(srcWorld, destWorld);
-			auto & dict = pathCache[srcWorld]();
-			dict[destWorld] = _Move(path);
-			return dict[destWorld]();
+			WorldTopologyOrder.Clear();
+			GetWorldTopologyOrder();
 		}
 
-		List<ImportPath> PipelineSymbol::FindPaths(String worldSrc, String worldDest)
-		{
-			List<ImportPath> resultPaths;
-			if (worldSrc == worldDest)
-				return resultPaths;
-			List<ImportPath> paths, paths2;
-			paths.Add(ImportPath());
-			paths[0].Nodes.Add(ImportPath::Node(worldSrc, nullptr));
-			while (paths.Count())
-			{
-				paths2.Clear();
-				for (auto & p : paths)
+		void PipelineSymbol::FindPaths(int worldSrc)
+		{
+			// breadth first, so that the paths to each world are listed from the shortest one. A path does not
+			// go through a world twice, which keeps the search finite if the import operators are circular.
+			List<ImportPath> currentPaths, nextPaths;
+			currentPaths.Add(ImportPath());
+			currentPaths[0].Nodes.Add(ImportPath::Node(worldNames[worldSrc], nullptr));
+			while (currentPaths.Count())
+			{
+				nextPaths.Clear();
+				for (auto & p : currentPaths)
 				{
 					String world0 = p.Nodes.Last().TargetWorld;
 					for (auto op : SyntaxNode->GetImportOperators())
 					{
-						if (op->SourceWorld.Content == world0)
+						if (op->SourceWorld.Content != world0)
+							continue;
+						int destWorld = GetWorldId(op->DestWorld.Content);
+						if (destWorld == -1)
+							continue;
+						bool isVisited = From(p.Nodes).Any([&](const ImportPath::Node & n)
 						{
-							ImportPath np = p;
-							if (op->GetParameters().Count() != 0)
-								np.IsImplicitPath = false;
-							for (auto &req : op->Requirements)
-								np.TypeRequirements.Add(req.Ptr());
-							np.Nodes.Add(ImportPath::Node(op->DestWorld.Content, op.Ptr()));
-							if (op->DestWorld.Content == worldDest)
-								resultPaths.Add(np);
-							else
-								paths2.Add(np);
-						}
+							return n.TargetWorld == op->DestWorld.Content;
+						});
+						if (isVisited)
+							continue;
+						ImportPath np = p;
+						if (op->GetParameters().Count() != 0)
+							np.IsImplicitPath = false;
+						for (auto &req : op->Requirements)
+							np.TypeRequirements.Add(req.Ptr());
+						np.Nodes.Add(ImportPath::Node(op->DestWorld.Content, op.Ptr()));
+						paths[worldSrc * worldCount + destWorld].Add(np);
+						nextPaths.Add(_Move(np));
 					}
 				}
-				paths.SwapWith(paths2);
+				currentPaths.SwapWith(nextPaths);
 			}
-			return resultPaths;
 		}
 
 		bool PipelineSymbol::IsAbstractWorld(String world)
@@ -454,24 +520,31 @@ namespace Spire
 			return true;
 		}
 
-		bool SymbolTable::IsWorldReachable(PipelineSymbol * pipe, String src, String targetWorld, RefPtr<ExpressionType> type)
+		bool SymbolTable::IsWorldReachable(PipelineSymbol * pipe, String src, String targetWorld, RefPtr<ExpressionType> type, bool implicitOnly)
 		{
 			if (src == targetWorld)
 				return true;
-			return From(pipe->GetPaths(src, targetWorld)).Any([&](const ImportPath & p)
+			int srcWorld = pipe->GetWorldId(src);
+			int destWorld = pipe->GetWorldId(targetWorld);
+			if (srcWorld == -1 || destWorld == -1 || !pipe->IsWorldReachable(srcWorld, destWorld, implicitOnly))
+				return false;
+			if (pipe->IsWorldUnconditionallyReachable(srcWorld, destWorld, implicitOnly))
+				return true;
+			// only the paths with type requirements are left to check
+			return From(pipe->GetPaths(srcWorld, destWorld)).Any([&](const ImportPath & p)
 			{
-				return CheckTypeRequirement(p, type);
+				return (p.IsImplicitPath || !implicitOnly) && CheckTypeRequirement(p, type);
 			});
 		}
 
+		bool SymbolTable::IsWorldReachable(PipelineSymbol * pipe, String src, String targetWorld, RefPtr<ExpressionType> type)
+		{
+			return IsWorldReachable(pipe, src, targetWorld, type, false);
+		}
+
 		bool SymbolTable::IsWorldImplicitlyReachable(PipelineSymbol * pipe, String src, String targetWorld, RefPtr<ExpressionType> type)
 		{
-			if (src == targetWorld)
-				return true;
-			return From(pipe->GetPaths(src, targetWorld)).Any([&](const ImportPath & p)
-			{
-				return p.IsImplicitPath && CheckTypeRequirement(p, type);
-			});
+			return IsWorldReachable(pipe, src, targetWorld, type, true);
 		}
 
 		bool SymbolTable::IsWorldImplicitlyReachable(PipelineSymbol * pipe, EnumerableHashSet<String>& src, String targetWorld, RefPtr<ExpressionType> type)
@@ -504,7 +577,7 @@ namespace Spire
 			}).ToList();
 		}
 
-        Decl* SymbolTable::LookUp(String const& name)
+        Decl* SymbolTable::LookUp(Atom name)
         {
             Decl* decl = nullptr;
             if (globalDecls.TryGetValue(name, decl))
@@ -512,22 +585,37 @@ namespace Spire
             return nullptr;
         }
 
+		void SymbolTable::Fork(SymbolTable & parent)
+		{
+			FunctionOverloads.Fork(parent.FunctionOverloads);
+			Functions.Fork(parent.Functions);
+			Shaders.Fork(parent.Shaders);
+			Pipelines.Fork(parent.Pipelines);
+			globalDecls.Fork(parent.globalDecls);
+			// the dependence order is computed again whenever shaders are checked
+			ShaderDependenceOrder.Clear();
+		}
+
+		void SymbolTable::Freeze()
+		{
+			FunctionOverloads.Freeze();
+			Functions.Freeze();
+			Shaders.Freeze();
+			Pipelines.Freeze();
+			globalDecls.Freeze();
+		}
+
 		void SymbolTable::MergeWith(SymbolTable & symTable)
 		{
-			for (auto & f : symTable.FunctionOverloads)
-				FunctionOverloads[f.Key] = f.Value;
-			for (auto & f : symTable.Functions)
-				Functions[f.Key] = f.Value;
-			for (auto & f : symTable.Shaders)
-				Shaders[f.Key] = f.Value;
-			for (auto & f : symTable.Pipelines)
-				Pipelines[f.Key] = f.Value;
-			for (auto & f : symTable.globalDecls)
-				globalDecls[f.Key] = f.Value;
+			FunctionOverloads.MergeWith(symTable.FunctionOverloads);
+			Functions.MergeWith(symTable.Functions);
+			Shaders.MergeWith(symTable.Shaders);
+			Pipelines.MergeWith(symTable.Pipelines);
+			globalDecls.MergeWith(symTable.globalDecls);
 			SortShaders();
 		}
 
-		int UniqueIdGenerator::currentGUID = 0;
+		thread_local int UniqueIdGenerator::currentGUID = 0;
 		void UniqueIdGenerator::Clear()
 		{
 			currentGUID = 0;
@@ -536,7 +624,7 @@ namespace Spire
 		{
 			return currentGUID++;
 		}
-		RefPtr<ShaderComponentSymbol> ShaderClosure::FindComponent(String name, bool findInPrivate, bool includeParams)
+		RefPtr<ShaderComponentSymbol> ShaderClosure::FindComponent(Atom name, bool findInPrivate, bool includeParams)
 		{
 			RefPtr<ShaderComponentSymbol> rs;
 			if (RefMap.TryGetValue(name, rs))
@@ -575,7 +663,7 @@ namespace Spire
 			}
 			return rs;
 		}
-		RefPtr<ShaderClosure> ShaderClosure::FindClosure(String name)
+		RefPtr<ShaderClosure> ShaderClosure::FindClosure(Atom name)
 		{
 			RefPtr<ShaderClosure> rs;
 			if (SubClosures.TryGetValue(name, rs))
@@ -5,6 +5,7 @@
 #include "Syntax.h"
 #include "IL.h"
 #include "VariantIR.h"
+#include "LayeredDictionary.h"
 
 namespace Spire
 {
@@ -135,12 +136,12 @@ namespace Spire
 			bool IsPublic = false;
 			String Name;
 			CodePosition UsingPosition;
-			EnumerableDictionary<String, RefPtr<ShaderComponentSymbol>> RefMap;
-			EnumerableDictionary<String, RefPtr<ShaderComponentSymbol>> Components;
-			EnumerableDictionary<String, ComponentInstance> AllComponents;
-			EnumerableDictionary<String, RefPtr<ShaderClosure>> SubClosures;
-			RefPtr<ShaderComponentSymbol> FindComponent(String name, bool findInPrivate = false, bool includeParams = true);
-			RefPtr<ShaderClosure> FindClosure(String name);
+			EnumerableDictionary<Atom, RefPtr<ShaderComponentSymbol>> RefMap;
+			EnumerableDictionary<Atom, RefPtr<ShaderComponentSymbol>> Components;
+			EnumerableDictionary<Atom, ComponentInstance> AllComponents;
+			EnumerableDictionary<Atom, RefPtr<ShaderClosure>> SubClosures;
+			RefPtr<ShaderComponentSymbol> FindComponent(Atom name, bool findInPrivate = false, bool includeParams = true);
+			RefPtr<ShaderClosure> FindClosure(Atom name);
 			List<ShaderComponentSymbol*> GetDependencyOrder();
 			RefPtr<ShaderIR> IR;
 		};
@@ -167,8 +168,17 @@ namespace Spire
 		{
 		private:
 			List<String> WorldTopologyOrder;
-			EnumerableDictionary<String, EnumerableDictionary<String, List<ImportPath>>> pathCache;
-			List<ImportPath> FindPaths(String worldSrc, String worldDest);
+			// dense ids of the worlds; the tables below are indexed by srcWorld * worldCount + destWorld
+			Dictionary<String, int> worldIds;
+			List<String> worldNames;
+			int worldCount = 0;
+			List<List<ImportPath>> paths;
+			// transitive closure of the import operators, over any paths and over implicit paths only. The
+			// unconditional sets hold the pairs connected by a path without type requirements.
+			IntSet reachableWorlds, implicitlyReachableWorlds;
+			IntSet unconditionallyReachableWorlds, unconditionallyImplicitlyReachableWorlds;
+			List<ImportPath> emptyPaths;
+			void FindPaths(int worldSrc);
 		public:
 			PipelineSyntaxNode * SyntaxNode;
 			PipelineSymbol * ParentPipeline;
@@ -176,11 +186,29 @@ namespace Spire
 			// SourceWorld=>DestinationWorld=>ImportOperator
 			EnumerableDictionary<String, EnumerableDictionary<String, List<RefPtr<ImportOperatorDefSyntaxNode>>>> ImportOperatorsByPath;
 			EnumerableDictionary<String, EnumerableHashSet<String>> WorldDependency;
-            EnumerableDictionary<String, WorldSyntaxNode*> Worlds;
+            EnumerableDictionary<Atom, WorldSyntaxNode*> Worlds;
 			bool IsAbstractWorld(String world);
 			bool IsChildOf(PipelineSymbol * parentPipeline);
 			
 			List<String> & GetWorldTopologyOrder();
+			// finds the import paths between all pairs of worlds once the import operators are added, after
+			// which the pipeline is only read and may be shared between threads
+			void EvalWorldReachability();
+			int GetWorldId(const String & world); // -1 if the world is not in the pipeline
+			// whether a path of import operators (of implicit ones if `implicitOnly`) leads from srcWorld to destWorld
+			bool IsWorldReachable(int srcWorld, int destWorld, bool implicitOnly)
+			{
+				return (implicitOnly ? implicitlyReachableWorlds : reachableWorlds).Contains(srcWorld * worldCount + destWorld);
+			}
+			// whether such a path has no type requirement, so that it can import a value of any type
+			bool IsWorldUnconditionallyReachable(int srcWorld, int destWorld, bool implicitOnly)
+			{
+				return (implicitOnly ? unconditionallyImplicitlyReachableWorlds : unconditionallyReachableWorlds).Contains(srcWorld * worldCount + destWorld);
+			}
+			List<ImportPath> & GetPaths(int srcWorld, int destWorld)
+			{
+				return paths[srcWorld * worldCount + destWorld];
+			}
 			List<ImportPath> & GetPaths(String srcWorld, String destWorld);
 			List<ImportOperatorDefSyntaxNode*> GetImportOperatorsFromSourceWorld(String worldSrc);
 			void AddImportOperator(RefPtr<ImportOperatorDefSyntaxNode> op);
@@ -192,14 +220,16 @@ namespace Spire
 		{
 		private:
 			bool CheckTypeRequirement(const ImportPath & p, RefPtr<ExpressionType> type);
+			bool IsWorldReachable(PipelineSymbol * pipe, String src, String targetWorld, RefPtr<ExpressionType> type, bool implicitOnly);
 		public:
-			EnumerableDictionary<String, List<RefPtr<FunctionSymbol>>> FunctionOverloads; // indexed by original name
-			EnumerableDictionary<String, RefPtr<FunctionSymbol>> Functions; // indexed by internal name
-			EnumerableDictionary<String, RefPtr<ShaderSymbol>> Shaders;
-			EnumerableDictionary<String, RefPtr<PipelineSymbol>> Pipelines;
-			EnumerableDictionary<String, Decl*> globalDecls;
+			LayeredDictionary<Atom, List<RefPtr<FunctionSymbol>>> FunctionOverloads; // indexed by original name
+			LayeredDictionary<Atom, RefPtr<FunctionSymbol>> Functions; // indexed by internal name
+			LayeredDictionary<Atom, RefPtr<ShaderSymbol>> Shaders;
+			LayeredDictionary<Atom, RefPtr<PipelineSymbol>> Pipelines;
+			LayeredDictionary<Atom, Decl*> globalDecls;
 			List<ShaderSymbol*> ShaderDependenceOrder;
 			bool SortShaders(); // return true if success, return false if dependency is cyclic
+			void AddShaderUsers(EnumerableHashSet<String> & shaderNames); // add every shader that directly or indirectly uses one of `shaderNames`
 			void EvalFunctionReferenceClosure();
 			bool CheckComponentImplementationConsistency(DiagnosticSink * sink, ShaderComponentSymbol * comp, ShaderComponentImplSymbol * impl);
 
@@ -209,14 +239,16 @@ namespace Spire
 			bool IsWorldImplicitlyReachable(PipelineSymbol * pipe, String src, String targetWorld, RefPtr<ExpressionType> type);
 			List<ImportPath> FindImplicitImportOperatorChain(PipelineSymbol * pipe, String worldSrc, String worldDest, RefPtr<ExpressionType> type);
 
-            Decl* LookUp(String const& name);
-			void MergeWith(SymbolTable & symTable);
+            Decl* LookUp(Atom name);
+			void Fork(SymbolTable & parent); // start out with the symbols of `parent`, sharing them instead of copying
+			void Freeze(); // make the symbols added so far shareable with forks
+			void MergeWith(SymbolTable & symTable); // bring the symbols inherited from `symTable` up to date
 		};
 
 		class UniqueIdGenerator
 		{
 		private:
-			static int currentGUID;
+			static thread_local int currentGUID;
 		public:
 			static void Clear();
 			static int Next();
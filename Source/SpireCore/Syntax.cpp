@@ -3,14 +3,17 @@
 #include "SymbolTable.h"
 
 #include <assert.h>
+#include <mutex>
 
 namespace Spire
 {
 	namespace Compiler
 	{
+		thread_local int SyntaxNodeAllocationCount = 0;
+
         // Scope
 
-        Decl* Scope::LookUp(String const& name)
+        Decl* Scope::LookUp(Atom name)
         {
             Scope* scope = this;
             while (scope)
@@ -26,8 +29,58 @@ namespace Spire
             return nullptr;
         }
 
+        // A container declaration fills in a scope of its own. The copy of that scope made while cloning the
+        // container must look names up in the cloned container, as the original may be gone by the time the
+        // clone is checked.
+        template<typename T>
+        static T * RetargetClonedScope(T * original, T * clone)
+        {
+            if (clone->Scope && clone->Scope->containerDecl == original)
+                clone->Scope->containerDecl = clone;
+            return clone;
+        }
+
+        // The members of a cloned container belong to the clone.
+        template<typename T>
+        static T * AdoptClonedMembers(T * clone)
+        {
+            for (auto & member : clone->Members)
+                member->ParentDecl = clone;
+            return clone;
+        }
+
         // Decl
 
+        void CloneModifiers(Decl * decl, CloneContext & ctx)
+        {
+            if (!ctx.CopyAll)
+                return;
+            RefPtr<Modifier> * link = &decl->modifiers.first;
+            for (Modifier * modifier = decl->modifiers.first.Ptr(); modifier; modifier = modifier->next.Ptr())
+            {
+                RefPtr<Modifier> copy;
+                if (auto attrib = dynamic_cast<SimpleAttribute*>(modifier))
+                    copy = new SimpleAttribute(*attrib);
+                else if (auto layout = dynamic_cast<LayoutModifier*>(modifier))
+                    copy = new LayoutModifier(*layout);
+                else if (auto specialize = dynamic_cast<SpecializeModifier*>(modifier))
+                {
+                    auto specializeCopy = new SpecializeModifier(*specialize);
+                    for (auto & value : specializeCopy->Values)
+                        value = value->Clone(ctx);
+                    copy = specializeCopy;
+                }
+                else
+                {
+                    // a kind of modifier that is never changed; the rest of the list stays shared
+                    *link = modifier;
+                    break;
+                }
+                *link = copy;
+                link = &copy->next;
+            }
+        }
+
         bool Decl::FindSimpleAttribute(String const& key, Token& outValue)
         {
             for (auto attr : GetLayoutAttributes())
@@ -228,11 +281,11 @@ namespace Spire
 		}
 		ProgramSyntaxNode * ProgramSyntaxNode::Clone(CloneContext & ctx)
 		{
-			auto rs = CloneSyntaxNodeFields(new ProgramSyntaxNode(*this), ctx);
+			auto rs = RetargetClonedScope(this, CloneSyntaxNodeFields(new ProgramSyntaxNode(*this), ctx));
 			rs->Members.Clear();
 			for (auto & m : Members)
 				rs->Members.Add(m->Clone(ctx));
-			return rs;
+			return AdoptClonedMembers(rs);
 		}
 		RefPtr<SyntaxNode> FunctionSyntaxNode::Accept(SyntaxVisitor * visitor)
 		{
@@ -240,14 +293,15 @@ namespace Spire
 		}
 		FunctionSyntaxNode * FunctionSyntaxNode::Clone(CloneContext & ctx)
 		{
-			auto rs = CloneSyntaxNodeFields(new FunctionSyntaxNode(*this), ctx);
+			auto rs = RetargetClonedScope(this, CloneSyntaxNodeFields(new FunctionSyntaxNode(*this), ctx));
 			for (auto & member : rs->Members)
 			{
 				member = member->Clone(ctx);
 			}
 			rs->ReturnTypeNode = ReturnTypeNode->Clone(ctx);
-			rs->Body = Body->Clone(ctx);
-			return rs;
+			if (Body)
+				rs->Body = Body->Clone(ctx);
+			return AdoptClonedMembers(rs);
 		}
 
         //
@@ -264,7 +318,7 @@ namespace Spire
             {
                 member = member->Clone(ctx);
             }
-            return rs;
+            return AdoptClonedMembers(rs);
         }
 
 
@@ -513,7 +567,8 @@ namespace Spire
 		{
 			auto rs = CloneSyntaxNodeFields(new ParameterSyntaxNode(*this), ctx);
 			rs->TypeNode = TypeNode->Clone(ctx);
-			rs->Expr = Expr->Clone(ctx);
+			if (Expr)
+				rs->Expr = Expr->Clone(ctx);
 			return rs;
 		}
 		RefPtr<SyntaxNode> BasicTypeSyntaxNode::Accept(SyntaxVisitor * visitor)
@@ -526,7 +581,7 @@ namespace Spire
 		}
 		ComponentSyntaxNode * ComponentSyntaxNode::Clone(CloneContext & ctx)
 		{
-			auto rs = CloneSyntaxNodeFields(new ComponentSyntaxNode(*this), ctx);
+			auto rs = RetargetClonedScope(this, CloneSyntaxNodeFields(new ComponentSyntaxNode(*this), ctx));
 			rs->TypeNode = TypeNode->Clone(ctx);
 			if (Rate)
 				rs->Rate = Rate->Clone(ctx);
@@ -542,11 +597,11 @@ namespace Spire
 		}
 		ShaderSyntaxNode * ShaderSyntaxNode::Clone(CloneContext & ctx)
 		{
-			auto rs = CloneSyntaxNodeFields(new ShaderSyntaxNode(*this), ctx);
+			auto rs = RetargetClonedScope(this, CloneSyntaxNodeFields(new ShaderSyntaxNode(*this), ctx));
 			rs->Members.Clear();
 			for (auto & comp : Members)
 				rs->Members.Add(comp->Clone(ctx));
-			return rs;
+			return AdoptClonedMembers(rs);
 		}
 
         // UsingFileDecl
@@ -577,15 +632,24 @@ namespace Spire
 		}
 		ImportOperatorDefSyntaxNode * ImportOperatorDefSyntaxNode::Clone(CloneContext & ctx)
 		{
-			return CloneSyntaxNodeFields(new ImportOperatorDefSyntaxNode(*this), ctx);
+			auto rs = RetargetClonedScope(this, CloneSyntaxNodeFields(new ImportOperatorDefSyntaxNode(*this), ctx));
+			if (!ctx.CopyAll)
+				return rs;
+			for (auto & member : rs->Members)
+				member = member->Clone(ctx);
+			for (auto & requirement : rs->Requirements)
+				requirement = requirement->Clone(ctx);
+			if (Body)
+				rs->Body = Body->Clone(ctx);
+			return AdoptClonedMembers(rs);
 		}
 		PipelineSyntaxNode * PipelineSyntaxNode::Clone(CloneContext & ctx)
 		{
-			auto rs = CloneSyntaxNodeFields(new PipelineSyntaxNode(*this), ctx);
+			auto rs = RetargetClonedScope(this, CloneSyntaxNodeFields(new PipelineSyntaxNode(*this), ctx));
 			rs->Members.Clear();
 			for (auto & m : Members)
 				rs->Members.Add(m->Clone(ctx));
-			return rs;
+			return AdoptClonedMembers(rs);
 		}
 		ChoiceValueSyntaxNode * ChoiceValueSyntaxNode::Clone(CloneContext & ctx)
 		{
@@ -707,15 +771,25 @@ namespace Spire
             return AsNamedTypeImpl();
         }
 
+        static std::recursive_mutex canonicalTypeMutex;
+
         ExpressionType* ExpressionType::GetCanonicalType() const
         {
             ExpressionType* et = const_cast<ExpressionType*>(this);
-            if (!et->canonicalType)
+            auto canonical = et->canonicalType.load(std::memory_order_acquire);
+            if (!canonical)
             {
-                // TODO(tfoley): worry about thread safety here?
-                et->canonicalType = et->CreateCanonicalType();
+                // creating a canonical type may recursively canonicalize its element types, and it appends
+                // to sCanonicalTypes, so all creation is serialized; lookups of existing ones stay lock-free
+                std::lock_guard<std::recursive_mutex> lock(canonicalTypeMutex);
+                canonical = et->canonicalType.load(std::memory_order_relaxed);
+                if (!canonical)
+                {
+                    canonical = et->CreateCanonicalType();
+                    et->canonicalType.store(canonical, std::memory_order_release);
+                }
             }
-            return et->canonicalType;
+            return canonical;
         }
 
 		bool ExpressionType::IsTexture() const
@@ -1036,11 +1110,11 @@ namespace Spire
 		}
 		InterfaceSyntaxNode * InterfaceSyntaxNode::Clone(CloneContext & ctx)
 		{
-			auto rs = CloneSyntaxNodeFields(new InterfaceSyntaxNode(*this), ctx);
+			auto rs = RetargetClonedScope(this, CloneSyntaxNodeFields(new InterfaceSyntaxNode(*this), ctx));
 			rs->Members.Clear();
 			for (auto & comp : Members)
 				rs->Members.Add(comp->Clone(ctx));
-			return rs;
+			return AdoptClonedMembers(rs);
 		}
 		RefPtr<SyntaxNode> TemplateShaderSyntaxNode::Accept(SyntaxVisitor * visitor)
 		{
@@ -1048,13 +1122,14 @@ namespace Spire
 		}
 		TemplateShaderSyntaxNode * TemplateShaderSyntaxNode::Clone(CloneContext & ctx)
 		{
-			auto rs = CloneSyntaxNodeFields(new TemplateShaderSyntaxNode(*this), ctx);
+			auto rs = RetargetClonedScope(this, CloneSyntaxNodeFields(new TemplateShaderSyntaxNode(*this), ctx));
 			rs->Parameters.Clear();
 			for (auto & param : Parameters)
 				rs->Parameters.Add(param->Clone(ctx));
+			rs->Members.Clear();
 			for (auto & member : Members)
 				rs->Members.Add(member->Clone(ctx));
-			return rs;
+			return AdoptClonedMembers(rs);
 		}
 		TemplateShaderParameterSyntaxNode * TemplateShaderParameterSyntaxNode::Clone(CloneContext & ctx)
 		{
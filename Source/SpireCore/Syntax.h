@@ -260,6 +260,15 @@ namespace Spire
 			// canonical types we create along the way
 			static List<RefPtr<ExpressionType>> sCanonicalTypes;
 		public:
+			ExpressionType() {}
+			ExpressionType(const ExpressionType & other)
+				: RefObject(other), canonicalType(other.canonicalType.load())
+			{}
+			ExpressionType & operator = (const ExpressionType & other)
+			{
+				canonicalType = other.canonicalType.load();
+				return *this;
+			}
 			virtual String ToString() const = 0;
 			virtual ExpressionType * Clone() = 0;
 
@@ -294,7 +303,9 @@ namespace Spire
 			virtual NamedExpressionType * AsNamedTypeImpl() const { return nullptr; }
 
 			virtual ExpressionType* CreateCanonicalType() = 0;
-			ExpressionType* canonicalType = nullptr;
+			// types from the standard library are shared by all compilation contexts,
+			// so the canonical type may be requested concurrently
+			std::atomic<ExpressionType*> canonicalType{nullptr};
 		};
 
 		class BasicExpressionType : public ExpressionType
@@ -407,7 +418,6 @@ namespace Spire
 			// ContrainedWorlds: Implementation must be defined at at least one of of these worlds in order to satisfy global dependency
 			// FeasibleWorlds: The component can be computed at any of these worlds
 			EnumerableHashSet<String> ConstrainedWorlds, FeasibleWorlds;
-			EnumerableHashSet<String> PinnedWorlds;
 		};
 
 		class ContainerDecl;
@@ -416,8 +426,8 @@ namespace Spire
 		public:
 			RefPtr<Scope> Parent;
 			ContainerDecl*  containerDecl;
-			Dictionary<String, Decl*> decls;
-			Decl* LookUp(String const& name);
+			Dictionary<Atom, Decl*> decls;
+			Decl* LookUp(Atom name);
 			Scope(RefPtr<Scope> parent, ContainerDecl* containerDecl)
 				: Parent(parent)
 				, containerDecl(containerDecl)
@@ -428,8 +438,22 @@ namespace Spire
 		{
 		public:
 			Dictionary<Spire::Compiler::Scope*, RefPtr<Spire::Compiler::Scope>> ScopeTranslateTable;
+			// Also copies what a clone otherwise shares with the original: the modifiers of declarations and the
+			// parameters and body of import operators. Set when the original has to stay as it is while the clone
+			// is checked.
+			bool CopyAll = false;
 		};
 
+		class SyntaxNode;
+		class Decl;
+		// copies the modifiers of a cloned declaration if `ctx.CopyAll` is set
+		inline void CloneModifiers(SyntaxNode *, CloneContext &)
+		{}
+		void CloneModifiers(Decl * decl, CloneContext & ctx);
+
+		// number of syntax nodes created (parsed or cloned) on this thread, for compile statistics
+		extern thread_local int SyntaxNodeAllocationCount;
+
 		class SyntaxNode : public RefObject
 		{
 		protected:
@@ -453,12 +477,23 @@ namespace Spire
 				}
 				target->Position = this->Position;
 				target->Tags = this->Tags;
+				CloneModifiers(target, ctx);
 				return target;
 			}
 		public:
 			EnumerableDictionary<String, RefPtr<Object>> Tags;
 			CodePosition Position;
 			RefPtr<Scope> Scope;
+			SyntaxNode()
+			{
+				SyntaxNodeAllocationCount++;
+			}
+			SyntaxNode(const SyntaxNode & other)
+				: RefObject(other), Tags(other.Tags), Position(other.Position), Scope(other.Scope)
+			{
+				SyntaxNodeAllocationCount++;
+			}
+			SyntaxNode & operator = (const SyntaxNode & other) = default;
 			virtual RefPtr<SyntaxNode> Accept(SyntaxVisitor * visitor) = 0;
 			virtual SyntaxNode * Clone(CloneContext & ctx) = 0;
 		};
@@ -837,7 +872,7 @@ namespace Spire
 		class VarExpressionSyntaxNode : public ExpressionSyntaxNode
 		{
 		public:
-			String Variable;
+			Atom Variable;
 			virtual RefPtr<SyntaxNode> Accept(SyntaxVisitor * visitor) override;
 			virtual VarExpressionSyntaxNode * Clone(CloneContext & ctx) override;
 		};
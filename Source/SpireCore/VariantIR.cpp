@@ -52,117 +52,247 @@ namespace Spire
 			for (auto & def : Definitions)
 				if (def->SyntaxNode->HasSimpleAttribute("FragDepth"))
 					def->IsEntryPoint = true;
-			List<ComponentDefinitionIR*> workList;
-			HashSet<ComponentDefinitionIR*> referencedDefs;
+			// walk the dependency graph from the entry points
+			if (DependencyGraph.Offsets.Count() != Definitions.Count() + 1)
+				BuildDependencyGraph();
+			IntSet referencedDefs(Definitions.Count());
+			List<int> workList;
 			for (auto & def : Definitions)
 			{
-				if (def->IsEntryPoint)
+				if (def->IsEntryPoint && !referencedDefs.Contains(def->Id))
 				{
-					if (referencedDefs.Add(def.Ptr()))
-						workList.Add(def.Ptr());
+					referencedDefs.Add(def->Id);
+					workList.Add(def->Id);
 				}
 			}
 			for (int i = 0; i < workList.Count(); i++)
 			{
-				auto def = workList[i];
-				for (auto & dep : def->Dependency)
+				for (auto dep : DependencyGraph[workList[i]])
 				{
-					if (referencedDefs.Add(dep))
+					if (!referencedDefs.Contains(dep))
+					{
+						referencedDefs.Add(dep);
 						workList.Add(dep);
+					}
 				}
 			}
+			for (auto & kv : DefinitionsByComponent)
+			{
+				for (auto & def : kv.Value)
+					if (!referencedDefs.Contains(def.Value->Id))
+						kv.Value.Remove(def.Key);
+			}
+			// renumber the remaining definitions and keep the edges between them
+			List<int> newIds;
+			newIds.SetSize(Definitions.Count());
 			List<RefPtr<ComponentDefinitionIR>> newDefinitions;
 			for (auto & def : Definitions)
 			{
-				if (referencedDefs.Contains(def.Ptr()))
+				if (referencedDefs.Contains(def->Id))
 				{
+					newIds[def->Id] = newDefinitions.Count();
 					newDefinitions.Add(def);
-					EnumerableHashSet<ComponentDefinitionIR*> newSet;
-					for (auto & comp : def->Users)
-						if (referencedDefs.Contains(comp))
-						{
-							newSet.Add(comp);
-						}
-					def->Users = newSet;
-					newSet.Clear();
-					for (auto & comp : def->Dependency)
-						if (referencedDefs.Contains(comp))
-						{
-							newSet.Add(comp);
-						}
-					def->Dependency = newSet;
 				}
+				else
+					newIds[def->Id] = -1;
+			}
+			ComponentAdjacency newDependencyGraph;
+			newDependencyGraph.Offsets.Add(0);
+			for (auto & def : newDefinitions)
+			{
+				for (auto dep : DependencyGraph[def->Id])
+					if (newIds[dep] != -1)
+						newDependencyGraph.Targets.Add(newIds[dep]);
+				newDependencyGraph.Offsets.Add(newDependencyGraph.Targets.Count());
 			}
+			for (auto & def : newDefinitions)
+				def->Id = newIds[def->Id];
 			Definitions = _Move(newDefinitions);
-			for (auto & kv : DefinitionsByComponent)
+			DependencyGraph = _Move(newDependencyGraph);
+			UpdateDependencySets();
+		}
+
+		void ShaderIR::BuildDependencyGraph()
+		{
+			for (int i = 0; i < Definitions.Count(); i++)
+				Definitions[i]->Id = i;
+			DependencyGraph.Clear();
+			DependencyGraph.Offsets.Add(0);
+			for (auto & def : Definitions)
 			{
-				for (auto & def : kv.Value)
-					if (!referencedDefs.Contains(def.Value))
-						kv.Value.Remove(def.Key);
+				for (auto & dep : def->Dependency)
+					DependencyGraph.Targets.Add(dep->Id);
+				DependencyGraph.Offsets.Add(DependencyGraph.Targets.Count());
+			}
+		}
+
+		void ShaderIR::UpdateDependencySets()
+		{
+			// users are the transpose of the dependency graph; counting the in-degrees first lets it be filled in place
+			UserGraph.Clear();
+			UserGraph.Offsets.SetSize(Definitions.Count() + 1);
+			for (auto & offset : UserGraph.Offsets)
+				offset = 0;
+			for (auto dep : DependencyGraph.Targets)
+				UserGraph.Offsets[dep + 1]++;
+			for (int i = 0; i < Definitions.Count(); i++)
+				UserGraph.Offsets[i + 1] += UserGraph.Offsets[i];
+			UserGraph.Targets.SetSize(DependencyGraph.Targets.Count());
+			List<int> fill;
+			fill.AddRange(UserGraph.Offsets.Buffer(), Definitions.Count());
+			for (int i = 0; i < Definitions.Count(); i++)
+				for (auto dep : DependencyGraph[i])
+					UserGraph.Targets[fill[dep]++] = i;
+			for (auto & def : Definitions)
+			{
+				def->ClearDependency();
+				def->Users.Clear();
+				for (auto dep : DependencyGraph[def->Id])
+					def->Dependency.Add(Definitions[dep].Ptr());
+				for (auto user : UserGraph[def->Id])
+					def->Users.Add(Definitions[user].Ptr());
 			}
 		}
 
 		class ReferenceWorkItem
 		{
 		public:
-			ComponentDependency Dependency;
-			String SourceWorld;
+			int Component;
+			int SourceWorld;
+			ImportOperatorDefSyntaxNode * ImportOperator;
+			ReferenceWorkItem() = default;
+			ReferenceWorkItem(int component, int sourceWorld, ImportOperatorDefSyntaxNode * importOperator)
+				: Component(component), SourceWorld(sourceWorld), ImportOperator(importOperator)
+			{}
 			int GetHashCode()
 			{
-				return Dependency.GetHashCode();
+				return Component * 16777619 ^ SourceWorld ^ (int)(CoreLib::PtrInt)(void*)(ImportOperator);
 			}
 			bool operator == (const ReferenceWorkItem & other)
 			{
-				return Dependency == other.Dependency && SourceWorld == other.SourceWorld;
+				return Component == other.Component && SourceWorld == other.SourceWorld && ImportOperator == other.ImportOperator;
 			}
 		};
 
 		void ShaderIR::ResolveComponentReference()
 		{
-			// build bidirectional dependency map of component definitions
-			for (auto & comp : Definitions)
+			// number definitions, worlds and components densely, so that selecting the definition a reference
+			// resolves to is a lookup in flat tables instead of nested string dictionaries
+			for (int i = 0; i < Definitions.Count(); i++)
+				Definitions[i]->Id = i;
+			Dictionary<String, int> worldIds;
+			List<String> worldNames;
+			auto addWorld = [&](const String & world)
+			{
+				if (!worldIds.ContainsKey(world))
+				{
+					worldIds[world] = worldNames.Count();
+					worldNames.Add(world);
+				}
+			};
+			for (auto & world : Shader->Pipeline->Worlds)
+				addWorld(world.Key);
+			for (auto & world : Shader->Pipeline->WorldDependency)
+			{
+				addWorld(world.Key);
+				for (auto & depWorld : world.Value)
+					addWorld(depWorld);
+			}
+			for (auto & impOp : Shader->Pipeline->SyntaxNode->GetImportOperators())
+				addWorld(impOp->SourceWorld.Content);
+			for (auto & def : Definitions)
+				addWorld(def->World);
+			addWorld("<uniform>");
+			int uniformWorld = worldIds["<uniform>"]();
+			int worldCount = worldNames.Count();
+
+			Dictionary<String, int> componentIds;
+			List<ShaderComponentSymbol*> componentSymbols;
+			List<ComponentDefinitionIR*> definitionTable; // component * worldCount + world => definition
+			IntSet pinnedDefinitions; // component * worldCount + world
+			for (auto & comp : DefinitionsByComponent)
 			{
-				comp->Dependency.Clear();
-				comp->Users.Clear();
+				int compId = componentSymbols.Count();
+				componentIds[comp.Key] = compId;
+				ComponentInstance inst;
+				Shader->AllComponents.TryGetValue(comp.Key, inst);
+				componentSymbols.Add(inst.Symbol);
+				for (int i = 0; i < worldCount; i++)
+					definitionTable.Add(nullptr);
+				for (auto & def : comp.Value)
+					definitionTable[compId * worldCount + worldIds[def.Key]()] = def.Value;
+				if (auto pinnedWorlds = PinnedWorlds.TryGetValue(comp.Key))
+				{
+					for (auto & world : *pinnedWorlds)
+					{
+						int worldId;
+						if (worldIds.TryGetValue(world, worldId))
+							pinnedDefinitions.Add(compId * worldCount + worldId);
+					}
+				}
 			}
+			// worlds a reference from a world may resolve to, in order of preference
+			List<List<int>> candidateWorlds;
+			candidateWorlds.SetSize(worldCount);
+			auto getCandidateWorlds = [&](int sourceWorld) -> List<int>&
+			{
+				auto & result = candidateWorlds[sourceWorld];
+				if (result.Count() == 0)
+				{
+					result.Add(sourceWorld);
+					for (auto & w : Shader->Pipeline->WorldDependency[worldNames[sourceWorld]]())
+						result.Add(worldIds[w]());
+					result.Add(uniformWorld);
+				}
+				return result;
+			};
+
+			// build the dependency graph of component definitions
+			DependencyGraph.Clear();
+			DependencyGraph.Offsets.Add(0);
+			List<int> lastUser;
+			lastUser.SetSize(Definitions.Count());
+			for (auto & id : lastUser)
+				id = -1;
+			List<ReferenceWorkItem> workList;
+			HashSet<ReferenceWorkItem> processedItems;
 			for (auto & comp : Definitions)
 			{
-				List<ReferenceWorkItem> workList;
-				for (auto & dep : GetDependentComponents(comp->SyntaxNode.Ptr()))
+				workList.Clear();
+				processedItems.Clear();
+				int compWorld = worldIds[comp->World]();
+				for (auto & dep : comp->GetSyntaxDependencies())
 				{
-					ReferenceWorkItem item;
-					item.Dependency = dep;
-					item.SourceWorld = dep.ImportOperator ? dep.ImportOperator->SourceWorld.Content : comp->World;
-					workList.Add(item);
+					int depComp;
+					if (!componentIds.TryGetValue(dep.ReferencedComponent, depComp))
+						continue;
+					workList.Add(ReferenceWorkItem(depComp, dep.ImportOperator ? worldIds[dep.ImportOperator->SourceWorld.Content.ToString()]() : compWorld,
+						dep.ImportOperator));
 				}
-				HashSet<ReferenceWorkItem> proceseedDefCompss;
 				for (int i = 0; i < workList.Count(); i++)
 				{
 					auto dep = workList[i];
-					if (!proceseedDefCompss.Add(dep))
+					if (!processedItems.Add(dep))
 						continue;
-					auto & depDefs = DefinitionsByComponent[dep.Dependency.ReferencedComponent]();
 					// select the best overload according to import operator ordering,
 					// prefer user-pinned definitions (as provided in the choice file)
-					List<String> depWorlds;
-					depWorlds.Add(dep.SourceWorld);
-					for (auto & w : Shader->Pipeline->WorldDependency[dep.SourceWorld]())
-						depWorlds.Add(w);
-					depWorlds.Add("<uniform>");
+					auto & depWorlds = getCandidateWorlds(dep.SourceWorld);
 					for (int pass = 0; pass < 2; pass++)
 					{
 						// in the first pass, examine the pinned definitions only
 						// in the second pass, examine all the rest definitions
-						for (auto & depWorld : depWorlds)
+						for (auto depWorld : depWorlds)
 						{
-							auto refComp = Shader->AllComponents[dep.Dependency.ReferencedComponent]();
-							bool isPinned = refComp.Symbol->Type->PinnedWorlds.Contains(depWorld);
+							int slot = dep.Component * worldCount + depWorld;
+							bool isPinned = pinnedDefinitions.Contains(slot);
 							if ((pass == 0 && !isPinned) || (pass == 1 && isPinned)) continue;
-							ComponentDefinitionIR * depDef;
-							if (depDefs.TryGetValue(depWorld, depDef))
+							if (auto depDef = definitionTable[slot])
 							{
-								comp->Dependency.Add(depDef);
-								depDef->Users.Add(comp.Ptr());
+								if (lastUser[depDef->Id] != comp->Id)
+								{
+									lastUser[depDef->Id] = comp->Id;
+									DependencyGraph.Targets.Add(depDef->Id);
+								}
 								// add additional dependencies due to import operators
 								auto processImportOperatorUsings = [&](ImportOperatorDefSyntaxNode * importOp)
 								{
@@ -171,19 +301,19 @@ namespace Spire
 										ComponentInstance refComp;
 										if (!Shader->AllComponents.TryGetValue(importUsing, refComp))
 											throw InvalidProgramException("import operator dependency not exists.");
-										ReferenceWorkItem workItem;
-										workItem.Dependency = ComponentDependency(refComp.Symbol->UniqueName, nullptr);
-										workItem.SourceWorld = importOp->SourceWorld.Content;
-										workList.Add(workItem);
+										int usingComp;
+										if (componentIds.TryGetValue(refComp.Symbol->UniqueName, usingComp))
+											workList.Add(ReferenceWorkItem(usingComp, worldIds[importOp->SourceWorld.Content.ToString()](), nullptr));
 									}
 								};
-								if (dep.Dependency.ImportOperator)
+								if (dep.ImportOperator)
 								{
-									processImportOperatorUsings(dep.Dependency.ImportOperator);
+									processImportOperatorUsings(dep.ImportOperator);
 								}
-								if (depWorld != dep.SourceWorld && depWorld != "<uniform>")
+								if (depWorld != dep.SourceWorld && depWorld != uniformWorld)
 								{
-									auto importPath = SymbolTable->FindImplicitImportOperatorChain(Shader->Pipeline, depWorld, dep.SourceWorld, refComp.Symbol->Type->DataType);
+									auto importPath = SymbolTable->FindImplicitImportOperatorChain(Shader->Pipeline, worldNames[depWorld], worldNames[dep.SourceWorld],
+										componentSymbols[dep.Component]->Type->DataType);
 									if (importPath.Count() == 0)
 										continue;
 									processImportOperatorUsings(importPath.First().Nodes.Last().ImportOperator);
@@ -194,7 +324,9 @@ namespace Spire
 					}
 				selectionEnd:;
 				}
+				DependencyGraph.Offsets.Add(DependencyGraph.Targets.Count());
 			}
+			UpdateDependencySets();
 		}
 		List<String> ShaderIR::GetComponentDependencyOrder()
 		{
@@ -244,6 +376,17 @@ namespace Spire
 			}
 			return result;
 		}
+		List<ComponentDependency> & ComponentDefinitionIR::GetSyntaxDependencies()
+		{
+			if (!hasSyntaxDependencies)
+			{
+				syntaxDependencies.Clear();
+				for (auto & dep : GetDependentComponents(SyntaxNode.Ptr()))
+					syntaxDependencies.Add(dep);
+				hasSyntaxDependencies = true;
+			}
+			return syntaxDependencies;
+		}
 		EnumerableHashSet<ComponentDefinitionIR*>& ComponentDefinitionIR::GetComponentFunctionDependencyClosure()
 		{
 			if (dependencyClosure.Count() || Dependency.Count() == 0)
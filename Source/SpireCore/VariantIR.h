@@ -8,6 +8,24 @@ namespace Spire
 	namespace Compiler
 	{
 		class ShaderClosure;
+		class ComponentDependency
+		{
+		public:
+			String ReferencedComponent;
+			ImportOperatorDefSyntaxNode * ImportOperator = nullptr;
+			ComponentDependency() = default;
+			ComponentDependency(String compName, ImportOperatorDefSyntaxNode * impOp)
+				: ReferencedComponent(compName), ImportOperator(impOp)
+			{}
+			int GetHashCode()
+			{
+				return ReferencedComponent.GetHashCode() ^ (int)(CoreLib::PtrInt)(void*)(ImportOperator);
+			}
+			bool operator == (const ComponentDependency & other)
+			{
+				return ReferencedComponent == other.ReferencedComponent && ImportOperator == other.ImportOperator;
+			}
+		};
 		class ModuleInstanceIR : public RefObject
 		{
 		public:
@@ -22,30 +40,75 @@ namespace Spire
 		{
 		private:
 			EnumerableHashSet<ComponentDefinitionIR *> dependencyClosure;
+			List<ComponentDependency> syntaxDependencies;
+			bool hasSyntaxDependencies = false;
 		public:
 			String OriginalName, UniqueName, UniqueKey;
+			// starts out as the syntax of the implementation the definition comes from, shared with the symbol
+			// and with the definitions of that implementation in other worlds; passes that change the syntax of
+			// one definition go through GetMutableSyntaxNode()
 			RefPtr<ComponentSyntaxNode> SyntaxNode;
+			bool OwnsSyntaxNode = false;
 			RefPtr<ExpressionType> Type;
 			ModuleInstanceIR * ModuleInstance = nullptr;
 			String World;
 			bool IsEntryPoint = false;
+			int Id = -1; // index of the definition in ShaderIR::Definitions, assigned when the dependency graph is built
 			EnumerableHashSet<ComponentDefinitionIR *> Users, Dependency; // Bidirectional dependency;
+			// components referenced by the syntax of the definition, collected once and kept until the syntax is changed
+			List<ComponentDependency> & GetSyntaxDependencies();
 			EnumerableHashSet<ComponentDefinitionIR *> & GetComponentFunctionDependencyClosure();
 			void ClearDependency()
 			{
 				Dependency.Clear();
 				dependencyClosure.Clear();
 			}
+			ComponentSyntaxNode * GetMutableSyntaxNode()
+			{
+				if (!OwnsSyntaxNode)
+				{
+					CloneContext cloneCtx;
+					SyntaxNode = SyntaxNode->Clone(cloneCtx);
+					OwnsSyntaxNode = true;
+				}
+				hasSyntaxDependencies = false;
+				return SyntaxNode.Ptr();
+			}
+		};
+
+		// adjacency lists of all definitions of a shader in compressed sparse row form, indexed by ComponentDefinitionIR::Id:
+		// the neighbours of definition i are Targets[Offsets[i]] ... Targets[Offsets[i + 1] - 1]
+		class ComponentAdjacency
+		{
+		public:
+			List<int> Offsets, Targets;
+			ArrayView<int> operator [](int id) const
+			{
+				return Targets.GetArrayView(Offsets[id], Offsets[id + 1] - Offsets[id]);
+			}
+			void Clear()
+			{
+				Offsets.Clear();
+				Targets.Clear();
+			}
 		};
 
 		class ShaderIR : public RefObject
 		{
+		private:
+			void BuildDependencyGraph();
+			void UpdateDependencySets();
 		public:
 			ShaderClosure * Shader;
 			SymbolTable * SymbolTable;
 			List<RefPtr<ModuleInstanceIR>> ModuleInstances;
 			List<RefPtr<ComponentDefinitionIR>> Definitions;
 			EnumerableDictionary<String, EnumerableDictionary<String, ComponentDefinitionIR*>> DefinitionsByComponent;
+			// component unique name => worlds whose definitions are preferred in this variant, as pinned in the source or chosen by the schedule
+			EnumerableDictionary<String, EnumerableHashSet<String>> PinnedWorlds;
+			// Dependency and Users of all definitions as built by ResolveComponentReference; passes that edit the
+			// per-definition sets afterwards clear the graph, and it is rebuilt from the sets when needed again
+			ComponentAdjacency DependencyGraph, UserGraph;
 			void EliminateDeadCode(); // returns remaining definitions in reverse dependency order
 			void ResolveComponentReference(); // resolve reference and build dependency map
 			List<String> GetComponentDependencyOrder(); // returns a list of all components' unique names in dependency order
@@ -67,6 +130,8 @@ namespace Spire
 						if (shouldRemove(def.Value))
 							kv.Value.Remove(def.Key);
 				}
+				DependencyGraph.Clear();
+				UserGraph.Clear();
 			}
 
 		};
@@ -0,0 +1,144 @@
+#include "ShaderCache.h"
+#include "SpireLib.h"
+#include "../CoreLib/LibIO.h"
+#include "../SpireCore/StdInclude.h"
+#include <stdio.h>
+#include <random>
+
+using namespace CoreLib::Basic;
+using namespace CoreLib::IO;
+using namespace Spire::Compiler;
+
+namespace SpireLib
+{
+	const int ShaderCache::FormatVersion;
+
+	String ShaderCache::GetCompilerIdentity()
+	{
+		static String identity = []()
+		{
+			ContentHash hash;
+			hash.Append(ShaderCache::FormatVersion);
+			hash.Append(String(GetCompilerBuildId()));
+			hash.Append(SpireStdLib::GetCode());
+			return hash.ProduceString();
+		}();
+		return identity;
+	}
+	const int ShaderCacheMagic = 0x45435053; // "SPCE"
+
+	void WriteCacheString(BinaryWriter & writer, const String & str)
+	{
+		writer.Write(str.Length());
+		if (str.Length())
+			writer.Write(str.Buffer(), str.Length());
+	}
+
+	String ReadCacheString(BinaryReader & reader)
+	{
+		int length = reader.ReadInt32();
+		if (length == 0)
+			return String();
+		List<char> buffer;
+		buffer.SetSize(length + 1);
+		reader.Read(buffer.Buffer(), length);
+		buffer[length] = 0;
+		return String(buffer.Buffer());
+	}
+
+	ShaderCache::ShaderCache(const String & dir)
+	{
+		directory = dir;
+		std::random_device random;
+		tempFileTag = String(random(), 16) + String(random(), 16);
+		if (directory.Length() && !File::Exists(directory))
+			Path::CreateDir(directory);
+	}
+
+	String ShaderCache::GetEntryFileName(const String & key)
+	{
+		return Path::Combine(directory, key + ".spcache");
+	}
+
+	bool ShaderCache::TryLoad(const String & key, ShaderCacheEntry & entry)
+	{
+		auto fileName = GetEntryFileName(key);
+		if (!File::Exists(fileName))
+			return false;
+		try
+		{
+			BinaryReader reader(new FileStream(fileName, FileMode::Open, FileAccess::Read, FileShare::ReadWrite));
+			if (reader.ReadInt32() != ShaderCacheMagic || reader.ReadInt32() != FormatVersion)
+				return false;
+			int dependencyCount = reader.ReadInt32();
+			for (int i = 0; i < dependencyCount; i++)
+			{
+				auto path = ReadCacheString(reader);
+				auto hash = ReadCacheString(reader);
+				if (!File::Exists(path) || ContentHash::Compute(File::ReadAllText(path)) != hash)
+					return false;
+				entry.Dependencies[path] = hash;
+			}
+			int shaderCount = reader.ReadInt32();
+			for (int i = 0; i < shaderCount; i++)
+			{
+				// each shader is stored in the binary .cse form
+				List<unsigned char> buffer;
+				buffer.SetSize(reader.ReadInt32());
+				reader.Read(buffer.Buffer(), buffer.Count());
+				ShaderLibFile libFile;
+				libFile.FromBinary(buffer.Buffer(), buffer.Count());
+				CompiledShaderSource src;
+				src.MetaData = libFile.MetaData;
+				src.Stages = _Move(libFile.Sources);
+				entry.Sources[src.MetaData.ShaderName] = src;
+			}
+			return true;
+		}
+		catch (const Exception &)
+		{
+			entry = ShaderCacheEntry();
+			return false;
+		}
+	}
+
+	void ShaderCache::Store(const String & key, const ShaderCacheEntry & entry)
+	{
+		auto fileName = GetEntryFileName(key);
+		// write to a temporary file first so that a concurrent reader never observes a partial entry;
+		// concurrent writers of the same entry each use their own temporary file
+		auto tempFileName = fileName + "." + tempFileTag + "." + String(tempFileCounter++) + ".tmp";
+		try
+		{
+			BinaryWriter writer(new FileStream(tempFileName, FileMode::Create));
+			writer.Write(ShaderCacheMagic);
+			writer.Write(FormatVersion);
+			writer.Write(entry.Dependencies.Count());
+			for (auto & dep : entry.Dependencies)
+			{
+				WriteCacheString(writer, dep.Key);
+				WriteCacheString(writer, dep.Value);
+			}
+			writer.Write(entry.Sources.Count());
+			for (auto & src : entry.Sources)
+			{
+				ShaderLibFile libFile;
+				libFile.MetaData = src.Value.MetaData;
+				libFile.Sources = src.Value.Stages;
+				List<unsigned char> buffer;
+				libFile.ToBinary(buffer);
+				writer.Write(buffer.Count());
+				writer.Write(buffer.Buffer(), buffer.Count());
+			}
+			writer.Close();
+		}
+		catch (const Exception &)
+		{
+			remove(tempFileName.Buffer());
+			return;
+		}
+		// an entry stored concurrently by another writer is replaced, never removed first
+		if (!File::Replace(tempFileName, fileName))
+			remove(tempFileName.Buffer());
+	}
+}
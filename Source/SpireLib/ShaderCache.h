@@ -0,0 +1,43 @@
+#ifndef SPIRE_LIB_SHADER_CACHE_H
+#define SPIRE_LIB_SHADER_CACHE_H
+
+#include "../CoreLib/Basic.h"
+#include "../SpireCore/CompiledProgram.h"
+#include "../SpireCore/ContentHash.h"
+
+namespace SpireLib
+{
+	using Spire::Compiler::ContentHash;
+
+	class ShaderCacheEntry
+	{
+	public:
+		// files read from disk while compiling (`using` and `#include`), mapped to their content hash
+		CoreLib::Basic::EnumerableDictionary<CoreLib::Basic::String, CoreLib::Basic::String> Dependencies;
+		CoreLib::Basic::EnumerableDictionary<CoreLib::Basic::String, Spire::Compiler::CompiledShaderSource> Sources;
+	};
+
+	// Persistent on-disk store of compiled shader variants, one file per key under `directory`.
+	class ShaderCache
+	{
+	private:
+		CoreLib::Basic::String directory;
+		// random for each cache object, so that caches in other contexts and processes sharing `directory`
+		// name their temporary files differently
+		CoreLib::Basic::String tempFileTag;
+		std::atomic<int> tempFileCounter{0};
+		CoreLib::Basic::String GetEntryFileName(const CoreLib::Basic::String & key);
+	public:
+		// bump whenever the entry layout or the generated code changes in an incompatible way
+		static const int FormatVersion = 3;
+		ShaderCache(const CoreLib::Basic::String & dir);
+		// hash of the compiler build and of the standard library it compiles with, part of every key
+		static CoreLib::Basic::String GetCompilerIdentity();
+		// returns false if there is no entry for `key`, the entry is unreadable,
+		// or any of the files it depends on changed since the entry was written
+		bool TryLoad(const CoreLib::Basic::String & key, ShaderCacheEntry & entry);
+		void Store(const CoreLib::Basic::String & key, const ShaderCacheEntry & entry);
+	};
+}
+
+#endif
@@ -1,10 +1,13 @@
 #include "SpireLib.h"
+#include "ShaderCache.h"
 #include "../CoreLib/LibIO.h"
 #include "../CoreLib/Tokenizer.h"
 #include "../SpireCore/StdInclude.h"
 #include "../../Spire.h"
 #include "../SpireCore/TypeLayout.h"
 #include "../SpireCore/Preprocessor.h"
+#include "../SpireCore/CompileUnitCache.h"
+#include <thread>
 
 using namespace CoreLib::Basic;
 using namespace CoreLib::IO;
@@ -13,7 +16,7 @@ using namespace Spire::Compiler;
 
 struct SpireDiagnosticSink
 {
-	int errorCount;
+	int errorCount = 0;
 	CoreLib::List<Spire::Compiler::Diagnostic> diagnostics;
 };
 
@@ -75,10 +78,63 @@ struct SpireModule
 	Dictionary<String, String> Attribs;
 	List<RefPtr<SpireModule>> SubModules;
 	CompilerState * State = nullptr;
-	static int IdAllocator;
+	// values of the specialization parameters of the module this module is a specialization of
+	List<int> SpecializationValues;
+	static std::atomic<int> IdAllocator;
+};
+
+std::atomic<int> SpireModule::IdAllocator{0};
+
+// Identifies a specialization of a module by the module's id and the values of its specialization
+// parameters. The values are not copied: a key used for lookup points to the caller's array, and a
+// stored key to the SpecializationValues of the specialized module.
+struct ModuleSpecializationKey
+{
+	int ModuleId = 0;
+	int ValueCount = 0;
+	const int * Values = nullptr;
+	int HashCode = 0;
+	ModuleSpecializationKey() = default;
+	ModuleSpecializationKey(int moduleId, const int * values, int valueCount)
+	{
+		ModuleId = moduleId;
+		Values = values;
+		ValueCount = valueCount;
+		unsigned int hash = (unsigned int)moduleId;
+		for (int i = 0; i < valueCount; i++)
+			hash = (hash ^ (unsigned int)values[i]) * 16777619u;
+		HashCode = (int)hash;
+	}
+	int GetHashCode() const
+	{
+		return HashCode;
+	}
+	bool operator == (const ModuleSpecializationKey & other) const
+	{
+		return ModuleId == other.ModuleId && ValueCount == other.ValueCount &&
+			memcmp(Values, other.Values, sizeof(int) * ValueCount) == 0;
+	}
 };
 
-int SpireModule::IdAllocator = 0;
+// Looks for `fileName` in each of `dirs` in turn. Returns nullptr if it is in none of them.
+static RefPtr<SourceFile> FindSourceFile(SourceFileCache & sourceFiles, const List<String> & dirs, const String & fileName)
+{
+	for (auto & dir : dirs)
+	{
+		if (auto file = sourceFiles.Load(Path::Combine(dir, fileName)))
+			return file;
+	}
+	return nullptr;
+}
+
+// Reads a file found earlier by FindSourceFile
+static String ReadSourceFile(SourceFileCache & sourceFiles, const String & fileName)
+{
+	auto file = sourceFiles.Load(fileName);
+	if (!file)
+		throw IOException("Cannot open file '" + fileName + "'");
+	return file->Text;
+}
 
 namespace SpireLib
 {
@@ -193,32 +249,20 @@ namespace SpireLib
 		struct IncludeHandlerImpl : IncludeHandler
 		{
 			List<String> searchDirs;
+			SourceFileCache sourceFiles;
 
-			virtual bool TryToFindIncludeFile(
+			virtual RefPtr<SourceFile> TryToFindIncludeFile(
 				CoreLib::String const& pathToInclude,
-				CoreLib::String const& pathIncludedFrom,
-				CoreLib::String* outFoundPath,
-				CoreLib::String* outFoundSource) override
+				CoreLib::String const& pathIncludedFrom) override
 			{
-				String path = Path::Combine(Path::GetDirectoryName(pathIncludedFrom), pathToInclude);
-				if (File::Exists(path))
-				{
-					*outFoundPath = path;
-					*outFoundSource = File::ReadAllText(path);
-					return true;
-				}
-
-				for (auto & dir : searchDirs)
-				{
-					path = Path::Combine(dir, pathToInclude);
-					if (File::Exists(path))
-					{
-						*outFoundPath = path;
-						*outFoundSource = File::ReadAllText(path);
-						return true;
-					}
-				}
-				return false;
+				auto file = sourceFiles.Load(Path::Combine(Path::GetDirectoryName(pathIncludedFrom), pathToInclude));
+				if (!file)
+					file = FindSourceFile(sourceFiles, searchDirs, pathToInclude);
+				return file;
+			}
+			virtual SourceFileCache * GetSourceFileCache() override
+			{
+				return &sourceFiles;
 			}
 
 		};
@@ -244,28 +288,21 @@ namespace SpireLib
 			{
 				String source = src;
 				if (i > 0)
-					source = File::ReadAllText(inputFileName);
+					source = ReadSourceFile(includeHandler.sourceFiles, inputFileName);
 				auto unit = compiler->Parse(compileResult, source, inputFileName, &includeHandler, options.PreprocessorDefinitions);
 				units.Add(unit);
 				if (unit.SyntaxNode)
 				{
 					for (auto inc : unit.SyntaxNode->GetUsings())
 					{
-						bool found = false;
-						for (auto & dir : searchDirs)
+						if (auto file = FindSourceFile(includeHandler.sourceFiles, searchDirs, inc->fileName.Content))
 						{
-							String includeFile = Path::Combine(dir, inc->fileName.Content);
-							if (File::Exists(includeFile))
+							if (processedUnits.Add(file->FileName))
 							{
-								if (processedUnits.Add(includeFile))
-								{
-									unitsToInclude.Add(includeFile);
-								}
-								found = true;
-								break;
+								unitsToInclude.Add(file->FileName);
 							}
 						}
-						if (!found)
+						else
 						{
 							compileResult.GetErrorWriter()->diagnose(inc->fileName.Position, Diagnostics::cannotFindFile, inc->fileName);
 						}
@@ -310,7 +347,21 @@ namespace SpireLib
 		for (auto & ublock : MetaData.ParameterSets)
 		{
 			writer << "paramset \"" << ublock.Key << "\" size " << ublock.Value->BufferSize
-				<< " binding " << ublock.Value->DescriptorSetId << "\n{\n";
+				<< " binding " << ublock.Value->DescriptorSetId;
+			if (ublock.Value->IsTopLevel)
+				writer << " toplevel";
+			writer << " legacybinding " << ublock.Value->UniformBufferLegacyBindingPoint
+				<< " offset " << ublock.Value->UniformBufferOffset
+				<< " start(" << ublock.Value->TextureBindingStartIndex << " " << ublock.Value->SamplerBindingStartIndex << " "
+				<< ublock.Value->StorageBufferBindingStartIndex << " " << ublock.Value->UniformBindingStartIndex << ")";
+			if (ublock.Value->SubModules.Count())
+			{
+				writer << " submodules(";
+				for (auto & submodule : ublock.Value->SubModules)
+					writer << "\"" << submodule->BindingName << "\" ";
+				writer << ")";
+			}
+			writer << "\n{\n";
 			for (auto & entry : ublock.Value->Parameters)
 			{
 				writer << entry.Value->Name << "(\"" << entry.Key << "\") : ";
@@ -325,9 +376,7 @@ namespace SpireLib
 				}
 				else
 				{
-                    // TODO(tfoley): Should use the correct layout rule here, and not assume `Std140`
-					writer << "buffer(" << entry.Value->BufferOffset << ", "
-						<< (int)GetTypeSize(entry.Value->Type.Ptr(), LayoutRule::Std140) << ")";
+					writer << "buffer(" << entry.Value->BufferOffset << ", " << entry.Value->Size << ")";
 				}
 				writer << ";\n";
 			}
@@ -377,6 +426,8 @@ namespace SpireLib
 	{
 		Clear();
 		CoreLib::Text::TokenReader parser(src);
+		// sub parameter sets are referenced by binding name and resolved once all sets are read
+		EnumerableDictionary<String, List<String>> subModuleNames;
 		while (!parser.IsEnd())
 		{
 			auto fieldName = parser.ReadWord();
@@ -404,6 +455,41 @@ namespace SpireLib
 					parser.ReadToken();
 					paramSet->DescriptorSetId = parser.ReadInt();
 				}
+				if (parser.LookAhead("toplevel"))
+				{
+					parser.ReadToken();
+					paramSet->IsTopLevel = true;
+				}
+				if (parser.LookAhead("legacybinding"))
+				{
+					parser.ReadToken();
+					paramSet->UniformBufferLegacyBindingPoint = parser.ReadInt();
+				}
+				if (parser.LookAhead("offset"))
+				{
+					parser.ReadToken();
+					paramSet->UniformBufferOffset = parser.ReadInt();
+				}
+				if (parser.LookAhead("start"))
+				{
+					parser.ReadToken();
+					parser.Read("(");
+					paramSet->TextureBindingStartIndex = parser.ReadInt();
+					paramSet->SamplerBindingStartIndex = parser.ReadInt();
+					paramSet->StorageBufferBindingStartIndex = parser.ReadInt();
+					paramSet->UniformBindingStartIndex = parser.ReadInt();
+					parser.Read(")");
+				}
+				if (parser.LookAhead("submodules"))
+				{
+					parser.ReadToken();
+					parser.Read("(");
+					List<String> names;
+					while (!parser.LookAhead(")"))
+						names.Add(parser.ReadStringLiteral());
+					parser.Read(")");
+					subModuleNames[paramSet->BindingName] = names;
+				}
 				parser.Read("{");
 				while (!parser.LookAhead("}"))
 				{
@@ -412,6 +498,8 @@ namespace SpireLib
 					parser.Read("(");
 					auto key = parser.ReadStringLiteral();
 					parser.Read(")");
+					if (parser.LookAhead(":"))
+						parser.ReadToken();
 					inst->Type = ILType::Deserialize(parser);
 					parser.Read("at");
 					if (parser.LookAhead("binding"))
@@ -427,18 +515,335 @@ namespace SpireLib
 						parser.Read("buffer");
 						parser.Read("(");
 						inst->BufferOffset = parser.ReadInt();
+						if (parser.LookAhead(","))
+						{
+							parser.ReadToken();
+							inst->Size = parser.ReadInt();
+						}
 						parser.Read(")");
 					}
+					if (parser.LookAhead(";"))
+						parser.ReadToken();
+					inst->Module = paramSet.Ptr();
 					paramSet->Parameters.Add(key, inst);
 				}
 				parser.Read("}");
 				MetaData.ParameterSets.Add(paramSet->BindingName, paramSet);
 			}
 		}
+		for (auto & set : subModuleNames)
+		{
+			auto paramSet = MetaData.ParameterSets[set.Key]();
+			for (auto & name : set.Value)
+			{
+				RefPtr<ILModuleParameterSet> subModule;
+				if (MetaData.ParameterSets.TryGetValue(name, subModule))
+					paramSet->SubModules.Add(subModule);
+			}
+		}
+	}
+
+	// The binary form holds the same fields as the text form, in the same order. Integers are 32-bit in native
+	// byte order, strings are prefixed by their length in bytes, and IL types are a tag followed by their fields.
+	const int ShaderLibBinaryMagic = 0x45534353; // "SCSE"
+	const int ShaderLibBinaryVersion = 1;
+
+	enum class BinaryTypeTag
+	{
+		Basic, Struct, Array, Generic, Record
+	};
+
+	class ShaderLibBinaryWriter
+	{
+	public:
+		List<unsigned char> & Buffer;
+		ShaderLibBinaryWriter(List<unsigned char> & buffer)
+			: Buffer(buffer)
+		{}
+		void WriteInt(int value)
+		{
+			Buffer.AddRange((unsigned char*)&value, sizeof(int));
+		}
+		void WriteString(const String & str)
+		{
+			WriteInt(str.Length());
+			Buffer.AddRange((const unsigned char*)str.Buffer(), str.Length());
+		}
+		void WriteType(ILType * type)
+		{
+			if (auto basicType = dynamic_cast<ILBasicType*>(type))
+			{
+				WriteInt((int)BinaryTypeTag::Basic);
+				WriteInt((int)basicType->Type);
+			}
+			else if (auto structType = dynamic_cast<ILStructType*>(type))
+			{
+				WriteInt((int)BinaryTypeTag::Struct);
+				WriteString(structType->TypeName);
+				WriteInt(structType->IsIntrinsic ? 1 : 0);
+				WriteInt(structType->Members.Count());
+				for (auto & member : structType->Members)
+				{
+					WriteString(member.FieldName);
+					WriteType(member.Type.Ptr());
+				}
+			}
+			else if (auto arrayType = dynamic_cast<ILArrayType*>(type))
+			{
+				WriteInt((int)BinaryTypeTag::Array);
+				WriteType(arrayType->BaseType.Ptr());
+				WriteInt(arrayType->ArrayLength);
+			}
+			else if (auto genericType = dynamic_cast<ILGenericType*>(type))
+			{
+				WriteInt((int)BinaryTypeTag::Generic);
+				WriteString(genericType->GenericTypeName);
+				WriteType(genericType->BaseType.Ptr());
+			}
+			else if (auto recordType = dynamic_cast<ILRecordType*>(type))
+			{
+				WriteInt((int)BinaryTypeTag::Record);
+				WriteString(recordType->TypeName);
+			}
+			else
+				throw NotSupportedException("Cannot serialize IL type '" + type->ToString() + "'.");
+		}
+	};
+
+	// Reads the binary form directly from memory; throws an IOException if the data ends early or is malformed.
+	class ShaderLibBinaryReader
+	{
+	private:
+		const unsigned char * data;
+		int size;
+		int pos = 0;
+		void Require(int length)
+		{
+			if (length < 0 || length > size - pos)
+				throw IOException("Invalid or truncated shader library data.");
+		}
+	public:
+		ShaderLibBinaryReader(const unsigned char * _data, int _size)
+			: data(_data), size(_size)
+		{}
+		int ReadInt()
+		{
+			Require(sizeof(int));
+			int value;
+			memcpy(&value, data + pos, sizeof(int));
+			pos += sizeof(int);
+			return value;
+		}
+		String ReadString()
+		{
+			int length = ReadInt();
+			Require(length);
+			if (length == 0)
+				return String();
+			RefPtr<char, RefPtrArrayDestructor> buffer = new char[length + 1];
+			memcpy(buffer.Ptr(), data + pos, length);
+			buffer[length] = 0;
+			pos += length;
+			return String::FromBuffer(buffer, length);
+		}
+		void ReadBytes(List<unsigned char> & bytes)
+		{
+			int length = ReadInt();
+			Require(length);
+			bytes.Clear();
+			bytes.AddRange(data + pos, length);
+			pos += length;
+		}
+		RefPtr<ILType> ReadType()
+		{
+			switch ((BinaryTypeTag)ReadInt())
+			{
+			case BinaryTypeTag::Basic:
+				return new ILBasicType((ILBaseType)ReadInt());
+			case BinaryTypeTag::Struct:
+			{
+				RefPtr<ILStructType> rs = new ILStructType();
+				rs->TypeName = ReadString();
+				rs->IsIntrinsic = ReadInt() != 0;
+				int memberCount = ReadInt();
+				for (int i = 0; i < memberCount; i++)
+				{
+					ILStructType::ILStructField field;
+					field.FieldName = ReadString();
+					field.Type = ReadType();
+					rs->Members.Add(field);
+				}
+				return rs;
+			}
+			case BinaryTypeTag::Array:
+			{
+				RefPtr<ILArrayType> rs = new ILArrayType();
+				rs->BaseType = ReadType();
+				rs->ArrayLength = ReadInt();
+				return rs;
+			}
+			case BinaryTypeTag::Generic:
+			{
+				RefPtr<ILGenericType> rs = new ILGenericType();
+				rs->GenericTypeName = ReadString();
+				rs->BaseType = ReadType();
+				return rs;
+			}
+			case BinaryTypeTag::Record:
+			{
+				RefPtr<ILRecordType> rs = new ILRecordType();
+				rs->TypeName = ReadString();
+				return rs;
+			}
+			default:
+				throw IOException("Invalid IL type in shader library data.");
+			}
+		}
+	};
+
+	void ShaderLibFile::ToBinary(List<unsigned char> & buffer)
+	{
+		ShaderLibBinaryWriter writer(buffer);
+		writer.WriteInt(ShaderLibBinaryMagic);
+		writer.WriteInt(ShaderLibBinaryVersion);
+		writer.WriteString(MetaData.ShaderName);
+		writer.WriteInt(MetaData.ParameterSets.Count());
+		for (auto & ublock : MetaData.ParameterSets)
+		{
+			auto paramSet = ublock.Value.Ptr();
+			writer.WriteString(ublock.Key);
+			writer.WriteInt(paramSet->BufferSize);
+			writer.WriteInt(paramSet->DescriptorSetId);
+			writer.WriteInt(paramSet->IsTopLevel ? 1 : 0);
+			writer.WriteInt(paramSet->UniformBufferLegacyBindingPoint);
+			writer.WriteInt(paramSet->UniformBufferOffset);
+			writer.WriteInt(paramSet->TextureBindingStartIndex);
+			writer.WriteInt(paramSet->SamplerBindingStartIndex);
+			writer.WriteInt(paramSet->StorageBufferBindingStartIndex);
+			writer.WriteInt(paramSet->UniformBindingStartIndex);
+			writer.WriteInt(paramSet->SubModules.Count());
+			for (auto & submodule : paramSet->SubModules)
+				writer.WriteString(submodule->BindingName);
+			writer.WriteInt(paramSet->Parameters.Count());
+			for (auto & entry : paramSet->Parameters)
+			{
+				writer.WriteString(entry.Key);
+				writer.WriteString(entry.Value->Name);
+				writer.WriteType(entry.Value->Type.Ptr());
+				writer.WriteInt(entry.Value->BufferOffset);
+				writer.WriteInt(entry.Value->Size);
+				writer.WriteInt(entry.Value->BindingPoints.Count());
+				for (auto binding : entry.Value->BindingPoints)
+					writer.WriteInt(binding);
+			}
+		}
+		writer.WriteInt(Sources.Count());
+		for (auto & src : Sources)
+		{
+			writer.WriteString(src.Key);
+			writer.WriteInt(src.Value.BinaryCode.Count());
+			buffer.AddRange(src.Value.BinaryCode);
+			writer.WriteString(src.Value.MainCode);
+		}
+	}
+
+	bool ShaderLibFile::IsBinary(const unsigned char * data, int size)
+	{
+		int magic = 0;
+		if (size >= (int)sizeof(int))
+			memcpy(&magic, data, sizeof(int));
+		return magic == ShaderLibBinaryMagic;
+	}
+
+	void ShaderLibFile::FromBinary(const unsigned char * data, int size)
+	{
+		Clear();
+		ShaderLibBinaryReader reader(data, size);
+		if (reader.ReadInt() != ShaderLibBinaryMagic)
+			throw IOException("Not a binary shader library.");
+		if (reader.ReadInt() != ShaderLibBinaryVersion)
+			throw IOException("Unsupported binary shader library version.");
+		MetaData.ShaderName = reader.ReadString();
+		EnumerableDictionary<String, List<String>> subModuleNames;
+		int paramSetCount = reader.ReadInt();
+		for (int i = 0; i < paramSetCount; i++)
+		{
+			RefPtr<ILModuleParameterSet> paramSet = new ILModuleParameterSet();
+			paramSet->BindingName = reader.ReadString();
+			paramSet->BufferSize = reader.ReadInt();
+			paramSet->DescriptorSetId = reader.ReadInt();
+			paramSet->IsTopLevel = reader.ReadInt() != 0;
+			paramSet->UniformBufferLegacyBindingPoint = reader.ReadInt();
+			paramSet->UniformBufferOffset = reader.ReadInt();
+			paramSet->TextureBindingStartIndex = reader.ReadInt();
+			paramSet->SamplerBindingStartIndex = reader.ReadInt();
+			paramSet->StorageBufferBindingStartIndex = reader.ReadInt();
+			paramSet->UniformBindingStartIndex = reader.ReadInt();
+			int subModuleCount = reader.ReadInt();
+			if (subModuleCount)
+			{
+				List<String> names;
+				for (int j = 0; j < subModuleCount; j++)
+					names.Add(reader.ReadString());
+				subModuleNames[paramSet->BindingName] = names;
+			}
+			int paramCount = reader.ReadInt();
+			for (int j = 0; j < paramCount; j++)
+			{
+				RefPtr<ILModuleParameterInstance> inst = new ILModuleParameterInstance();
+				auto key = reader.ReadString();
+				inst->Name = reader.ReadString();
+				inst->Type = reader.ReadType();
+				inst->BufferOffset = reader.ReadInt();
+				inst->Size = reader.ReadInt();
+				int bindingCount = reader.ReadInt();
+				for (int k = 0; k < bindingCount; k++)
+					inst->BindingPoints.Add(reader.ReadInt());
+				inst->Module = paramSet.Ptr();
+				paramSet->Parameters.Add(key, inst);
+			}
+			MetaData.ParameterSets.Add(paramSet->BindingName, paramSet);
+		}
+		for (auto & set : subModuleNames)
+		{
+			auto paramSet = MetaData.ParameterSets[set.Key]();
+			for (auto & name : set.Value)
+			{
+				RefPtr<ILModuleParameterSet> subModule;
+				if (MetaData.ParameterSets.TryGetValue(name, subModule))
+					paramSet->SubModules.Add(subModule);
+			}
+		}
+		int stageCount = reader.ReadInt();
+		for (int i = 0; i < stageCount; i++)
+		{
+			auto worldName = reader.ReadString();
+			StageSource compiledSrc;
+			reader.ReadBytes(compiledSrc.BinaryCode);
+			compiledSrc.MainCode = reader.ReadString();
+			Sources[worldName] = _Move(compiledSrc);
+		}
+	}
+
+	void ShaderLibFile::SaveToBinaryFile(CoreLib::Basic::String fileName)
+	{
+		List<unsigned char> buffer;
+		ToBinary(buffer);
+		BinaryWriter writer(new FileStream(fileName, FileMode::Create));
+		writer.Write(buffer.Buffer(), buffer.Count());
 	}
 
 	void ShaderLibFile::Load(String fileName)
 	{
+		// binary files are read in place from the mapped file; text files go through the tokenizer
+		{
+			MemoryMappedFile file(fileName);
+			if (IsBinary(file.GetBuffer(), (int)file.GetSize()))
+			{
+				FromBinary(file.GetBuffer(), (int)file.GetSize());
+				return;
+			}
+		}
 		String src = File::ReadAllText(fileName);
 		FromString(src);
 	}
@@ -468,7 +873,7 @@ public:
 	RefPtr<Decl> Syntax;
 	Shader(String name, String source)
 	{
-		static int idAllocator = 0;
+		static std::atomic<int> idAllocator{0};
 		Id = idAllocator++;
 		shaderName = name;
 		src = source;
@@ -488,14 +893,20 @@ class CompileResult
 public:
 	CoreLib::EnumerableDictionary<String, CompiledShaderSource> Sources;
 	CoreLib::EnumerableDictionary<String, List<SpireParameterSet>> ParamSets;
-
+	CoreLib::EnumerableDictionary<String, ShaderCostEstimate> CostEstimates;
+	Spire::Compiler::CompileStats Stats;
+	bool LoadedFromCache = false;
 };
 
 struct CompilerState : public RefObject
 {
 	List<CompileUnit> moduleUnits;
 	HashSet<String> processedModuleUnits;
+	// file name and source of everything loaded through LoadModuleSource, in load order
+	List<KeyValuePair<String, String>> loadedSources;
 	EnumerableDictionary<String, RefPtr<SpireModule>> modules;
+	// specializations created from the modules of this state
+	Dictionary<ModuleSpecializationKey, RefPtr<SpireModule>> specializations;
 	EnumerableDictionary<String, RefPtr<Shader>> shaders;
 	RefPtr<Spire::Compiler::CompilationContext> context;
 	RefPtr<CompilerState> Parent;
@@ -503,6 +914,17 @@ struct CompilerState : public RefObject
 	int Version = 0;
 	// the version of parent states cached in this state
 	int CachedParentVersion = 0;
+	// digest of all sources loaded into this state, used to key the on-disk shader cache
+	String SourceKey;
+	String GetSourceKey()
+	{
+		if (!Parent)
+			return SourceKey;
+		ContentHash hash;
+		hash.Append(Parent->GetSourceKey());
+		hash.Append(SourceKey);
+		return hash.ProduceString();
+	}
 	void Update() // update this state to include latest version of parent
 	{
 		if (Parent)
@@ -525,14 +947,19 @@ struct CompilerState : public RefObject
 	CompilerState(RefPtr<CompilerState> parent)
 	{
 		this->Parent = parent;
-
-		// Do the ugly thing to copy parent's symbol table to child
-		if (parent)
-			context = new Spire::Compiler::CompilationContext(*parent->context);
+		ForkParentContext();
 	}
-	~CompilerState()
+	// start over from the parent's context (or an empty one), forgetting everything loaded into this state
+	void ForkParentContext()
 	{
-		printf("break");
+		context = new Spire::Compiler::CompilationContext();
+		if (Parent)
+		{
+			// symbols are shared with the parent rather than copied, and the parent's program (and with it
+			// the constant pool of the functions inherited from it) is kept alive through `Parent`
+			context->Fork(Parent->context.Ptr());
+			CachedParentVersion = Parent->Version;
+		}
 	}
 };
 
@@ -552,36 +979,36 @@ public:
 
 	List<RefPtr<::CompilerState>> states;
 	RefPtr<ShaderCompiler> compiler;
+	RefPtr<ShaderCache> cache;
 
 	struct IncludeHandlerImpl : IncludeHandler
 	{
 		List<String> searchDirs;
-
-		virtual bool TryToFindIncludeFile(
+		// if set, records the content hash of every file that gets included
+		EnumerableDictionary<String, String> * dependencies = nullptr;
+		// files read by this context, shared with its batch workers
+		RefPtr<SourceFileCache> sourceFiles = new SourceFileCache();
+		// files parsed by this context, shared with its batch workers
+		RefPtr<CompileUnitCache> compileUnits = new CompileUnitCache();
+
+		virtual RefPtr<SourceFile> TryToFindIncludeFile(
 			CoreLib::String const& pathToInclude,
-			CoreLib::String const& pathIncludedFrom,
-			CoreLib::String* outFoundPath,
-			CoreLib::String* outFoundSource) override
+			CoreLib::String const& pathIncludedFrom) override
 		{
-			String path = Path::Combine(Path::GetDirectoryName(pathIncludedFrom), pathToInclude);
-			if (File::Exists(path))
-			{
-				*outFoundPath = path;
-				*outFoundSource = File::ReadAllText(path);
-				return true;
-			}
-
-			for (auto & dir : searchDirs)
-			{
-				path = Path::Combine(dir, pathToInclude);
-				if (File::Exists(path))
-				{
-					*outFoundPath = path;
-					*outFoundSource = File::ReadAllText(path);
-					return true;
-				}
-			}
-			return false;
+			auto file = sourceFiles->Load(Path::Combine(Path::GetDirectoryName(pathIncludedFrom), pathToInclude));
+			if (!file)
+				file = FindSourceFile(*sourceFiles, searchDirs, pathToInclude);
+			if (file && dependencies)
+				(*dependencies)[file->FileName] = ContentHash::Compute(file->Text);
+			return file;
+		}
+		virtual SourceFileCache * GetSourceFileCache() override
+		{
+			return sourceFiles.Ptr();
+		}
+		virtual CompileUnitCache * GetCompileUnitCache() override
+		{
+			return compileUnits.Ptr();
 		}
 	};
 	IncludeHandlerImpl includeHandler;
@@ -589,11 +1016,14 @@ public:
 public:
 	CompileOptions Options;
 
-	CompilationContext(bool /*pUseCache*/, CoreLib::String /*pCacheDir*/)
+	CompilationContext(bool pUseCache, CoreLib::String pCacheDir)
 	{
+		useCache = pUseCache;
+		cacheDir = pCacheDir;
+		if (useCache)
+			cache = new ShaderCache(cacheDir);
 		compiler = CreateShaderCompiler();
-		states.Add(new ::CompilerState());
-		LoadModuleSource(states.First().Ptr(), SpireStdLib::GetCode(), "stdlib", NULL);
+		states.Add(new ::CompilerState(GetStdLibState()));
 	}
 
 	~CompilationContext()
@@ -601,6 +1031,40 @@ public:
 		SpireStdLib::Finalize();
 	}
 
+private:
+	struct StdLibTag {};
+	CompilationContext(StdLibTag)
+	{
+		compiler = CreateShaderCompiler();
+		states.Add(new ::CompilerState());
+		LoadModuleSource(states.First().Ptr(), SpireStdLib::GetCode(), "stdlib", NULL);
+		// contexts fork the library on any thread, which only reads it once it is frozen
+		states.First()->context->Freeze();
+	}
+	// The checked standard library is the same for every context, so it is built once per process and
+	// becomes the parent of each context's root state. The context that built it is never destroyed:
+	// it keeps its compiler, and with it the basic expression types the library refers to, alive.
+	static RefPtr<::CompilerState> GetStdLibState()
+	{
+		static ::CompilationContext * stdLibContext = new ::CompilationContext(StdLibTag());
+		return stdLibContext->states.First();
+	}
+	// A batch worker compiles with the options and the cache of `owner`, but with a compiler and an
+	// include handler of its own. It has no states: it only compiles in states forked for each request.
+	struct WorkerTag {};
+	CompilationContext(WorkerTag, ::CompilationContext * owner)
+	{
+		useCache = owner->useCache;
+		cacheDir = owner->cacheDir;
+		cache = owner->cache;
+		Options = owner->Options;
+		compiler = CreateShaderCompiler();
+		includeHandler.sourceFiles = owner->includeHandler.sourceFiles;
+		includeHandler.compileUnits = owner->includeHandler.compileUnits;
+	}
+
+public:
+
 	SpireModule * FindModule(CoreLib::String moduleName)
 	{
 		auto ptr = states.Last()->modules.TryGetValue(moduleName);
@@ -610,65 +1074,85 @@ public:
 			return nullptr;
 	}
 
-	StringBuilder moduleKeyBuilder;
 	SpireModule * SpecializeModule(SpireModule * module, int * params, int numParams, SpireDiagnosticSink * sink)
 	{
-		moduleKeyBuilder.Clear();
-		moduleKeyBuilder.Append(module->Name);
+		auto state = module->State;
+		if (auto specialized = state->specializations.TryGetValue(ModuleSpecializationKey(module->Id, params, numParams)))
+			return specialized->Ptr();
+
+		// the values are given in the order the specialization parameters are listed in module->Parameters
+		Dictionary<String, int> paramValues;
 		for (auto & param : module->Parameters)
 		{
 			if (param.IsSpecialize)
 			{
-				int id = -1;
-				for (int i = 0; i < numParams; i++)
-				{
-					moduleKeyBuilder.Append(params[id]);
-					moduleKeyBuilder.Append('_');
-				}
+				if (paramValues.Count() == numParams)
+					return nullptr;
+				paramValues[param.Name] = params[paramValues.Count()];
 			}
 		}
-		if (auto smodule = module->State->modules.TryGetValue(moduleKeyBuilder.Buffer()))
-			return smodule->Ptr();
+		if (paramValues.Count() != numParams)
+			return nullptr;
 		RefPtr<ShaderSymbol> originalModule;
-		module->State->context->Symbols.Shaders.TryGetValue(module->Name, originalModule);
-		CompileUnit unit;
-		unit.SyntaxNode = new ProgramSyntaxNode();
+		if (!state->context->Symbols.Shaders.TryGetValue(module->Name, originalModule))
+			return nullptr;
+
+		// the specialized module is a copy of the module in which each specialization parameter is a constant;
+		// the parameter itself stays as a renamed placeholder so that the parameter layout does not change
+		StringBuilder nameBuilder;
+		nameBuilder << module->Name << "<";
+		for (int i = 0; i < numParams; i++)
+		{
+			nameBuilder << params[i];
+			if (i < numParams - 1)
+				nameBuilder << ",";
+		}
+		nameBuilder << ">";
 		CloneContext cloneCtx;
-		auto newModule = originalModule->SyntaxNode->Clone(cloneCtx);
-		newModule->Name.Content = moduleKeyBuilder.ToString();
-		int id = 0;
+		RefPtr<ShaderSyntaxNode> newModule = originalModule->SyntaxNode->Clone(cloneCtx);
+		newModule->Name.Content = nameBuilder.ProduceString();
+		newModule->SemanticallyChecked = false;
+		List<RefPtr<Decl>> constants;
 		for (auto & member : newModule->Members)
 		{
-			if (auto param = member.As<ComponentSyntaxNode>())
-			{
-				if (auto specialize = param->FindSpecializeModifier())
-				{
-					if (id >= numParams)
-					{
-						return nullptr;
-					}
-					auto newParam = param->Clone(cloneCtx);
-					newParam->modifiers.first = nullptr;
-					newParam->modifiers.flags = ModifierFlag::Public;
-					param->BlockStatement = nullptr;
-					auto expr = new ConstantExpressionSyntaxNode();
-					if (param->Type->Equals(ExpressionType::Bool))
-						expr->ConstType = ConstantExpressionSyntaxNode::ConstantType::Bool;
-					else
-						expr->ConstType = ConstantExpressionSyntaxNode::ConstantType::Int;
-					expr->IntValue = params[id];
-					newParam->Expression = expr;
-					newModule->Members.Add(newParam);
-					param->Name.Content = param->Name.Content + "placeholder";
-					id++;
-				}
-			}
+			auto param = member.As<ComponentSyntaxNode>();
+			int value = 0;
+			if (!param || !param->FindSpecializeModifier() || !paramValues.TryGetValue(param->Name.Content, value))
+				continue;
+			auto constant = param->Clone(cloneCtx);
+			constant->modifiers.first = nullptr;
+			constant->modifiers.flags = ModifierFlag::Public;
+			auto expr = new ConstantExpressionSyntaxNode();
+			if (param->Type->Equals(ExpressionType::Bool))
+				expr->ConstType = ConstantExpressionSyntaxNode::ConstantType::Bool;
+			else if (param->Type->Equals(ExpressionType::UInt))
+				expr->ConstType = ConstantExpressionSyntaxNode::ConstantType::UInt;
+			else
+				expr->ConstType = ConstantExpressionSyntaxNode::ConstantType::Int;
+			expr->IntValue = value;
+			constant->Expression = expr;
+			constants.Add(constant);
+			param->Name.Content = param->Name.Content.ToString() + "placeholder";
 		}
+		newModule->Members.AddRange(constants);
+
+		CompileUnit unit;
+		unit.SyntaxNode = new ProgramSyntaxNode();
 		unit.SyntaxNode->Members.Add(newModule);
 		List<CompileUnit> units;
 		units.Add(unit);
-		UpdateModuleLibrary(module->State, units, sink);
-		return FindModule(newModule->Name.Content);
+		UpdateModuleLibrary(state, units, sink);
+		ContentHash stateKey;
+		stateKey.Append(state->SourceKey);
+		stateKey.Append(newModule->Name.Content);
+		state->SourceKey = stateKey.ProduceString();
+
+		RefPtr<SpireModule> specialized;
+		if (!state->modules.TryGetValue(newModule->Name.Content, specialized))
+			return nullptr;
+		specialized->SpecializationValues.AddRange(params, numParams);
+		state->specializations[ModuleSpecializationKey(module->Id, specialized->SpecializationValues.Buffer(), numParams)] = specialized;
+		return specialized.Ptr();
 	}
 
 	LayoutRule GetUniformBufferLayoutRule()
@@ -780,7 +1264,11 @@ public:
 	void UpdateModuleLibrary(CompilerState * state, List<CompileUnit> & units, SpireDiagnosticSink * sink)
 	{
 		Spire::Compiler::CompileResult result;
-		compiler->Compile(result, *state->context, units, Options);
+		// a library is not compiled for a particular shader, but Options still names the one compiled last
+		auto options = Options;
+		options.SymbolToCompile = String();
+		options.TemplateShaderArguments.Clear();
+		compiler->Compile(result, *state->context, units, options);
 		state->Version++;
 		for (auto & shader : state->context->Symbols.Shaders)
 		{
@@ -859,13 +1347,202 @@ public:
 	int LoadModuleSource(CompilerState * state, CoreLib::String src, CoreLib::String fileName, SpireDiagnosticSink* sink)
 	{
 		List<CompileUnit> units;
-		int errCount = LoadModuleUnits(state, units, src, fileName, sink);
+		EnumerableDictionary<String, String> dependencies;
+		int errCount = LoadModuleUnits(state, units, src, fileName, sink, &dependencies);
 		state->moduleUnits.AddRange(units);
+		state->loadedSources.Add(KeyValuePair<String, String>(fileName, src));
 		UpdateModuleLibrary(state, units, sink);
+		UpdateSourceKey(state, src, fileName, dependencies);
 		return errCount;
 	}
 
-	int LoadModuleUnits(CompilerState * state, List<CompileUnit> & units, CoreLib::String src, CoreLib::String fileName, SpireDiagnosticSink* sink)
+	void UpdateSourceKey(CompilerState * state, const CoreLib::String & src, const CoreLib::String & fileName, EnumerableDictionary<String, String> & dependencies)
+	{
+		ContentHash stateKey;
+		stateKey.Append(state->SourceKey);
+		stateKey.Append(fileName);
+		stateKey.Append(src);
+		for (auto & dep : dependencies)
+		{
+			stateKey.Append(dep.Key);
+			stateKey.Append(dep.Value);
+		}
+		AppendSorted(stateKey, Options.PreprocessorDefinitions);
+		state->SourceKey = stateKey.ProduceString();
+	}
+
+	// A module library file is "shader only" if it declares nothing but shaders, modules and template shaders,
+	// so that changing it can only affect the shaders that use what it declares.
+	static bool IsShaderOnlyUnit(ProgramSyntaxNode * unit)
+	{
+		for (auto & member : unit->Members)
+		{
+			if (!dynamic_cast<ShaderSyntaxNode*>(member.Ptr()) && !dynamic_cast<TemplateShaderSyntaxNode*>(member.Ptr())
+				&& !dynamic_cast<UsingFileDecl*>(member.Ptr()))
+				return false;
+		}
+		return true;
+	}
+
+	// Brings `state` up to date with the current content of `fileName`, one of the files loaded into it. Only the
+	// shaders declared in that file and the shaders using them are checked again. A file that declares anything
+	// else (functions, structs, pipelines, interfaces) can affect every shader, so the whole state is reloaded
+	// in that case. Returns the number of shaders that were checked again.
+	int ReloadModuleFile(CompilerState * state, CoreLib::String fileName, SpireDiagnosticSink * sink)
+	{
+		int unitIndex = -1;
+		for (int i = 0; i < state->moduleUnits.Count(); i++)
+		{
+			if (state->moduleUnits[i].SyntaxNode && state->moduleUnits[i].SyntaxNode->Position.FileName == fileName)
+				unitIndex = i;
+		}
+		if (unitIndex == -1)
+			return 0;
+		String source;
+		try
+		{
+			source = File::ReadAllText(fileName);
+		}
+		catch (IOException)
+		{
+			Spire::Compiler::CompileResult result;
+			result.GetErrorWriter()->diagnose(CodePosition(0, 0, 0, ""), Diagnostics::cannotOpenFile, fileName);
+			if (sink)
+			{
+				sink->diagnostics.AddRange(result.sink.diagnostics);
+				sink->errorCount += result.GetErrorCount();
+			}
+			return 0;
+		}
+		auto oldUnit = state->moduleUnits[unitIndex].SyntaxNode;
+		List<CompileUnit> units;
+		EnumerableDictionary<String, String> dependencies;
+		SpireDiagnosticSink parseSink;
+		LoadModuleUnits(state, units, source, fileName, &parseSink, &dependencies);
+		if (!IsShaderOnlyUnit(oldUnit.Ptr()) || units.Count() == 0 || !units.First().SyntaxNode || !IsShaderOnlyUnit(units.First().SyntaxNode.Ptr()))
+			return ReloadState(state, fileName, source, sink);
+		if (sink)
+		{
+			sink->diagnostics.AddRange(parseSink.diagnostics);
+			sink->errorCount += parseSink.errorCount;
+		}
+
+		auto & symbols = state->context->Symbols;
+		HashSet<Decl*> oldDecls;
+		EnumerableHashSet<String> shaderNames;
+		for (auto & member : oldUnit->Members)
+		{
+			oldDecls.Add(member.Ptr());
+			if (dynamic_cast<ShaderDeclBase*>(member.Ptr()))
+			{
+				state->shaders.Remove(member->Name.Content);
+				if (auto shader = dynamic_cast<ShaderSyntaxNode*>(member.Ptr()))
+					shaderNames.Add(shader->Name.Content);
+			}
+		}
+		symbols.AddShaderUsers(shaderNames);
+		// the specializations of a module that is checked again are dropped rather than checked again themselves;
+		// they are made anew from the reloaded module when they are next asked for
+		HashSet<int> reloadedModuleIds;
+		for (auto & name : shaderNames)
+			if (auto module = state->modules.TryGetValue(name))
+				reloadedModuleIds.Add((*module)->Id);
+		EnumerableHashSet<String> specializationNames;
+		bool specializationRemoved = true;
+		while (specializationRemoved)
+		{
+			specializationRemoved = false;
+			Dictionary<ModuleSpecializationKey, RefPtr<SpireModule>> keptSpecializations;
+			for (auto & specialization : state->specializations)
+			{
+				if (reloadedModuleIds.Contains(specialization.Key.ModuleId))
+				{
+					specializationNames.Add(specialization.Value->Name);
+					reloadedModuleIds.Add(specialization.Value->Id);
+					specializationRemoved = true;
+				}
+				else
+					keptSpecializations[specialization.Key] = specialization.Value;
+			}
+			state->specializations = _Move(keptSpecializations);
+		}
+		for (auto & name : specializationNames)
+		{
+			shaderNames.Remove(name);
+			state->modules.Remove(name);
+		}
+		state->context->RemoveShaders(specializationNames);
+		List<String> oldGlobalDecls;
+		for (auto & decl : symbols.globalDecls)
+			if (oldDecls.Contains(decl.Value))
+				oldGlobalDecls.Add(decl.Key);
+		for (auto & name : oldGlobalDecls)
+			symbols.globalDecls.Remove(name);
+
+		// users declared in other files are checked again from a fresh copy of their (already checked) syntax,
+		// which also replaces the old syntax in the unit it came from
+		CompileUnit usersUnit;
+		usersUnit.SyntaxNode = new ProgramSyntaxNode();
+		for (auto & name : shaderNames)
+		{
+			RefPtr<ShaderSymbol> shader;
+			if (!symbols.Shaders.TryGetValue(name, shader) || oldDecls.Contains((Decl*)shader->SyntaxNode.Ptr()))
+				continue;
+			CloneContext cloneCtx;
+			RefPtr<ShaderSyntaxNode> newShader = shader->SyntaxNode->Clone(cloneCtx);
+			newShader->SemanticallyChecked = false;
+			for (auto & unit : state->moduleUnits)
+			{
+				if (!unit.SyntaxNode)
+					continue;
+				for (auto & member : unit.SyntaxNode->Members)
+					if (member.Ptr() == shader->SyntaxNode.Ptr())
+						member = newShader;
+			}
+			usersUnit.SyntaxNode->Members.Add(newShader);
+		}
+		state->context->RemoveShaders(shaderNames);
+		for (auto & name : shaderNames)
+			state->modules.Remove(name);
+
+		state->moduleUnits[unitIndex] = units.First();
+		for (int i = 1; i < units.Count(); i++)
+			state->moduleUnits.Add(units[i]);
+		for (auto & unit : state->loadedSources)
+			if (unit.Key == fileName)
+				unit.Value = source;
+		if (usersUnit.SyntaxNode->Members.Count())
+			units.Add(usersUnit);
+		UpdateModuleLibrary(state, units, sink);
+		UpdateSourceKey(state, source, fileName, dependencies);
+		for (auto & shader : units.First().SyntaxNode->GetShaders())
+			shaderNames.Add(shader->Name.Content);
+		return shaderNames.Count();
+	}
+
+	// Reloads everything that was loaded into `state`, with `source` as the new content of `fileName`.
+	int ReloadState(CompilerState * state, CoreLib::String fileName, CoreLib::String source, SpireDiagnosticSink * sink)
+	{
+		auto loadedSources = state->loadedSources;
+		state->moduleUnits.Clear();
+		state->processedModuleUnits.Clear();
+		state->loadedSources.Clear();
+		state->modules.Clear();
+		state->specializations.Clear();
+		state->shaders.Clear();
+		state->SourceKey = String();
+		state->ForkParentContext();
+		for (auto & loadedSource : loadedSources)
+			LoadModuleSource(state, loadedSource.Key == fileName ? source : loadedSource.Value, loadedSource.Key, sink);
+		int shaderCount = 0;
+		for (auto & unit : state->moduleUnits)
+			if (unit.SyntaxNode)
+				shaderCount += unit.SyntaxNode->GetShaders().Count();
+		return shaderCount;
+	}
+
+	int LoadModuleUnits(CompilerState * state, List<CompileUnit> & units, CoreLib::String src, CoreLib::String fileName, SpireDiagnosticSink* sink,
+		EnumerableDictionary<String, String> * dependencies = nullptr, CompileStats * stats = nullptr)
 	{
 		auto & processedUnits = state->processedModuleUnits;
 		Spire::Compiler::CompileResult result;
@@ -875,6 +1552,8 @@ public:
 		auto searchDirs = Options.SearchDirectories;
 		searchDirs.Add(Path::GetDirectoryName(fileName));
 		searchDirs.Reverse();
+		includeHandler.searchDirs = Options.SearchDirectories;
+		includeHandler.dependencies = dependencies;
 		for (int i = 0; i < unitsToInclude.Count(); i++)
 		{
 			auto inputFileName = unitsToInclude[i];
@@ -882,28 +1561,25 @@ public:
 			{
 				String source = src;
 				if (i > 0)
-					source = File::ReadAllText(inputFileName);
+				{
+					source = ReadSourceFile(*includeHandler.sourceFiles, inputFileName);
+					if (dependencies)
+						(*dependencies)[inputFileName] = ContentHash::Compute(source);
+				}
 				auto unit = compiler->Parse(result, source, inputFileName, &includeHandler, Options.PreprocessorDefinitions);
 				units.Add(unit);
 				if (unit.SyntaxNode)
 				{
 					for (auto inc : unit.SyntaxNode->GetUsings())
 					{
-						bool found = false;
-						for (auto & dir : searchDirs)
+						if (auto file = FindSourceFile(*includeHandler.sourceFiles, searchDirs, inc->fileName.Content))
 						{
-							String includeFile = Path::Combine(dir, inc->fileName.Content);
-							if (File::Exists(includeFile))
+							if (processedUnits.Add(file->FileName))
 							{
-								if (processedUnits.Add(includeFile))
-								{
-									unitsToInclude.Add(includeFile);
-								}
-								found = true;
-								break;
+								unitsToInclude.Add(file->FileName);
 							}
 						}
-						if (!found)
+						else
 						{
 							result.GetErrorWriter()->diagnose(inc->fileName.Position, Diagnostics::cannotFindFile, inc->fileName);
 						}
@@ -915,6 +1591,9 @@ public:
 				result.GetErrorWriter()->diagnose(CodePosition(0, 0, 0, ""), Diagnostics::cannotOpenFile, inputFileName);
 			}
 		}
+		includeHandler.dependencies = nullptr;
+		if (stats)
+			stats->Add(result.Stats);
 		if (sink)
 		{
 			sink->diagnostics.AddRange(result.sink.diagnostics);
@@ -983,6 +1662,76 @@ public:
 			Options.TemplateShaderArguments.Add(module->Name);
 		return Compile(result, currentState, shader.Syntax, additionalSource, shader.GetName(), sink);
 	}
+	void CompileBatch(::CompileResult ** results, RefPtr<CompilerState> baseState, ArrayView<SpireCompileRequest> requests, int threadCount)
+	{
+		// bring the shared state up to date once, so that workers only ever read it
+		baseState->Update();
+		baseState->context->Freeze();
+		List<SpireDiagnosticSink> sinks;
+		sinks.SetSize(requests.Count());
+		for (int i = 0; i < requests.Count(); i++)
+		{
+			sinks[i].errorCount = 0;
+			results[i] = new ::CompileResult();
+		}
+		std::atomic<int> nextRequest(0);
+		auto worker = [&]()
+		{
+			::CompilationContext workerContext(WorkerTag(), this);
+			for (int i = nextRequest++; i < requests.Count(); i = nextRequest++)
+			{
+				auto & request = requests[i];
+				workerContext.Options.PreprocessorDefinitions = Options.PreprocessorDefinitions;
+				for (int j = 0; j < request.DefineCount; j++)
+					workerContext.Options.PreprocessorDefinitions[request.Defines[j].Name] = request.Defines[j].Value;
+				// the entry point is visited by the semantic checker, so every request works on its own copy
+				auto shader = reinterpret_cast<Shader*>(request.Shader);
+				CloneContext cloneCtx;
+				Shader requestShader(shader->GetName(), shader->GetSource());
+				requestShader.Syntax = shader->Syntax->Clone(cloneCtx);
+				// an exception must not leave the thread, so it fails only the request that raised it
+				auto abortRequest = [&](const String & message)
+				{
+					delete results[i];
+					results[i] = new ::CompileResult();
+					DiagnosticSink exceptionSink;
+					exceptionSink.diagnose(CodePosition(0, 0, 0, ""), Diagnostics::compilationAborted, message);
+					sinks[i].diagnostics.AddRange(exceptionSink.diagnostics);
+					sinks[i].errorCount += exceptionSink.errorCount;
+				};
+				try
+				{
+					workerContext.Compile(*results[i], new CompilerState(baseState), requestShader,
+						ArrayView<SpireModule*>(request.Args, request.ArgCount), request.AdditionalSource, &sinks[i]);
+				}
+				catch (Exception & e)
+				{
+					abortRequest(e.Message.Length() ? e.Message : String("internal compiler error"));
+				}
+				catch (...)
+				{
+					abortRequest("unexpected exception");
+				}
+			}
+		};
+		if (threadCount <= 0)
+			threadCount = Math::Max(1, (int)std::thread::hardware_concurrency());
+		threadCount = Math::Min(threadCount, requests.Count());
+		List<std::thread> threads;
+		for (int i = 1; i < threadCount; i++)
+			threads.Add(std::thread(worker));
+		worker();
+		for (auto & thread : threads)
+			thread.join();
+		for (int i = 0; i < requests.Count(); i++)
+		{
+			if (auto sink = requests[i].Sink)
+			{
+				sink->diagnostics.AddRange(sinks[i].diagnostics);
+				sink->errorCount += sinks[i].errorCount;
+			}
+		}
+	}
 	SpireParameterSet GetParameterSet(ILModuleParameterSet * module)
 	{
 		SpireParameterSet set;
@@ -1016,13 +1765,78 @@ public:
 			set.subsets.Add(GetParameterSet(submodule.Ptr()));
 		return set;
 	}
+	template<typename TDictionary>
+	void AppendSorted(ContentHash & hash, TDictionary & dict)
+	{
+		List<String> keys;
+		for (auto & item : dict)
+			keys.Add(item.Key);
+		keys.Sort();
+		hash.Append(keys.Count());
+		for (auto & key : keys)
+		{
+			hash.Append(key);
+			hash.Append(dict[key]());
+		}
+	}
+	// the cache key covers everything that determines the compiled output except the files read from disk,
+	// which are recorded in the entry itself and validated on lookup
+	String GetCacheKey(CompilerState * state, const String & source, const String & fileName)
+	{
+		ContentHash hash;
+		hash.Append(ShaderCache::GetCompilerIdentity());
+		hash.Append(state->GetSourceKey());
+		hash.Append(fileName);
+		hash.Append(source);
+		hash.Append((int)Options.Mode);
+		hash.Append((int)Options.Target);
+		hash.Append(Options.SymbolToCompile);
+		hash.Append(Options.TemplateShaderArguments.Count());
+		for (auto & arg : Options.TemplateShaderArguments)
+			hash.Append(arg);
+		hash.Append(Options.ScheduleSource);
+		hash.Append(Options.SearchDirectories.Count());
+		for (auto & dir : Options.SearchDirectories)
+			hash.Append(dir);
+		AppendSorted(hash, Options.BackendArguments);
+		AppendSorted(hash, Options.PreprocessorDefinitions);
+		return hash.ProduceString();
+	}
+	void FillParameterSets(::CompileResult & result)
+	{
+		for (auto shader : result.Sources)
+		{
+			List<SpireParameterSet> paramSets;
+			for (auto & pset : shader.Value.MetaData.ParameterSets)
+			{
+				if (!pset.Value->IsTopLevel)
+					continue;
+				paramSets.Add(GetParameterSet(pset.Value.Ptr()));
+			}
+			result.ParamSets[shader.Key] = _Move(paramSets);
+		}
+	}
 	bool Compile(::CompileResult & result, RefPtr<CompilerState> currentState, RefPtr<Decl> entryPoint, CoreLib::String source, CoreLib::String fileName, SpireDiagnosticSink* sink)
 	{
 		if (currentState->errorCount != 0)
 			return false;
 		currentState->Update();
+		String cacheKey;
+		if (cache)
+		{
+			cacheKey = GetCacheKey(currentState.Ptr(), source, fileName);
+			ShaderCacheEntry entry;
+			if (cache->TryLoad(cacheKey, entry))
+			{
+				result.Sources = _Move(entry.Sources);
+				result.LoadedFromCache = true;
+				FillParameterSets(result);
+				return true;
+			}
+		}
 		List<CompileUnit> units;
-		currentState->errorCount += LoadModuleUnits(currentState.Ptr(), units, source, fileName, sink);
+		EnumerableDictionary<String, String> dependencies;
+		currentState->errorCount += LoadModuleUnits(currentState.Ptr(), units, source, fileName, sink, &dependencies, &result.Stats);
 		if (currentState->errorCount != 0)
 		{
 			return false;
@@ -1038,6 +1852,8 @@ public:
 		Spire::Compiler::CompileResult cresult;
 		compiler->Compile(cresult, *(currentState->context), units, Options);
 		result.Sources = cresult.CompiledSource;
+		result.CostEstimates = cresult.CostEstimates;
+		result.Stats.Add(cresult.Stats);
 		currentState->errorCount += cresult.GetErrorCount();
 		if (sink)
 		{
@@ -1046,16 +1862,13 @@ public:
 		}
 		if (currentState->errorCount == 0)
 		{
-			for (auto shader : result.Sources)
+			FillParameterSets(result);
+			if (cache)
 			{
-				List<SpireParameterSet> paramSets;
-				for (auto & pset : shader.Value.MetaData.ParameterSets)
-				{
-					if (!pset.Value->IsTopLevel)
-						continue;
-					paramSets.Add(GetParameterSet(pset.Value.Ptr()));
-				}
-				result.ParamSets[shader.Key] = _Move(paramSets);
+				ShaderCacheEntry entry;
+				entry.Dependencies = _Move(dependencies);
+				entry.Sources = result.Sources;
+				cache->Store(cacheKey, entry);
 			}
 		}
 		bool succ = currentState->errorCount == 0;
@@ -1148,6 +1961,16 @@ void spEnvLoadModuleLibraryFromSource(SpireCompilationEnvironment * env, const c
 	env->context->LoadModuleSource(env->state.Ptr(), source, fileName, sink);
 }
 
+int spReloadModuleFile(SpireCompilationContext * ctx, const char * fileName, SpireDiagnosticSink * sink)
+{
+	return CTX(ctx)->ReloadModuleFile(CTX(ctx)->states.Last().Ptr(), fileName, sink);
+}
+
+int spEnvReloadModuleFile(SpireCompilationEnvironment * env, const char * fileName, SpireDiagnosticSink * sink)
+{
+	return env->context->ReloadModuleFile(env->state.Ptr(), fileName, sink);
+}
+
 void spPushContext(SpireCompilationContext * ctx)
 {
 	CTX(ctx)->PushContext();
@@ -1171,7 +1994,14 @@ SpireCompilationEnvironment * spCreateEnvironment(SpireCompilationContext * ctx,
 	auto rs = new SpireCompilationEnvironment();
 	rs->context = CTX(ctx);
 	if (forkOrigin)
-		rs->state = new CompilerState(*forkOrigin->state);
+	{
+		// the fork shares the symbols of its origin, and each adds new ones to layers of its own
+		auto origin = forkOrigin->state;
+		origin->context->Freeze();
+		rs->state = new CompilerState(*origin);
+		rs->state->context = new Spire::Compiler::CompilationContext(*origin->context);
+		rs->state->context->IsProgramShared = true;
+	}
 	else
 		rs->state = new CompilerState();
 	return rs;
@@ -1417,6 +2247,16 @@ SPIRE_API SpireCompilationResult * spEnvCompileShader(SpireCompilationEnvironmen
 	return reinterpret_cast<SpireCompilationResult*>(rs);
 }
 
+void spCompileShaderBatch(SpireCompilationContext * ctx, SpireCompileRequest * requests, int requestCount, int threadCount, SpireCompilationResult ** results)
+{
+	CTX(ctx)->CompileBatch(reinterpret_cast<::CompileResult**>(results), CTX(ctx)->states.Last(), ArrayView<SpireCompileRequest>(requests, requestCount), threadCount);
+}
+
+void spEnvCompileShaderBatch(SpireCompilationEnvironment * env, SpireCompileRequest * requests, int requestCount, int threadCount, SpireCompilationResult ** results)
+{
+	env->context->CompileBatch(reinterpret_cast<::CompileResult**>(results), env->state, ArrayView<SpireCompileRequest>(requests, requestCount), threadCount);
+}
+
 SpireCompilationResult * spCompileShaderFromSource(SpireCompilationContext * ctx, const char * source, const char * fileName, SpireDiagnosticSink* sink)
 {
 	::CompileResult * rs = new ::CompileResult();
@@ -1660,6 +2500,85 @@ SpireResourceBindingInfo * spParameterSetGetBindingSlot(SpireParameterSet * set,
 {
 	return &set->bindings[index];
 }
+int spGetCompilationStats(SpireCompilationResult * result, SpireCompilationStats * stats)
+{
+	if (!result || !stats)
+		return SPIRE_ERROR_INVALID_PARAMETER;
+	auto & src = RS(result)->Stats;
+	stats->PreprocessTime = src.PhaseTimes[(int)CompilePhase::Preprocess];
+	stats->ParseTime = src.PhaseTimes[(int)CompilePhase::Parse];
+	stats->SemanticCheckTime = src.PhaseTimes[(int)CompilePhase::SemanticCheck];
+	stats->ShaderClosureTime = src.PhaseTimes[(int)CompilePhase::ShaderClosure];
+	stats->VariantIRTime = src.PhaseTimes[(int)CompilePhase::VariantIR];
+	stats->ImplicitImportTime = src.PhaseTimes[(int)CompilePhase::ImplicitImports];
+	stats->ILCodeGenTime = src.PhaseTimes[(int)CompilePhase::ILCodeGen];
+	stats->TargetCodeGenTime = src.PhaseTimes[(int)CompilePhase::TargetCodeGen];
+	stats->TokenCount = src.TokenCount;
+	stats->SyntaxNodeCount = src.SyntaxNodeCount;
+	stats->ILInstructionCount = src.ILInstructionCount;
+	stats->OutputBytes = src.OutputBytes;
+	stats->LoadedFromCache = RS(result)->LoadedFromCache ? 1 : 0;
+	return 0;
+}
+
+static ShaderCostEstimate * GetCostEstimate(SpireCompilationResult * result, const char * shaderName)
+{
+	auto rs = RS(result);
+	if (shaderName == nullptr)
+	{
+		if (rs->CostEstimates.Count())
+			return &rs->CostEstimates.First().Value;
+		return nullptr;
+	}
+	return rs->CostEstimates.TryGetValue(shaderName);
+}
+
+int spGetShaderWorldCostCount(SpireCompilationResult * result, const char * shaderName)
+{
+	if (!result)
+		return SPIRE_ERROR_INVALID_PARAMETER;
+	if (RS(result)->LoadedFromCache)
+		return 0;
+	auto estimate = GetCostEstimate(result, shaderName);
+	if (!estimate)
+		return SPIRE_ERROR_INVALID_PARAMETER;
+	return estimate->Worlds.Count();
+}
+
+int spGetShaderWorldCost(SpireCompilationResult * result, const char * shaderName, int index, SpireWorldCost * cost)
+{
+	if (!result || !cost)
+		return SPIRE_ERROR_INVALID_PARAMETER;
+	auto estimate = GetCostEstimate(result, shaderName);
+	if (!estimate || index < 0 || index >= estimate->Worlds.Count())
+		return SPIRE_ERROR_INVALID_PARAMETER;
+	int i = 0;
+	for (auto & world : estimate->Worlds)
+	{
+		if (i++ != index)
+			continue;
+		cost->WorldName = world.Key.Buffer();
+		cost->Frequency = world.Value.Frequency;
+		cost->AluOps = world.Value.AluOps;
+		cost->TextureFetches = world.Value.TextureFetches;
+		cost->Interpolants = world.Value.Interpolants;
+		cost->Instructions = world.Value.Instructions;
+		cost->WeightedCost = world.Value.GetWeightedCost();
+		break;
+	}
+	return 0;
+}
+
+double spGetShaderEstimatedCost(SpireCompilationResult * result, const char * shaderName)
+{
+	if (!result)
+		return SPIRE_ERROR_INVALID_PARAMETER;
+	auto estimate = GetCostEstimate(result, shaderName);
+	if (!estimate)
+		return SPIRE_ERROR_INVALID_PARAMETER;
+	return estimate->TotalCost;
+}
+
 void spDestroyCompilationResult(SpireCompilationResult * result)
 {
 	delete RS(result);
@@ -16,8 +16,14 @@ namespace SpireLib
 		void FromString(const CoreLib::String & str);
 		CoreLib::String ToString();
 		void SaveToFile(CoreLib::Basic::String fileName);
+		// versioned binary form of the text format, which Load reads from a memory-mapped file without tokenizing
+		void ToBinary(CoreLib::Basic::List<unsigned char> & buffer);
+		void FromBinary(const unsigned char * data, int size);
+		void SaveToBinaryFile(CoreLib::Basic::String fileName);
+		static bool IsBinary(const unsigned char * data, int size);
 		ShaderLibFile() = default;
 		void Clear();
+		// loads either form, telling them apart by the magic number of the binary form
 		void Load(CoreLib::Basic::String fileName);
 	};
 	
@@ -172,6 +172,40 @@ extern "C"
 		int Col;                 /**< The column position of this error.*/
 	};
 
+	/*!
+	@brief Where the time of a compile went, and how much data the compiler produced. Times are wall-clock seconds.
+	*/
+	struct SpireCompilationStats
+	{
+		double PreprocessTime;       /**< Time spent running the preprocessor over the source and the files it uses.*/
+		double ParseTime;            /**< Time spent parsing the preprocessed tokens.*/
+		double SemanticCheckTime;    /**< Time spent in semantic checking, including template shader instantiation.*/
+		double ShaderClosureTime;    /**< Time spent creating and flattening shader closures.*/
+		double VariantIRTime;        /**< Time spent generating the shader variant IR.*/
+		double ImplicitImportTime;   /**< Time spent inserting implicit import operators.*/
+		double ILCodeGenTime;        /**< Time spent generating IL code.*/
+		double TargetCodeGenTime;    /**< Time spent in the backend generating target code.*/
+		int TokenCount;              /**< The number of tokens produced by the preprocessor.*/
+		int SyntaxNodeCount;         /**< The number of syntax nodes parsed or cloned.*/
+		int ILInstructionCount;      /**< The number of IL instructions created.*/
+		int OutputBytes;             /**< The total size (in bytes) of the code of all compiled stages.*/
+		int LoadedFromCache;         /**< 1 if the result was loaded from the shader cache, in which case all other fields are 0.*/
+	};
+
+	/*!
+	@brief Static estimate of the work of one world of a compiled shader, per invocation of the world.
+	*/
+	struct SpireWorldCost
+	{
+		const char * WorldName;   /**< The name of the world. Storage is owned by SpireCompilationResult.*/
+		double Frequency;         /**< Invocations of the world relative to the other worlds, from its Frequency attribute (1 if not declared).*/
+		double AluOps;            /**< Estimated number of arithmetic operations, with loop bodies counted several times.*/
+		double TextureFetches;    /**< Estimated number of texture fetches.*/
+		double Interpolants;      /**< Number of scalars the world imports from other worlds.*/
+		double Instructions;      /**< Estimated number of IL instructions.*/
+		double WeightedCost;      /**< Frequency * (AluOps + 4 * TextureFetches + Interpolants).*/
+	};
+
 	/*!
 	@brief Stores description of a component.
 	*/
@@ -191,6 +225,30 @@ extern "C"
 	*/
 	typedef struct SpireParameterSet SpireParameterSet;
 
+	/*!
+	@brief A preprocessor macro definition.
+	*/
+	struct SpireMacroDefinition
+	{
+		const char * Name;         /**< The name of the macro. */
+		const char * Value;        /**< The value of the macro. */
+	};
+
+	/*!
+	@brief Describes one shader variant to compile in a batch.
+	@see spCompileShaderBatch()
+	*/
+	struct SpireCompileRequest
+	{
+		SpireShader * Shader;                  /**< The shader object to compile. */
+		SpireModule ** Args;                   /**< The modules used as template shader arguments. */
+		int ArgCount;                          /**< The number of elements in @p Args. */
+		const char * AdditionalSource;         /**< Additional source code to append before passing to compiler, can be NULL. */
+		SpireMacroDefinition * Defines;        /**< Preprocessor definitions added to those of the context for this request only. */
+		int DefineCount;                       /**< The number of elements in @p Defines. */
+		SpireDiagnosticSink * Sink;            /**< The sink where diagnostic output should be sent, or NULL to ignore messages. */
+	};
+
 	/*!
 	@brief Represents information on a binding slot of a parameter set.
 	*/
@@ -206,6 +264,9 @@ extern "C"
 	@brief Create a compilation context.
 	@param cacheDir The directory used to store cached compilation results. Pass NULL to disable caching.
 	@return A new compilation context.
+	@note Different compilation contexts may be created, used and destroyed on different threads at the same time, and a compilation
+	produces the same result whether or not other contexts are compiling concurrently. A single context, and the objects obtained from it,
+	must not be used by more than one thread at a time.
 	*/
 	SPIRE_API SpireCompilationContext * spCreateCompilationContext(const char * cacheDir);
 
@@ -215,7 +276,8 @@ extern "C"
 	@param target The code generation target. Possible values are:
 	- SPIRE_GLSL. Generates GLSL code.
 	- SPIRE_HLSL. Generates HLSL code.
-	- SPIRE_SPIRV. Generates SPIR-V code.
+	- SPIRE_SPIRV. Generates SPIR-V code. Hull and compute shader stages are not supported: compiling a shader that has
+	  one fails with an error. Such shaders can be compiled for SPIRE_GLSL_VULKAN, which uses the same resource bindings.
 	*/
 	SPIRE_API void spSetCodeGenTarget(SpireCompilationContext * ctx, int target);
 
@@ -302,6 +364,21 @@ extern "C"
 	SPIRE_API void spLoadModuleLibraryFromSource(SpireCompilationContext * ctx, const char * source, const char * fileName, SpireDiagnosticSink* sink);
 	SPIRE_API void spEnvLoadModuleLibraryFromSource(SpireCompilationEnvironment * env, const char * source, const char * fileName, SpireDiagnosticSink* sink);
 
+	/*!
+	@brief Update the loaded module libraries after a file loaded by spLoadModuleLibrary(), or through a `using` in a loaded file, changed on disk.
+	Only the shaders and modules declared in the file, and the shaders and modules that use them, are checked again. If the file declares
+	functions, structs, pipelines or interfaces, all loaded libraries are reloaded instead.
+	SpireShader and SpireModule objects of the shaders that were checked again are no longer valid and must be obtained again
+	via spFindShader() and spFindModule().
+	@param ctx The compilation context.
+	@param fileName The filename of the changed file, as it was passed to spLoadModuleLibrary() or written in the `using` statement
+	(combined with the directory it was found in).
+	@param sink The sink where diagnostic output should be sent, or NULL to ignore messages.
+	@return The number of shaders and modules that were checked again, 0 if @p fileName is not loaded in this context.
+	*/
+	SPIRE_API int spReloadModuleFile(SpireCompilationContext * ctx, const char * fileName, SpireDiagnosticSink* sink);
+	SPIRE_API int spEnvReloadModuleFile(SpireCompilationEnvironment * env, const char * fileName, SpireDiagnosticSink* sink);
+
 
 	/*!
 	@brief Store current compilation context to a stack. spLoadModuleLibrary() and spLoadModuleLibraryFromSource() load new symbols to
@@ -317,6 +394,13 @@ extern "C"
 	void spPopContext(SpireCompilationContext * ctx);
 
 	SPIRE_API SpireCompilationEnvironment * spGetCurrentEnvironment(SpireCompilationContext * ctx);
+	/*!
+	@brief Create a compilation environment.
+	@param ctx The compilation context.
+	@param forkOrigin If not NULL, the new environment starts out with everything loaded into this environment. The symbols are shared
+		   with the origin rather than copied, so forking takes constant time regardless of the size of the loaded libraries. Modules
+		   loaded into either environment afterwards are not visible to the other one.
+	*/
 	SPIRE_API SpireCompilationEnvironment * spCreateEnvironment(SpireCompilationContext * ctx, SpireCompilationEnvironment * forkOrigin);
 	SPIRE_API void spReleaseEnvironment(SpireCompilationEnvironment* env);
 
@@ -498,6 +582,30 @@ extern "C"
 		const char * additionalSource,
 		SpireDiagnosticSink* sink);
 
+	/*!
+	@brief Compiles a batch of shader variants against the module library loaded in a context.
+	Each request produces the same result as a call to spCompileShader() with the same arguments, but the requests are compiled
+	concurrently: the checked module library is shared, and every request gets its own copy of the compiler state.
+	@param ctx A shader compilation context.
+	@param requests The shader variants to compile.
+	@param requestCount The number of elements in @p requests.
+	@param threadCount The maximum number of threads to use. Pass 0 to use one thread per hardware thread.
+	@param[out] results An array of @p requestCount elements that receives one SpireCompilationResult object per request, in request order.
+	@note Diagnostics are added to each request's sink after all requests finished, in request order, so requests may share a sink.
+	You are responsible for destroying every returned SpireCompilationResult object.
+	*/
+	SPIRE_API void spCompileShaderBatch(SpireCompilationContext * ctx,
+		SpireCompileRequest * requests,
+		int requestCount,
+		int threadCount,
+		SpireCompilationResult ** results);
+
+	SPIRE_API void spEnvCompileShaderBatch(SpireCompilationEnvironment * env,
+		SpireCompileRequest * requests,
+		int requestCount,
+		int threadCount,
+		SpireCompilationResult ** results);
+
 	/*!
 	@brief Compiles a shader object.
 	@param ctx A shader compilation context.
@@ -587,6 +695,40 @@ extern "C"
 	*/
 	SPIRE_API const char * spGetShaderStageSource(SpireCompilationResult * result, const char * shaderName, const char * stage, int * length);
 
+	/*!
+	@brief Retrieve timing and size statistics of the compile that produced a compilation result.
+	@param result A SpireCompilationResult object.
+	@param[out] stats A pointer used to receive the statistics.
+	@return 0 if sucessful, or SPIRE_ERROR_INVALID_PARAMETER if any of the parameters is NULL.
+	*/
+	SPIRE_API int spGetCompilationStats(SpireCompilationResult * result, SpireCompilationStats * stats);
+
+	/*!
+	@brief Retrieve the number of worlds with a cost estimate in a compiled shader.
+	@param result A SpireCompilationResult object.
+	@param shaderName The name of a shader. If @p shaderName is NULL, the function uses the first shader in @p result.
+	@return The number of worlds, 0 if the shader was loaded from the shader cache, or SPIRE_ERROR_INVALID_PARAMETER if the shader does not exist.
+	*/
+	SPIRE_API int spGetShaderWorldCostCount(SpireCompilationResult * result, const char * shaderName);
+
+	/*!
+	@brief Retrieve the static cost estimate of a world in a compiled shader.
+	@param result A SpireCompilationResult object.
+	@param shaderName The name of a shader. If @p shaderName is NULL, the function uses the first shader in @p result.
+	@param index The index of the world, between 0 and the value returned by spGetShaderWorldCostCount.
+	@param[out] cost A pointer used to receive the estimate.
+	@return 0 if sucessful, or SPIRE_ERROR_INVALID_PARAMETER if any of the parameters was invalid.
+	*/
+	SPIRE_API int spGetShaderWorldCost(SpireCompilationResult * result, const char * shaderName, int index, SpireWorldCost * cost);
+
+	/*!
+	@brief Retrieve the sum of the weighted costs of all worlds of a compiled shader, used to compare the variants of a shader.
+	@param result A SpireCompilationResult object.
+	@param shaderName The name of a shader. If @p shaderName is NULL, the function uses the first shader in @p result.
+	@return The estimated cost, or a negative value if the shader does not exist or was loaded from the shader cache.
+	*/
+	SPIRE_API double spGetShaderEstimatedCost(SpireCompilationResult * result, const char * shaderName);
+
 	/*!
 	@brief Retrieve the number of parameter sets defined by a compiled shader.
 	@param result A SpireCompilationResult object, as a result of shader compilation.
@@ -1,4 +1,5 @@
 #ifndef SPIRE_NO_CORE_LIB
+#include "Source/CoreLib/Atom.cpp"
 #include "Source/CoreLib/CommandLineParser.cpp"
 #include "Source/CoreLib/LibIO.cpp"
 #include "Source/CoreLib/LibMath.cpp"
@@ -12,7 +13,9 @@
 #include "Source/SpireCore/Closure.cpp"
 #include "Source/SpireCore/CodeGenerator.cpp"
 #include "Source/SpireCore/CompiledProgram.cpp"
+#include "Source/SpireCore/CompileUnitCache.cpp"
 #include "Source/SpireCore/ConstantPool.cpp"
+#include "Source/SpireCore/ContentHash.cpp"
 #include "Source/SpireCore/Diagnostics.cpp"
 #include "Source/SpireCore/GetDependencyVisitor.cpp"
 #include "Source/SpireCore/GLSLCodeGen.cpp"
@@ -26,7 +29,9 @@
 #include "Source/SpireCore/Parser.cpp"
 #include "Source/SpireCore/Preprocessor.cpp"
 #include "Source/SpireCore/Schedule.cpp"
+#include "Source/SpireCore/ScheduleExplorer.cpp"
 #include "Source/SpireCore/SemanticsVisitor.cpp"
+#include "Source/SpireCore/SourceFileCache.cpp"
 #include "Source/SpireCore/ShaderCompiler.cpp"
 #include "Source/SpireCore/SpirVCodeGen.cpp"
 #include "Source/SpireCore/StdInclude.cpp"
@@ -34,5 +39,7 @@
 #include "Source/SpireCore/Syntax.cpp"
 #include "Source/SpireCore/TypeLayout.cpp"
 #include "Source/SpireCore/SamplerUsageAnalysis.cpp"
+#include "Source/SpireCore/CostAnalysis.cpp"
 #include "Source/SpireCore/VariantIR.cpp"
+#include "Source/SpireLib/ShaderCache.cpp"
 #include "Source/SpireLib/SpireLib.cpp"
@@ -0,0 +1,179 @@
+// concurrency.cpp
+
+#include "concurrency.h"
+#include "../../Spire.h"
+#include "../../Source/CoreLib/Tokenizer.h"
+
+#include <stdio.h>
+#include <thread>
+
+using namespace CoreLib::Basic;
+using namespace CoreLib::IO;
+using namespace CoreLib::Text;
+
+String resultToString(SpireCompilationResult * result, SpireDiagnosticSink * sink)
+{
+	StringBuilder sb;
+	List<char> buffer;
+	buffer.SetSize(spGetDiagnosticOutput(sink, nullptr, 0) + 1);
+	spGetDiagnosticOutput(sink, buffer.Buffer(), buffer.Count());
+	sb << "diagnostics = {\n" << buffer.Buffer() << "}\n";
+
+	buffer.SetSize(spGetCompiledShaderNames(result, nullptr, 0) + 1);
+	spGetCompiledShaderNames(result, buffer.Buffer(), buffer.Count());
+	for (auto & shaderName : Split(buffer.Buffer(), '\n'))
+	{
+		if (shaderName.Length() == 0)
+			continue;
+		sb << "shader " << shaderName << "\n";
+		List<char> stageNames;
+		stageNames.SetSize(spGetCompiledShaderStageNames(result, shaderName.Buffer(), nullptr, 0) + 1);
+		spGetCompiledShaderStageNames(result, shaderName.Buffer(), stageNames.Buffer(), stageNames.Count());
+		for (auto & stageName : Split(stageNames.Buffer(), '\n'))
+		{
+			if (stageName.Length() == 0)
+				continue;
+			int length = 0;
+			auto code = spGetShaderStageSource(result, shaderName.Buffer(), stageName.Buffer(), &length);
+			sb << "stage " << stageName << " (" << length << " bytes)\n";
+			// binary targets may contain zeros, so the code is compared as hex
+			for (int i = 0; i < length; i++)
+			{
+				static const char digits[] = "0123456789abcdef";
+				sb << digits[((unsigned char)code[i]) >> 4] << digits[code[i] & 15];
+			}
+			sb << "\n";
+		}
+		int paramSetCount = spGetShaderParameterSetCount(result, shaderName.Buffer());
+		for (int i = 0; i < paramSetCount; i++)
+		{
+			auto paramSet = spGetShaderParameterSet(result, shaderName.Buffer(), i);
+			sb << "parameter set " << spParameterSetGetBindingName(paramSet) << " " << spParameterSetGetBindingIndex(paramSet)
+				<< " size " << spParameterSetGetBufferSize(paramSet) << "\n";
+			for (int j = 0; j < spParameterSetGetUniformFieldCount(paramSet); j++)
+			{
+				SpireUniformField field;
+				spParameterSetGetUniformField(paramSet, j, &field);
+				sb << "  " << field.type << " " << field.name << " @" << field.offset << "\n";
+			}
+		}
+	}
+	return sb.ProduceString();
+}
+
+// Compile `source` in a fresh context.
+static String compileToString(String source, String filePath, int target)
+{
+	auto ctx = spCreateCompilationContext(nullptr);
+	spSetCodeGenTarget(ctx, target);
+	spAddSearchPath(ctx, Path::GetDirectoryName(filePath).Buffer());
+	auto sink = spCreateDiagnosticSink(ctx);
+	auto result = spCompileShaderFromSource(ctx, source.Buffer(), filePath.Buffer(), sink);
+	String output = resultToString(result, sink);
+	spDestroyCompilationResult(result);
+	spDestroyDiagnosticSink(sink);
+	spDestroyCompilationContext(ctx);
+	return output;
+}
+
+bool runConcurrentCompileTest(
+	String	filePath,
+	int		target,
+	int		threadCount,
+	int		iterationCount)
+{
+	String source = File::ReadAllText(filePath);
+	String expectedOutput = compileToString(source, filePath, target);
+
+	List<String> actualOutputs;
+	actualOutputs.SetSize(threadCount * iterationCount);
+	List<std::thread> threads;
+	for (int t = 0; t < threadCount; t++)
+	{
+		threads.Add(std::thread([&, t]()
+		{
+			for (int i = 0; i < iterationCount; i++)
+				actualOutputs[t * iterationCount + i] = compileToString(source, filePath, target);
+		}));
+	}
+	for (auto & thread : threads)
+		thread.join();
+
+	for (auto & actualOutput : actualOutputs)
+	{
+		if (actualOutput != expectedOutput)
+		{
+			File::WriteAllText(filePath + ".concurrent.expected", expectedOutput);
+			File::WriteAllText(filePath + ".concurrent.actual", actualOutput);
+			return false;
+		}
+	}
+	return true;
+}
+
+bool runBatchCompileTest(
+	String			libraryPath,
+	String			shaderName,
+	List<String>	moduleNames,
+	int				target,
+	int				threadCount)
+{
+	auto ctx = spCreateCompilationContext(nullptr);
+	spSetCodeGenTarget(ctx, target);
+	auto sink = spCreateDiagnosticSink(ctx);
+	spLoadModuleLibrary(ctx, libraryPath.Buffer(), sink);
+	auto shader = spFindShader(ctx, shaderName.Buffer());
+	List<SpireModule*> modules;
+	for (auto & moduleName : moduleNames)
+		modules.Add(spFindModule(ctx, moduleName.Buffer()));
+	bool passed = shader != nullptr && !spDiagnosticSinkHasAnyErrors(sink) && !modules.Contains(nullptr);
+
+	// every module is requested several times so that identical requests run on different threads
+	const int repeatCount = 4;
+	List<SpireCompileRequest> requests;
+	List<SpireDiagnosticSink*> requestSinks;
+	List<String> expectedOutputs;
+	for (int i = 0; passed && i < repeatCount; i++)
+	{
+		for (auto & module : modules)
+		{
+			SpireCompileRequest request = {};
+			request.Shader = shader;
+			request.Args = &module;
+			request.ArgCount = 1;
+			request.Sink = spCreateDiagnosticSink(ctx);
+			requests.Add(request);
+			requestSinks.Add(request.Sink);
+			if (i == 0)
+			{
+				auto sinkForSerial = spCreateDiagnosticSink(ctx);
+				auto result = spCompileShader(ctx, shader, &module, 1, nullptr, sinkForSerial);
+				passed = passed && !spDiagnosticSinkHasAnyErrors(sinkForSerial);
+				expectedOutputs.Add(resultToString(result, sinkForSerial));
+				spDestroyCompilationResult(result);
+				spDestroyDiagnosticSink(sinkForSerial);
+			}
+		}
+	}
+
+	List<SpireCompilationResult*> results;
+	results.SetSize(requests.Count());
+	spCompileShaderBatch(ctx, requests.Buffer(), requests.Count(), threadCount, results.Buffer());
+	for (int i = 0; i < results.Count(); i++)
+	{
+		String actualOutput = resultToString(results[i], requestSinks[i]);
+		String & expectedOutput = expectedOutputs[i % modules.Count()];
+		if (passed && actualOutput != expectedOutput)
+		{
+			File::WriteAllText(libraryPath + ".batch.expected", expectedOutput);
+			File::WriteAllText(libraryPath + ".batch.actual", actualOutput);
+			passed = false;
+		}
+		spDestroyCompilationResult(results[i]);
+		spDestroyDiagnosticSink(requestSinks[i]);
+	}
+
+	spDestroyDiagnosticSink(sink);
+	spDestroyCompilationContext(ctx);
+	return passed;
+}
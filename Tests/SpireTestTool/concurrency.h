@@ -0,0 +1,27 @@
+// concurrency.h
+
+#include "../../Source/CoreLib/LibIO.h"
+#include "../../Spire.h"
+
+// Flattens everything the compiler produced (diagnostics, stage code and parameter layout)
+// into one string for comparison.
+CoreLib::Basic::String resultToString(SpireCompilationResult * result, SpireDiagnosticSink * sink);
+
+// Compiles `filePath` for `target` once on the calling thread, then on `threadCount`
+// threads at once, each thread using its own compilation context for `iterationCount`
+// compiles. Returns true if every compile produced output identical to the serial one.
+bool runConcurrentCompileTest(
+	CoreLib::Basic::String	filePath,
+	int						target,
+	int						threadCount,
+	int						iterationCount);
+
+// Loads the module library at `libraryPath` and compiles the template shader `shaderName` with
+// each of `moduleNames` as its argument, both one by one and as one batch on `threadCount`
+// threads. Returns true if the batch results are identical to the serial ones.
+bool runBatchCompileTest(
+	CoreLib::Basic::String						libraryPath,
+	CoreLib::Basic::String						shaderName,
+	CoreLib::Basic::List<CoreLib::Basic::String>	moduleNames,
+	int											target,
+	int											threadCount);
@@ -0,0 +1,68 @@
+// cost.cpp
+
+#include "cost.h"
+#include "../../Spire.h"
+#include "../../Source/CoreLib/Tokenizer.h"
+#include <math.h>
+
+using namespace CoreLib::Basic;
+using namespace CoreLib::IO;
+using namespace CoreLib::Text;
+
+static bool IsClose(double v0, double v1)
+{
+	return fabs(v0 - v1) <= 1e-6 * (fabs(v0) + fabs(v1) + 1.0);
+}
+
+bool runCostEstimateTest(
+	String	filePath,
+	String	frequentWorld,
+	double	frequency,
+	int		target)
+{
+	auto ctx = spCreateCompilationContext(nullptr);
+	spSetCodeGenTarget(ctx, target);
+	auto sink = spCreateDiagnosticSink(ctx);
+	String source = File::ReadAllText(filePath);
+	auto result = spCompileShaderFromSource(ctx, source.Buffer(), filePath.Buffer(), sink);
+	SpireWorldCost cost;
+	bool passed = !spDiagnosticSinkHasAnyErrors(sink) &&
+		spGetShaderWorldCostCount(result, "NoSuchShader") == SPIRE_ERROR_INVALID_PARAMETER &&
+		spGetShaderWorldCost(result, nullptr, -1, &cost) == SPIRE_ERROR_INVALID_PARAMETER &&
+		spGetShaderWorldCost(result, nullptr, 0, nullptr) == SPIRE_ERROR_INVALID_PARAMETER;
+
+	// the shaders together use every kind of cost
+	double aluOps = 0.0, textureFetches = 0.0, interpolants = 0.0;
+	bool hasFrequentWorld = false;
+	List<char> buffer;
+	buffer.SetSize(spGetCompiledShaderNames(result, nullptr, 0) + 1);
+	spGetCompiledShaderNames(result, buffer.Buffer(), buffer.Count());
+	for (auto & shaderName : Split(buffer.Buffer(), '\n'))
+	{
+		if (!passed || shaderName.Length() == 0)
+			continue;
+		int worldCount = spGetShaderWorldCostCount(result, shaderName.Buffer());
+		passed = passed && worldCount > 0 && spGetShaderWorldCost(result, shaderName.Buffer(), worldCount, &cost) == SPIRE_ERROR_INVALID_PARAMETER;
+		double totalCost = 0.0;
+		for (int i = 0; i < worldCount && passed; i++)
+		{
+			passed = spGetShaderWorldCost(result, shaderName.Buffer(), i, &cost) == 0;
+			bool isFrequentWorld = frequentWorld == cost.WorldName;
+			hasFrequentWorld = hasFrequentWorld || isFrequentWorld;
+			passed = passed && cost.Frequency == (isFrequentWorld ? frequency : 1.0) &&
+				IsClose(cost.WeightedCost, cost.Frequency * (cost.AluOps + cost.TextureFetches * 4.0 + cost.Interpolants)) &&
+				cost.Instructions >= cost.AluOps + cost.TextureFetches;
+			aluOps += cost.AluOps;
+			textureFetches += cost.TextureFetches;
+			interpolants += cost.Interpolants;
+			totalCost += cost.WeightedCost;
+		}
+		passed = passed && IsClose(spGetShaderEstimatedCost(result, shaderName.Buffer()), totalCost);
+	}
+	passed = passed && hasFrequentWorld && aluOps > 0.0 && textureFetches > 0.0 && interpolants > 0.0;
+
+	spDestroyCompilationResult(result);
+	spDestroyDiagnosticSink(sink);
+	spDestroyCompilationContext(ctx);
+	return passed;
+}
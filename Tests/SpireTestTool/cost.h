@@ -0,0 +1,12 @@
+// cost.h
+
+#include "../../Source/CoreLib/LibIO.h"
+
+// Compiles `filePath` for the text target `target` in a fresh context. Returns true if every compiled shader
+// has a cost estimate for each of its worlds, with world `frequentWorld` weighted by `frequency` and the
+// other worlds by 1, and the estimated cost of the shader is the sum of the weighted costs of its worlds.
+bool runCostEstimateTest(
+	CoreLib::Basic::String	filePath,
+	CoreLib::Basic::String	frequentWorld,
+	double					frequency,
+	int						target);
@@ -0,0 +1,94 @@
+// explore.cpp
+
+#include "explore.h"
+#include "../../Source/SpireLib/SpireLib.h"
+
+using namespace CoreLib::Basic;
+using namespace CoreLib::IO;
+using namespace Spire::Compiler;
+
+template<typename T>
+static bool IsSameList(const List<T> & l0, const List<T> & l1)
+{
+	if (l0.Count() != l1.Count())
+		return false;
+	for (int i = 0; i < l0.Count(); i++)
+		if (!(l0[i] == l1[i]))
+			return false;
+	return true;
+}
+
+static bool IsSameExploration(ScheduleExplorationResult & e0, ScheduleExplorationResult & e1)
+{
+	if (e0.Schedules.Count() != e1.Schedules.Count() || !IsSameList(e0.ParetoFront, e1.ParetoFront) || !IsSameList(e0.CostNames, e1.CostNames) ||
+		e0.EvaluatedCount != e1.EvaluatedCount || e0.IsExhaustive != e1.IsExhaustive || e0.LowestCostSchedule != e1.LowestCostSchedule)
+		return false;
+	for (int i = 0; i < e0.Schedules.Count(); i++)
+	{
+		if (e0.Schedules[i].ToScheduleSource() != e1.Schedules[i].ToScheduleSource() || !IsSameList(e0.Schedules[i].Costs, e1.Schedules[i].Costs))
+			return false;
+	}
+	return true;
+}
+
+bool runScheduleExplorationTest(
+	String	filePath,
+	String	shaderName,
+	int		maxSchedules,
+	int		target)
+{
+	CompileResult results[2];
+	int threadCounts[2] = { 1, 8 };
+	for (int i = 0; i < 2; i++)
+	{
+		CompileOptions options;
+		options.Target = (CodeGenTarget)target;
+		options.Mode = CompilerMode::GenerateChoice;
+		options.SymbolToCompile = shaderName;
+		options.ExploreSchedules = true;
+		options.MaxExploredSchedules = maxSchedules;
+		options.ExplorationThreadCount = threadCounts[i];
+		SpireLib::CompileShaderSourceFromFile(results[i], filePath, options);
+		if (results[i].GetErrorCount() != 0 || !results[i].ExploredSchedules.ContainsKey(shaderName))
+			return false;
+	}
+	auto & exploration = results[0].ExploredSchedules[shaderName]();
+	bool passed = IsSameExploration(exploration, results[1].ExploredSchedules[shaderName]()) &&
+		exploration.ParetoFront.Count() != 0 && exploration.EvaluatedCount <= maxSchedules + 1;
+	for (auto & schedule : exploration.Schedules)
+		passed = passed && schedule.Costs.Count() == exploration.CostNames.Count();
+	if (!passed)
+		return false;
+
+	// the lowest cost schedule is not dominated by any other
+	auto getTotalCost = [](ExploredSchedule & schedule)
+	{
+		double cost = 0.0;
+		for (auto c : schedule.Costs)
+			cost += c;
+		return cost;
+	};
+	auto & lowestCostSchedule = exploration.Schedules[exploration.LowestCostSchedule];
+	if (!exploration.ParetoFront.Contains(exploration.LowestCostSchedule))
+		return false;
+	for (auto & schedule : exploration.Schedules)
+		if (getTotalCost(schedule) < getTotalCost(lowestCostSchedule))
+			return false;
+
+	// the first schedule is the one of the default values
+	auto & defaultSchedule = exploration.Schedules[0];
+	for (auto & choice : results[0].Choices)
+	{
+		String world;
+		if (defaultSchedule.Choices.TryGetValue(choice.ChoiceName, world) && world != choice.DefaultValue)
+			return false;
+	}
+
+	CompileResult result;
+	CompileOptions options;
+	options.Target = (CodeGenTarget)target;
+	options.SymbolToCompile = shaderName;
+	options.ScheduleSource = lowestCostSchedule.ToScheduleSource();
+	auto files = SpireLib::CompileShaderSourceFromFile(result, filePath, options);
+	return result.GetErrorCount() == 0 && files.Count() != 0;
+}
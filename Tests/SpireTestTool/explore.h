@@ -0,0 +1,13 @@
+// explore.h
+
+#include "../../Source/CoreLib/LibIO.h"
+
+// Explores the schedules of shader `shaderName` in `filePath` with one and with several threads, looking at
+// no more than `maxSchedules` of them. Returns true if both explorations give the same schedules and costs,
+// start with the default schedule, have a non-empty Pareto front that holds the schedule of the lowest total cost,
+// and that schedule compiles.
+bool runScheduleExplorationTest(
+	CoreLib::Basic::String	filePath,
+	CoreLib::Basic::String	shaderName,
+	int						maxSchedules,
+	int						target);
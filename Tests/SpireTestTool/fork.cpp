@@ -0,0 +1,99 @@
+// fork.cpp
+
+#include "fork.h"
+#include "concurrency.h"
+
+using namespace CoreLib::Basic;
+using namespace CoreLib::IO;
+
+// Compile `shaderName` with each of `moduleNames` in `env`. Compiling as a batch leaves the
+// environment itself unchanged. Modules the environment does not have are listed as missing.
+static String compileModulesToString(SpireCompilationContext * ctx, SpireCompilationEnvironment * env, String shaderName, List<String> & moduleNames)
+{
+	StringBuilder sb;
+	auto shader = spEnvFindShader(env, shaderName.Buffer());
+	if (!shader)
+		return "missing shader " + shaderName + "\n";
+	for (auto & moduleName : moduleNames)
+	{
+		auto module = spEnvFindModule(env, moduleName.Buffer());
+		if (!module)
+		{
+			sb << "missing module " << moduleName << "\n";
+			continue;
+		}
+		SpireCompileRequest request = {};
+		request.Shader = shader;
+		request.Args = &module;
+		request.ArgCount = 1;
+		request.Sink = spCreateDiagnosticSink(ctx);
+		SpireCompilationResult * result = nullptr;
+		spEnvCompileShaderBatch(env, &request, 1, 1, &result);
+		sb << "module " << moduleName << "\n" << resultToString(result, request.Sink);
+		spDestroyCompilationResult(result);
+		spDestroyDiagnosticSink(request.Sink);
+	}
+	return sb.ProduceString();
+}
+
+// Compile in a context that loads `libraryPaths` from scratch.
+static String compileFreshToString(List<String> libraryPaths, String shaderName, List<String> & moduleNames, int target)
+{
+	auto ctx = spCreateCompilationContext(nullptr);
+	spSetCodeGenTarget(ctx, target);
+	auto sink = spCreateDiagnosticSink(ctx);
+	for (auto & libraryPath : libraryPaths)
+		spLoadModuleLibrary(ctx, libraryPath.Buffer(), sink);
+	auto env = spGetCurrentEnvironment(ctx);
+	String output = compileModulesToString(ctx, env, shaderName, moduleNames);
+	spReleaseEnvironment(env);
+	spDestroyDiagnosticSink(sink);
+	spDestroyCompilationContext(ctx);
+	return output;
+}
+
+bool runEnvironmentForkTest(
+	String			libraryPath,
+	String			forkLibraryPath,
+	String			shaderName,
+	List<String>	moduleNames,
+	int				target)
+{
+	auto ctx = spCreateCompilationContext(nullptr);
+	spSetCodeGenTarget(ctx, target);
+	auto sink = spCreateDiagnosticSink(ctx);
+	spLoadModuleLibrary(ctx, libraryPath.Buffer(), sink);
+	auto origin = spGetCurrentEnvironment(ctx);
+	auto fork = spCreateEnvironment(ctx, origin);
+	spEnvLoadModuleLibrary(fork, forkLibraryPath.Buffer(), sink);
+	bool passed = !spDiagnosticSinkHasAnyErrors(sink);
+
+	List<String> libraryPaths;
+	libraryPaths.Add(libraryPath);
+	String expectedOriginOutput = compileFreshToString(libraryPaths, shaderName, moduleNames, target);
+	libraryPaths.Add(forkLibraryPath);
+	String expectedForkOutput = compileFreshToString(libraryPaths, shaderName, moduleNames, target);
+	// the fork library must add modules, or the fork could not be told apart from its origin
+	passed = passed && expectedOriginOutput != expectedForkOutput;
+
+	String actualForkOutput = compileModulesToString(ctx, fork, shaderName, moduleNames);
+	String actualOriginOutput = compileModulesToString(ctx, origin, shaderName, moduleNames);
+	if (passed && actualForkOutput != expectedForkOutput)
+	{
+		File::WriteAllText(forkLibraryPath + ".fork.expected", expectedForkOutput);
+		File::WriteAllText(forkLibraryPath + ".fork.actual", actualForkOutput);
+		passed = false;
+	}
+	if (passed && actualOriginOutput != expectedOriginOutput)
+	{
+		File::WriteAllText(libraryPath + ".fork.expected", expectedOriginOutput);
+		File::WriteAllText(libraryPath + ".fork.actual", actualOriginOutput);
+		passed = false;
+	}
+
+	spReleaseEnvironment(fork);
+	spReleaseEnvironment(origin);
+	spDestroyDiagnosticSink(sink);
+	spDestroyCompilationContext(ctx);
+	return passed;
+}
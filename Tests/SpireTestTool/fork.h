@@ -0,0 +1,14 @@
+// fork.h
+
+#include "../../Source/CoreLib/LibIO.h"
+
+// Loads the module library at `libraryPath` and forks the current environment, then loads
+// `forkLibraryPath` into the fork only. Returns true if the modules of `forkLibraryPath` are visible
+// in the fork but not in its origin, and compiling `shaderName` with each of `moduleNames` in either
+// environment gives the same output as in a context that loaded the same libraries from scratch.
+bool runEnvironmentForkTest(
+	CoreLib::Basic::String						libraryPath,
+	CoreLib::Basic::String						forkLibraryPath,
+	CoreLib::Basic::String						shaderName,
+	CoreLib::Basic::List<CoreLib::Basic::String>	moduleNames,
+	int											target);
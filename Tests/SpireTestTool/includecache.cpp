@@ -0,0 +1,129 @@
+// includecache.cpp
+
+#include "includecache.h"
+#include "concurrency.h"
+
+using namespace CoreLib::Basic;
+using namespace CoreLib::IO;
+
+static String compileSourceToString(SpireCompilationContext * ctx, String & source, String & sourcePath)
+{
+	auto sink = spCreateDiagnosticSink(ctx);
+	auto result = spCompileShaderFromSource(ctx, source.Buffer(), sourcePath.Buffer(), sink);
+	String output = resultToString(result, sink);
+	spDestroyCompilationResult(result);
+	spDestroyDiagnosticSink(sink);
+	return output;
+}
+
+bool runIncludeCacheTest(
+	String			sourcePath,
+	String			includeFilePath,
+	List<String>	includeVersionPaths,
+	int				target)
+{
+	String originalIncludeSource = File::ReadAllText(includeFilePath);
+	String source = File::ReadAllText(sourcePath);
+	auto ctx = spCreateCompilationContext(nullptr);
+	spSetCodeGenTarget(ctx, target);
+	// the included file is cached from here on
+	String previousOutput = compileSourceToString(ctx, source, sourcePath);
+	bool passed = true;
+
+	for (int i = 0; passed && i < includeVersionPaths.Count(); i++)
+	{
+		File::WriteAllText(includeFilePath, File::ReadAllText(includeVersionPaths[i]));
+
+		auto freshCtx = spCreateCompilationContext(nullptr);
+		spSetCodeGenTarget(freshCtx, target);
+		String expectedOutput = compileSourceToString(freshCtx, source, sourcePath);
+		spDestroyCompilationContext(freshCtx);
+
+		String actualOutput = compileSourceToString(ctx, source, sourcePath);
+		// every version changes the output, so an unchanged output means the file was not read again
+		if (actualOutput != expectedOutput || actualOutput == previousOutput)
+		{
+			File::WriteAllText(includeVersionPaths[i] + ".includecache.expected", expectedOutput);
+			File::WriteAllText(includeVersionPaths[i] + ".includecache.actual", actualOutput);
+			passed = false;
+		}
+		previousOutput = actualOutput;
+	}
+
+	spDestroyCompilationContext(ctx);
+	File::WriteAllText(includeFilePath, originalIncludeSource);
+	return passed;
+}
+
+bool runTokenCacheTest(
+	String	sourcePath,
+	String	macroName,
+	int		target)
+{
+	String source = File::ReadAllText(sourcePath);
+	auto ctx = spCreateCompilationContext(nullptr);
+	spSetCodeGenTarget(ctx, target);
+	List<String> outputs;
+	List<String> expectedOutputs;
+	for (int i = 0; i < 2; i++)
+	{
+		if (i == 1)
+			spAddPreprocessorDefine(ctx, macroName.Buffer(), "1");
+		outputs.Add(compileSourceToString(ctx, source, sourcePath));
+
+		auto freshCtx = spCreateCompilationContext(nullptr);
+		spSetCodeGenTarget(freshCtx, target);
+		if (i == 1)
+			spAddPreprocessorDefine(freshCtx, macroName.Buffer(), "1");
+		expectedOutputs.Add(compileSourceToString(freshCtx, source, sourcePath));
+		spDestroyCompilationContext(freshCtx);
+	}
+	spDestroyCompilationContext(ctx);
+
+	bool passed = outputs[0] != outputs[1];
+	for (int i = 0; i < 2; i++)
+	{
+		if (outputs[i] != expectedOutputs[i])
+		{
+			File::WriteAllText(sourcePath + ".tokencache.expected", expectedOutputs[i]);
+			File::WriteAllText(sourcePath + ".tokencache.actual", outputs[i]);
+			passed = false;
+		}
+	}
+	return passed;
+}
+
+bool runCompileUnitCacheTest(
+	String			sourcePath,
+	List<String>	macroNames,
+	List<String>	macroValues,
+	List<int>		sameAsFirst,
+	int				target)
+{
+	String source = File::ReadAllText(sourcePath);
+	auto ctx = spCreateCompilationContext(nullptr);
+	spSetCodeGenTarget(ctx, target);
+	List<String> outputs;
+	bool passed = true;
+	for (int i = 0; i <= macroNames.Count(); i++)
+	{
+		auto freshCtx = spCreateCompilationContext(nullptr);
+		spSetCodeGenTarget(freshCtx, target);
+		if (i > 0)
+			spAddPreprocessorDefine(ctx, macroNames[i - 1].Buffer(), macroValues[i - 1].Buffer());
+		for (int j = 0; j < i; j++)
+			spAddPreprocessorDefine(freshCtx, macroNames[j].Buffer(), macroValues[j].Buffer());
+		String expectedOutput = compileSourceToString(freshCtx, source, sourcePath);
+		spDestroyCompilationContext(freshCtx);
+
+		outputs.Add(compileSourceToString(ctx, source, sourcePath));
+		if (outputs[i] != expectedOutput || (i > 0 && (outputs[i] == outputs[0]) != (sameAsFirst[i - 1] != 0)))
+		{
+			File::WriteAllText(sourcePath + ".unitcache.expected", expectedOutput);
+			File::WriteAllText(sourcePath + ".unitcache.actual", outputs[i]);
+			passed = false;
+		}
+	}
+	spDestroyCompilationContext(ctx);
+	return passed;
+}
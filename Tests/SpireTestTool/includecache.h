@@ -0,0 +1,33 @@
+// includecache.h
+
+#include "../../Source/CoreLib/LibIO.h"
+
+// Compiles `sourcePath`, which includes the file `includeFilePath`, after writing each of
+// `includeVersionPaths` to that file in turn, all in one compilation context. Returns true if every
+// compile gives the same output as a fresh context, so that a cached include file is never used
+// after the file changed on disk. The file is restored afterwards.
+bool runIncludeCacheTest(
+	CoreLib::Basic::String						sourcePath,
+	CoreLib::Basic::String						includeFilePath,
+	CoreLib::Basic::List<CoreLib::Basic::String>	includeVersionPaths,
+	int											target);
+
+// Compiles `sourcePath` in one compilation context, then defines `macroName` in that context and
+// compiles it again, which preprocesses the tokens cached by the first compile. Returns true if both
+// compiles give the same output as a fresh context with the same definitions, and the outputs differ.
+bool runTokenCacheTest(
+	CoreLib::Basic::String	sourcePath,
+	CoreLib::Basic::String	macroName,
+	int						target);
+
+// Compiles `sourcePath` in one compilation context, then again after each definition of `macroNames[i]`
+// as `macroValues[i]`, so that files parsed under earlier definitions are reused when the new one does
+// not affect them. Returns true if every compile gives the same output as a fresh context with the same
+// definitions, and the output after definition `i` equals the first output exactly when `sameAsFirst[i]`
+// is nonzero.
+bool runCompileUnitCacheTest(
+	CoreLib::Basic::String						sourcePath,
+	CoreLib::Basic::List<CoreLib::Basic::String>	macroNames,
+	CoreLib::Basic::List<CoreLib::Basic::String>	macroValues,
+	CoreLib::Basic::List<int>					sameAsFirst,
+	int											target);
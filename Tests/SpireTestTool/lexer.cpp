@@ -0,0 +1,118 @@
+// lexer.cpp
+
+#include "lexer.h"
+#include "../../Source/CoreLib/Tokenizer.h"
+#include "../../Source/SpireCore/StdInclude.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+
+using namespace CoreLib::Basic;
+using namespace CoreLib::IO;
+using namespace CoreLib::Text;
+
+static bool IsSameToken(const Token & t0, const Token & t1)
+{
+	return t0.Type == t1.Type && t0.Content == t1.Content && t0.flags == t1.flags &&
+		t0.Position.Line == t1.Position.Line && t0.Position.Col == t1.Position.Col &&
+		t0.Position.Pos == t1.Position.Pos && t0.Position.FileName == t1.Position.FileName;
+}
+
+// returns the seconds taken to lex all of `texts` `repeatCount` times
+static double LexAll(List<String> & fileNames, List<String> & texts, int repeatCount, List<List<Token>> & tokens)
+{
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < repeatCount; i++)
+	{
+		tokens.Clear();
+		for (int j = 0; j < texts.Count(); j++)
+			tokens.Add(TokenizeText(fileNames[j], texts[j]));
+	}
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool runLexerBenchmark(
+	List<String>	filePaths,
+	int				repeatCount)
+{
+	List<String> fileNames, texts;
+	int byteCount = 0;
+	for (auto & filePath : filePaths)
+	{
+		fileNames.Add(filePath);
+		texts.Add(File::ReadAllText(filePath));
+	}
+	fileNames.Add("stdlib");
+	texts.Add(Spire::Compiler::SpireStdLib::GetCode());
+	for (auto & text : texts)
+		byteCount += text.Length();
+
+	List<List<Token>> scalarTokens, fastTokens;
+	TokenizerFastScan = false;
+	double scalarTime = LexAll(fileNames, texts, repeatCount, scalarTokens);
+	TokenizerFastScan = true;
+	double fastTime = LexAll(fileNames, texts, repeatCount, fastTokens);
+
+	double megabytes = byteCount * (double)repeatCount / (1024.0 * 1024.0);
+	printf("lexer: %.1f MB in %.1f ms one character at a time (%.0f MB/s), %.1f ms with block scanning (%.0f MB/s)\n",
+		megabytes, scalarTime * 1000.0, megabytes / scalarTime, fastTime * 1000.0, megabytes / fastTime);
+
+	for (int i = 0; i < texts.Count(); i++)
+	{
+		if (scalarTokens[i].Count() != fastTokens[i].Count())
+			return false;
+		for (int j = 0; j < scalarTokens[i].Count(); j++)
+			if (!IsSameToken(scalarTokens[i][j], fastTokens[i][j]))
+				return false;
+	}
+	return true;
+}
+
+static void WriteBytes(const String & fileName, const List<unsigned char> & bytes)
+{
+	FileStream stream(fileName, FileMode::Create);
+	stream.Write(bytes.Buffer(), bytes.Count());
+}
+
+bool runReadAllTextTest(
+	List<String>	filePaths)
+{
+	bool passed = true;
+	for (auto & filePath : filePaths)
+	{
+		auto bytes = File::ReadAllBytes(filePath);
+		List<List<unsigned char>> versions;
+		versions.Add(bytes);
+		List<unsigned char> crlf, bom, utf16;
+		bom.Add(0xEF); bom.Add(0xBB); bom.Add(0xBF);
+		utf16.Add(0xFF); utf16.Add(0xFE);
+		for (auto ch : bytes)
+		{
+			if (ch == '\n')
+				crlf.Add('\r');
+			crlf.Add(ch);
+			bom.Add(ch);
+			utf16.Add(ch);
+			utf16.Add(0);
+		}
+		versions.Add(crlf);
+		versions.Add(bom);
+		versions.Add(utf16);
+		String scratchPath = filePath + ".readtext";
+		for (auto & version : versions)
+		{
+			WriteBytes(scratchPath, version);
+			String expected;
+			{
+				StreamReader reader(new FileStream(scratchPath, FileMode::Open, FileAccess::Read, FileShare::ReadWrite));
+				expected = reader.ReadToEnd();
+			}
+			String actual = File::ReadAllText(scratchPath);
+			if (actual.Length() != expected.Length() || memcmp(actual.Buffer(), expected.Buffer(), actual.Length()) != 0)
+				passed = false;
+		}
+		remove(scratchPath.Buffer());
+	}
+	return passed;
+}
@@ -0,0 +1,16 @@
+// lexer.h
+
+#include "../../Source/CoreLib/LibIO.h"
+
+// Lexes each of `filePaths` and the standard library `repeatCount` times, once scanning one character
+// at a time and once with the block scanning fast path, and prints the time each took. Returns true if
+// both produce the same tokens.
+bool runLexerBenchmark(
+	CoreLib::Basic::List<CoreLib::Basic::String>	filePaths,
+	int												repeatCount);
+
+// Writes each of `filePaths` to a scratch file as is, with "\r\n" line breaks, with a UTF-8 byte order
+// mark and as UTF-16. Returns true if File::ReadAllText reads every version into the same text as
+// StreamReader does.
+bool runReadAllTextTest(
+	CoreLib::Basic::List<CoreLib::Basic::String>	filePaths);
@@ -6,6 +6,17 @@ using namespace CoreLib::Basic;
 using namespace CoreLib::IO;
 
 #include "os.h"
+#include "concurrency.h"
+#include "reload.h"
+#include "shaderlib.h"
+#include "stats.h"
+#include "specialize.h"
+#include "fork.h"
+#include "includecache.h"
+#include "lexer.h"
+#include "explore.h"
+#include "cost.h"
+#include "../../Spire.h"
 
 #include <assert.h>
 #include <stdio.h>
@@ -113,14 +124,14 @@ struct TestContext
 	int failedTestCount;
 };
 
-void runTest(
+// Counts the result of one test and prints it with its description.
+void reportTest(
 	TestContext*	context,
-	String			filePath)
+	bool			passed,
+	String			description)
 {
-
 	context->totalTestCount++;
-	TestResult result = runTestImpl(filePath);
-	if (result == kTestResult_Pass)
+	if (passed)
 	{
 		printf("passed");
 		context->passedTestCount++;
@@ -131,7 +142,23 @@ void runTest(
 		context->failedTestCount++;
 	}
 
-	printf(" test: '%S'\n", filePath.ToWString());
+	printf(" test: '%S'\n", description.ToWString());
+}
+
+// Describes a test that compiles a file for one code generation target.
+String describeTest(
+	String	action,
+	String	filePath,
+	int		target)
+{
+	return action + " of " + filePath + " (target " + String(target) + ")";
+}
+
+void runTest(
+	TestContext*	context,
+	String			filePath)
+{
+	reportTest(context, runTestImpl(filePath) == kTestResult_Pass, filePath);
 }
 
 void runTestsInDirectory(
@@ -159,6 +186,121 @@ int main(
 	runTestsInDirectory(&context, "Tests/Diagnostics/");
 	runTestsInDirectory(&context, "Tests/Preprocessor/");
 
+	// separate compilation contexts on separate threads must produce the same output as a serial compile
+	reportTest(&context, runConcurrentCompileTest("Tests/HLSLCodeGen/shader1.spire", SPIRE_HLSL, 8, 4),
+		describeTest("concurrent compile", "Tests/HLSLCodeGen/shader1.spire", SPIRE_HLSL));
+	reportTest(&context, runConcurrentCompileTest("Tests/HLSLCodeGen/shader1.spire", SPIRE_SPIRV, 8, 4),
+		describeTest("concurrent compile", "Tests/HLSLCodeGen/shader1.spire", SPIRE_SPIRV));
+
+	List<String> materials;
+	materials.Add("FlatMaterial");
+	materials.Add("TexturedMaterial");
+	materials.Add("LitMaterial");
+	reportTest(&context, runBatchCompileTest("Tests/Concurrency/batch-library.spire", "BatchShader", materials, SPIRE_HLSL, 4),
+		describeTest("batch compile", "Tests/Concurrency/batch-library.spire", SPIRE_HLSL));
+	reportTest(&context, runBatchCompileTest("Tests/Concurrency/batch-library.spire", "BatchShader", materials, SPIRE_SPIRV, 4),
+		describeTest("batch compile", "Tests/Concurrency/batch-library.spire", SPIRE_SPIRV));
+
+	// reloading one changed file must give the same result as loading the library from scratch
+	List<String> materialVersions;
+	materialVersions.Add("Tests/Reload/reload-material-2.spireh");
+	materialVersions.Add("Tests/Reload/reload-material-3.spireh");
+	List<int> checkedShaderCounts;
+	checkedShaderCounts.Add(3); // BaseMaterial, TintedMaterial and their user ShadedMaterial
+	checkedShaderCounts.Add(4); // the function in version 3 makes every module of the library be checked again
+	List<String> reloadMaterials;
+	reloadMaterials.Add("ShadedMaterial");
+	reloadMaterials.Add("UnlitMaterial");
+	reloadMaterials.Add("TintedMaterial");
+	reportTest(&context, runModuleReloadTest("Tests/Reload/reload-library.spire", "Tests/Reload/reload-material.spireh", materialVersions,
+		checkedShaderCounts, "ReloadShader", reloadMaterials, SPIRE_HLSL),
+		describeTest("reload", "Tests/Reload/reload-material.spireh", SPIRE_HLSL));
+
+	// a cached include file is read again once it changes on disk, even if its size stays the same
+	List<String> includeVersions;
+	includeVersions.Add("Tests/IncludeCache/include-cache-common-2.spireh");
+	includeVersions.Add("Tests/IncludeCache/include-cache-common-3.spireh");
+	reportTest(&context, runIncludeCacheTest("Tests/IncludeCache/include-cache-shader.spire", "Tests/IncludeCache/include-cache-common.spireh",
+		includeVersions, SPIRE_HLSL),
+		describeTest("include cache", "Tests/IncludeCache/include-cache-common.spireh", SPIRE_HLSL));
+
+	// preprocessing cached tokens again under a new macro definition gives the same result as lexing them anew
+	reportTest(&context, runTokenCacheTest("Tests/IncludeCache/include-cache-shader.spire", "INCLUDE_CACHE_HALF_TINT", SPIRE_HLSL),
+		describeTest("token cache", "Tests/IncludeCache/include-cache-shader.spire", SPIRE_HLSL));
+
+	// a parsed file is reused under definitions of macros it does not look at, and parsed again otherwise
+	List<String> unitCacheMacros, unitCacheValues;
+	List<int> unitCacheSameAsFirst;
+	unitCacheMacros.Add("UNIT_CACHE_UNUSED");
+	unitCacheValues.Add("1");
+	unitCacheSameAsFirst.Add(1);
+	unitCacheMacros.Add("UNIT_CACHE_TINT_LEVEL");
+	unitCacheValues.Add("2");
+	unitCacheSameAsFirst.Add(0);
+	unitCacheMacros.Add("UNIT_CACHE_TINT_LEVEL");
+	unitCacheValues.Add("1");
+	unitCacheSameAsFirst.Add(1);
+	reportTest(&context, runCompileUnitCacheTest("Tests/IncludeCache/unit-cache-shader.spire", unitCacheMacros, unitCacheValues,
+		unitCacheSameAsFirst, SPIRE_HLSL),
+		describeTest("compile unit cache", "Tests/IncludeCache/unit-cache-shader.spire", SPIRE_HLSL));
+
+	// a forked environment sees what its origin loaded, but not the other way round
+	List<String> forkMaterials = materials;
+	forkMaterials.Add("EmissiveMaterial");
+	forkMaterials.Add("TintedLitMaterial");
+	reportTest(&context, runEnvironmentForkTest("Tests/Concurrency/batch-library.spire", "Tests/Fork/fork-materials.spire", "BatchShader", forkMaterials, SPIRE_HLSL),
+		describeTest("environment fork", "Tests/Fork/fork-materials.spire", SPIRE_HLSL));
+
+	// specializing a module twice with the same values gives the same module
+	List<List<int>> switchValues;
+	for (int mode = 0; mode < 3; mode++)
+	{
+		for (int inverted = 0; inverted < 2; inverted++)
+		{
+			List<int> values;
+			values.Add(mode);
+			values.Add(inverted);
+			switchValues.Add(values);
+		}
+	}
+	reportTest(&context, runModuleSpecializationTest("Tests/Concurrency/batch-library.spire", "Tests/Specialize/specialize-materials.spire",
+		"BatchShader", "SwitchMaterial", switchValues, SPIRE_HLSL),
+		describeTest("specialization", "SwitchMaterial", SPIRE_HLSL));
+
+	// the binary .cse form must load back to the same shader library as the text form
+	reportTest(&context, runShaderLibFormatTest("Tests/HLSLCodeGen/shader1.spire", SPIRE_HLSL),
+		describeTest("shader library formats", "Tests/HLSLCodeGen/shader1.spire", SPIRE_HLSL));
+	reportTest(&context, runShaderLibFormatTest("Tests/HLSLCodeGen/shader1.spire", SPIRE_SPIRV),
+		describeTest("shader library formats", "Tests/HLSLCodeGen/shader1.spire", SPIRE_SPIRV));
+
+	// every phase of a compile is timed, and what it produced counted
+	reportTest(&context, runCompilationStatsTest("Tests/HLSLCodeGen/shader1.spire", SPIRE_HLSL),
+		describeTest("compilation stats", "Tests/HLSLCodeGen/shader1.spire", SPIRE_HLSL));
+
+	// exploring the schedules of a shader gives the same result on any number of threads
+	reportTest(&context, runScheduleExplorationTest("Tests/HLSLCodeGen/shader1.spire", "DeferredLighting", 48, SPIRE_HLSL),
+		describeTest("schedule exploration", "Tests/HLSLCodeGen/shader1.spire", SPIRE_HLSL));
+
+	// the estimated costs of a shader are weighted by the frequency declared on its pipeline
+	reportTest(&context, runCostEstimateTest("Tests/Cost/cost-shader.spire", "Fragment", 16.0, SPIRE_HLSL),
+		describeTest("cost estimates", "Tests/Cost/cost-shader.spire", SPIRE_HLSL));
+
+	// lexing with the block scanning fast path gives the same tokens as lexing one character at a time
+	List<String> lexerCorpus;
+	lexerCorpus.Add("Tests/FrontEnd/lexer-comments.spire");
+	lexerCorpus.Add("Tests/FrontEnd/parser-decls.spire");
+	lexerCorpus.Add("Tests/Preprocessor/define-function-like.spire");
+	lexerCorpus.Add("Tests/HLSLCodeGen/StandardPipeline.spire");
+	lexerCorpus.Add("Tests/HLSLCodeGen/Utils.spire");
+	lexerCorpus.Add("Tests/HLSLCodeGen/shader1.spire");
+	lexerCorpus.Add("Tests/Concurrency/batch-library.spire");
+	reportTest(&context, runLexerBenchmark(lexerCorpus, 20),
+		String("lexer fast path over ") + String(lexerCorpus.Count()) + " files and the standard library");
+
+	// source files read through a file mapping give the same text as StreamReader, in every encoding
+	reportTest(&context, runReadAllTextTest(lexerCorpus),
+		String("reading ") + String(lexerCorpus.Count()) + " source files through a file mapping");
+
 	if (!context.totalTestCount)
 	{
 		printf("no tests run");
@@ -0,0 +1,77 @@
+// reload.cpp
+
+#include "reload.h"
+#include "concurrency.h"
+
+using namespace CoreLib::Basic;
+using namespace CoreLib::IO;
+
+// Compile `shaderName` with each of `moduleNames` in `ctx`. Modules the context does not have are
+// listed as missing, so that contexts with different modules compare as different.
+static String compileModulesToString(SpireCompilationContext * ctx, String shaderName, List<String> & moduleNames)
+{
+	StringBuilder sb;
+	auto shader = spFindShader(ctx, shaderName.Buffer());
+	if (!shader)
+		return "missing shader " + shaderName + "\n";
+	for (auto & moduleName : moduleNames)
+	{
+		auto module = spFindModule(ctx, moduleName.Buffer());
+		if (!module)
+		{
+			sb << "missing module " << moduleName << "\n";
+			continue;
+		}
+		auto sink = spCreateDiagnosticSink(ctx);
+		auto result = spCompileShader(ctx, shader, &module, 1, nullptr, sink);
+		sb << "module " << moduleName << "\n" << resultToString(result, sink);
+		spDestroyCompilationResult(result);
+		spDestroyDiagnosticSink(sink);
+	}
+	return sb.ProduceString();
+}
+
+bool runModuleReloadTest(
+	String			libraryPath,
+	String			moduleFilePath,
+	List<String>	moduleVersionPaths,
+	List<int>		checkedShaderCounts,
+	String			shaderName,
+	List<String>	moduleNames,
+	int				target)
+{
+	String originalModuleSource = File::ReadAllText(moduleFilePath);
+	auto ctx = spCreateCompilationContext(nullptr);
+	spSetCodeGenTarget(ctx, target);
+	auto sink = spCreateDiagnosticSink(ctx);
+	spLoadModuleLibrary(ctx, libraryPath.Buffer(), sink);
+	bool passed = !spDiagnosticSinkHasAnyErrors(sink);
+
+	for (int i = 0; passed && i < moduleVersionPaths.Count(); i++)
+	{
+		File::WriteAllText(moduleFilePath, File::ReadAllText(moduleVersionPaths[i]));
+		int checkedShaderCount = spReloadModuleFile(ctx, moduleFilePath.Buffer(), sink);
+		passed = !spDiagnosticSinkHasAnyErrors(sink) && checkedShaderCount == checkedShaderCounts[i];
+
+		auto freshCtx = spCreateCompilationContext(nullptr);
+		spSetCodeGenTarget(freshCtx, target);
+		auto freshSink = spCreateDiagnosticSink(freshCtx);
+		spLoadModuleLibrary(freshCtx, libraryPath.Buffer(), freshSink);
+		String expectedOutput = compileModulesToString(freshCtx, shaderName, moduleNames);
+		spDestroyDiagnosticSink(freshSink);
+		spDestroyCompilationContext(freshCtx);
+
+		String actualOutput = compileModulesToString(ctx, shaderName, moduleNames);
+		if (passed && actualOutput != expectedOutput)
+		{
+			File::WriteAllText(moduleVersionPaths[i] + ".reload.expected", expectedOutput);
+			File::WriteAllText(moduleVersionPaths[i] + ".reload.actual", actualOutput);
+			passed = false;
+		}
+	}
+
+	spDestroyDiagnosticSink(sink);
+	spDestroyCompilationContext(ctx);
+	File::WriteAllText(moduleFilePath, originalModuleSource);
+	return passed;
+}
@@ -0,0 +1,17 @@
+// reload.h
+
+#include "../../Source/CoreLib/LibIO.h"
+
+// Loads the module library at `libraryPath`, which uses the file `moduleFilePath`. Then writes each
+// of `moduleVersionPaths` to that file in turn and reloads just that file, expecting
+// `checkedShaderCounts[i]` shaders to be checked again. Returns true if, after every reload, compiling
+// `shaderName` with each of `moduleNames` gives the same output as in a context that loaded the
+// library from scratch. The file is restored afterwards.
+bool runModuleReloadTest(
+	CoreLib::Basic::String						libraryPath,
+	CoreLib::Basic::String						moduleFilePath,
+	CoreLib::Basic::List<CoreLib::Basic::String>	moduleVersionPaths,
+	CoreLib::Basic::List<int>					checkedShaderCounts,
+	CoreLib::Basic::String						shaderName,
+	CoreLib::Basic::List<CoreLib::Basic::String>	moduleNames,
+	int											target);
@@ -0,0 +1,55 @@
+// shaderlib.cpp
+
+#include "shaderlib.h"
+#include "../../Source/SpireLib/SpireLib.h"
+
+using namespace CoreLib::Basic;
+using namespace CoreLib::IO;
+using namespace Spire::Compiler;
+
+bool runShaderLibFormatTest(
+	String	filePath,
+	int		target)
+{
+	CompileResult result;
+	CompileOptions options;
+	options.Target = (CodeGenTarget)target;
+	auto files = SpireLib::CompileShaderSourceFromFile(result, filePath, options);
+	bool passed = result.GetErrorCount() == 0 && files.Count() != 0;
+	for (auto & file : files)
+	{
+		if (!passed)
+			break;
+		auto textFileName = filePath + "." + file.MetaData.ShaderName + ".text.cse";
+		auto binaryFileName = filePath + "." + file.MetaData.ShaderName + ".binary.cse";
+		file.SaveToFile(textFileName);
+		file.SaveToBinaryFile(binaryFileName);
+
+		// reading the text form back adds line breaks to the stage code, so only the binary form is compared
+		// in full; the text file must still be recognized as text
+		SpireLib::ShaderLib textLib(textFileName), binaryLib(binaryFileName);
+		String expected = file.ToString();
+		passed = binaryLib.ToString() == expected && textLib.MetaData.ShaderName == file.MetaData.ShaderName &&
+			textLib.Sources.Count() == file.Sources.Count() && textLib.MetaData.ParameterSets.Count() == file.MetaData.ParameterSets.Count();
+		if (!passed)
+		{
+			File::WriteAllText(filePath + ".shaderlib.expected", expected);
+			File::WriteAllText(filePath + ".shaderlib.actual", binaryLib.ToString());
+		}
+
+		List<unsigned char> buffer;
+		file.ToBinary(buffer);
+		try
+		{
+			SpireLib::ShaderLibFile truncated;
+			truncated.FromBinary(buffer.Buffer(), buffer.Count() - 1);
+			passed = false;
+		}
+		catch (const IOException &)
+		{
+		}
+		remove(textFileName.Buffer());
+		remove(binaryFileName.Buffer());
+	}
+	return passed;
+}
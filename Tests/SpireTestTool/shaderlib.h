@@ -0,0 +1,10 @@
+// shaderlib.h
+
+#include "../../Source/CoreLib/LibIO.h"
+
+// Compiles `filePath` for `target` into shader library files and saves each of them in both the
+// text and the binary .cse form next to `filePath`. Returns true if loading the binary file gives back
+// the same shader library, the text file still loads as text, and truncated binary data is rejected.
+bool runShaderLibFormatTest(
+	CoreLib::Basic::String	filePath,
+	int						target);
@@ -0,0 +1,76 @@
+// specialize.cpp
+
+#include "specialize.h"
+#include "../../Spire.h"
+
+using namespace CoreLib::Basic;
+using namespace CoreLib::IO;
+
+bool runModuleSpecializationTest(
+	String				libraryPath,
+	String				materialLibraryPath,
+	String				shaderName,
+	String				moduleName,
+	List<List<int>>		valueSets,
+	int					target)
+{
+	auto ctx = spCreateCompilationContext(nullptr);
+	spSetCodeGenTarget(ctx, target);
+	auto sink = spCreateDiagnosticSink(ctx);
+	spLoadModuleLibrary(ctx, libraryPath.Buffer(), sink);
+	spLoadModuleLibrary(ctx, materialLibraryPath.Buffer(), sink);
+	auto shader = spFindShader(ctx, shaderName.Buffer());
+	auto module = spFindModule(ctx, moduleName.Buffer());
+	bool passed = shader != nullptr && module != nullptr && !spDiagnosticSinkHasAnyErrors(sink);
+
+	List<SpireModule*> specializedModules;
+	for (int i = 0; passed && i < valueSets.Count(); i++)
+	{
+		auto & values = valueSets[i];
+		auto specialized = spSpecializeModule(ctx, module, values.Buffer(), values.Count(), sink);
+		// the second request must be answered from the specialization table
+		passed = specialized != nullptr && !specializedModules.Contains(specialized) &&
+			spSpecializeModule(ctx, module, values.Buffer(), values.Count(), sink) == specialized &&
+			spModuleGetParameterCount(specialized) == spModuleGetParameterCount(module);
+		if (!passed)
+			break;
+		specializedModules.Add(specialized);
+
+		auto compileSink = spCreateDiagnosticSink(ctx);
+		auto result = spCompileShader(ctx, shader, &specialized, 1, nullptr, compileSink);
+		passed = result != nullptr && !spDiagnosticSinkHasAnyErrors(compileSink);
+		spDestroyCompilationResult(result);
+		spDestroyDiagnosticSink(compileSink);
+	}
+	// a wrong number of values is rejected
+	if (passed && valueSets.Count())
+		passed = spSpecializeModule(ctx, module, valueSets[0].Buffer(), valueSets[0].Count() - 1, sink) == nullptr;
+
+	// reloading drops the specializations of the reloaded modules, so the same values can be specialized again:
+	// the material library is reloaded on its own, and the main library takes every loaded file with it
+	String reloadPaths[] = { materialLibraryPath, libraryPath };
+	for (auto & reloadPath : reloadPaths)
+	{
+		if (!passed || !valueSets.Count())
+			break;
+		spReloadModuleFile(ctx, reloadPath.Buffer(), sink);
+		module = spFindModule(ctx, moduleName.Buffer());
+		shader = spFindShader(ctx, shaderName.Buffer());
+		auto & values = valueSets[0];
+		auto specialized = module ? spSpecializeModule(ctx, module, values.Buffer(), values.Count(), sink) : nullptr;
+		passed = shader != nullptr && specialized != nullptr && !spDiagnosticSinkHasAnyErrors(sink) &&
+			spSpecializeModule(ctx, module, values.Buffer(), values.Count(), sink) == specialized;
+		if (!passed)
+			break;
+
+		auto compileSink = spCreateDiagnosticSink(ctx);
+		auto result = spCompileShader(ctx, shader, &specialized, 1, nullptr, compileSink);
+		passed = result != nullptr && !spDiagnosticSinkHasAnyErrors(compileSink);
+		spDestroyCompilationResult(result);
+		spDestroyDiagnosticSink(compileSink);
+	}
+
+	spDestroyDiagnosticSink(sink);
+	spDestroyCompilationContext(ctx);
+	return passed;
+}
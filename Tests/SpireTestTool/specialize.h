@@ -0,0 +1,15 @@
+// specialize.h
+
+#include "../../Source/CoreLib/LibIO.h"
+
+// Loads the module libraries at `libraryPath` and `materialLibraryPath` and specializes the module
+// `moduleName` with each of `valueSets`. Returns true if specializing with the same values twice gives
+// the same module, different values give different modules with the parameters of the original, and
+// compiling `shaderName` with each of them succeeds, also after each library is reloaded.
+bool runModuleSpecializationTest(
+	CoreLib::Basic::String							libraryPath,
+	CoreLib::Basic::String							materialLibraryPath,
+	CoreLib::Basic::String							shaderName,
+	CoreLib::Basic::String							moduleName,
+	CoreLib::Basic::List<CoreLib::Basic::List<int>>	valueSets,
+	int												target);
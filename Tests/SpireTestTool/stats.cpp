@@ -0,0 +1,60 @@
+// stats.cpp
+
+#include "stats.h"
+#include "../../Spire.h"
+#include "../../Source/CoreLib/Tokenizer.h"
+
+using namespace CoreLib::Basic;
+using namespace CoreLib::IO;
+using namespace CoreLib::Text;
+
+bool runCompilationStatsTest(
+	String	filePath,
+	int		target)
+{
+	auto ctx = spCreateCompilationContext(nullptr);
+	spSetCodeGenTarget(ctx, target);
+	auto sink = spCreateDiagnosticSink(ctx);
+	String source = File::ReadAllText(filePath);
+	auto result = spCompileShaderFromSource(ctx, source.Buffer(), filePath.Buffer(), sink);
+	SpireCompilationStats stats;
+	bool passed = !spDiagnosticSinkHasAnyErrors(sink) && spGetCompilationStats(result, &stats) == 0 &&
+		spGetCompilationStats(result, nullptr) == SPIRE_ERROR_INVALID_PARAMETER;
+
+	if (passed)
+	{
+		double phaseTimes[] = { stats.PreprocessTime, stats.ParseTime, stats.SemanticCheckTime, stats.ShaderClosureTime,
+			stats.VariantIRTime, stats.ImplicitImportTime, stats.ILCodeGenTime, stats.TargetCodeGenTime };
+		for (auto time : phaseTimes)
+			passed = passed && time > 0.0;
+		passed = passed && stats.TokenCount > 0 && stats.SyntaxNodeCount > 0 && stats.ILInstructionCount > 0 && !stats.LoadedFromCache;
+
+		int outputBytes = 0;
+		List<char> buffer;
+		buffer.SetSize(spGetCompiledShaderNames(result, nullptr, 0) + 1);
+		spGetCompiledShaderNames(result, buffer.Buffer(), buffer.Count());
+		for (auto & shaderName : Split(buffer.Buffer(), '\n'))
+		{
+			if (shaderName.Length() == 0)
+				continue;
+			List<char> stageNames;
+			stageNames.SetSize(spGetCompiledShaderStageNames(result, shaderName.Buffer(), nullptr, 0) + 1);
+			spGetCompiledShaderStageNames(result, shaderName.Buffer(), stageNames.Buffer(), stageNames.Count());
+			for (auto & stageName : Split(stageNames.Buffer(), '\n'))
+			{
+				if (stageName.Length() == 0)
+					continue;
+				// the length of text code includes the terminating zero
+				int length = 0;
+				spGetShaderStageSource(result, shaderName.Buffer(), stageName.Buffer(), &length);
+				outputBytes += length - 1;
+			}
+		}
+		passed = passed && outputBytes > 0 && stats.OutputBytes == outputBytes;
+	}
+
+	spDestroyCompilationResult(result);
+	spDestroyDiagnosticSink(sink);
+	spDestroyCompilationContext(ctx);
+	return passed;
+}
@@ -0,0 +1,10 @@
+// stats.h
+
+#include "../../Source/CoreLib/LibIO.h"
+
+// Compiles `filePath` for the text target `target` in a fresh context. Returns true if the compile
+// statistics report time in every phase, non-zero token, syntax node and IL instruction counts, and
+// an output size equal to the size of the code of all compiled stages.
+bool runCompilationStatsTest(
+	CoreLib::Basic::String	filePath,
+	int						target);